@@ -38,9 +38,11 @@ class ArticulatedBody : public virtual Ravelin::ArticulatedBodyd, public virtual
     virtual void ode(double t, double dt, void* data, Ravelin::SharedVectorNd& dx);
 //    virtual unsigned num_generalized_coordinates(Ravelin::DynamicBodyd::GeneralizedCoordinateType gctype) const;
 
+    void update_limit_dofs() const;
+
     /// Finds (joint) limit constraints 
     template <class OutputIterator>
-    OutputIterator find_limit_constraints(OutputIterator begin) const;
+    OutputIterator find_limit_constraints(OutputIterator begin, double dt = 0.0) const;
 
     /// Gets shared pointer to this object as type ArticulatedBody
     ArticulatedBodyPtr get_this() { return boost::dynamic_pointer_cast<ArticulatedBody>(Ravelin::ArticulatedBodyd::shared_from_this()); }
@@ -60,6 +62,17 @@ class ArticulatedBody : public virtual Ravelin::ArticulatedBodyd, public virtual
     // temporary variables
     Ravelin::VectorNd _dq;
 
+    bool limit_dofs_current() const;
+
+    // the finite joint limits, keyed by (joint, DOF, upper/lower) (flat arrays)
+    mutable std::vector<JointPtr> _limit_joints;
+    mutable std::vector<unsigned> _limit_dofs;
+    mutable std::vector<bool> _limit_upper;
+
+    // the joints and their numbers of DOFs when the finite limits were determined
+    mutable std::vector<boost::shared_ptr<Ravelin::Jointd> > _limit_joint_set;
+    mutable std::vector<unsigned> _limit_joint_ndof;
+
 }; // end class
 
 #include "ArticulatedBody.inl"
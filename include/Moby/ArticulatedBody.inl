@@ -1,42 +1,67 @@
 /****************************************************************************
  * Copyright 2011 Evan Drumwright
- * This library is distributed under the terms of the Apache V2.0 
+ * This library is distributed under the terms of the Apache V2.0
  * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
  ****************************************************************************/
 
-/// Gets joint limit constraints 
+/// Gets joint limit constraints
+/**
+ * A limit constraint is generated for every finite limit that a DOF is at or
+ * past. If dt > 0, a speculative limit constraint is also generated for
+ * every limit that the DOF would cross were it to move with its current
+ * velocity for dt; the constraint's velocity is offset by gap / dt, so that
+ * it permits the DOF to reach (but not pass) the limit over dt rather than
+ * stopping it immediately. Constraints are generated in the order of the
+ * joints and their DOFs, with the upper limit of a DOF before its lower
+ * limit.
+ * \param dt the lookahead time (use zero to generate only constraints for
+ *        limits that have already been reached)
+ */
 template <class OutputIterator>
-OutputIterator ArticulatedBody::find_limit_constraints(OutputIterator output_begin) const 
+OutputIterator ArticulatedBody::find_limit_constraints(OutputIterator output_begin, double dt) const
 {
-  for (unsigned i=0; i< _joints.size(); i++)
+  // determine the finite limits, if necessary
+  if (!limit_dofs_current())
+    update_limit_dofs();
+
+  for (unsigned i=0; i< _limit_dofs.size(); i++)
   {
-    boost::shared_ptr<Joint> joint = boost::dynamic_pointer_cast<Joint>(_joints[i]);
-    for (unsigned j=0; j< joint->num_dof(); j++)
-    {
+    const JointPtr& joint = _limit_joints[i];
+    const unsigned j = _limit_dofs[i];
+    const bool UPPER = _limit_upper[i];
 
-      // get the current joint position and velocity
-      double q = joint->q[j] + joint->_q_tare[j];
+    // get the current joint position and velocity
+    double q = joint->q[j] + joint->_q_tare[j];
+    double qd = joint->qd[j];
 
-      // setup an constraint for this joint/dof in case we need it
-      UnilateralConstraint e;
-      e.constraint_type = UnilateralConstraint::eLimit;
-      e.limit_joint = joint;
-      e.limit_dof = j;
-      e.limit_epsilon = joint->limit_restitution;
+    // get the (signed) distance to the limit and the speed toward it; the
+    // limit is read again, so that a limit made infinite is never active
+    double gap = (UPPER) ? joint->hilimit[j] - q : q - joint->lolimit[j];
+    double approach_vel = (UPPER) ? qd : -qd;
+
+    // see whether the limit is to be processed
+    if (gap > 0.0 && !(dt > 0.0 && gap < approach_vel*dt))
+      continue;
 
-      // check whether we are already at a limit
-      if (q >= joint->hilimit[j])
-      {
-        // add constraint for upper limit
-        e.limit_upper = true;
-        *output_begin++ = e;
-      }
-      if (q <= joint->lolimit[j])
-      {
-        e.limit_upper = false;
-        *output_begin++ = e;
-      }
+    // setup a constraint for this joint/dof/limit
+    UnilateralConstraint e;
+    e.constraint_type = UnilateralConstraint::eLimit;
+    e.limit_joint = joint;
+    e.limit_dof = j;
+    e.limit_upper = UPPER;
+    e.signed_violation = gap;
+    if (gap > 0.0)
+    {
+      // speculative constraint: no restitution
+      e.limit_epsilon = 0.0;
+      e.limit_speculative_vel = gap/dt;
+    }
+    else
+    {
+      e.limit_epsilon = joint->limit_restitution;
+      e.limit_speculative_vel = 0.0;
     }
+    *output_begin++ = e;
   }
 
   return output_begin;
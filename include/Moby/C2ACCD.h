@@ -1,6 +1,6 @@
 /****************************************************************************
  * Copyright 2010 Evan Drumwright
- * This library is distributed under the terms of the Apache V2.0 
+ * This library is distributed under the terms of the Apache V2.0
  * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
  ****************************************************************************/
 
@@ -8,102 +8,128 @@
 #define _C2A_CCD_H
 
 #include <list>
-#include <set>
 #include <map>
+#include <vector>
 #include <boost/shared_ptr.hpp>
-#include <Ravelin/sorted_pair>
-#include <Moby/Log.h>
-#include <Moby/CollisionDetection.h>
-#include <Moby/ThickTriangle.h>
-#include <Moby/BV.h>
-#include <Moby/Integrator.h>
+#include <Ravelin/Transform3d.h>
+#include <Moby/IndexedTriArray.h>
+#include <Moby/TriangleMeshPrimitive.h>
+#include <Moby/CCD.h>
 
 namespace Moby {
 
-class RigidBody;
-class ArticulatedBody;
-class CollisionGeometry;  
-class DStruct;
-
-/// Implements the ContactFinder abstract class to perform exact contact finding using vertices against triangles 
-class C2ACCD : public CollisionDetection
+/// Conservative advancement collision detection for (non-convex) triangle meshes
+/**
+ * Implements the C2A algorithm (Tang, Kim, and Manocha [2009]): pairs of
+ * triangle meshes are advanced conservatively by traversing a pair of
+ * bounding volume hierarchies and computing a safe step for every pair of
+ * nodes that is not culled. The front of the traversal (the node pairs at
+ * which the previous traversal stopped) is retained between calls so that
+ * consecutive conservative advancement iterations do not restart from the
+ * roots. Pairs of geometries that are not both triangle meshes are handled by
+ * CCD.
+ *
+ * The bounding volume hierarchies use bounding spheres stored in flat arrays;
+ * after the first call for a pair of geometries, the conservative advancement
+ * computation performs no allocation, and pairs are processed concurrently
+ * (when OpenMP is available) by calc_CA_Euler_steps().
+ */
+class C2ACCD : public CCD
 {
   public:
     C2ACCD();
     virtual ~C2ACCD() {}
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
-    virtual bool is_collision(double epsilon = 0.0);
-    virtual bool is_contact(double dt, const std::vector<std::pair<ControlledBodyPtr, Ravelin::VectorNd> >& q0, const std::vector<std::pair<ControlledBodyPtr, Ravelin::VectorNd> >& q1, std::vector<Event>& contacts);
     virtual void add_collision_geometry(CollisionGeometryPtr geom);
     virtual void remove_collision_geometry(CollisionGeometryPtr geom);
-    virtual void remove_all_collision_geometries();
-    virtual void add_rigid_body(RigidBodyPtr body); 
-    virtual void remove_rigid_body(RigidBodyPtr body); 
-    virtual void add_articulated_body(ArticulatedBodyPtr abody, bool disable_adjacent);
-    virtual void remove_articulated_body(ArticulatedBodyPtr abody);
-
-    template <class InputIterator>
-    C2ACCD(InputIterator begin, InputIterator end);
+    virtual double calc_CA_Euler_step(const PairwiseDistInfo& pdi);
+    virtual void calc_CA_Euler_steps(const std::vector<PairwiseDistInfo>& pdi, std::vector<double>& steps);
+    virtual double calc_signed_dist(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, Point3d& pA, Point3d& pB);
+    virtual void find_contacts(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, std::vector<UnilateralConstraint>& contacts, double TOL = NEAR_ZERO);
+    using CCD::find_contacts;
 
-    /// The distance tolerance for conservative advancement 
-    double eps_tolerance;
+    /// The maximum number of triangles in a leaf of a bounding volume hierarchy
+    unsigned max_leaf_tris;
 
-    /// The smallest advancement step fraction of the step size
-    double alpha_tolerance;
+    /// The maximum number of node pairs retained in a traversal front
+    unsigned max_front_size;
 
   private:
+    /// A node of a bounding sphere hierarchy
+    struct Node
+    {
+      double c[3];      // the center of the sphere (in the mesh frame)
+      double r;         // the radius of the sphere
+      double rmax;      // distance from the body origin to the farthest point
+      int left;         // index of the left child (the right follows it); -1 for a leaf
+      unsigned first;   // index of the first triangle of the node
+      unsigned count;   // the number of triangles in the node
+
+      bool is_leaf() const { return left < 0; }
+    };
 
-    class AThickTri : public ThickTriangle
+    /// A bounding sphere hierarchy over a triangle mesh
+    struct Tree
     {
-      public:
-        AThickTri(const Triangle& tri, double tol) : ThickTriangle(tri, tol) {}
-        boost::shared_ptr<const IndexedTriArray> mesh;  // the mesh that this triangle came from
-        unsigned tri_idx;             // the index of this triangle
+      boost::shared_ptr<const IndexedTriArray> mesh;
+      boost::shared_ptr<const Ravelin::Pose3d> P;
+      std::vector<Node> nodes;
+      std::vector<unsigned> tris;
     };
 
-    double calc_dist(boost::shared_ptr<SSR> a, boost::shared_ptr<SSR> b, const Ravelin::Transform3d& aTb, Point3d& cpa, Point3d& cpb) const;
-    static bool query_intersect_seg_tri(const LineSeg3& seg, const Triangle& tri, double& t, Point3d& p);
-    void determine_contacts(CollisionGeometryPtr a, CollisionGeometryPtr b, double toc, std::vector<Event>& contacts) const;
-    bool check_collision(CollisionGeometryPtr a, CollisionGeometryPtr b, std::vector<std::pair<unsigned, unsigned> >& colliding_tris) const;
-    double do_CA(double step_size, CollisionGeometryPtr a, CollisionGeometryPtr b, boost::shared_ptr<SSR> ssr_a, boost::shared_ptr<SSR> ssr_b, const Ravelin::Transform3d& aTb, double dt);
-    double do_CAStep(double dist, const Ravelin::Vector3d& dab, CollisionGeometryPtr a, CollisionGeometryPtr b, boost::shared_ptr<SSR> ssr_a, boost::shared_ptr<SSR> ssr_b);
-    double calc_mu(double dist, const Ravelin::Vector3d& n, CollisionGeometryPtr g, boost::shared_ptr<SSR> ssr, bool positive);
-    void add_rigid_body_model(RigidBodyPtr body);
-    bool intersect_BV_trees(boost::shared_ptr<BV> a, boost::shared_ptr<BV> b, const Ravelin::Transform3d& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b);
-    void check_vertices(double dt, CollisionGeometryPtr a, CollisionGeometryPtr b, BVPtr ob, const std::vector<const Point3d*>& a_verts, const Ravelin::Transform3d bTa_t0, const Ravelin::SVelocityd& a_vel, const Ravelin::SVelocityd& b_vel, double& earliest, std::vector<Event>& local_contacts) const;
-    void check_geoms(double dt, CollisionGeometryPtr a, CollisionGeometryPtr b, const std::vector<std::pair<ControlledBodyPtr, Ravelin::VectorNd> >& q0, const std::vector<std::pair<ControlledBodyPtr, Ravelin::VectorNd> >& q1, std::vector<Event>& contacts); 
-    void build_BV_tree(CollisionGeometryPtr geom);
-    bool split(BVPtr source, BVPtr& tgt1, BVPtr& tgt2, const Ravelin::Vector3d& axis);
-    void split_tris(const Point3d& point, const Ravelin::Vector3d& normal, const IndexedTriArray& orig_mesh, const std::list<unsigned>& ofacets, std::list<unsigned>& pfacets, std::list<unsigned>& nfacets);
-    void get_vertices(BVPtr bv, std::vector<const Point3d*>& vertices) const;
-    static bool coplanar_tris(const Triangle& ta, const Triangle& tb);
-    static bool project_and_intersect(const Triangle& ta, const Triangle& tb, std::vector<Point3d>& contact_points);
-    static bool project_and_intersect(const Triangle& t, const LineSeg3& s, std::vector<Point3d>& contact_points);
-    static bool project_and_intersect(const Triangle& t, const Point3d& p);
-    void determine_closest_features(const Triangle& ta, const Triangle& tb, Triangle::FeatureType& fa, Triangle::FeatureType& fb, std::vector<Point3d>& contact_points) const;
-    void determine_closest_tris(CollisionGeometryPtr a, CollisionGeometryPtr b, const Ravelin::Transform3d& aTb, std::vector<std::pair<Triangle, Triangle> >& closest_tris) const;
-    static ControlledBodyPtr get_super_body(CollisionGeometryPtr a);
-    static unsigned find_body(const std::vector<std::pair<ControlledBodyPtr, Ravelin::VectorNd> >& q, ControlledBodyPtr body);
-
-    template <class OutputIterator>
-    OutputIterator intersect_BV_leafs(BVPtr a, BVPtr b, const Ravelin::Transform3d& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b, OutputIterator output_begin) const;
-
-    template <class InputIterator, class OutputIterator>
-    OutputIterator get_vertices(const IndexedTriArray& tris, InputIterator fselect_begin, InputIterator fselect_end, OutputIterator output);
-
-    // lock for the contact set 
-    pthread_mutex_t _contact_mutex;
-
-    // mapping from CollisionGeometry pointers to root SSRs
-    std::map<CollisionGeometryPtr, boost::shared_ptr<SSR> > _root_SSRs;
-
-    // mapping from BVs to triangles contained within
-    std::map<BVPtr, std::pair<boost::shared_ptr<const IndexedTriArray>, std::list<unsigned> > > _meshes;
-}; // end class
+    /// Bound on the distance a body can move along a direction per unit time
+    /**
+     * The bound is <n, v> + ||w x n||*r + a*r + b, where r is the distance
+     * from the body origin to the farthest point of interest (see
+     * CCD::calc_max_dist()).
+     */
+    struct MotionBound
+    {
+      double v[3], w[3];
+      double a, b;
+    };
 
-// include inline functions
-#include "C2ACCD.inl"
+    /// Data retained for a pair of meshes
+    struct PairData
+    {
+      PairData() : A(NULL), B(NULL) { }
+
+      Tree* A;
+      Tree* B;
+      boost::shared_ptr<const IndexedTriArray> meshA, meshB;
+      Ravelin::Transform3d aTb;   // transform from B's mesh frame to A's
+      double R[9], x[3];          // aTb as a row-major rotation and translation
+      double wRa[9];              // rotation from A's mesh frame to global
+      MotionBound mA, mB;
+      std::vector<std::pair<unsigned, unsigned> > front, stack;
+    };
+
+    typedef std::pair<CollisionGeometryPtr, CollisionGeometryPtr> GeomPair;
+
+    static boost::shared_ptr<TriangleMeshPrimitive> get_mesh_primitive(CollisionGeometryPtr cg);
+    Tree* get_tree(CollisionGeometryPtr cg);
+    PairData* get_pair_data(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, bool& swapped);
+    void build_tree(CollisionGeometryPtr cg, Tree& tree);
+    void build_node(Tree& tree, unsigned idx, unsigned first, unsigned count, const std::vector<Ravelin::Origin3d>& centroids, const Ravelin::Transform3d& rbTp);
+    static void calc_motion_bound(RigidBodyPtr rb, MotionBound& mb);
+    static double calc_max_dist(const MotionBound& mb, const double* n, double r);
+    static double calc_max_speed(const MotionBound& mb, double r);
+    double calc_CA_Euler_step_meshes(PairData& pd) const;
+    static double calc_sphere_dist(const PairData& pd, const Node& na, const Node& nb, double* n);
+    static double calc_leaf_dist(const PairData& pd, const Node& na, const Node& nb, Point3d& cpA, Point3d& cpB);
+    static double calc_dist_meshes(PairData& pd, Point3d& cpA, Point3d& cpB);
+
+    /// The bounding sphere hierarchies, one per triangle mesh geometry
+    std::map<CollisionGeometryPtr, Tree> _trees;
+
+    /// Data retained for pairs of triangle mesh geometries (keyed with the lesser geometry first)
+    std::map<GeomPair, PairData> _pair_data;
+
+    /// Temporaries used by calc_CA_Euler_steps()
+    std::vector<PairData*> _mesh_pairs;
+    std::vector<unsigned> _mesh_pair_indices;
+}; // end class
 
 } // end namespace
 
@@ -0,0 +1,113 @@
+/****************************************************************************
+ * Copyright 2016 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _MOBY_CAPI_H
+#define _MOBY_CAPI_H
+
+/**
+ * A flat C interface for embedding Moby simulations.
+ *
+ * State is exposed through a MobyState structure whose arrays are allocated
+ * once, when a simulation is loaded, and are rewritten in place after every
+ * call to moby_step(). Callers may therefore wrap the arrays once (e.g., as
+ * NumPy arrays or Go slices) and read them after each step without any
+ * further calls or copies. Pointers remain valid until the simulation is
+ * destroyed, reloaded, or moby_reserve_contacts() grows the contact arrays.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Number of doubles per body in MobyState::poses (x, y, z, qx, qy, qz, qw)
+#define MOBY_POSE_STRIDE 7
+
+/// Number of doubles per body in MobyState::velocities (xd, yd, zd, wx, wy, wz)
+#define MOBY_VELOCITY_STRIDE 6
+
+/// Number of doubles per contact in MobyState::contacts (point, normal, impulse)
+#define MOBY_CONTACT_STRIDE 9
+
+/// The default number of contacts that MobyState can hold
+#define MOBY_DEFAULT_CONTACT_CAPACITY 1024
+
+/// Opaque handle to a simulation
+typedef struct MobySimulation MobySimulation;
+
+/// State of a simulation, updated in place after every step
+typedef struct MobyState
+{
+  /// The current simulation time
+  double time;
+
+  /// The number of steps taken since the simulation was loaded or reset
+  unsigned long step;
+
+  /// The number of rigid bodies (articulated body links are included)
+  unsigned n_bodies;
+
+  /// Poses of the rigid bodies (n_bodies x MOBY_POSE_STRIDE, global frame)
+  double* poses;
+
+  /// Velocities of the rigid bodies (n_bodies x MOBY_VELOCITY_STRIDE)
+  /**
+   * Linear velocities are those of the body frame origin; both linear and
+   * angular velocities are expressed in the global frame.
+   */
+  double* velocities;
+
+  /// The total number of joint degrees-of-freedom
+  unsigned n_joint_dofs;
+
+  /// Joint positions (n_joint_dofs)
+  double* joint_q;
+
+  /// Joint velocities (n_joint_dofs)
+  double* joint_qd;
+
+  /// The number of contacts stored after the last step
+  unsigned n_contacts;
+
+  /// The number of contacts that were found but did not fit into the arrays
+  unsigned n_contacts_dropped;
+
+  /// The number of contacts that the contact arrays can hold
+  unsigned contact_capacity;
+
+  /// Contact data (contact_capacity x MOBY_CONTACT_STRIDE, global frame)
+  /**
+   * Each contact consists of the contact point, the contact normal (pointing
+   * toward the first body), and the linear impulse applied to the first body
+   * over the last step.
+   */
+  double* contacts;
+
+  /// Indices of the two bodies in each contact (contact_capacity x 2)
+  /**
+   * An index of -1 indicates a body that is not tracked (e.g., a body added
+   * to the simulator after loading).
+   */
+  int* contact_bodies;
+} MobyState;
+
+MobySimulation* moby_create(void);
+void moby_destroy(MobySimulation* sim);
+int moby_load(MobySimulation* sim, const char* fname);
+int moby_reset(MobySimulation* sim);
+int moby_step(MobySimulation* sim, double dt, unsigned n);
+const MobyState* moby_get_state(const MobySimulation* sim);
+int moby_reserve_contacts(MobySimulation* sim, unsigned capacity);
+int moby_find_body(const MobySimulation* sim, const char* id);
+const char* moby_get_body_id(const MobySimulation* sim, unsigned index);
+int moby_find_joint(const MobySimulation* sim, const char* id);
+const char* moby_get_last_error(const MobySimulation* sim);
+
+#ifdef __cplusplus
+} // end extern "C"
+#endif
+
+#endif
+
@@ -41,6 +41,8 @@ class CCD : public CollisionDetection
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
     virtual void broad_phase(double dt, const std::vector<ControlledBodyPtr>& bodies, std::vector<std::pair<CollisionGeometryPtr, CollisionGeometryPtr> >& to_check);
+    virtual void add_collision_geometry(CollisionGeometryPtr geom);
+    virtual void remove_collision_geometry(CollisionGeometryPtr geom);
     virtual double calc_CA_Euler_step(const PairwiseDistInfo& pdi);
     virtual void find_contacts(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, std::vector<UnilateralConstraint>& contacts, double TOL = NEAR_ZERO)
     {
@@ -53,14 +55,6 @@ class CCD : public CollisionDetection
     template <class OutputIterator>
     OutputIterator find_contacts(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, OutputIterator output_begin, double TOL = NEAR_ZERO);
 
-    /// Pairs of collision geometries that aren't checked for contact/collision
-    /**
-     * \note collisions between geometries for two disabled bodies and
-     *       collisions between geometries for a single body are automatically
-     *       not checked and do not need to be added to this set.
-     */
-    std::set<Ravelin::sorted_pair<CollisionGeometryPtr> > disabled_pairs;
-
   protected:
     virtual double calc_next_CA_Euler_step(const PairwiseDistInfo& pdi) { return calc_next_CA_Euler_step_generic(pdi); }
 
@@ -111,10 +105,16 @@ class CCD : public CollisionDetection
     /// Minimum observed distance between two bodies (to make conservative advancement faster in face of numerical error)
     std::map<Ravelin::sorted_pair<CollisionGeometryPtr>, double> _min_dist_observed;
 
+    /// Geometries that have been unregistered but whose bounds and observed distances have not yet been removed
+    std::vector<CollisionGeometryPtr> _removed_geoms;
+
     static BVPtr construct_bounding_sphere(CollisionGeometryPtr cg);
     void sort_AABBs(const std::vector<RigidBodyPtr>& rigid_bodies, double dt);
     void update_bounds_vector(std::vector<std::pair<double, BoundsStruct> >& bounds, AxisType axis, double dt, bool recreate_bvs);
     void build_bv_vector(const std::vector<RigidBodyPtr>& rigid_bodies, std::vector<std::pair<double, BoundsStruct> >& bounds);
+    void purge_removed_geometries();
+    static void remove_bounds(std::vector<std::pair<double, BoundsStruct> >& bounds, const std::vector<CollisionGeometryPtr>& geoms);
+    static void add_bounds(std::vector<std::pair<double, BoundsStruct> >& bounds, CollisionGeometryPtr geom, BVPtr bv);
     BVPtr get_swept_BV(CollisionGeometryPtr geom, BVPtr bv, double dt);
 
     bool intersect_BV_trees(boost::shared_ptr<BV> a, boost::shared_ptr<BV> b, const Ravelin::Transform3d& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b);
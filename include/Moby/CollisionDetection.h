@@ -9,11 +9,14 @@
 
 #include <map>
 #include <set>
+#include <limits>
+#include <boost/unordered_map.hpp>
 #include <Ravelin/VectorNd.h>
 #include <Ravelin/Pose3d.h>
 #include <Ravelin/sorted_pair>
 #include <Moby/Base.h>
 #include <Moby/PairwiseDistInfo.h>
+#include <Moby/SceneQueryResults.h>
 #include <Moby/CollisionGeometry.h>
 #include <Moby/UnilateralConstraint.h>
 #include <Moby/RigidBody.h>
@@ -21,6 +24,7 @@
 namespace Moby {
 
 class ConstraintSimulator;
+class QueryScene;
 class ArticulatedBody;
 class CollisionGeometry;
 class Triangle;
@@ -34,15 +38,37 @@ class IndexedTriArray;
  * determines whether two bodies will come into contact (or are already in 
  * contact) in a given time interval; if the bodies do/will contact, contact
  * finding computes contact points and normals. 
+ *
+ * Pairs of geometries are filtered during the broad phase: two geometries
+ * are checked only if their collision groups and masks permit them to
+ * collide (see CollisionGeometry::groups_collide()), unless an override has
+ * been set for that specific pair.
+ *
+ * Batches of scene queries (rays, line segments, swept spheres and boxes, and
+ * point distances) can be answered against all geometries of a set of
+ * bodies. The queries in a batch are processed concurrently; each query
+ * accepts a collision mask, and only geometries whose collision group
+ * intersects the mask are considered. The hierarchy built over the
+ * geometries for a batch is reused by later batches until the geometries or
+ * their poses change, so batches from one collision detector must not be
+ * issued concurrently.
  */
 class CollisionDetection : public virtual Base
 {
   public:
-    CollisionDetection() {}
+    CollisionDetection() { query_tolerance = 1e-6; }
     virtual ~CollisionDetection() {}
     virtual void set_simulator(boost::shared_ptr<ConstraintSimulator> sim) {}
     virtual void broad_phase(double dt, const std::vector<ControlledBodyPtr>& bodies, std::vector<std::pair<CollisionGeometryPtr, CollisionGeometryPtr> >& to_check);
+
+    /// Called by the simulator when a geometry enters the simulation
+    virtual void add_collision_geometry(CollisionGeometryPtr geom) {}
+
+    /// Called by the simulator when a geometry leaves the simulation
+    virtual void remove_collision_geometry(CollisionGeometryPtr geom) {}
+
     virtual double calc_CA_Euler_step(const PairwiseDistInfo& pdi) = 0;
+    virtual void calc_CA_Euler_steps(const std::vector<PairwiseDistInfo>& pdi, std::vector<double>& steps);
     virtual void find_contacts(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, std::vector<UnilateralConstraint>& contacts, double TOL = NEAR_ZERO) = 0;
 
     /// Calculates the signed distance between two geometries
@@ -51,14 +77,64 @@ class CollisionDetection : public virtual Base
       return CollisionGeometry::calc_signed_dist(cg1, cg2, p1, p2);
     }
 
+    void cast_segments(const std::vector<ControlledBodyPtr>& bodies, const std::vector<LineSeg3>& segs, SceneQueryResults& results, unsigned mask = std::numeric_limits<unsigned>::max(), const std::vector<RigidBodyPtr>* ignored = NULL);
+    void cast_rays(const std::vector<ControlledBodyPtr>& bodies, const std::vector<Point3d>& origins, const std::vector<Ravelin::Vector3d>& dirs, double max_dist, SceneQueryResults& results, unsigned mask = std::numeric_limits<unsigned>::max());
+    void cast_spheres(const std::vector<ControlledBodyPtr>& bodies, const std::vector<LineSeg3>& segs, double radius, SceneQueryResults& results, unsigned mask = std::numeric_limits<unsigned>::max());
+    void cast_boxes(const std::vector<ControlledBodyPtr>& bodies, const std::vector<LineSeg3>& segs, const Ravelin::Origin3d& half_lengths, const Ravelin::Quatd& q, SceneQueryResults& results, unsigned mask = std::numeric_limits<unsigned>::max());
+    void calc_point_distances(const std::vector<ControlledBodyPtr>& bodies, const std::vector<Point3d>& points, double max_dist, SceneQueryResults& results, unsigned mask = std::numeric_limits<unsigned>::max());
+
+    /// The distance at which a cast shape is considered to hit a geometry (default = 1e-6)
+    double query_tolerance;
+
     /// Get the shared pointer for this
     boost::shared_ptr<CollisionDetection> get_this() { return boost::dynamic_pointer_cast<CollisionDetection>(shared_from_this()); }
 
+    void set_pair_enabled(CollisionGeometryPtr cg1, CollisionGeometryPtr cg2, bool enabled);
+    void clear_pair_override(CollisionGeometryPtr cg1, CollisionGeometryPtr cg2);
+    void clear_pair_overrides(CollisionGeometryPtr geom);
+    void clear_pair_overrides(const std::vector<CollisionGeometryPtr>& geoms);
+
+    /// Removes all per-pair overrides
+    void clear_pair_overrides() { _pair_overrides.clear(); }
+
+    /// Determines whether a pair of geometries passes the collision filter
+    bool is_checked(const CollisionGeometryPtr& cg1, const CollisionGeometryPtr& cg2) const
+    {
+      if (!_pair_overrides.empty())
+      {
+        PairOverrideMap::const_iterator i = _pair_overrides.find(make_key(cg1, cg2));
+        if (i != _pair_overrides.end())
+          return i->second.second;
+      }
+      return CollisionGeometry::groups_collide(*cg1, *cg2);
+    }
+
+    /// Per-pair overrides of the collision group filter, keyed on (sorted) geometry addresses
+    typedef boost::unordered_map<std::pair<const CollisionGeometry*, const CollisionGeometry*>, std::pair<Ravelin::sorted_pair<CollisionGeometryPtr>, bool> > PairOverrideMap;
+
+    /// Gets the per-pair overrides (each value holds the pair and whether it is checked)
+    const PairOverrideMap& get_pair_overrides() const { return _pair_overrides; }
+
   protected:
     virtual double calc_next_CA_Euler_step(const PairwiseDistInfo& pdi) = 0;
     static UnilateralConstraint create_contact(CollisionGeometryPtr a, CollisionGeometryPtr b, const Point3d& point, const Ravelin::Vector3d& normal, double violation = 0.0);
 
   friend class ConstraintStabilization;
+
+  private:
+    const QueryScene& get_query_scene(const std::vector<ControlledBodyPtr>& bodies, unsigned mask, bool use_bvs);
+
+    /// Gets the key for a pair of geometries in the override map
+    static std::pair<const CollisionGeometry*, const CollisionGeometry*> make_key(const CollisionGeometryPtr& cg1, const CollisionGeometryPtr& cg2)
+    {
+      return (cg1.get() < cg2.get()) ? std::make_pair((const CollisionGeometry*) cg1.get(), (const CollisionGeometry*) cg2.get()) : std::make_pair((const CollisionGeometry*) cg2.get(), (const CollisionGeometry*) cg1.get());
+    }
+
+    /// Per-pair overrides of the collision group filter
+    PairOverrideMap _pair_overrides;
+
+    /// The scenes of the last batches of queries (without and with the geometries' bounding volume hierarchies)
+    boost::shared_ptr<QueryScene> _query_scenes[2];
 }; // end class
 
 } // end namespace Moby
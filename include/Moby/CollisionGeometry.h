@@ -32,6 +32,13 @@ namespace Moby {
  *  nonstationarity (changing over time) or deformities (e.g., due to 
  *  collision).  Note that while the underlying geometry may be shared, it is
  *  not intended for CollisionGeometry objects to be shared.
+ *
+ *  The geometry may also have coarser levels of detail (e.g., a bounding
+ *  sphere or the convex hull of a mesh), each of which must enclose the
+ *  finer levels and the geometry itself. The distance between coarse levels
+ *  is then a lower bound on the distance between the geometries, and it is
+ *  used (see calc_coarse_signed_dist()) when it exceeds the switching
+ *  distance of the levels.
  */
 class CollisionGeometry : public virtual Base
 {
@@ -51,6 +58,8 @@ class CollisionGeometry : public virtual Base
     void get_vertices(std::vector<Point3d>& p) const;
     Point3d get_supporting_point(const Ravelin::Vector3d& d) const;
     double get_farthest_point_distance() const;
+    void add_detail_level(PrimitivePtr primitive, double switch_dist);
+    static bool calc_coarse_signed_dist(CollisionGeometryPtr gA, CollisionGeometryPtr gB, double margin, double& dist, Point3d& pA, Point3d& pB);
 
     /// Gets the shared pointer for this
     CollisionGeometryPtr get_this() { return boost::dynamic_pointer_cast<CollisionGeometry>(shared_from_this()); }
@@ -70,6 +79,24 @@ class CollisionGeometry : public virtual Base
     /// Gets the geometry for this primitive
     PrimitivePtr get_geometry() const { return _geometry; }
 
+    /// Gets the number of coarser levels of detail
+    unsigned num_detail_levels() const { return _detail_levels.size(); }
+
+    /// Gets the primitive of the i'th coarser level of detail (level 0 is the coarsest)
+    PrimitivePtr get_detail_level(unsigned i) const { return _detail_levels[i].first; }
+
+    /// Gets the distance at and below which the i'th coarser level of detail is not used
+    double get_detail_level_switch_dist(unsigned i) const { return _detail_levels[i].second; }
+
+    /// Determines whether the collision groups and masks of two geometries permit them to collide
+    static bool groups_collide(const CollisionGeometry& a, const CollisionGeometry& b) { return (a.collision_group & b.collision_mask) && (b.collision_group & a.collision_mask); }
+
+    /// Bits identifying the collision groups to which this geometry belongs (default = 1)
+    unsigned collision_group;
+
+    /// Bits identifying the collision groups that this geometry may collide with (default = all groups)
+    unsigned collision_mask;
+
   protected:
     /// The pose of the CollisionGeometry (relative to the rigid body)
     boost::shared_ptr<Ravelin::Pose3d> _F;
@@ -77,6 +104,9 @@ class CollisionGeometry : public virtual Base
     /// The underlying geometry
     PrimitivePtr _geometry;
 
+    /// Coarser levels of detail (primitive and switching distance), coarsest first
+    std::vector<std::pair<PrimitivePtr, double> > _detail_levels;
+
   private:
     boost::weak_ptr<Ravelin::SingleBodyd> _single_body;
     boost::weak_ptr<CollisionGeometry> _parent;
@@ -17,6 +17,12 @@
 #include <Moby/CCD.h>
 #include <Moby/UnilateralConstraint.h>
 #include <Moby/ConstraintStabilization.h>
+#include <Moby/SceneQueryResults.h>
+
+namespace osg { 
+  class Geode;
+  class PositionAttitudeTransform;
+}
 
 namespace Moby {
 
@@ -33,17 +39,19 @@ class ConstraintSimulator : public Simulator
 
   public:
     ConstraintSimulator();
+    virtual ~ConstraintSimulator();
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
+    virtual void add_dynamic_body(ControlledBodyPtr body);
+    virtual void remove_dynamic_body(ControlledBodyPtr body);
+    virtual void reset_caches();
+    void determine_geometries();
     boost::shared_ptr<ContactParameters> get_contact_parameters(CollisionGeometryPtr geom1, CollisionGeometryPtr geom2) const;
-    const std::vector<PairwiseDistInfo>& get_pairwise_distances() const { return _pairwise_distances; }
+    const std::vector<PairwiseDistInfo>& get_pairwise_distances() { purge_removed_geometries(); return _pairwise_distances; }
 
     /// The constraint stabilization mechanism
     ConstraintStabilization cstab;
 
-    /// Determines whether two geometries are not checked
-    std::set<Ravelin::sorted_pair<CollisionGeometryPtr> > unchecked_pairs;
-
     /// Vectors set and passed to collision detection
     std::vector<std::pair<ControlledBodyPtr, Ravelin::VectorNd> > _x0, _x1;
 
@@ -71,10 +79,19 @@ class ConstraintSimulator : public Simulator
     boost::shared_ptr<void> constraint_post_callback_data;
  
     /// Gets the (sorted) compliant constraint data
-    std::vector<UnilateralConstraint>& get_compliant_constraints() { return _compliant_constraints; }
+    std::vector<UnilateralConstraint>& get_compliant_constraints() { purge_removed_geometries(); return _compliant_constraints; }
 
     /// Gets the (sorted) rigid constraint data
-    std::vector<UnilateralConstraint>& get_rigid_constraints() { return _rigid_constraints; }
+    std::vector<UnilateralConstraint>& get_rigid_constraints() { purge_removed_geometries(); return _rigid_constraints; }
+
+    /// Gets the contacts of the last step, each with the impulse (in the global frame) that it applied over the step
+    /**
+     * Contacts are recorded from every mini-step, including impacts,
+     * sustained contact forces, and compliant contact forces (a force
+     * applied over a mini-step is recorded as the corresponding impulse);
+     * contacts are only recorded if there are sensors.
+     */
+    const std::vector<UnilateralConstraint>& get_step_contacts() const { return _step_contacts; }
 
     /// Mapping from objects to contact parameters
     std::map<Ravelin::sorted_pair<BasePtr>, boost::shared_ptr<ContactParameters> > contact_params;
@@ -82,6 +99,9 @@ class ConstraintSimulator : public Simulator
     /// If set to 'true' simulator will process contact points for rendering
     bool render_contact_points;
 
+    /// The sensors, which are updated at the end of each step at which they are due
+    std::vector<SensorPtr> sensors;
+
     /// Gets the collision detection mechanism
     boost::shared_ptr<CollisionDetection> get_collision_detection() const { return _coldet; }
 
@@ -93,15 +113,46 @@ class ConstraintSimulator : public Simulator
      */
     double contact_dist_thresh;
 
+    /// The time over which geometries' motion is considered when choosing their levels of detail (default 0.01)
+    /**
+     * A coarse level of detail is only used for a pair of geometries if
+     * the levels remain farther apart than their switching distances after
+     * the geometries move toward each other at their maximum speeds for this
+     * time, so fast-moving pairs switch to finer levels sooner.
+     */
+    double lod_lookahead;
+
+    /// Wall-clock time spent in broad phase collision detection on the last step
+    double broad_phase_time;
+
+    /// Wall-clock time spent computing pairwise distances on the last step (excluding those computed for stabilization)
+    double narrow_phase_time;
+
+    /// Wall-clock time spent finding and solving unilateral constraints on the last step
+    double constraint_time;
+
+    /// Wall-clock time spent on constraint stabilization on the last step (including the pairwise distances that it computes)
+    double stabilization_time;
+
+    /// The number of contacts found on the last step (summed over its mini-steps)
+    unsigned step_contacts;
+
+    /// The number of LCP pivots taken by the impact solver on the last step (only counted for the LCP impact solver; always zero for the QP and NQP solvers)
+    unsigned long step_pivots;
+
   protected:
     void calc_impacting_unilateral_constraint_forces(double dt);
-    void find_unilateral_constraints(double min_contact_dist);
+    void find_unilateral_constraints(double min_contact_dist, double limit_lookahead = 0.0);
     void calc_compliant_unilateral_constraint_forces();
     void preprocess_constraint(UnilateralConstraint& e);
-    void determine_geometries();
     void broad_phase(double dt);
     void calc_pairwise_distances();
     void visualize_contact( UnilateralConstraint& constraint );
+    void reset_contact_visualization();
+    void update_sensors(double dt);
+    void reset_step_statistics();
+    void purge_removed_geometries();
+    void record_step_contacts(const std::vector<UnilateralConstraint>& constraints, double h);
 
     /// Object for handling impact constraints
     ImpactConstraintHandler _impact_constraint_handler;
@@ -137,6 +188,37 @@ class ConstraintSimulator : public Simulator
 
     /// Geometric pairs that should be checked for unilateral constraints (according to broad phase collision detection)
     std::vector<std::pair<CollisionGeometryPtr, CollisionGeometryPtr> > _pairs_to_check;
+
+    /// Geometries removed (with their bodies) whose cached data has not yet been discarded
+    std::vector<CollisionGeometryPtr> _removed_geometries;
+
+  private:
+    void create_contact_visualization_mesh();
+    static void get_geometries(ControlledBodyPtr body, std::vector<CollisionGeometryPtr>& geoms);
+
+    /// The group holding all contact visualization instances
+    osg::Group* _contact_vdata;
+
+    /// The mesh shared by all contact visualization instances 
+    osg::Geode* _contact_geode;
+
+    /// The pool of contact visualization instances
+    std::vector<osg::PositionAttitudeTransform*> _contact_xforms;
+
+    /// The number of contact visualization instances in use
+    unsigned _n_visualized_contacts;
+
+    /// The rays cast for the sensors (retained to avoid reallocation)
+    std::vector<LineSeg3> _sensor_rays;
+
+    /// The body whose geometries each ray cast for the sensors passes through
+    std::vector<RigidBodyPtr> _sensor_ignored;
+
+    /// The contacts of the current step, with their impulses
+    std::vector<UnilateralConstraint> _step_contacts;
+
+    /// The results of the rays cast for the sensors
+    SceneQueryResults _sensor_results;
 }; // end class
 
 } // end namespace
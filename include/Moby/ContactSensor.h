@@ -0,0 +1,67 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _CONTACT_SENSOR_H
+#define _CONTACT_SENSOR_H
+
+#include <vector>
+#include <Ravelin/Vector3d.h>
+#include <Moby/Sensor.h>
+
+namespace Moby {
+
+/// A sensor that reports the contacts on its body
+/**
+ * The sensor reports the point, normal, and force of each contact involving
+ * a geometry of its body over the last step (see
+ * ConstraintSimulator::get_step_contacts()), up to its capacity; further
+ * contacts are counted as dropped. A contact that persists over several
+ * mini-steps is reported once for each. The normal and force are oriented
+ * for the body (the normal points into the body, and the force is the force
+ * applied to the body, averaged over the step, so that the forces of all
+ * reported contacts sum to the average contact force on the body). All
+ * quantities are in the global frame.
+ */
+class ContactSensor : public Sensor
+{
+  public:
+    ContactSensor();
+    void set_capacity(unsigned n);
+    virtual void update(ConstraintSimulator* sim, double dt);
+    virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
+    virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
+
+    /// Gets the maximum number of contacts that can be reported
+    unsigned get_capacity() const { return _points.size(); }
+
+    /// Gets the number of contacts reported by the last update
+    unsigned num_contacts() const { return _n; }
+
+    /// Gets the number of contacts that did not fit at the last update
+    unsigned num_dropped() const { return _dropped; }
+
+    /// Gets the contact points (only the first num_contacts() are valid)
+    const std::vector<Point3d>& get_points() const { return _points; }
+
+    /// Gets the contact normals (only the first num_contacts() are valid)
+    const std::vector<Ravelin::Vector3d>& get_normals() const { return _normals; }
+
+    /// Gets the contact forces (only the first num_contacts() are valid)
+    const std::vector<Ravelin::Vector3d>& get_forces() const { return _forces; }
+
+  private:
+    /// The contact data
+    std::vector<Point3d> _points;
+    std::vector<Ravelin::Vector3d> _normals, _forces;
+
+    /// The number of contacts reported and dropped
+    unsigned _n, _dropped;
+}; // end class
+
+} // end namespace
+
+#endif
+
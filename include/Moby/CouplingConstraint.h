@@ -0,0 +1,90 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _COUPLING_CONSTRAINT_H
+#define _COUPLING_CONSTRAINT_H
+
+#include <map>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <Ravelin/DynamicBodyd.h>
+#include <Moby/Base.h>
+#include <Moby/SparseJacobian.h>
+#include <Moby/Joint.h>
+
+namespace Moby {
+
+/// A linear coupling between the velocities of joint degrees-of-freedom
+/**
+ * The coupling enforces sum_i r_i * qd_i = 0 over its terms, where qd_i is
+ * the velocity of degree-of-freedom i of an explicit joint of a
+ * reduced-coordinate articulated body and r_i is the ratio for that term.
+ * The joints may belong to different articulated bodies, so gear trains,
+ * belts, differentials, and mimic joints can be expressed without adding any
+ * links. Each coupling contributes a single (sparse) row to the
+ * implicit constraint Jacobian that the simulator uses for forward dynamics
+ * and that the impact constraint handler uses alongside contacts and limits.
+ *
+ * The position error of the coupling is sum_i r_i * q_i - offset. If the
+ * backlash is positive, the coupling is inactive while the magnitude of the
+ * position error is smaller than half of the backlash; once that magnitude
+ * is reached, the coupling only prevents the error from growing further
+ * (the coupling is unilateral: it can push but not pull).
+ */
+class CouplingConstraint : public virtual Base
+{
+  public:
+    CouplingConstraint();
+    virtual ~CouplingConstraint() {}
+    void add_term(JointPtr joint, unsigned dof, double ratio);
+    double calc_position_error() const;
+    double calc_velocity() const;
+    int get_direction() const;
+    bool is_engaged() const;
+    bool is_bilateral() const { return backlash <= 0.0; }
+    void get_super_bodies(std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> >& bodies) const;
+    void add_to_Jacobian(const std::map<boost::shared_ptr<Ravelin::DynamicBodyd>, unsigned>& gc_map, unsigned row, SparseJacobian& J) const;
+    virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
+    virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
+
+    /// Gets the number of terms in the coupling
+    unsigned num_terms() const { return _terms.size(); }
+
+    /// Gets the joint of the i'th term
+    JointPtr get_joint(unsigned i) const { return _terms[i].joint; }
+
+    /// Gets the joint degree-of-freedom of the i'th term
+    unsigned get_dof(unsigned i) const { return _terms[i].dof; }
+
+    /// Gets the ratio of the i'th term
+    double get_ratio(unsigned i) const { return _terms[i].ratio; }
+
+    /// The total free play of the coupling, in the units of the position error (default = 0)
+    double backlash;
+
+    /// The value of sum_i r_i * q_i at which the coupling is centered (default = 0)
+    double offset;
+
+    /// The impulse or force (last computed) along the coupling row
+    double lambda;
+
+  private:
+    /// A single joint degree-of-freedom and its ratio
+    struct Term
+    {
+      JointPtr joint;
+      unsigned dof;
+      double ratio;
+    };
+
+    /// The terms of the coupling
+    std::vector<Term> _terms;
+}; // end class
+
+} // end namespace
+
+#endif
+
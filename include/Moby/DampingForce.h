@@ -13,6 +13,12 @@
 namespace Moby {
 
 /// Defines a force that damps rigid bodies on any given step
+/**
+ * Damping constants given for an articulated body apply to all of its links,
+ * unless constants are given for a link. add_forces() resolves the constants
+ * for every link only when the set of bodies changes; invalidate_batch()
+ * must be called after the damping constants are modified.
+ */
 class DampingForce : public RecurrentForce
 {
   public:
@@ -20,6 +26,7 @@ class DampingForce : public RecurrentForce
     DampingForce(const DampingForce& source);
     virtual ~DampingForce() {}
     virtual void add_force(boost::shared_ptr<Ravelin::DynamicBodyd> body);
+    virtual void add_forces(const std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> >& bodies);
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
 
@@ -37,6 +44,16 @@ class DampingForce : public RecurrentForce
 
   private:
     static void add_damping(boost::shared_ptr<Ravelin::RigidBodyd> rb, double ld, double ad, double ldsq, double adsq);
+    static double get_constant(const std::map<boost::shared_ptr<Ravelin::DynamicBodyd>, double>& k, boost::shared_ptr<Ravelin::DynamicBodyd> body, double default_value);
+
+    /// The rigid bodies (and links) that damping is applied to by add_forces()
+    std::vector<boost::shared_ptr<Ravelin::RigidBodyd> > _links;
+
+    /// The bodies that the links belong to
+    std::vector<unsigned> _owners;
+
+    /// The linear, angular, linear squared, and angular squared damping constants for each link
+    std::vector<double> _kl, _ka, _klsq, _kasq;
 }; // end class
 } // end namespace
 
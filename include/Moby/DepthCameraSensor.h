@@ -0,0 +1,60 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _DEPTH_CAMERA_SENSOR_H
+#define _DEPTH_CAMERA_SENSOR_H
+
+#include <vector>
+#include <Moby/RaySensor.h>
+
+namespace Moby {
+
+/// A pinhole depth camera
+/**
+ * The camera looks along the z-axis of the sensor frame, with image columns
+ * increasing along the x-axis and image rows increasing along the y-axis.
+ * The depth image is stored row-major; each value is the depth of the first
+ * hit along the optical axis (not the distance along the ray), and a pixel
+ * whose ray does not hit anything yields std::numeric_limits<double>::max().
+ * The min_range and max_range of the sensor are the near and far clipping
+ * depths.
+ */
+class DepthCameraSensor : public RaySensor
+{
+  public:
+    DepthCameraSensor();
+    void setup();
+    virtual void prepare(double t);
+    virtual unsigned num_rays() const { return width*height; }
+    virtual void get_rays(std::vector<LineSeg3>& segs) const;
+    virtual void set_ray_results(const SceneQueryResults& results, unsigned offset);
+    virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
+    virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
+
+    /// Gets the depth image (height rows by width columns)
+    const std::vector<double>& get_depths() const { return _depths; }
+
+    /// The width of the image in pixels (default = 64)
+    unsigned width;
+
+    /// The height of the image in pixels (default = 48)
+    unsigned height;
+
+    /// The horizontal field of view in radians (default = pi/2)
+    double fov;
+
+  private:
+    /// The depths
+    std::vector<double> _depths;
+
+    /// The direction through each pixel (sensor frame), scaled to unit depth
+    std::vector<Ravelin::Origin3d> _dirs;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -1,26 +1,80 @@
 /****************************************************************************
  * Copyright 2015 Evan Drumwright
- * This library is distributed under the terms of the Apache V2.0 
+ * This library is distributed under the terms of the Apache V2.0
  * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
  ****************************************************************************/
 
 #ifndef _DISSIPATION_H
 #define _DISSIPATION_H
 
+#include <boost/weak_ptr.hpp>
 #include <Moby/RecurrentForce.h>
 
 namespace Moby {
-class Dissipation : public Base 
+
+class RCArticulatedBody;
+
+/// Dissipates energy from the joints of articulated bodies
+/**
+ * Each joint velocity is decayed exponentially (multiplied by the decay
+ * coefficient, lambda, at every step) and may additionally be subject to
+ * viscous friction (which reduces the velocity at the rate viscous*qd) and
+ * Coulomb friction (which reduces the speed at the constant rate coulomb,
+ * without reversing it). Articulated bodies without coefficients use a
+ * decay coefficient of 0.99 and no friction.
+ *
+ * The coefficients are stored in flat arrays (one entry per joint degree of
+ * freedom, ordered by body and then by joint), which are built at the first
+ * call to apply() and rebuilt whenever the set of bodies, the number of joint
+ * degrees of freedom of an articulated body, or the coefficient maps change.
+ */
+class Dissipation : public Base
 {
   public:
     Dissipation();
     virtual ~Dissipation() {}
-    void apply(const std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> >& bodies);
+    void apply(const std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> >& bodies, double dt);
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
 
-    /// The mapping from bodies to decay coefficients 
-    std::map<boost::shared_ptr<Ravelin::DynamicBodyd>, double> _coeffs; 
+    /// Forces the per-DOF coefficients to be rebuilt at the next call to apply()
+    void invalidate() { _bodies.clear(); }
+
+    /// The mapping from bodies to decay coefficients
+    std::map<boost::shared_ptr<Ravelin::DynamicBodyd>, double> _coeffs;
+
+    /// The mapping from bodies to joint viscous friction coefficients
+    std::map<boost::shared_ptr<Ravelin::DynamicBodyd>, double> _viscous_coeffs;
+
+    /// The mapping from bodies to joint Coulomb friction coefficients
+    std::map<boost::shared_ptr<Ravelin::DynamicBodyd>, double> _coulomb_coeffs;
+
+  private:
+    bool is_current(const std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> >& bodies) const;
+    void setup(const std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> >& bodies);
+    static double get_coeff(const std::map<boost::shared_ptr<Ravelin::DynamicBodyd>, double>& coeffs, boost::shared_ptr<Ravelin::DynamicBodyd> body, double default_value);
+    static unsigned num_joint_dof(boost::shared_ptr<RCArticulatedBody> ab);
+
+    /// The bodies that the per-DOF arrays were built for
+    std::vector<boost::weak_ptr<Ravelin::DynamicBodyd> > _bodies;
+
+    /// The articulated bodies among the bodies
+    std::vector<boost::weak_ptr<RCArticulatedBody> > _abodies;
+
+    /// The number of joint DOF of each articulated body in the per-DOF arrays
+    std::vector<unsigned> _abody_ndof;
+
+    /// The coefficient maps that the per-DOF arrays were built from
+    std::map<boost::shared_ptr<Ravelin::DynamicBodyd>, double> _setup_coeffs, _setup_viscous_coeffs, _setup_coulomb_coeffs;
+
+    /// The per-DOF coefficients
+    std::vector<double> _decay, _viscous, _coulomb;
+
+    /// Whether any DOF is subject to friction
+    bool _friction;
+
+    /// The joint velocities (per-DOF)
+    std::vector<double> _qd;
 }; // end class
 } // end namespace
 
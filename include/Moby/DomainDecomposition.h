@@ -0,0 +1,149 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _DOMAIN_DECOMPOSITION_H
+#define _DOMAIN_DECOMPOSITION_H
+
+#include <sys/types.h>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <Ravelin/DynamicBodyd.h>
+#include <Moby/Types.h>
+
+namespace Moby {
+
+class Simulator;
+
+/// Splits a large scene among simulator processes on the same host
+/**
+ * Every process loads the same scene and constructs a DomainDecomposition
+ * with its own region index; the world is split into slabs along one axis
+ * (the cuts give the slab boundaries, so there are one more regions than
+ * cuts). The bodies are grouped by the islands that Simulator::find_islands()
+ * determines (bodies connected by implicit joints or couplings), and each
+ * island is owned by the region that contains the mean position of its
+ * bodies.
+ *
+ * After every step, exchange() must be called: each process writes the
+ * states of the islands that it owns to a POSIX shared memory segment,
+ * waits for the other processes, and reads the states of all other islands.
+ * Ownership is then recomputed from the (identical) exchanged states, so
+ * islands migrate between regions deterministically. Islands owned by other
+ * regions but within ghost_width of this region are kept as ghosts: they are
+ * simulated and collide with the owned bodies (so contacts across region
+ * boundaries are resolved on both sides), but their states are overwritten
+ * by those from their owners at every exchange. All other islands are
+ * disabled and excluded from collision detection.
+ *
+ * Rigid bodies that are disabled in the scene are treated as static and are
+ * not exchanged.
+ *
+ * Only rigid bodies of islands that are not active are removed from
+ * integration: every process still integrates all articulated bodies, and
+ * broad phase collision detection still runs over all geometries (inactive
+ * geometries are only filtered out by their collision group), so the cost
+ * of those parts of a step is not divided among the regions.
+ *
+ * Region 0 creates the segment and publishes a generation for the run;
+ * other processes only join a segment whose generation has been published
+ * and whose creator is alive, so a segment left over from a crashed run is
+ * not used. Processes that wait in exchange() check that the others are
+ * still alive and throw a runtime_error if one has exited or if the others
+ * do not arrive within timeout seconds.
+ */
+class DomainDecomposition
+{
+  public:
+    DomainDecomposition(boost::shared_ptr<Simulator> sim, const std::string& name, unsigned region, unsigned axis, const std::vector<double>& cuts);
+    ~DomainDecomposition();
+    void exchange();
+    bool owns(boost::shared_ptr<Ravelin::DynamicBodyd> body) const;
+
+    /// Gets the number of regions
+    unsigned num_regions() const { return _cuts.size()+1; }
+
+    /// Gets the region of this process
+    unsigned get_region() const { return _region; }
+
+    /// Distance beyond the region boundaries within which islands are kept as ghosts
+    double ghost_width;
+
+    /// Seconds to wait for the other processes (when joining and at each exchange) before failing (default 60)
+    double timeout;
+
+  private:
+    struct Header;
+
+    void open_segment(const std::string& name);
+    void map_segment(int fd, size_t pids_offset, size_t buffer_offset);
+    void unmap_segment();
+    void wait_for_all();
+    void update_ownership();
+    void set_active(unsigned island, bool active);
+    unsigned find_region(double x) const;
+    double calc_island_position(unsigned island) const;
+    static unsigned state_size(boost::shared_ptr<Ravelin::DynamicBodyd> body);
+    static void write_state(boost::shared_ptr<Ravelin::DynamicBodyd> body, double* state);
+    static void read_state(boost::shared_ptr<Ravelin::DynamicBodyd> body, const double* state);
+
+    /// The simulator
+    boost::shared_ptr<Simulator> _sim;
+
+    /// The name of the shared memory segment
+    std::string _name;
+
+    /// The region of this process
+    unsigned _region;
+
+    /// The axis along which the world is split
+    unsigned _axis;
+
+    /// The (sorted) boundaries between regions
+    std::vector<double> _cuts;
+
+    /// The islands (bodies in the order of the simulator)
+    std::vector<std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> > > _islands;
+
+    /// The offset of each body's state in the shared state buffers
+    std::vector<std::vector<unsigned> > _offsets;
+
+    /// The collision geometries of each island, with their collision groups
+    std::vector<std::vector<std::pair<CollisionGeometryPtr, unsigned> > > _geoms;
+
+    /// The region that owns each island
+    std::vector<unsigned> _owner;
+
+    /// Whether each island is simulated (owned or a ghost) by this process
+    std::vector<bool> _active;
+
+    /// The shared memory segment and its size
+    void* _segment;
+    size_t _segment_size;
+
+    /// The segment header
+    Header* _header;
+
+    /// The process id of each region (0 for regions that have not joined)
+    volatile pid_t* _pids;
+
+    /// The generation of the run that this process joined
+    unsigned long _generation;
+
+    /// The two shared state buffers
+    double* _buffers[2];
+
+    /// The number of doubles in each state buffer
+    unsigned _n_state;
+
+    /// The state buffer to be written at the next exchange
+    unsigned _parity;
+}; // end class
+
+} // end namespace
+
+#endif
+
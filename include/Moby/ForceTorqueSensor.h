@@ -0,0 +1,41 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _FORCE_TORQUE_SENSOR_H
+#define _FORCE_TORQUE_SENSOR_H
+
+#include <Ravelin/SForced.h>
+#include <Moby/Sensor.h>
+
+namespace Moby {
+
+/// A six-axis force/torque sensor
+/**
+ * The sensor measures the net wrench that contacts apply to its body (e.g.,
+ * a foot or a fingertip), averaged over the last step and expressed in the
+ * sensor frame. The wrench is computed from the impacts, sustained contact
+ * forces, and compliant contact forces of every mini-step (see
+ * ConstraintSimulator::get_step_contacts()).
+ */
+class ForceTorqueSensor : public Sensor
+{
+  public:
+    ForceTorqueSensor();
+    virtual void update(ConstraintSimulator* sim, double dt);
+    virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
+
+    /// Gets the wrench measured at the last update (in the sensor frame)
+    const Ravelin::SForced& get_wrench() const { return _wrench; }
+
+  private:
+    /// The measured wrench
+    Ravelin::SForced _wrench;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -18,11 +18,22 @@ class GravityForce : public RecurrentForce
     GravityForce(const GravityForce& source);
     virtual ~GravityForce() {}
     virtual void add_force(boost::shared_ptr<Ravelin::DynamicBodyd> body);
+    virtual void add_forces(const std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> >& bodies);
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
 
     /// The gravity vector
     Ravelin::Vector3d gravity;
+
+  private:
+    /// The rigid bodies (and links) that gravity is applied to by add_forces()
+    std::vector<boost::shared_ptr<Ravelin::RigidBodyd> > _links;
+
+    /// The bodies that the links belong to
+    std::vector<unsigned> _owners;
+
+    /// The frames (at the link origins, aligned with the global frame) in which gravity is applied to the links
+    std::vector<boost::shared_ptr<Ravelin::Pose3d> > _poses;
 }; // end class
 } // end namespace
 
@@ -36,14 +36,19 @@ class HeightmapPrimitive : public Primitive
     virtual BVPtr get_BVH_root(CollisionGeometryPtr geom);
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
+    void set_heights(const Ravelin::MatrixNd& heights, double width, double depth);
     const Ravelin::MatrixNd& get_heights() const { return _heights; }
     double get_width() const { return _width; }
     double get_depth() const { return _depth; }
+
+    /// Gets an upper bound on the magnitude of the heightmap's gradient (its slope)
+    double get_max_slope() const { return _max_slope; }
     virtual double get_bounding_radius() const { return 0.0; }
 
   protected:
     virtual double calc_height(const Point3d& p) const;
     void calc_gradient(const Point3d& p, double& gx, double& gz) const;
+    void calc_max_slope();
 
     /// width of the heightmap
     double _width;
@@ -54,6 +59,9 @@ class HeightmapPrimitive : public Primitive
     // heights
     Ravelin::MatrixNd _heights;
 
+    /// upper bound on the magnitude of the gradient (computed when the heights are set)
+    double _max_slope;
+
     /// The bounding volumes for the heightmap 
     std::map<CollisionGeometryPtr, boost::shared_ptr<OBB> > _obbs; 
 
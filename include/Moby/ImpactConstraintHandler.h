@@ -45,6 +45,7 @@ class ImpactConstraintHandler
   public:
     ImpactConstraintHandler();
     void process_constraints(const std::vector<UnilateralConstraint>& constraints);
+    void clear_warm_start_data();
     static boost::shared_ptr<Ravelin::DynamicBodyd> get_super_body(boost::shared_ptr<Ravelin::SingleBodyd> sb);
 
     /// If set to true, uses the interior-point solver (default is false)
@@ -77,8 +78,13 @@ class ImpactConstraintHandler
     void apply_model(const std::vector<UnilateralConstraint>& constraints);
     void apply_model_to_connected_constraints(const std::list<UnilateralConstraint*>& constraints, const std::list<boost::shared_ptr<Ravelin::SingleBodyd> >& single_bodies);
     void compute_problem_data(UnilateralConstraintProblemData& epd, const std::list<boost::shared_ptr<Ravelin::SingleBodyd> >& single_bodies);
+    bool release_pulling_couplings(const UnilateralConstraintProblemData& epd);
+    void save_island_state(const UnilateralConstraintProblemData& epd);
+    void restore_island_state(const UnilateralConstraintProblemData& epd);
     void solve_lcp(UnilateralConstraintProblemData& epd, Ravelin::VectorNd& z);
     void solve_qp_work(UnilateralConstraintProblemData& epd, Ravelin::VectorNd& z);
+    void set_nqp_starting_point(const UnilateralConstraintProblemData& q);
+    void save_nqp_solution(const UnilateralConstraintProblemData& q);
     double calc_ke(UnilateralConstraintProblemData& epd, const Ravelin::VectorNd& z);
     void update_problem(const UnilateralConstraintProblemData& qorig, UnilateralConstraintProblemData& qnew);
     void update_solution(const UnilateralConstraintProblemData& q, const Ravelin::VectorNd& x, const std::vector<bool>& working_set, unsigned jidx, Ravelin::VectorNd& z);
@@ -109,6 +115,14 @@ class ImpactConstraintHandler
     // a pointer to the simulator
     boost::shared_ptr<ConstraintSimulator> _simulator;
 
+    // couplings with backlash that were released (found to be pulling) while solving the current island
+    std::vector<CouplingConstraintPtr> _released_couplings;
+
+    // the island's generalized velocities and impulses before solving, restored when couplings are released
+    std::vector<Ravelin::VectorNd> _saved_gv;
+    std::vector<Ravelin::SMomentumd> _saved_contact_impulses;
+    std::vector<double> _saved_limit_impulses;
+
     // temporaries for compute_problem_data(), solve_qp_work(), solve_lcp(), and apply_impulses()
     Ravelin::MatrixNd _MM;
     Ravelin::VectorNd _zlast, _v;
@@ -141,7 +155,36 @@ class ImpactConstraintHandler
     #ifdef HAVE_IPOPT
     Ipopt::SmartPtr <NQP_IPOPT> _ipsolver;
     Ipopt::SmartPtr <LCP_IPOPT> _lcpsolver;
+
+    // whether IPOPT has been set up for the structure of the last NQP
+    bool _nqp_initialized;
     #endif
+
+    // contact impulses and multipliers from NQP solves (for warm starting)
+    struct NQPContactSolution
+    {
+      Point3d point;                // the contact point
+      double cn, cs, ct;            // the contact impulses
+      double z_cn;                  // the multiplier for cn >= 0
+      double lambda_cn, lambda_mu;  // the noninterpenetration and friction cone multipliers
+    };
+
+    // limit impulses and multipliers from NQP solves (for warm starting)
+    struct NQPLimitSolution
+    {
+      double l;                     // the limit impulse
+      double z_l;                   // the multiplier for l >= 0
+      double lambda_l;              // the limit constraint multiplier
+    };
+
+    // NQP solutions during this and the last call to process_constraints(),
+    // keyed by geometry pair (contacts) and by joint and 2*dof + upper (limits)
+    typedef std::pair<const CollisionGeometry*, const CollisionGeometry*> NQPContactKey;
+    typedef std::pair<const Joint*, unsigned> NQPLimitKey;
+    typedef std::multimap<NQPContactKey, NQPContactSolution> NQPContactMap;
+    typedef std::map<NQPLimitKey, NQPLimitSolution> NQPLimitMap;
+    NQPContactMap _nqp_contacts, _nqp_last_contacts;
+    NQPLimitMap _nqp_limits, _nqp_last_limits;
     Ravelin::MatrixNd _RTH;
     Ravelin::VectorNd _w, _workv2, _x;
 
@@ -26,6 +26,9 @@ class LCP
     bool lcp_fast_regularized(const Ravelin::MatrixNd& M, const Ravelin::VectorNd& q, Ravelin::VectorNd& z, int min_exp = -20, unsigned step_exp = 4, int max_exp = 20, double piv_tol = -1.0, double zero_tol = -1.0);
     bool fast_pivoting(const Ravelin::MatrixNd& M, const Ravelin::VectorNd& q, Ravelin::VectorNd& z, double eps = std::sqrt(std::numeric_limits<double>::epsilon()));
 
+    /// The number of pivots over all solves (may be reset by the user)
+    unsigned long total_pivots;
+
   private:
     unsigned pivots;
     static void log_failure(const Ravelin::MatrixNd& M, const Ravelin::VectorNd& q);
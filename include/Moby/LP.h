@@ -1,27 +1,46 @@
 /****************************************************************************
  * Copyright 2015 Evan Drumwright
- * This library is distributed under the terms of the Apache V2.0 
+ * This library is distributed under the terms of the Apache V2.0
  * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
  ****************************************************************************/
 
 #ifndef _LP_H
 #define _LP_H
 
+#include <vector>
 #include <Ravelin/NonsquareMatrixException.h>
 #include <Ravelin/VectorNd.h>
 #include <Ravelin/MatrixNd.h>
 
 namespace Moby {
 
-/// Determines closest points/common points between two polytopes 
-class LP 
+/// Solves low-dimensional linear programs (and least-squares programs) using Seidel's method
+/**
+ * Both solvers share one randomized incremental implementation, which runs
+ * in expected O(d!n) time for d variables and n constraints (i.e., O(n) for
+ * fixed dimension). All work is done in a workspace that is retained between
+ * calls (one per thread), so solving problems no larger than those solved
+ * previously by the same thread performs no memory allocation.
+ *
+ * The constraints are processed in an order given by a pseudo-random
+ * generator that is reseeded (with 'seed') on every call, so results are
+ * reproducible and independent of the state of rand(). The solvers may be
+ * called concurrently (as long as 'seed' is not changed meanwhile).
+ */
+class LP
 {
   public:
     static bool lp_seidel(const Ravelin::MatrixNd& A, const Ravelin::VectorNd& b, const Ravelin::VectorNd& c, const Ravelin::VectorNd& l, const Ravelin::VectorNd& u, Ravelin::VectorNd& x);
+    static bool lsq_seidel(const Ravelin::MatrixNd& A, const Ravelin::VectorNd& b, const Ravelin::MatrixNd& C, const Ravelin::VectorNd& e, Ravelin::VectorNd& x);
+
+    /// The seed used to order the constraints
+    static unsigned seed;
 
   private:
-    static Ravelin::VectorNd& insert_component(const Ravelin::VectorNd& x, unsigned k, Ravelin::VectorNd& xn);
-    static Ravelin::VectorNd& remove_component(const Ravelin::VectorNd& x, unsigned k, Ravelin::VectorNd& xn);
+    static bool solve(const Ravelin::MatrixNd& A, const Ravelin::VectorNd& b, const Ravelin::VectorNd& c, const Ravelin::VectorNd& l, const Ravelin::VectorNd& u, const Ravelin::MatrixNd& C, const Ravelin::VectorNd& e, Ravelin::VectorNd& x);
+    static bool seidel(unsigned d, unsigned n, const double* A, const double* b, const double* c, const double* l, const double* u, unsigned m, const double* C, const double* e, double* x, double* stack, double* scratch);
+    static bool seidel_1d(unsigned n, const double* A, const double* b, double c, double l, double u, unsigned m, const double* C, const double* e, double& x);
+    static void solve_unconstrained(unsigned d, const double* c, const double* l, const double* u, unsigned m, const double* C, const double* e, double* x, double* scratch);
     static double finitize(double x);
 }; // end class
 
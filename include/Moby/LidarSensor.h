@@ -0,0 +1,79 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _LIDAR_SENSOR_H
+#define _LIDAR_SENSOR_H
+
+#include <vector>
+#include <Moby/RaySensor.h>
+
+namespace Moby {
+
+/// A scanning range finder (lidar)
+/**
+ * The lidar samples a grid of azimuth (about the z-axis of the sensor frame,
+ * measured from the x-axis) and elevation (from the x-y plane) angles. The
+ * ranges are stored row-major, with one row per elevation and one column
+ * per azimuth; a ray that does not hit anything yields a range of
+ * std::numeric_limits<double>::max().
+ *
+ * If spin_rate is zero, the lidar is solid state: all columns are sampled
+ * at every update. Otherwise, the lidar head rotates about the z-axis at
+ * spin_rate (radians per unit time), the columns cover a full revolution,
+ * and each update samples only the columns that the head swept since the
+ * previous update.
+ */
+class LidarSensor : public RaySensor
+{
+  public:
+    LidarSensor();
+    void setup();
+    virtual void prepare(double t);
+    virtual unsigned num_rays() const { return _ncols * vertical_samples; }
+    virtual void get_rays(std::vector<LineSeg3>& segs) const;
+    virtual void set_ray_results(const SceneQueryResults& results, unsigned offset);
+    virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
+    virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
+
+    /// Gets the ranges (vertical_samples rows by horizontal_samples columns)
+    const std::vector<double>& get_ranges() const { return _ranges; }
+
+    /// The number of azimuth samples (default = 360)
+    unsigned horizontal_samples;
+
+    /// The number of elevation samples (default = 1)
+    unsigned vertical_samples;
+
+    /// The minimum and maximum azimuth angles (ignored for a spinning lidar; default = [-pi, pi))
+    double min_azimuth, max_azimuth;
+
+    /// The minimum and maximum elevation angles (default = 0)
+    double min_elevation, max_elevation;
+
+    /// The rate at which the lidar head spins, in radians per unit time (default = 0)
+    double spin_rate;
+
+  private:
+    double get_azimuth(unsigned col) const;
+    double get_elevation(unsigned row) const;
+
+    /// The ranges
+    std::vector<double> _ranges;
+
+    /// The sine and cosine of each azimuth and elevation
+    std::vector<double> _saz, _caz, _sel, _cel;
+
+    /// The first column sampled at the current update and the number of columns sampled
+    unsigned _col0, _ncols;
+
+    /// The number of head positions passed as of the last update (-1 before the first update)
+    long _last_tick;
+}; // end class
+
+} // end namespace
+
+#endif
+
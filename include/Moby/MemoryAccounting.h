@@ -0,0 +1,75 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _MOBY_MEMORY_ACCOUNTING_H
+#define _MOBY_MEMORY_ACCOUNTING_H
+
+#include <cstddef>
+#include <ostream>
+
+namespace Moby {
+
+/// Accounts for the memory allocated by each subsystem
+/**
+ * When Moby is built with MEMORY_ACCOUNTING, the global allocation operators
+ * (including the aligned forms, when compiled as C++17) are replaced so that every allocation is tagged with the subsystem that
+ * is current (in the allocating thread) and every deallocation is charged
+ * back to the subsystem that made the allocation; memory retained by a
+ * subsystem (e.g., meshes or bounding volume hierarchies built during
+ * collision detection) thus remains attributed to it. Subsystems are made
+ * current by placing a MemoryAccounting::Scope at their entry points; the
+ * innermost scope wins. Without MEMORY_ACCOUNTING, scopes compile to nothing
+ * and all counts are zero.
+ */
+class MemoryAccounting
+{
+  public:
+    /// The subsystems to which allocations are charged
+    enum Subsystem
+    {
+      eOther,              // anything outside of a tagged scope
+      eGeometry,           // primitives, meshes, and narrow phase queries
+      eBroadPhase,         // broad phase collision detection and body registration
+      eConstraints,        // finding unilateral constraints
+      eSolver,             // impact and stabilization solves
+      eArticulatedBodies,  // articulated body setup and forward dynamics
+      eIO,                 // reading and writing scenes
+      eNumSubsystems
+    };
+
+    /// Makes a subsystem current for the lifetime of the object
+    class Scope
+    {
+      public:
+        #ifdef MEMORY_ACCOUNTING
+        Scope(Subsystem s) { _last = MemoryAccounting::set_current(s); }
+        ~Scope() { MemoryAccounting::set_current(_last); }
+        #else
+        Scope(Subsystem s) {}
+        #endif
+
+      private:
+        #ifdef MEMORY_ACCOUNTING
+        Subsystem _last;
+        #endif
+    };
+
+    static bool enabled();
+    static Subsystem set_current(Subsystem s);
+    static Subsystem get_current();
+    static size_t get_bytes(Subsystem s);
+    static size_t get_peak_bytes(Subsystem s);
+    static size_t get_total_bytes();
+    static size_t get_total_peak_bytes();
+    static void reset_peaks();
+    static const char* get_name(Subsystem s);
+    static void report(std::ostream& out);
+}; // end class
+
+} // end namespace
+
+#endif
+
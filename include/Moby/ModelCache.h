@@ -0,0 +1,85 @@
+/****************************************************************************
+ * Copyright 2016 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _MOBY_MODEL_CACHE_H
+#define _MOBY_MODEL_CACHE_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <Moby/Types.h>
+
+namespace Moby {
+
+class IndexedTriArray;
+class Polyhedron;
+
+/// Caches data read from model files so that repeated loads are cheap
+/**
+ * Meshes (and their convex hulls) are keyed by the resolved path, size, and
+ * modification time of the mesh file, so identical URIs share one
+ * (immutable) mesh. Parsed model description files (URDF/SDF) are keyed the
+ * same way; at most max_trees trees are kept, and the least recently used
+ * tree is discarded first. The convex hull of a mesh object (cached or not)
+ * is shared by every primitive using that object for as long as the object
+ * lives. Cached objects are shared, so they must never be modified in
+ * place (TriangleMeshPrimitive::center(), for example, creates a new mesh);
+ * the only exception is the processed flags of cached trees, which readers
+ * set and which are cleared whenever a tree is returned from the cache.
+ * \note the cache is not thread-safe; only prefetch_meshes() runs in parallel
+ */
+class ModelCache
+{
+  public:
+    static boost::shared_ptr<const IndexedTriArray> get_mesh(const std::string& fname);
+    static boost::shared_ptr<const Polyhedron> get_convex_hull(const std::string& fname);
+    static boost::shared_ptr<const IndexedTriArray> get_convex_hull_mesh(boost::shared_ptr<const IndexedTriArray> mesh);
+    static boost::shared_ptr<const XMLTree> get_tree(const std::string& fname);
+    static void prefetch_meshes(const std::vector<std::string>& fnames);
+    static void clear();
+
+    /// Set to false to disable caching (files are then read on every request)
+    static bool enabled;
+
+    /// The maximum number of model description trees to keep (default 32)
+    static unsigned max_trees;
+
+  private:
+    /// A cached model description tree
+    struct CachedTree
+    {
+      boost::shared_ptr<const XMLTree> tree;
+
+      /// The value of _tree_requests when the tree was last returned
+      unsigned long last_used;
+    };
+
+    static std::string get_file_key(const std::string& fname);
+    static boost::shared_ptr<const IndexedTriArray> load_mesh(const std::string& fname);
+    static void clear_processed(boost::shared_ptr<const XMLTree> node);
+
+    /// Cached meshes
+    static std::map<std::string, boost::shared_ptr<const IndexedTriArray> > _meshes;
+
+    /// Cached convex hulls of meshes
+    static std::map<std::string, boost::shared_ptr<const Polyhedron> > _hulls;
+
+    /// Cached convex hulls of mesh objects (entries expire with the meshes)
+    static std::map<boost::weak_ptr<const IndexedTriArray>, boost::shared_ptr<const IndexedTriArray> > _hull_meshes;
+
+    /// Cached model description trees
+    static std::map<std::string, CachedTree> _trees;
+
+    /// Counts the tree requests (for discarding the least recently used tree)
+    static unsigned long _tree_requests;
+}; // end class
+
+} // end namespace
+
+#endif
+
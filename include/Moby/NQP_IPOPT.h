@@ -1,6 +1,6 @@
 /****************************************************************************
  * Copyright 2011 Evan Drumwright
- * This library is distributed under the terms of the Apache V2.0 
+ * This library is distributed under the terms of the Apache V2.0
  * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
  ****************************************************************************/
 
@@ -15,31 +15,46 @@
 #include <Moby/Base.h>
 #include <Moby/Types.h>
 #include <Moby/LCP.h>
-#include <Moby/Event.h>
-#include <Moby/EventProblemData.h>
+#include <Moby/UnilateralConstraintProblemData.h>
 
 namespace Moby {
 
-/// Defines the mechanism for handling impact events 
-class NQP_IPOPT : public Ipopt::TNLP 
+/// Defines the nonlinearly constrained QP (true friction cones) for impacts
+/**
+ * The variables are [cn; cs; ct; l]. The problem data (H, c, mu_c, mu_visc,
+ * and the starting point) must be set, and then setup_sparse() must be
+ * called, before each solve. The Hessian and constraint Jacobian are given
+ * to IPOPT in sparse form: their sparsity follows the structural nonzeros of
+ * H, which depend only upon which constraints share bodies, so the structure
+ * remains the same between solves of the same set of contacts and IPOPT can
+ * be reoptimized without repeating its setup.
+ */
+class NQP_IPOPT : public Ipopt::TNLP
 {
   public:
     NQP_IPOPT();
+    bool setup_sparse();
 
-    /// Particular solution (before optimization), final solution (after)
+    /// Final solution (after optimization)
     Ravelin::VectorNd z;
 
-    /// noninterpenetration jacobian block
-    Ravelin::MatrixNd Cn_block;
+    /// Multipliers for the nonlinear constraints at the final solution
+    Ravelin::VectorNd lambda;
 
-    /// noninterpenetration vector
-    Ravelin::SharedConstVectorNd Cn_v;
+    /// Multipliers for the variable lower bounds at the final solution
+    Ravelin::VectorNd z_L;
 
-    /// noninterpenetration jacobian block
-    Ravelin::SharedConstMatrixNd L_block;
+    /// Whether to start from z0, lambda0, and z_L0 (rather than from zero)
+    bool warm_start;
 
-    /// Nullspace for optimization
-    Ravelin::MatrixNd R;
+    /// Starting point for the variables (used if warm_start is true)
+    Ravelin::VectorNd z0;
+
+    /// Starting point for the constraint multipliers (used if warm_start is true)
+    Ravelin::VectorNd lambda0;
+
+    /// Starting point for the lower bound multipliers (used if warm_start is true)
+    Ravelin::VectorNd z_L0;
 
     /// Quadratic optimization matrix
     Ravelin::MatrixNd H;
@@ -47,18 +62,18 @@ class NQP_IPOPT : public Ipopt::TNLP
     /// Linear optimization vector
     Ravelin::VectorNd c;
 
-    /// pointer to the EventProblemData
-    const EventProblemData* epd;
+    /// pointer to the UnilateralConstraintProblemData
+    const UnilateralConstraintProblemData* epd;
 
-    /// Squared Coulomb friction coefficients for contacts (size N_TRUE_CONE)
+    /// Squared Coulomb friction coefficients for contacts (size N_CONTACTS)
     std::vector<double> mu_c;
 
-    /// Squared viscous terms for contacts (size N_TRUE_CONE); this is squared viscous friction coefficient times squared tangential contact velocity
+    /// Squared viscous terms for contacts (size N_CONTACTS); this is squared viscous friction coefficient times squared tangential contact velocity
     std::vector<double> mu_visc;
 
   public:
     // virtual methods for IPOPT-based optimization
-    virtual bool get_nlp_info(Ipopt::Index& n, Ipopt::Index& m, Ipopt::Index& nnz_jac_g, Ipopt::Index& nnz_h_lag, Ipopt::TNLP::IndexStyleEnum& index_style);   
+    virtual bool get_nlp_info(Ipopt::Index& n, Ipopt::Index& m, Ipopt::Index& nnz_jac_g, Ipopt::Index& nnz_h_lag, Ipopt::TNLP::IndexStyleEnum& index_style);
     virtual bool get_bounds_info(Ipopt::Index n, Ipopt::Number* x_l, Ipopt::Number* x_u, Ipopt::Index m, Ipopt::Number* g_l, Ipopt::Number* g_u);
     virtual bool get_starting_point(Ipopt::Index n, bool init_x, Ipopt::Number* x, bool init_z, Ipopt::Number* z_L, Ipopt::Number* z_U, Ipopt::Index m, bool init_lambda, Ipopt::Number* lambda);
     virtual bool eval_f(Ipopt::Index n, const Ipopt::Number* x, bool new_x, Ipopt::Number& obj_value);
@@ -68,45 +83,23 @@ class NQP_IPOPT : public Ipopt::TNLP
     virtual bool eval_h(Ipopt::Index n, const Ipopt::Number* x, bool new_x, Ipopt::Number obj_factor, Ipopt::Index m, const Ipopt::Number* lambda, bool new_lambda, Ipopt::Index nele_hess, Ipopt::Index* iRow, Ipopt::Index* jCol, Ipopt::Number* values);
     virtual void finalize_solution(Ipopt::SolverReturn status, Ipopt::Index n, const Ipopt::Number* x, const Ipopt::Number* z_L, const Ipopt::Number* z_U, Ipopt::Index, const Ipopt::Number* g, const Ipopt::Number* lambda, Ipopt::Number obj_value, const Ipopt::IpoptData* ip_data, Ipopt::IpoptCalculatedQuantities* ip_cq);
 
-    // tolerance for checking for zero
-    double _ZERO_EPS;
-
-    // number of nonzeros in objective Hessian
-    unsigned _nnz_h_obj;
+  private:
+    // the number of variables and constraints
+    unsigned _n, _m;
 
-    // number of nonzeros in each nonlinear constraint Hessian
-    std::vector<unsigned> _nnz_h_con;
+    // the upper triangle of H in triplet form
+    std::vector<unsigned> _h_iRow, _h_jCol;
+    std::vector<double> _h_obj;
 
-    // the objective Hessian nonzero values
-    boost::shared_array<double> _h_obj;
+    // index of each diagonal element of H in the triplets
+    std::vector<unsigned> _h_diag;
 
-    // the constraint Hessian nonzero values
-    std::vector<boost::shared_array<double> > _h_con;
-    
-    // indices (mapping from 0..nnz in constraint hessian to index in additive Hessian array
-    std::vector<std::vector<unsigned> > _h_con_indices;
-
-    // number of constant components of the constraint Jacobian
+    // number of (constant) linear components of the constraint Jacobian
     unsigned _cJac_constant;
 
-    // constant components of constraint Jacobian
-    boost::shared_array<double> _cJac;
-
-    // nonzero indices of the constraint Jacobian
-    boost::shared_array<unsigned> _cJac_iRow, _cJac_jCol;
-
-    // nonzero indices of the Hessian 
-    boost::shared_array<unsigned> _h_iRow, _h_jCol;
-
-    // temporaries 
-    Ravelin::VectorNd _w, _workv, _workv2, _x;
-    Ravelin::MatrixNd _M;
-
-    // is the problem dense or not?
-    bool _dense;
-
-    // tolerance for the Coulomb friction and kappa constraints
-    double _tol;
+    // the constraint Jacobian in triplet form (only the linear components have values)
+    std::vector<unsigned> _cJac_iRow, _cJac_jCol;
+    std::vector<double> _cJac;
 }; // end class
 } // end namespace
 
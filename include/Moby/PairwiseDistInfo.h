@@ -13,11 +13,14 @@ namespace Moby {
 
 struct PairwiseDistInfo
 {
+  PairwiseDistInfo() { coarse = false; }
+
   CollisionGeometryPtr a;  // the first geometry
   CollisionGeometryPtr b;  // the second geometry
   double dist;             // the signed distance
   Point3d pa;              // the closest point on geometry A
   Point3d pb;              // the closest point on geometry B
+  bool coarse;             // whether dist was computed using coarser levels of detail (and is only a lower bound)
 }; // end struct
 
 } // end namespace
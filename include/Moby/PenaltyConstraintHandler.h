@@ -23,9 +23,9 @@ class PenaltyConstraintHandler
 {
   public:
     PenaltyConstraintHandler();
-    void process_constraints(const std::vector<UnilateralConstraint>& constraints) const;
+    void process_constraints(std::vector<UnilateralConstraint>& constraints) const;
   private:
-    void apply_model(const std::vector<UnilateralConstraint>& constraints) const;
+    void apply_model(std::vector<UnilateralConstraint>& constraints) const;
     static double sqr(double x) { return x*x; }
 }; // end class
 } // end namespace
@@ -0,0 +1,51 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _MOBY_PER_THREAD_H
+#define _MOBY_PER_THREAD_H
+
+#include <pthread.h>
+
+namespace Moby {
+
+/// An object of which each thread has its own instance
+/**
+ * Instances are default constructed on first use by a thread and destroyed
+ * when that thread exits. This allows workspaces that are retained between
+ * calls (to avoid memory allocation) to be used by functions that are
+ * called concurrently.
+ */
+template <class T>
+class PerThread
+{
+  public:
+    PerThread() { pthread_key_create(&_key, &destroy); }
+    ~PerThread() { destroy(pthread_getspecific(_key)); pthread_key_delete(_key); }
+
+    /// Gets the calling thread's instance
+    T& get()
+    {
+      T* t = (T*) pthread_getspecific(_key);
+      if (!t)
+      {
+        t = new T;
+        pthread_setspecific(_key, t);
+      }
+      return *t;
+    }
+
+  private:
+    PerThread(const PerThread&);
+    PerThread& operator=(const PerThread&);
+    static void destroy(void* t) { delete (T*) t; }
+
+    pthread_key_t _key;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -36,6 +36,14 @@ class PolyhedralPrimitive : public Primitive
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
     virtual void set_pose(const Ravelin::Pose3d& P);
+    virtual double calc_signed_dist(const Point3d& p) const;
+    void build_distance_field(unsigned max_recursion, double epsilon);
+
+    /// Sets the distance field used to answer point distance queries (NULL to use the polyhedron)
+    void set_distance_field(boost::shared_ptr<ADF> adf) { _adf = adf; }
+
+    /// Gets the distance field used to answer point distance queries, if any
+    boost::shared_ptr<ADF> get_distance_field() const { return _adf; }
 
     /// Gets the polyhedron corresponding to this primitive (in its transformed state)
     const Polyhedron& get_polyhedron() const { return _poly; }
@@ -66,6 +74,9 @@ class PolyhedralPrimitive : public Primitive
     void calc_mass_properties();
     double calc_signed_dist(boost::shared_ptr<const PolyhedralPrimitive> p, Point3d& pthis, Point3d& pp) const;
     Polyhedron _poly;
+
+    /// The distance field over the polyhedron (if any)
+    boost::shared_ptr<ADF> _adf;
 }; // end class
 
 #include "PolyhedralPrimitive.inl"
@@ -0,0 +1,66 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _RAY_SENSOR_H
+#define _RAY_SENSOR_H
+
+#include <vector>
+#include <Moby/Sensor.h>
+#include <Moby/SceneQueryResults.h>
+
+namespace Moby {
+
+/// An abstract sensor whose output is determined by casting rays into the scene
+/**
+ * The simulator gathers the rays of all ray sensors that are due and casts
+ * them in a single batch (see CollisionDetection::cast_segments()). Each ray
+ * begins min_range from the origin of the sensor frame and ends max_range
+ * from it; only geometries whose collision groups intersect the sensor's
+ * collision mask are seen. By default, the rays pass through the geometries
+ * of the body that the sensor is attached to.
+ */
+class RaySensor : public Sensor
+{
+  public:
+    RaySensor();
+    virtual void update(ConstraintSimulator* sim, double dt);
+    virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
+    virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
+
+    /// Selects the rays to be cast for an update at time t
+    virtual void prepare(double t) { }
+
+    /// Gets the number of rays to be cast for the update
+    virtual unsigned num_rays() const = 0;
+
+    /// Appends the rays to be cast for the update (global frame) to segs
+    virtual void get_rays(std::vector<LineSeg3>& segs) const = 0;
+
+    void get_ignored_bodies(std::vector<RigidBodyPtr>& ignored) const;
+
+    /// Sets the output of the sensor from the results of its rays, which begin at index offset
+    virtual void set_ray_results(const SceneQueryResults& results, unsigned offset) = 0;
+
+    /// The distance from the sensor origin at which rays begin (default = 0)
+    double min_range;
+
+    /// The distance from the sensor origin at which rays end (default = 10)
+    double max_range;
+
+    /// The collision groups that the sensor can see (default = all)
+    unsigned collision_mask;
+
+    /// Whether the rays pass through the geometries of the sensor's own body (default = true)
+    bool ignore_own_body;
+
+  protected:
+    void append_ray(const Ravelin::Transform3d& gTs, const Ravelin::Origin3d& dir, double t0, double t1, std::vector<LineSeg3>& segs) const;
+}; // end class
+
+} // end namespace
+
+#endif
+
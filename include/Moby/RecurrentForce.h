@@ -11,6 +11,7 @@
 #include <map>
 #include <boost/shared_ptr.hpp>
 #include <Ravelin/DynamicBodyd.h>
+#include <Ravelin/RigidBodyd.h>
 #include <Moby/Base.h>
 
 namespace Moby {
@@ -20,14 +21,37 @@ namespace Moby {
  * Recurrent forces may be constant (like gravity) or vary by the velocity
  * of the body (like wind resistance).  The recurrent force can be either an
  * actual force, or a torque, or both.
+ *
+ * The simulator applies each recurrent force to all bodies that it affects
+ * with a single call to add_forces(). Derived classes can override that
+ * method to resolve per-link data (links of articulated bodies, parameters)
+ * into flat arrays only when the set of bodies changes, rather than on
+ * every call to add_force().
  */
 class RecurrentForce : public virtual Base
 {
   public:
+    RecurrentForce() { _batch_valid = false; }
     virtual ~RecurrentForce() { }
     
     /// Abstract method for applying this force/torque to a body
     virtual void add_force(boost::shared_ptr<Ravelin::DynamicBodyd> body) = 0;  
+
+    virtual void add_forces(const std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> >& bodies);
+
+    /// Forces per-body data to be resolved again on the next call to add_forces() (call after changing parameters)
+    void invalidate_batch() { _batch_valid = false; }
+
+  protected:
+    bool update_batch(const std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> >& bodies);
+    static void get_links(const std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> >& bodies, std::vector<boost::shared_ptr<Ravelin::RigidBodyd> >& links, std::vector<unsigned>& owners);
+
+  private:
+    /// The bodies for which per-body data was last resolved
+    std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> > _batch_bodies;
+
+    /// Whether per-body data is valid for _batch_bodies
+    bool _batch_valid;
 }; // end class
 
 } // end namespace Moby
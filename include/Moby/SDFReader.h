@@ -56,6 +56,7 @@ class SDFReader
     static boost::shared_ptr<const XMLTree> find_one_tag(const std::string& tag, boost::shared_ptr<const XMLTree> root);
     static std::list<boost::shared_ptr<const XMLTree> > find_tag(const std::string& tag, boost::shared_ptr<const XMLTree> root);
     static void find_tag(const std::string& tag, boost::shared_ptr<const XMLTree> root, std::list<boost::shared_ptr<const XMLTree> >& l);
+    static void find_mesh_uris(boost::shared_ptr<const XMLTree> root, std::vector<std::string>& uris);
     static boost::shared_ptr<OSGGroupWrapper> read_OSG_file(boost::shared_ptr<const XMLTree> node);
     static PrimitivePtr read_heightmap(boost::shared_ptr<const XMLTree> node);
     static PrimitivePtr read_plane(boost::shared_ptr<const XMLTree> node);
@@ -0,0 +1,39 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _MOBY_SCENE_QUERY_RESULTS_H_
+#define _MOBY_SCENE_QUERY_RESULTS_H_
+
+#include <vector>
+#include <Moby/Types.h>
+
+namespace Moby {
+
+/// The results of a batch of scene queries, stored in flat arrays with one entry per query
+struct SceneQueryResults
+{
+  std::vector<CollisionGeometryPtr> geoms;  // the geometry hit (NULL if none)
+  std::vector<double> t;                    // the (first) hit parameter or the distance
+  std::vector<Point3d> points;              // the point on the geometry (global frame)
+  std::vector<Ravelin::Vector3d> normals;   // the geometry normal at the point (global frame)
+
+  /// Resizes the arrays and clears all hits
+  void resize(unsigned n)
+  {
+    geoms.assign(n, CollisionGeometryPtr());
+    t.resize(n);
+    points.resize(n);
+    normals.resize(n);
+  }
+
+  /// Gets the number of queries
+  unsigned size() const { return geoms.size(); }
+}; // end struct
+
+} // end namespace
+
+#endif
+
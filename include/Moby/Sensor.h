@@ -0,0 +1,73 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _SENSOR_H
+#define _SENSOR_H
+
+#include <map>
+#include <boost/shared_ptr.hpp>
+#include <Ravelin/Pose3d.h>
+#include <Moby/Base.h>
+#include <Moby/Types.h>
+
+namespace Moby {
+
+class ConstraintSimulator;
+
+/// An abstract sensor that is rigidly attached to a rigid body
+/**
+ * The sensor frame is defined relative to the frame of the body. Sensors
+ * are updated by the simulator at the end of each step at which they are
+ * due, according to their rates; each sensor writes its output to buffers
+ * that it allocates when it is configured, so updates do not allocate
+ * memory.
+ */
+class Sensor : public virtual Base
+{
+  public:
+    Sensor();
+    virtual ~Sensor() {}
+    void set_body(RigidBodyPtr body);
+    void set_relative_pose(const Ravelin::Pose3d& P);
+    bool is_due(double t) const;
+    void set_updated(double t);
+    virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
+    virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
+
+    /// Updates the output of the sensor
+    /**
+     * \param sim the simulator
+     * \param dt the size of the step that was just taken
+     */
+    virtual void update(ConstraintSimulator* sim, double dt) = 0;
+
+    /// Gets the body that the sensor is attached to
+    RigidBodyPtr get_body() const { return _body; }
+
+    /// Gets the sensor frame
+    boost::shared_ptr<const Ravelin::Pose3d> get_pose() const { return _F; }
+
+    /// Gets the simulation time of the last update (negative if the sensor has not been updated)
+    double get_timestamp() const { return _timestamp; }
+
+    /// The number of updates per unit of simulation time (0 = update at every step)
+    double rate;
+
+  protected:
+    /// The body that the sensor is attached to
+    RigidBodyPtr _body;
+
+    /// The sensor frame (relative to the body frame)
+    boost::shared_ptr<Ravelin::Pose3d> _F;
+
+    /// The simulation time of the last update
+    double _timestamp;
+}; // end class
+
+} // end namespace
+
+#endif
+
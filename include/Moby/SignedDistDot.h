@@ -15,10 +15,12 @@
 #include <Moby/Types.h>
 #include <Moby/UnilateralConstraint.h>
 #include <Moby/UnilateralConstraintProblemData.h>
+#include <Moby/PairwiseDistInfo.h>
 
 namespace Moby {
 
 class ConstraintSimulator;
+class CollisionDetection;
 
 /// Defines the mechanism for handling impact constraints
 class SignedDistDot
@@ -28,6 +30,7 @@ class SignedDistDot
 
   public:
     static void compute_signed_dist_dot_Jacobians(UnilateralConstraintProblemData& q, Ravelin::MatrixNd& CnT, Ravelin::MatrixNd& CsT, Ravelin::MatrixNd& CtT, Ravelin::MatrixNd& LT, Ravelin::VectorNd& Cdot_v);
+    static double calc_signed_dist_dot(const PairwiseDistInfo& pdi, boost::shared_ptr<CollisionDetection> coldet);
 
   private:
     static double calc_signed_dist(boost::shared_ptr<Ravelin::SingleBodyd> sb1, boost::shared_ptr<Ravelin::SingleBodyd> sb2);
@@ -17,6 +17,7 @@
 #include <Moby/Log.h>
 #include <Moby/RigidBody.h>
 #include <Moby/ArticulatedBody.h>
+#include <Moby/SparseLDLT.h>
 
 namespace osg { 
   class Node;
@@ -40,6 +41,7 @@ class VisualizationData;
 class Simulator : public virtual Base
 {
   friend class ConstraintStabilization;
+  friend class DomainDecomposition;
   friend class ImpactConstraintHandler;
   friend class RigidBody;
   friend class RCArticulatedBody;
@@ -49,8 +51,9 @@ class Simulator : public virtual Base
     virtual ~Simulator(); 
     virtual double step(double step_size);
     ControlledBodyPtr find_dynamic_body(const std::string& name) const;
-    void add_dynamic_body(ControlledBodyPtr body);
-    void remove_dynamic_body(ControlledBodyPtr body);
+    virtual void add_dynamic_body(ControlledBodyPtr body);
+    virtual void remove_dynamic_body(ControlledBodyPtr body);
+    virtual void reset_caches();
     void update_visualization();
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);  
@@ -79,22 +82,28 @@ class Simulator : public virtual Base
     /// Callback function after a step is completed
     void (*post_step_callback_fn)(Simulator* s);
 
-    /// User time spent by dynamics on the last step
+    /// Wall-clock time spent computing forward dynamics and integrating on the last step
     double dynamics_time;
 
     /// Set of implicit joints maintained in the simulation (does not include implicit joints belonging to RCArticulatedBody objects)
     std::vector<JointPtr> implicit_joints;
 
+    /// Set of linear velocity couplings between joints (e.g., gears and belts) maintained in the simulation
+    std::vector<CouplingConstraintPtr> coupling_constraints;
+
   protected:
     void apply_impulse(boost::shared_ptr<Ravelin::DynamicBodyd> db, const Ravelin::SharedVectorNd& gj);
-    void solve(const std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> >& island, const std::vector<JointPtr>& island_joints, const Ravelin::VectorNd& v, const Ravelin::VectorNd& f, double dt, Ravelin::VectorNd& a, Ravelin::VectorNd& lambda) const;
+    void solve(const std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> >& island, const std::vector<JointPtr>& island_joints, const std::vector<CouplingConstraintPtr>& island_couplings, const Ravelin::VectorNd& v, const Ravelin::VectorNd& f, double dt, Ravelin::VectorNd& a, Ravelin::VectorNd& lambda) const;
+    void get_island_couplings(const std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> >& island, std::vector<CouplingConstraintPtr>& island_couplings) const;
     virtual double check_pairwise_constraint_violations(double t) { return 0.0; }
     void find_islands(std::vector<std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> > >& islands);
+    static double get_current_time();
     unsigned num_generalized_coordinates(const std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> > & island) const;
     osg::Group* _persistent_vdata;
     osg::Group* _transient_vdata;
     void calc_fwd_dyn(double dt);
     void precalc_fwd_dyn();
+    void update_recurrent_force_batches();
 
     /// The set of bodies in the simulation
     std::vector<ControlledBodyPtr> _bodies;
@@ -109,6 +118,15 @@ class Simulator : public virtual Base
     double integrate(double step_size) { return integrate(step_size, _bodies.begin(), _bodies.end()); }
 
   private:
+    /// The recurrent forces in the simulation, each with the bodies that it is applied to
+    std::vector<std::pair<RecurrentForcePtr, std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> > > > _rf_batches;
+
+    /// The bodies and their recurrent forces, in order, from which _rf_batches was determined
+    std::vector<const void*> _rf_signature, _rf_signature_work;
+
+    /// Sparse factorizations of J*inv(M)*J' for each island (keyed by the first body in the island), retained so that the symbolic analysis is reused between steps
+    mutable std::map<boost::shared_ptr<Ravelin::DynamicBodyd>, SparseLDLT> _island_factorizations;
+
     static Ravelin::VectorNd& ode(const Ravelin::VectorNd& x, double t, double dt, void* data, Ravelin::VectorNd& dx);
 }; // end class
 
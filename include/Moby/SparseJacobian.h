@@ -26,6 +26,22 @@ struct MatrixBlock
   Ravelin::MatrixNd block;
 };
 
+/// A sparse matrix in compressed sparse row (CSR) format
+/**
+ * The entries of row i are stored at indices [row_ptr[i], row_ptr[i+1]) of
+ * col_idx and values, in order of increasing column. Entries are structural:
+ * an entry is kept even if its value happens to be zero, so that the pattern
+ * depends only on which blocks are present.
+ */
+struct CSRMatrix
+{
+  CSRMatrix() { rows = cols = 0; }
+  unsigned rows, cols;
+  std::vector<unsigned> row_ptr;
+  std::vector<unsigned> col_idx;
+  std::vector<double> values;
+};
+
 /// A Sparse Jacobian representation along with multiplication routines
 class SparseJacobian
 {
@@ -38,6 +54,8 @@ class SparseJacobian
     Ravelin::MatrixNd& mult(const std::vector<Ravelin::MatrixNd>& M, Ravelin::MatrixNd& result) const; 
     Ravelin::MatrixNd& mult_transpose(const SparseJacobian& M, Ravelin::MatrixNd& result) const; 
     Ravelin::MatrixNd& to_dense(Ravelin::MatrixNd& M) const;
+    CSRMatrix& to_csr(CSRMatrix& M) const;
+    CSRMatrix& calc_J_iM_JT(const std::vector<MatrixBlock>& iM, CSRMatrix& result) const;
 
     // vector of Jacobian blocks
     std::vector<MatrixBlock> blocks;
@@ -0,0 +1,79 @@
+/****************************************************************************
+ * Copyright 2016 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _MOBY_SPARSE_LDLT_H
+#define _MOBY_SPARSE_LDLT_H
+
+#include <vector>
+#include <Ravelin/VectorNd.h>
+#include <Moby/SparseJacobian.h>
+
+namespace Moby {
+
+/// Sparse LDL' factorization of a symmetric matrix
+/**
+ * The matrix is symmetrically permuted using a minimum degree ordering to
+ * reduce fill-in before it is factored. The ordering and the symbolic
+ * analysis (elimination tree and nonzero counts of L) depend only on the
+ * sparsity pattern, so they are computed once and reused by factor() for as
+ * long as the pattern does not change; repeated factorizations of matrices
+ * with the same structure (e.g., J*inv(M)*J' for a mechanism from one step to
+ * the next) only perform the numeric phase.
+ *
+ * The numeric phase is the up-looking algorithm of T. Davis' LDL package.
+ */
+class SparseLDLT
+{
+  public:
+    SparseLDLT() { _n = 0; }
+    void analyze(const CSRMatrix& A);
+    bool factor(const CSRMatrix& A);
+    Ravelin::VectorNd& solve(Ravelin::VectorNd& x) const;
+
+    /// Gets the number of nonzeros in the strictly lower triangular factor L
+    unsigned nnz_L() const { return (_n == 0) ? 0 : _Lp[_n]; }
+
+    /// Gets the fill-reducing permutation (row i of the permuted matrix is row P[i] of the original)
+    const std::vector<unsigned>& get_permutation() const { return _P; }
+
+  private:
+    bool same_pattern(const CSRMatrix& A) const;
+    static void calc_min_degree_ordering(const CSRMatrix& A, std::vector<unsigned>& P);
+
+    // the dimension of the factored matrix
+    unsigned _n;
+
+    // the sparsity pattern that was analyzed
+    std::vector<unsigned> _pattern_ptr, _pattern_idx;
+
+    // the permutation and its inverse
+    std::vector<unsigned> _P, _Pinv;
+
+    // the elimination tree (-1 indicates a root)
+    std::vector<int> _parent;
+
+    // column pointers of L and nonzero counts of its columns
+    std::vector<unsigned> _Lp, _Lnz;
+
+    // row indices and values of L
+    std::vector<unsigned> _Li;
+    std::vector<double> _Lx;
+
+    // the diagonal matrix D
+    std::vector<double> _D;
+
+    // work vectors for the numeric factorization
+    std::vector<double> _Y;
+    std::vector<int> _pattern, _flag;
+
+    // work vector for solving
+    mutable std::vector<double> _work;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -0,0 +1,126 @@
+/****************************************************************************
+ * Copyright 2016 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _MOBY_STATE_RING_H
+#define _MOBY_STATE_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Layout of the shared-memory ring buffer that moby-server publishes
+ * simulation state through.
+ *
+ * The ring has a single writer (the server) and any number of readers. The
+ * writer never waits on readers: each slot is bracketed by sequence numbers
+ * that the writer sets before and after writing the payload, and a reader
+ * accepts a slot only if both sequence numbers match the one it expected.
+ * A reader that is lapped by the writer simply retries with the newest slot.
+ *
+ * Each slot payload consists of (as doubles): the simulation time, the step
+ * number, body poses (7 per body: x, y, z, qx, qy, qz, qw), body velocities
+ * (6 per body: xd, yd, zd, wx, wy, wz), joint positions, and joint velocities.
+ */
+
+/// Magic number identifying a Moby state ring ("MOBY")
+#define MOBY_STATE_RING_MAGIC 0x59424f4du
+
+/// Version of the state ring layout
+#define MOBY_STATE_RING_VERSION 1u
+
+/// Header at the beginning of the shared memory region
+typedef struct MobyStateRingHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t n_bodies;
+  uint32_t n_joint_dofs;
+  uint32_t n_slots;
+  uint32_t payload_size;           // number of doubles in each slot payload
+  volatile uint64_t write_seq;     // number of slots written so far
+} MobyStateRingHeader;
+
+/// Gets the number of doubles in a payload
+static inline uint32_t moby_state_ring_payload_size(uint32_t n_bodies, uint32_t n_joint_dofs)
+{
+  return 2 + n_bodies*13 + n_joint_dofs*2;
+}
+
+/// Gets the number of bytes in a slot (two sequence numbers plus the payload)
+static inline size_t moby_state_ring_slot_bytes(const MobyStateRingHeader* h)
+{
+  return 2*sizeof(uint64_t) + h->payload_size*sizeof(double);
+}
+
+/// Gets the total number of bytes needed for a ring
+static inline size_t moby_state_ring_bytes(uint32_t n_bodies, uint32_t n_joint_dofs, uint32_t n_slots)
+{
+  return sizeof(MobyStateRingHeader) + n_slots*(2*sizeof(uint64_t) + moby_state_ring_payload_size(n_bodies, n_joint_dofs)*sizeof(double));
+}
+
+/// Gets the slot that holds the given sequence number
+static inline unsigned char* moby_state_ring_slot(MobyStateRingHeader* h, uint64_t seq)
+{
+  return (unsigned char*) (h+1) + (seq % h->n_slots)*moby_state_ring_slot_bytes(h);
+}
+
+/// Begins writing the next slot; returns the payload to be filled in
+static inline double* moby_state_ring_begin_write(MobyStateRingHeader* h)
+{
+  const uint64_t seq = h->write_seq;
+  unsigned char* slot = moby_state_ring_slot(h, seq);
+  volatile uint64_t* seq_begin = (volatile uint64_t*) slot;
+  volatile uint64_t* seq_end = (volatile uint64_t*) (slot + sizeof(uint64_t) + h->payload_size*sizeof(double));
+
+  // invalidate the slot before touching the payload
+  *seq_end = ~(uint64_t) 0;
+  __sync_synchronize();
+  *seq_begin = seq;
+  __sync_synchronize();
+  return (double*) (slot + sizeof(uint64_t));
+}
+
+/// Finishes writing the slot started by moby_state_ring_begin_write()
+static inline void moby_state_ring_end_write(MobyStateRingHeader* h)
+{
+  const uint64_t seq = h->write_seq;
+  unsigned char* slot = moby_state_ring_slot(h, seq);
+  volatile uint64_t* seq_end = (volatile uint64_t*) (slot + sizeof(uint64_t) + h->payload_size*sizeof(double));
+  __sync_synchronize();
+  *seq_end = seq;
+  __sync_synchronize();
+  h->write_seq = seq+1;
+}
+
+/// Copies the newest complete slot into payload (payload_size doubles)
+/**
+ * \return the sequence number read, or -1 if nothing has been written yet
+ */
+static inline int64_t moby_state_ring_read_latest(MobyStateRingHeader* h, double* payload)
+{
+  while (1)
+  {
+    const uint64_t n = h->write_seq;
+    if (n == 0)
+      return -1;
+    __sync_synchronize();
+    const uint64_t seq = n-1;
+    unsigned char* slot = moby_state_ring_slot(h, seq);
+    volatile uint64_t* seq_begin = (volatile uint64_t*) slot;
+    volatile uint64_t* seq_end = (volatile uint64_t*) (slot + sizeof(uint64_t) + h->payload_size*sizeof(double));
+    if (*seq_end != seq)
+      continue;
+    __sync_synchronize();
+    memcpy(payload, slot + sizeof(uint64_t), h->payload_size*sizeof(double));
+    __sync_synchronize();
+    if (*seq_begin == seq && *seq_end == seq)
+      return (int64_t) seq;
+  }
+}
+
+#endif
+
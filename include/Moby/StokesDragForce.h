@@ -17,11 +17,21 @@ class StokesDragForce : public RecurrentForce
     StokesDragForce(const StokesDragForce& source);
     virtual ~StokesDragForce() {}
     virtual void add_force(boost::shared_ptr<Ravelin::DynamicBodyd> body);
+    virtual void add_forces(const std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> >& bodies);
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
 
     /// The drag coefficient 
     double b, b_ang;
+
+  private:
+    static void add_drag(boost::shared_ptr<Ravelin::RigidBodyd> rb, double b, double b_ang);
+
+    /// The rigid bodies (and links) that drag is applied to by add_forces()
+    std::vector<boost::shared_ptr<Ravelin::RigidBodyd> > _links;
+
+    /// The bodies that the links belong to
+    std::vector<unsigned> _owners;
 }; // end class
 } // end namespace
 
@@ -10,52 +10,78 @@
 #include <list>
 #include <vector>
 #include <map>
-#include <Ravelin/LinAlgd.h>
+#include <limits>
+#include <Ravelin/sorted_pair>
+#include <Ravelin/Vector2d.h>
 #include <Moby/Base.h>
 #include <Moby/Types.h>
 #include <Moby/LCP.h>
 #include <Moby/UnilateralConstraint.h>
-#include <Moby/SustainedUnilateralConstraintProblemData.h>
 
 namespace Moby {
 
-/// Defines the mechanism for handling impact constraints
+/// Defines the mechanism for handling sustained (resting) unilateral constraints
+/**
+ * Constraint forces are computed at the acceleration level: for each group
+ * of connected constraints, a linear complementarity problem is solved that
+ * prevents contacts and joint limits from accelerating into violation.
+ * Resting contacts are prevented from sliding using a four direction
+ * friction pyramid; contacts that are already sliding (tangential speed
+ * above the sliding tolerance) receive Coulomb friction opposite to the
+ * sliding direction. The bodies' generalized accelerations must already
+ * have been computed; the constraint forces are added to the bodies' force
+ * accumulators, after which forward dynamics must be recomputed.
+ *
+ * Contact forces are retained for each pair of geometries and used to
+ * warm-start the next solve for that pair, so that the active set of a
+ * resting contact configuration that does not change is found immediately.
+ */
 class SustainedUnilateralConstraintHandler
 {
   public:
     SustainedUnilateralConstraintHandler();
-    void process_constraints(const std::vector<UnilateralConstraint>& constraints);
+    void process_constraints(std::vector<UnilateralConstraint>& constraints, double sliding_vel_tol = std::numeric_limits<double>::max());
+    void clear_warm_start_data() { _warm_start.clear(); }
 
   private:
-    static void calc_constraint_velocities(SustainedUnilateralConstraintProblemData& q, Ravelin::VectorNd& cn_v, Ravelin::VectorNd& cs_v, Ravelin::VectorNd& ct_v, Ravelin::VectorNd& l_v); 
-    static ControlledBodyPtr get_super_body(boost::shared_ptr<Ravelin::SingleBodyd> sb);
-    void apply_model(const std::vector<UnilateralConstraint>& constraints);
-    void apply_model_to_connected_constraints(const std::list<UnilateralConstraint*>& constraints);
-    void apply_purely_viscous_model_to_connected_constraints(const std::list<UnilateralConstraint*>& constraints);
-    void compute_problem_data(SustainedUnilateralConstraintProblemData& epd);
-    void compute_problem_data2(SustainedUnilateralConstraintProblemData& epd);
-    bool solve_coulomb_lcp(SustainedUnilateralConstraintProblemData& epd, Ravelin::VectorNd& z);
-    bool solve_purely_viscous_lcp(SustainedUnilateralConstraintProblemData& epd, Ravelin::VectorNd& z);
-    double calc_ke(SustainedUnilateralConstraintProblemData& epd, const Ravelin::VectorNd& z);
-    void apply_forces(const SustainedUnilateralConstraintProblemData& epd);
-    static double sqr(double x) { return x*x; }
-
-    /// the linear algebra object
-    Ravelin::LinAlgd _LA;
-
-    /// the LCP solver
+    void apply_model(std::vector<UnilateralConstraint>& constraints, double sliding_vel_tol);
+    void apply_model_to_connected_constraints(const std::list<UnilateralConstraint*>& constraints, double sliding_vel_tol);
+    void compute_problem_data();
+    bool solve_lcp(Ravelin::VectorNd& z);
+    void get_warm_start(Ravelin::VectorNd& z) const;
+    void save_warm_start(const Ravelin::VectorNd& z);
+    void apply_forces(const Ravelin::VectorNd& z);
+
+    /// The LCP solver
     LCP _lcp;
 
-    /// Problem data
-    SustainedUnilateralConstraintProblemData _epd;
+    /// The contact and limit constraints being processed
+    std::vector<UnilateralConstraint*> _constraints;
+
+    /// The first row of each constraint in the constraint space matrix and vector
+    std::vector<unsigned> _offset;
+
+    /// The index of each resting contact's friction variables (-1 if the constraint has none)
+    std::vector<int> _resting;
+
+    /// The (unit) tangential sliding direction of each sliding contact (zero for other constraints)
+    std::vector<Ravelin::Vector2d> _slide_dir;
+
+    /// The number of contacts with friction variables
+    unsigned _NR;
+
+    /// Contact forces from the last solve for each pair of geometries (per contact: normal force followed by the four friction pyramid forces)
+    std::map<Ravelin::sorted_pair<CollisionGeometryPtr>, std::vector<double> > _warm_start;
+
+    /// Constraint space inverse inertia matrix (normal, first and second tangent directions for each contact; one direction for each limit)
+    Ravelin::MatrixNd _A;
 
-    /// Matrices and vectors for solving LCP
-    Ravelin::MatrixNd _UL, _LL, _MM, _UR, _workM;
-    Ravelin::VectorNd _qq, _workv;
+    /// Constraint space acceleration (normal, first and second tangent directions for each contact; one direction for each limit)
+    Ravelin::VectorNd _a;
 
-    /// Matrices and vectors for solving purely viscous LCP
-    Ravelin::MatrixNd _A, _B, _C, _D, _AU, _AV;
-    Ravelin::VectorNd _alpha_x, _v, _a, _b, _cs_visc, _AS;
+    /// Matrices and vectors for solving LCPs
+    Ravelin::MatrixNd _MM, _workM, _workM2;
+    Ravelin::VectorNd _qq, _z, _workv, _workv2;
 }; // end class
 
 } // end namespace
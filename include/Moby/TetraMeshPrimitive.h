@@ -0,0 +1,129 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifndef _TETRA_MESH_PRIMITIVE_H
+#define _TETRA_MESH_PRIMITIVE_H
+
+#include <map>
+#include <vector>
+#include <string>
+#include <Moby/Primitive.h>
+#include <Moby/IndexedTetraArray.h>
+#include <Moby/OBB.h>
+
+namespace Moby {
+
+/// Represents a solid whose interior is given explicitly by a tetrahedral mesh
+/**
+ * The boundary of the solid consists of the faces of the mesh that belong to
+ * exactly one tetrahedron. A signed distance to the boundary is stored at
+ * every vertex of the mesh (zero on the boundary, negative in the interior);
+ * within a tetrahedron, the signed distance is the barycentric interpolation
+ * of the values at its vertices, and the normal is the (constant) gradient of
+ * that interpolant. Point containment and penetration queries thus require
+ * only locating the tetrahedron that contains the point, which is done
+ * using an axis-aligned bounding box hierarchy over the tetrahedra. The
+ * distance to the boundary is computed exactly for points outside of the
+ * mesh and for points in tetrahedra that have no interior vertices (where the
+ * interpolant is identically zero).
+ *
+ * The mesh is defined in the frame of the primitive.
+ */
+class TetraMeshPrimitive : public Primitive
+{
+  public:
+    TetraMeshPrimitive();
+    TetraMeshPrimitive(const std::string& filename, bool center = true);
+    TetraMeshPrimitive(const std::string& filename, const Ravelin::Pose3d& T, bool center = true);
+    void set_tetra_mesh(boost::shared_ptr<const IndexedTetraArray> mesh);
+    virtual osg::Node* create_visualization();
+    virtual double get_bounding_radius() const { return _bounding_radius; }
+    virtual double calc_signed_dist(const Point3d& p) const;
+    virtual double calc_dist_and_normal(const Point3d& point, std::vector<Ravelin::Vector3d>& normals) const;
+    virtual double calc_signed_dist(boost::shared_ptr<const Primitive> p, Point3d& pthis, Point3d& pp) const;
+    virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
+    virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
+    virtual BVPtr get_BVH_root(CollisionGeometryPtr geom);
+    virtual void get_vertices(boost::shared_ptr<const Ravelin::Pose3d> P, std::vector<Point3d>& vertices) const;
+    virtual boost::shared_ptr<const IndexedTriArray> get_mesh(boost::shared_ptr<const Ravelin::Pose3d> P) { return _boundary; }
+
+    /// Gets the tetrahedral mesh
+    boost::shared_ptr<const IndexedTetraArray> get_tetra_mesh() const { return _mesh; }
+
+    /// Gets the signed distances to the boundary at the vertices of the tetrahedral mesh
+    const std::vector<double>& get_vertex_distances() const { return _vdist; }
+
+    /// The maximum number of tetrahedra in a leaf of the bounding box hierarchy
+    static const unsigned MAX_LEAF_TETRA = 4;
+
+  protected:
+    virtual void calc_mass_properties();
+
+  private:
+    /// A node of the bounding box hierarchy
+    struct Node
+    {
+      double lo[3];     // the lower corner of the box
+      double hi[3];     // the upper corner of the box
+      int left;         // index of the left child (the right follows it); -1 for a leaf
+      unsigned first;   // index of the first tetrahedron of the node
+      unsigned count;   // the number of tetrahedra in the node
+
+      bool is_leaf() const { return left < 0; }
+    };
+
+    /// Data precomputed for each tetrahedron
+    struct TetraData
+    {
+      double Binv[9];          // maps p - d to the first three barycentric coordinates (row-major)
+      double grad[3];          // gradient of the interpolated signed distance
+      unsigned faces[4];       // indices of the boundary triangles formed by this tetrahedron
+      unsigned nfaces;         // the number of boundary triangles formed by this tetrahedron
+      bool degenerate;         // whether the tetrahedron has (nearly) zero volume
+      bool surface;            // whether all vertices lie on the boundary
+    };
+
+    void build_boundary();
+    void build_tree();
+    void build_node(unsigned idx, unsigned first, unsigned count, const std::vector<Ravelin::Origin3d>& centroids);
+    void build_distance_field();
+    int find_tetra(const Point3d& p, double bary[4]) const;
+    double calc_boundary_dist(const Point3d& p, Point3d& closest, unsigned& tri) const;
+    double calc_field_dist(const Point3d& p, Ravelin::Vector3d& normal) const;
+    static double calc_sq_dist(const Node& node, const Point3d& p);
+
+    /// The tetrahedral mesh
+    boost::shared_ptr<const IndexedTetraArray> _mesh;
+
+    /// The boundary of the tetrahedral mesh
+    boost::shared_ptr<const IndexedTriArray> _boundary;
+
+    /// The indices of the mesh vertices that lie on the boundary
+    std::vector<unsigned> _boundary_verts;
+
+    /// The signed distance to the boundary at each vertex of the mesh
+    std::vector<double> _vdist;
+
+    /// Data precomputed for each tetrahedron
+    std::vector<TetraData> _tetra_data;
+
+    /// The nodes of the bounding box hierarchy (the root is the first node)
+    std::vector<Node> _nodes;
+
+    /// The tetrahedra indices, ordered so that each node covers a contiguous range
+    std::vector<unsigned> _tetra;
+
+    /// The distance from the origin of the primitive frame to the farthest vertex
+    double _bounding_radius;
+
+    /// The bounding volumes for the primitive, indexed by geometry
+    std::map<CollisionGeometryPtr, OBBPtr> _obbs;
+}; // end class
+
+} // end namespace
+
+#endif
+
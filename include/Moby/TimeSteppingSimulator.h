@@ -34,13 +34,26 @@ class TimeSteppingSimulator : public ConstraintSimulator
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
     virtual double step(double dt);
+    virtual void reset_caches();
     boost::shared_ptr<ContactParameters> get_contact_parameters(CollisionGeometryPtr geom1, CollisionGeometryPtr geom2) const;
 
     // the minimum step that the simulator should take (default = 1e-8)
     double min_step_size;
 
-    /// Determines whether two geometries are not checked
-    std::set<Ravelin::sorted_pair<CollisionGeometryPtr> > unchecked_pairs;
+    /// The number of consecutive mini-steps that contacts between two geometries must rest before their forces are computed at the acceleration level
+    /**
+     * Forces for such (sustained) contacts are computed by the
+     * SustainedUnilateralConstraintHandler, which keeps the contacts from
+     * becoming impacting, so that only impacting contacts are processed by
+     * the ImpactConstraintHandler. A value of zero (the default) disables
+     * acceleration-level contact force computation. Acceleration-level
+     * contact force computation is not used when the simulator contains
+     * implicit joints.
+     */
+    unsigned sustained_contact_steps;
+
+    /// The maximum normal and tangential contact speed for contacts to be considered resting (default = 1e-3)
+    double sustained_contact_vel_tol;
 
     /// Vectors set and passed to collision detection
     std::vector<std::pair<ControlledBodyPtr, Ravelin::VectorNd> > _x0, _x1;
@@ -54,6 +67,18 @@ class TimeSteppingSimulator : public ConstraintSimulator
     double do_mini_step(double dt);
     void step_si_Euler(double dt);
     double calc_next_CA_Euler_step(double contact_dist_thresh) const;
+    void calc_sustained_unilateral_constraint_forces(double dt);
+    void update_resting_steps();
+    void stabilize_constraints();
+
+    /// Object for handling sustained (resting) contact constraints
+    SustainedUnilateralConstraintHandler _sustained_constraint_handler;
+
+    /// The sustained contact constraints
+    std::vector<UnilateralConstraint> _sustained_constraints;
+
+    /// The number of consecutive mini-steps that contacts between pairs of geometries have been resting
+    std::map<Ravelin::sorted_pair<CollisionGeometryPtr>, unsigned> _resting_steps;
 }; // end class
 
 } // end namespace
@@ -35,6 +35,7 @@ class TriangleMeshPrimitive : public Primitive
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);  
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
     virtual BVPtr get_BVH_root(CollisionGeometryPtr geom);
+    bool intersect_seg(CollisionGeometryPtr geom, const LineSeg3& seg, double& t, Point3d& isect, Ravelin::Vector3d& normal) const;
     virtual void get_vertices(boost::shared_ptr<const Ravelin::Pose3d> P, std::vector<Point3d>& vertices) const;
     virtual double calc_dist_and_normal(const Point3d& point, std::vector<Ravelin::Vector3d>& normals) const;
     virtual boost::shared_ptr<const IndexedTriArray> get_mesh(boost::shared_ptr<const Ravelin::Pose3d> P) { return _mesh; }
@@ -42,11 +43,22 @@ class TriangleMeshPrimitive : public Primitive
     virtual void set_pose(const Ravelin::Pose3d& T);
     virtual double calc_signed_dist(boost::shared_ptr<const Primitive> p, Point3d& pthis, Point3d& pp) const;
     virtual bool is_convex() const;
-    
+    void build_distance_field(unsigned max_recursion, double epsilon);
+
+    /// Sets the distance field used to answer point distance queries (NULL to scan the mesh)
+    void set_distance_field(boost::shared_ptr<ADF> adf) { _adf = adf; }
+
+    /// Gets the distance field used to answer point distance queries, if any
+    boost::shared_ptr<ADF> get_distance_field() const { return _adf; }
+
 
   private:
     void center();
     virtual void calc_mass_properties();
+    static double calc_mesh_signed_dist(const IndexedTriArray& mesh, const Point3d& p);
+    static double calc_mesh_signed_dist(const IndexedTriArray& mesh, const Point3d& p, Ravelin::Vector3d& normal);
+    static double calc_solid_angle(const Triangle& tri, const Point3d& p);
+    static double mesh_distance_function(const Ravelin::Vector3d& p, void* data);
 
     /// Determines whether we convexify the mesh for inertial calculations
     bool _convexify_inertia;
@@ -60,6 +72,9 @@ class TriangleMeshPrimitive : public Primitive
      */
     boost::shared_ptr<const IndexedTriArray> _mesh;
 
+    /// The distance field over the mesh (if any), defined in the mesh frame
+    boost::shared_ptr<ADF> _adf;
+
     /// Edge sample length above which pseudo-vertices are added
     double _edge_sample_length;
 
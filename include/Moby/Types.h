@@ -21,6 +21,7 @@
 namespace Moby {
 
 class TessellatedPolyhedron;
+class ADF;
 class Simulator;
 class RigidBody;
 class SingleBody;
@@ -28,11 +29,13 @@ class ArticulatedBody;
 class RCArticulatedBody;
 class MCArticulatedBody;
 class Joint;
+class CouplingConstraint;
 class CollisionGeometry;
 class Contact;
 class Primitive;
 class Base;
 class RecurrentForce;
+class Sensor;
 class ControlledBody;
 class XMLTree;
 class OSGGroupWrapper;
@@ -73,6 +76,9 @@ typedef boost::shared_ptr<MCArticulatedBody> MCArticulatedBodyPtr;
 /// Reduced-coordinate articulated body joint smart pointer
 typedef boost::shared_ptr<Joint> JointPtr;
 
+/// Coupling constraint smart pointer
+typedef boost::shared_ptr<CouplingConstraint> CouplingConstraintPtr;
+
 /// Collision geometry smart pointer
 typedef boost::shared_ptr<CollisionGeometry> CollisionGeometryPtr;
 
@@ -85,6 +91,9 @@ typedef boost::shared_ptr<Base> BasePtr;
 /// Recurrent force smart pointer
 typedef boost::shared_ptr<RecurrentForce> RecurrentForcePtr;
 
+/// Sensor smart pointer
+typedef boost::shared_ptr<Sensor> SensorPtr;
+
 /// Dynamic body smart pointer
 typedef boost::shared_ptr<ControlledBody> ControlledBodyPtr;
 
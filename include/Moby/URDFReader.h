@@ -61,7 +61,8 @@ class URDFReader
     static bool read_color(boost::shared_ptr<const XMLTree> node, URDFData& data, Ravelin::VectorNd& color);
     static void read_material(boost::shared_ptr<const XMLTree> node, URDFData& data, void* osg_node);
     static PrimitivePtr read_primitive(boost::shared_ptr<const XMLTree> node, URDFData& data);
-//    static boost::shared_ptr<TriangleMeshPrimitive> read_trimesh(boost::shared_ptr<const XMLTree> node, URDFData& data);
+    static bool is_obj_file(const std::string& fname);
+    static boost::shared_ptr<TriangleMeshPrimitive> read_trimesh(boost::shared_ptr<const XMLTree> node, URDFData& data);
     static boost::shared_ptr<SpherePrimitive> read_sphere(boost::shared_ptr<const XMLTree> node, URDFData& data);
     static boost::shared_ptr<BoxPrimitive> read_box(boost::shared_ptr<const XMLTree> node, URDFData& data);
     static boost::shared_ptr<CylinderPrimitive> read_cylinder(boost::shared_ptr<const XMLTree> node, URDFData& data);
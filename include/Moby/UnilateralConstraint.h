@@ -32,7 +32,7 @@ class UnilateralConstraint
     enum Compliance { eRigid, eCompliant};
     UnilateralConstraint();
     UnilateralConstraint(const UnilateralConstraint& e) { _contact_frame = boost::shared_ptr<Ravelin::Pose3d>(new Ravelin::Pose3d); *this = e; }
-    static void determine_connected_constraints(const std::vector<UnilateralConstraint>& constraints, const std::vector<JointPtr>& implicit_joints, std::list<std::pair<std::list<UnilateralConstraint*>, std::list<boost::shared_ptr<Ravelin::SingleBodyd> > > >& groups, std::list<std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> > >& remaining_islands);
+    static void determine_connected_constraints(const std::vector<UnilateralConstraint>& constraints, const std::vector<JointPtr>& implicit_joints, const std::vector<CouplingConstraintPtr>& couplings, std::list<std::pair<std::list<UnilateralConstraint*>, std::list<boost::shared_ptr<Ravelin::SingleBodyd> > > >& groups, std::list<std::vector<boost::shared_ptr<Ravelin::DynamicBodyd> > >& remaining_islands);
     static void remove_inactive_groups(std::list<std::pair<std::list<UnilateralConstraint*>, std::list<boost::shared_ptr<Ravelin::SingleBodyd> > > >& groups);
     UnilateralConstraint& operator=(const UnilateralConstraint& e);
     double calc_contact_vel(const Ravelin::Vector3d& v) const;
@@ -45,7 +45,7 @@ class UnilateralConstraint
     void set_contact_parameters(const ContactParameters& cparams);
     void determine_contact_tangents();
     boost::shared_ptr<const Ravelin::Pose3d> get_pose() const { return GLOBAL; }
-    void compute_constraint_data(Ravelin::MatrixNd& M, Ravelin::VectorNd& q) const;
+    void compute_constraint_data(Ravelin::MatrixNd& M, Ravelin::VectorNd& q, Ravelin::VectorNd* a = NULL) const;
     void compute_cross_constraint_data(const UnilateralConstraint& e, Ravelin::MatrixNd& M) const;
 
     template <class OutputIterator>
@@ -78,6 +78,14 @@ class UnilateralConstraint
     /// Limit impulse magnitude (for limit constraints)
     double limit_impulse;
 
+    /// Velocity offset permitting approach to a limit that has not yet been reached (for speculative limit constraints)
+    /**
+     * The DOF may approach the limit with speed up to this value (the
+     * distance to the limit divided by the lookahead time); this is zero
+     * for limits that have been reached.
+     */
+    double limit_speculative_vel;
+
     /// The point contact (for contact constraints)
     Point3d contact_point;
 
@@ -98,6 +106,14 @@ class UnilateralConstraint
      */
     Ravelin::SMomentumd contact_impulse;
 
+    /// Force that has been applied (for sustained and compliant contact constraints)
+    /**
+     * Force (in the global frame) applied to the body of the first geometry;
+     * the reverse of this force is applied to the body of the second
+     * geometry.
+     */
+    Ravelin::SForced contact_force;
+
     /// The collision geometries involved (for contact constraints)
     CollisionGeometryPtr contact_geom1, contact_geom2;
 
@@ -96,6 +96,7 @@ struct UnilateralConstraintProblemData
 
     // copy implicit constraints, Jacobian, and related terms
     island_ijoints = q.island_ijoints;
+    island_couplings = q.island_couplings;
     J = q.J;
     Jfull = q.Jfull;
     Jx_iM_JxT = q.Jx_iM_JxT;
@@ -140,6 +141,7 @@ struct UnilateralConstraintProblemData
 
     // clear implicit constraint related stuff
     island_ijoints.clear();
+    island_couplings.clear();
     J.blocks.clear();
     Jfull.blocks.clear();
     Jx_iM_JxT.resize(0,0);
@@ -335,7 +337,7 @@ struct UnilateralConstraintProblemData
   // the total number of generalized coordinates
   unsigned N_GC;
 
-  // the number of implicit joint constraint equations (total)
+  // the number of implicit joint and coupling constraint equations (total)
   unsigned N_CONSTRAINT_EQNS_IMP;
 
   // pairwise distances between rigid bodies
@@ -382,6 +384,9 @@ struct UnilateralConstraintProblemData
   // implicit bilateral constraints in this island
   std::vector<JointPtr> island_ijoints;
 
+  // coupling constraints in this island (rows follow the implicit joint rows)
+  std::vector<CouplingConstraintPtr> island_couplings;
+
   // the implicit constraint Jacobian (full)
   SparseJacobian Jfull;
 
@@ -7,24 +7,73 @@
 #ifndef _OPT_QPOASES_H
 #define _OPT_QPOASES_H
 
+#include <map>
+#include <vector>
+#include <boost/shared_ptr.hpp>
 #include <Ravelin/MatrixNd.h>
 #include <Ravelin/VectorNd.h>
 #include <Moby/Constants.h>
+#include <Moby/Log.h>
 #include <qpOASES.hpp>
 
 namespace Moby {
 
+/// Interface to the qpOASES active-set QP solver
+/**
+ * If the structure of a QP is identified (using set_topology()) before it
+ * is solved, the qpOASES problem is retained after the solve. The next QP
+ * with the same structure (and dimensions) is then hot started from the
+ * retained working set and solution, rather than being solved from
+ * scratch; the problem is only solved from scratch when no such QP has
+ * been solved recently or when the hot start fails.
+ */
 class QPOASES
 {
   public:
+   /// Identifies the structure of a QP (e.g., the objects whose constraints form the QP)
+   typedef std::vector<std::pair<const void*, unsigned> > Topology;
+
    QPOASES() {
+     max_problems = 32;
+     _has_topology = false;
+     _tick = 0;
    }
 
   template <class Mat1, class Vec1, class Vec2, class Vec3, class Mat2, class Vec4, class Mat3, class Vec5, class Vec6>
   bool qp_activeset(const Mat1& H, const Vec1& c, const Vec2& lb, const Vec3& ub, const Mat2& M, const Vec4& q, const Mat3& A, const Vec5& b, Vec6& z);
 
+  /// Sets the structure of the next QP to be solved, so that it can be hot started
+  void set_topology(const Topology& topology) { _topology = topology; _has_topology = true; }
+
+  /// Discards all problems retained for hot starting
+  void clear_problems() { _problems.clear(); }
+
+  /// The maximum number of problems retained for hot starting (default = 32)
+  unsigned max_problems;
+
 private:
    static bool rel_equal(double x, double y, double tol = NEAR_ZERO) { return std::fabs(x-y) <= tol*std::max(std::fabs(x), std::max(std::fabs(y), (double) 1.0)); }
+
+   /// A problem retained for hot starting
+   struct WarmProblem
+   {
+     boost::shared_ptr<qpOASES::SQProblem> problem;  // the problem (NULL if not yet solved)
+     Ravelin::MatrixNd H, X;                         // the matrices referenced by the problem
+     int n, m;                                       // the number of variables and constraints
+     unsigned long last_used;                        // when the problem was last used
+   };
+
+   /// The problems retained for hot starting
+   std::map<Topology, WarmProblem> _problems;
+
+   /// The structure of the next QP to be solved
+   Topology _topology;
+
+   /// Whether the structure of the next QP has been set
+   bool _has_topology;
+
+   /// Counts the QPs solved (for discarding the least recently used problem)
+   unsigned long _tick;
 }; // end class
 
 #include "qpOASES.inl"
@@ -38,21 +38,45 @@ bool QPOASES::qp_activeset(const Mat1& H, const Vec1& c, const Vec2& lb, const V
    // set the number of constraints
    int m = M.rows() + A.rows();
 
-   // Setup the problem
-   QProblem problem(n, m);
-
    // configure the problem
    Options opts;
    opts.setToReliable();
    opts.enableEqualities = BT_TRUE;
    opts.printLevel = PL_NONE;
-   problem.setOptions(opts);
 
-   // setup the constraint matrix
+   // see whether a problem with the same structure can be hot started
+   WarmProblem* warm = NULL;
+   if (_has_topology)
+   {
+      _has_topology = false;
+
+      // discard the least recently used problem to make room, if necessary
+      if (_problems.find(_topology) == _problems.end() && !_problems.empty() && _problems.size() >= max_problems)
+      {
+         std::map<Topology, WarmProblem>::iterator lru = _problems.begin();
+         for (std::map<Topology, WarmProblem>::iterator i = _problems.begin(); i != _problems.end(); i++)
+            if (i->second.last_used < lru->second.last_used)
+               lru = i;
+         _problems.erase(lru);
+      }
+
+      warm = &_problems[_topology];
+      warm->last_used = _tick++;
+   }
+
+   // setup the constraint matrix (qpOASES only references the matrices, so
+   // retained problems use their own copies)
    Ravelin::MatrixNd _X;
-   _X.resize(z.rows(), m);
-   _X.set_sub_mat(0, 0, M, Ravelin::eTranspose);
-   _X.set_sub_mat(0, M.rows(), A, Ravelin::eTranspose);
+   Ravelin::MatrixNd& X = (warm) ? warm->X : _X;
+   X.resize(z.rows(), m);
+   X.set_sub_mat(0, 0, M, Ravelin::eTranspose);
+   X.set_sub_mat(0, M.rows(), A, Ravelin::eTranspose);
+   if (warm)
+   {
+      warm->H.resize(n, n);
+      warm->H.set_sub_mat(0, 0, H);
+   }
+   const double* Hdata = (warm) ? warm->H.data() : H.data();
 
    // set the maximum number of working set recalculations
    int nSWR = 100000000;
@@ -75,8 +99,8 @@ bool QPOASES::qp_activeset(const Mat1& H, const Vec1& c, const Vec2& lb, const V
 
    // setup equality and inequality constraints
    Ravelin::VectorNd _lbA, _ubA;
-   _lbA.set_zero(_X.rows());
-   _ubA.set_zero(_X.rows());
+   _lbA.set_zero(X.columns());
+   _ubA.set_zero(X.columns());
 
    // set the inequality constraint into the lower bound vector
    _lbA.set_sub_vec(0, q);
@@ -88,38 +112,84 @@ bool QPOASES::qp_activeset(const Mat1& H, const Vec1& c, const Vec2& lb, const V
    std::fill_n(_ubA.begin(), q.rows(), INF);
    _ubA.set_sub_vec((int) q.rows(), b);
 
-   returnValue result;
-   try {
-      result = problem.init(
-         H.data(),
-         c.data(),
-         _X.data(),
-         _lb.data(),
-         _ub.data(),
-         _lbA.data(),
-         _ubA.data(),
-         nSWR,
-         NULL, /* Maximum solution time */
-         z.data() /* Initial guesses for primal solution */
-      );
+   // attempt to hot start from the working set of the last problem with
+   // the same structure
+   returnValue result = RET_HOTSTART_FAILED;
+   if (warm && warm->problem && warm->n == n && warm->m == m)
+   {
+      try {
+         result = warm->problem->hotstart(
+            Hdata,
+            c.data(),
+            X.data(),
+            _lb.data(),
+            _ub.data(),
+            _lbA.data(),
+            _ubA.data(),
+            nSWR,
+            NULL /* Maximum solution time */
+         );
+      }
+      catch (std::runtime_error e)
+      {
+         result = RET_HOTSTART_FAILED;
+      }
+      FILE_LOG(LOG_OPT) << "QPOASES::qp_activeset() - hot start " << ((result == SUCCESSFUL_RETURN) ? "succeeded" : "failed") << std::endl;
    }
-   catch (std::runtime_error e)
+
+   // solve the problem from scratch, if necessary
+   boost::shared_ptr<SQProblem> problem = (warm) ? warm->problem : boost::shared_ptr<SQProblem>();
+   if (result != SUCCESSFUL_RETURN)
    {
-      return false;
+      problem = boost::shared_ptr<SQProblem>(new SQProblem(n, m));
+      problem->setOptions(opts);
+      nSWR = 100000000;
+      try {
+         result = problem->init(
+            Hdata,
+            c.data(),
+            X.data(),
+            _lb.data(),
+            _ub.data(),
+            _lbA.data(),
+            _ubA.data(),
+            nSWR,
+            NULL, /* Maximum solution time */
+            z.data() /* Initial guesses for primal solution */
+         );
+      }
+      catch (std::runtime_error e)
+      {
+         if (warm)
+            _problems.erase(_topology);
+         return false;
+      }
+
+      // retain the problem for hot starting
+      if (warm)
+      {
+         warm->problem = problem;
+         warm->n = n;
+         warm->m = m;
+      }
    }
 
    // look whether failure is indicated
    if (result != SUCCESSFUL_RETURN) {
       std::cerr << "Failed to solve QP: " << MessageHandling::getErrorCodeMessage(result) << std::endl;
+      if (warm)
+         _problems.erase(_topology);
       return false;
    }
 
    // extract the result
-   result = problem.getPrimalSolution(z.data());
+   result = problem->getPrimalSolution(z.data());
 
    // look whether failure is indicated
    if (result != SUCCESSFUL_RETURN) {
       std::cerr << "Failed to fetch primal solution: " << MessageHandling::getErrorCodeMessage(result) << std::endl;
+      if (warm)
+         _problems.erase(_topology);
       return false;
    }
 
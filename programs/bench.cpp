@@ -0,0 +1,509 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Benchmark that generates scenes from parameters and reports how the step
+ * scales.  Every scene is built in code (no input files are read) from a
+ * fixed random seed, so runs are deterministic and can be compared across
+ * revisions.
+ *****************************************************************************/
+
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <boost/foreach.hpp>
+#include <Moby/Log.h>
+#include <Moby/Constants.h>
+#include <Moby/TimeSteppingSimulator.h>
+#include <Moby/GravityForce.h>
+#include <Moby/ContactParameters.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/RigidBody.h>
+#include <Moby/RCArticulatedBody.h>
+#include <Moby/RevoluteJoint.h>
+#include <Moby/BoxPrimitive.h>
+#include <Moby/SpherePrimitive.h>
+#include <Moby/PlanePrimitive.h>
+#include <Moby/HeightmapPrimitive.h>
+#include <Moby/TriangleMeshPrimitive.h>
+#include <Moby/IndexedTriArray.h>
+
+using boost::shared_ptr;
+using Ravelin::Pose3d;
+using Ravelin::Quatd;
+using Ravelin::Origin3d;
+using Ravelin::Vector3d;
+using Ravelin::MatrixNd;
+using namespace Moby;
+
+/// The shapes of the loose bodies
+enum Shape { eBox, eSphere, eMesh, eMixed };
+
+/// The default simulation step size
+const double DEFAULT_STEP_SIZE = .001;
+
+/// The simulation step size
+double STEP_SIZE = DEFAULT_STEP_SIZE;
+
+/// The number of steps to take
+unsigned MAX_ITER = 1000;
+
+/// The number of loose bodies in the pile
+unsigned N_BODIES = 64;
+
+/// The shape of the loose bodies
+Shape SHAPE = eBox;
+
+/// The number of stacks and the number of boxes in each
+unsigned N_STACKS = 0;
+unsigned STACK_HEIGHT = 10;
+
+/// The number of articulated arms and the number of links in each
+unsigned N_ARMS = 0;
+unsigned N_ARM_LINKS = 6;
+
+/// The number of grid points along each side of the heightmap terrain (0 = flat ground)
+unsigned TERRAIN_RES = 0;
+
+/// Whether the loose bodies are packed closely (dense contact) or spread apart
+bool DENSE = true;
+
+/// The random seed
+unsigned SEED = 1;
+
+/// Whether to output the statistics for every step
+bool OUTPUT_STEPS = false;
+
+/// The size (edge length or diameter) of the loose bodies
+const double BODY_SIZE = 0.1;
+
+/// The gravity (the y axis is up, as for planes and heightmaps)
+shared_ptr<GravityForce> GRAVITY;
+
+/// The contact parameters used for all pairs of geometries
+shared_ptr<ContactParameters> CONTACT_PARAMS;
+
+/// The state of the random number generator
+unsigned long RNG_STATE;
+
+/// Generates a uniformly distributed random number in [lo, hi] (the
+/// generator is local so that results do not depend on the C library)
+double rand_uniform(double lo, double hi)
+{
+  RNG_STATE = (RNG_STATE*1103515245UL + 12345UL) & 0x7fffffffUL;
+  return lo + (hi - lo)*((double) RNG_STATE/0x7fffffffUL);
+}
+
+/// Gets the current time (as a floating-point number)
+double get_current_time()
+{
+  const double MICROSEC = 1.0/1000000;
+  timeval t;
+  gettimeofday(&t, NULL);
+  return (double) t.tv_sec + (double) t.tv_usec * MICROSEC;
+}
+
+/// Gets the resident memory of the process in kilobytes (0 if unavailable)
+unsigned long get_resident_memory()
+{
+  std::ifstream in("/proc/self/status");
+  std::string key;
+  while (in >> key)
+  {
+    if (key == "VmRSS:")
+    {
+      unsigned long kb;
+      in >> kb;
+      return kb;
+    }
+    std::getline(in, key);
+  }
+
+  return 0;
+}
+
+/// Gets the peak resident memory of the process in kilobytes
+unsigned long get_peak_memory()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  #ifdef __APPLE__
+  return usage.ru_maxrss/1024;
+  #else
+  return usage.ru_maxrss;
+  #endif
+}
+
+/// Returns the contact parameters for every pair of geometries
+shared_ptr<ContactParameters> get_contact_parameters(CollisionGeometryPtr g1, CollisionGeometryPtr g2)
+{
+  return CONTACT_PARAMS;
+}
+
+/// Gets the mesh of an octahedron the size of a body, shared by all mesh bodies
+shared_ptr<const IndexedTriArray> get_octahedron()
+{
+  static shared_ptr<const IndexedTriArray> mesh;
+  if (mesh)
+    return mesh;
+
+  const double R = BODY_SIZE*0.5;
+  shared_ptr<std::vector<Origin3d> > verts(new std::vector<Origin3d>);
+  verts->push_back(Origin3d(R,0,0));
+  verts->push_back(Origin3d(-R,0,0));
+  verts->push_back(Origin3d(0,R,0));
+  verts->push_back(Origin3d(0,-R,0));
+  verts->push_back(Origin3d(0,0,R));
+  verts->push_back(Origin3d(0,0,-R));
+  std::vector<IndexedTri> facets;
+  facets.push_back(IndexedTri(0,2,4));
+  facets.push_back(IndexedTri(2,1,4));
+  facets.push_back(IndexedTri(1,3,4));
+  facets.push_back(IndexedTri(3,0,4));
+  facets.push_back(IndexedTri(2,0,5));
+  facets.push_back(IndexedTri(1,2,5));
+  facets.push_back(IndexedTri(3,1,5));
+  facets.push_back(IndexedTri(0,3,5));
+  mesh = shared_ptr<const IndexedTriArray>(new IndexedTriArray(verts, facets));
+  return mesh;
+}
+
+/// Creates a rigid body with a single collision geometry
+RigidBodyPtr create_body(const std::string& id, PrimitivePtr primitive, double mass, const Pose3d& P, bool enabled)
+{
+  RigidBodyPtr rb(new RigidBody);
+  rb->id = rb->body_id = id;
+  if (mass > 0.0)
+  {
+    primitive->set_mass(mass);
+    rb->set_inertia(primitive->get_inertia());
+  }
+  rb->set_pose(P);
+  rb->set_enabled(enabled);
+
+  // add the collision geometry
+  CollisionGeometryPtr cg(new CollisionGeometry);
+  rb->geometries.push_back(cg);
+  cg->set_single_body(rb);
+  cg->set_geometry(primitive);
+
+  return rb;
+}
+
+/// Creates the ground: a plane or a heightmap terrain
+void add_ground(shared_ptr<TimeSteppingSimulator> sim, double extent)
+{
+  PrimitivePtr primitive;
+  if (TERRAIN_RES < 2)
+    primitive = PrimitivePtr(new PlanePrimitive);
+  else
+  {
+    // rolling hills, with a wavelength of several bodies
+    const double WIDTH = extent*2.0, AMPLITUDE = BODY_SIZE*0.5;
+    const double WAVELENGTH = BODY_SIZE*8.0;
+    MatrixNd heights(TERRAIN_RES, TERRAIN_RES);
+    for (unsigned i=0; i< TERRAIN_RES; i++)
+      for (unsigned j=0; j< TERRAIN_RES; j++)
+      {
+        double x = -WIDTH*0.5 + WIDTH*i/(TERRAIN_RES-1);
+        double z = -WIDTH*0.5 + WIDTH*j/(TERRAIN_RES-1);
+        heights(i,j) = AMPLITUDE*std::sin(2.0*M_PI*x/WAVELENGTH)*std::cos(2.0*M_PI*z/WAVELENGTH);
+      }
+    shared_ptr<HeightmapPrimitive> hm(new HeightmapPrimitive);
+    hm->set_heights(heights, WIDTH, WIDTH);
+    primitive = hm;
+  }
+
+  sim->add_dynamic_body(create_body("ground", primitive, 0.0, Pose3d(), false));
+}
+
+/// Creates the primitive for a loose body
+PrimitivePtr create_primitive(Shape shape)
+{
+  if (shape == eMixed)
+    shape = (Shape) ((unsigned) rand_uniform(0.0, 2.999));
+
+  switch (shape)
+  {
+    case eSphere:
+      return PrimitivePtr(new SpherePrimitive(BODY_SIZE*0.5));
+
+    case eMesh:
+    {
+      shared_ptr<TriangleMeshPrimitive> tm(new TriangleMeshPrimitive);
+      tm->set_mesh(get_octahedron());
+      return tm;
+    }
+
+    default:
+      return PrimitivePtr(new BoxPrimitive(BODY_SIZE, BODY_SIZE, BODY_SIZE));
+  }
+}
+
+/// Adds a pile of loose bodies, dropped in layers from above the ground
+void add_pile(shared_ptr<TimeSteppingSimulator> sim)
+{
+  const double SPACING = BODY_SIZE*(DENSE ? 1.05 : 3.0);
+  const unsigned SIDE = std::max((unsigned) std::ceil(std::sqrt((double) N_BODIES/(DENSE ? 4.0 : 1.0))), (unsigned) 1);
+  const double JITTER = BODY_SIZE*0.02;
+  const double BASE_HEIGHT = BODY_SIZE*2.0;
+
+  for (unsigned i=0; i< N_BODIES; i++)
+  {
+    unsigned layer = i/(SIDE*SIDE);
+    unsigned row = (i/SIDE) % SIDE, col = i % SIDE;
+    double x = (row - 0.5*(SIDE-1))*SPACING + rand_uniform(-JITTER, JITTER);
+    double y = BASE_HEIGHT + layer*SPACING;
+    double z = (col - 0.5*(SIDE-1))*SPACING + rand_uniform(-JITTER, JITTER);
+    Quatd q = Quatd::rpy(rand_uniform(-0.1, 0.1), rand_uniform(-M_PI, M_PI), rand_uniform(-0.1, 0.1));
+
+    std::ostringstream id;
+    id << "body" << i;
+    RigidBodyPtr rb = create_body(id.str(), create_primitive(SHAPE), 1.0, Pose3d(q, Origin3d(x, y, z)), true);
+    rb->get_recurrent_forces().push_back(GRAVITY);
+    sim->add_dynamic_body(rb);
+  }
+}
+
+/// Adds stacks of boxes, resting on one another, behind the pile
+void add_stacks(shared_ptr<TimeSteppingSimulator> sim, double extent)
+{
+  for (unsigned i=0; i< N_STACKS; i++)
+    for (unsigned j=0; j< STACK_HEIGHT; j++)
+    {
+      double x = (i - 0.5*(N_STACKS-1))*BODY_SIZE*3.0;
+      double y = BODY_SIZE*(0.5 + j);
+      double z = -extent*0.5 - BODY_SIZE*2.0;
+
+      std::ostringstream id;
+      id << "stack" << i << "-" << j;
+      PrimitivePtr box(new BoxPrimitive(BODY_SIZE, BODY_SIZE, BODY_SIZE));
+      RigidBodyPtr rb = create_body(id.str(), box, 1.0, Pose3d(Quatd::identity(), Origin3d(x, y, z)), true);
+      rb->get_recurrent_forces().push_back(GRAVITY);
+      sim->add_dynamic_body(rb);
+    }
+}
+
+/// Adds fixed-base arms of revolute links that swing down into the scene
+/**
+ * The links of the arms do not collide with each other (adjacent links
+ * overlap at their joints), but do collide with the ground and the loose
+ * bodies.
+ */
+void add_arms(shared_ptr<TimeSteppingSimulator> sim, double extent)
+{
+  const double LINK_LEN = BODY_SIZE*2.0, LINK_WIDTH = BODY_SIZE*0.5;
+  const unsigned ARM_GROUP = 2;
+
+  for (unsigned i=0; i< N_ARMS; i++)
+  {
+    const double Z = extent*0.5 + BODY_SIZE*2.0 + i*BODY_SIZE*2.0;
+    const double X0 = -0.5*N_ARM_LINKS*LINK_LEN;
+    const double Y = N_ARM_LINKS*LINK_LEN + BODY_SIZE;
+
+    std::vector<RigidBodyPtr> links;
+    std::vector<JointPtr> joints;
+    std::ostringstream arm_id;
+    arm_id << "arm" << i;
+
+    // the (fixed) base, which overlaps the first link and so is in the
+    // arm's collision group as well
+    PrimitivePtr base_box(new BoxPrimitive(LINK_WIDTH, LINK_WIDTH, LINK_WIDTH));
+    links.push_back(create_body(arm_id.str() + "-base", base_box, 1.0, Pose3d(Quatd::identity(), Origin3d(X0, Y, Z)), false));
+    BOOST_FOREACH(CollisionGeometryPtr cg, links.back()->geometries)
+    {
+      cg->collision_group = ARM_GROUP;
+      cg->collision_mask = ~ARM_GROUP;
+    }
+
+    // the links, initially horizontal
+    for (unsigned j=0; j< N_ARM_LINKS; j++)
+    {
+      std::ostringstream id;
+      id << arm_id.str() << "-link" << j;
+      PrimitivePtr box(new BoxPrimitive(LINK_LEN, LINK_WIDTH, LINK_WIDTH));
+      Pose3d P(Quatd::identity(), Origin3d(X0 + (j+0.5)*LINK_LEN, Y, Z));
+      RigidBodyPtr link = create_body(id.str(), box, 1.0, P, true);
+      BOOST_FOREACH(CollisionGeometryPtr cg, link->geometries)
+      {
+        cg->collision_group = ARM_GROUP;
+        cg->collision_mask = ~ARM_GROUP;
+      }
+
+      // revolute joint (about z) at the inboard end of the link
+      shared_ptr<RevoluteJoint> joint(new RevoluteJoint);
+      joint->joint_id = id.str() + "-joint";
+      joint->set_location(Point3d(X0 + j*LINK_LEN, Y, Z, GLOBAL), links.back(), link);
+      joint->set_axis(Vector3d(0,0,1,GLOBAL));
+      links.push_back(link);
+      joints.push_back(joint);
+    }
+
+    RCArticulatedBodyPtr ab(new RCArticulatedBody);
+    ab->id = ab->body_id = arm_id.str();
+    ab->algorithm_type = RCArticulatedBody::eCRB;
+    ab->set_links_and_joints(links, joints);
+    ab->set_floating_base(false);
+    ab->get_recurrent_forces().push_back(GRAVITY);
+    sim->add_dynamic_body(ab);
+  }
+}
+
+/// Builds the scene from the parameters
+shared_ptr<TimeSteppingSimulator> build_scene()
+{
+  shared_ptr<TimeSteppingSimulator> sim(new TimeSteppingSimulator);
+
+  GRAVITY = shared_ptr<GravityForce>(new GravityForce);
+  GRAVITY->gravity = Vector3d(0, -9.8, 0);
+  CONTACT_PARAMS = shared_ptr<ContactParameters>(new ContactParameters);
+  CONTACT_PARAMS->mu_coulomb = 0.5;
+  sim->get_contact_parameters_callback_fn = &get_contact_parameters;
+
+  // size the ground to hold the pile, stacks, and arms
+  const double SPACING = BODY_SIZE*(DENSE ? 1.05 : 3.0);
+  const double PILE_EXTENT = std::ceil(std::sqrt((double) N_BODIES))*SPACING;
+  const double EXTENT = PILE_EXTENT + BODY_SIZE*(6.0 + 2.0*N_ARMS) + N_ARM_LINKS*BODY_SIZE*2.0 + N_STACKS*BODY_SIZE*3.0;
+
+  add_ground(sim, EXTENT);
+  add_pile(sim);
+  add_stacks(sim, PILE_EXTENT);
+  add_arms(sim, PILE_EXTENT);
+
+  return sim;
+}
+
+/// Gets whether the option begins with the given prefix
+bool has_prefix(const std::string& option, const char* prefix)
+{
+  return option.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+  // get all options
+  for (int i=1; i< argc; i++)
+  {
+    std::string option(argv[i]);
+    std::string value = option.substr(option.find('=')+1);
+
+    if (has_prefix(option, "-n="))
+      N_BODIES = std::atoi(value.c_str());
+    else if (has_prefix(option, "-shape="))
+    {
+      if (value == "box")
+        SHAPE = eBox;
+      else if (value == "sphere")
+        SHAPE = eSphere;
+      else if (value == "mesh")
+        SHAPE = eMesh;
+      else if (value == "mixed")
+        SHAPE = eMixed;
+      else
+      {
+        std::cerr << "bench: unknown shape " << value << std::endl;
+        return -1;
+      }
+    }
+    else if (has_prefix(option, "-stacks="))
+      N_STACKS = std::atoi(value.c_str());
+    else if (has_prefix(option, "-h="))
+      STACK_HEIGHT = std::atoi(value.c_str());
+    else if (has_prefix(option, "-arms="))
+      N_ARMS = std::atoi(value.c_str());
+    else if (has_prefix(option, "-links="))
+      N_ARM_LINKS = std::max(std::atoi(value.c_str()), 1);
+    else if (has_prefix(option, "-terrain="))
+      TERRAIN_RES = std::atoi(value.c_str());
+    else if (option == "-sparse")
+      DENSE = false;
+    else if (option == "-dense")
+      DENSE = true;
+    else if (has_prefix(option, "-seed="))
+      SEED = std::atoi(value.c_str());
+    else if (has_prefix(option, "-s="))
+    {
+      STEP_SIZE = std::atof(value.c_str());
+      assert(STEP_SIZE > 0.0);
+    }
+    else if (has_prefix(option, "-mi="))
+    {
+      MAX_ITER = std::atoi(value.c_str());
+      assert(MAX_ITER > 0);
+    }
+    else if (option == "-os")
+      OUTPUT_STEPS = true;
+    else
+    {
+      std::cerr << "syntax: bench [-n=N] [-shape=box|sphere|mesh|mixed] [-stacks=S] [-h=H]" << std::endl;
+      std::cerr << "             [-arms=K] [-links=L] [-terrain=RES] [-dense|-sparse]" << std::endl;
+      std::cerr << "             [-seed=SEED] [-s=STEP] [-mi=STEPS] [-os]" << std::endl;
+      return -1;
+    }
+  }
+
+  // seed the random number generators (the C generator is used by some solvers)
+  RNG_STATE = SEED;
+  srand(SEED);
+
+  // build the scene
+  unsigned long mem_start = get_resident_memory();
+  double build_start = get_current_time();
+  shared_ptr<TimeSteppingSimulator> sim = build_scene();
+  double build_time = get_current_time() - build_start;
+  unsigned long mem_built = get_resident_memory();
+
+  // step the simulation
+  double total_time = 0.0, broad_phase = 0.0, narrow_phase = 0.0;
+  double dynamics = 0.0, constraints = 0.0, stabilization = 0.0;
+  unsigned long contacts = 0, pivots = 0;
+  unsigned max_contacts = 0;
+  if (OUTPUT_STEPS)
+    std::cout << "step,time,broad_phase,narrow_phase,dynamics,constraints,stabilization,contacts,lcp_pivots,memory_kb" << std::endl;
+  for (unsigned i=0; i< MAX_ITER; i++)
+  {
+    double start = get_current_time();
+    sim->step(STEP_SIZE);
+    double elapsed = get_current_time() - start;
+
+    total_time += elapsed;
+    broad_phase += sim->broad_phase_time;
+    narrow_phase += sim->narrow_phase_time;
+    dynamics += sim->dynamics_time;
+    constraints += sim->constraint_time;
+    stabilization += sim->stabilization_time;
+    contacts += sim->step_contacts;
+    pivots += sim->step_pivots;
+    max_contacts = std::max(max_contacts, sim->step_contacts);
+
+    if (OUTPUT_STEPS)
+      std::cout << i << "," << elapsed << "," << sim->broad_phase_time << "," << sim->narrow_phase_time << "," << sim->dynamics_time << "," << sim->constraint_time << "," << sim->stabilization_time << "," << sim->step_contacts << "," << sim->step_pivots << "," << get_resident_memory() << std::endl;
+  }
+
+  // report
+  const double MS = 1000.0/MAX_ITER;
+  std::cout << "bodies: " << sim->get_dynamic_bodies().size() << "  steps: " << MAX_ITER << "  step size: " << STEP_SIZE << "  seed: " << SEED << std::endl;
+  std::cout << "scene build time (s): " << build_time << std::endl;
+  std::cout << "mean time per step (ms): " << total_time*MS << std::endl;
+  std::cout << "  broad phase:         " << broad_phase*MS << std::endl;
+  std::cout << "  narrow phase:        " << narrow_phase*MS << std::endl;
+  std::cout << "  dynamics:            " << dynamics*MS << std::endl;
+  std::cout << "  constraints:         " << constraints*MS << std::endl;
+  std::cout << "  stabilization:       " << stabilization*MS << std::endl;
+  std::cout << "  other:               " << (total_time - broad_phase - narrow_phase - dynamics - constraints - stabilization)*MS << std::endl;
+  std::cout << "contacts per step: " << (double) contacts/MAX_ITER << " (max " << max_contacts << ")" << std::endl;
+  std::cout << "LCP pivots per step (LCP impact solver only): " << (double) pivots/MAX_ITER << std::endl;
+  std::cout << "memory (kB): scene " << (mem_built - mem_start) << "  final " << get_resident_memory() << "  peak " << get_peak_memory() << std::endl;
+
+  return 0;
+}
+
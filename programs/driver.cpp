@@ -33,6 +33,8 @@
 #include <Moby/Simulator.h>
 #include <Moby/RigidBody.h>
 #include <Moby/TimeSteppingSimulator.h>
+#include <Moby/DomainDecomposition.h>
+#include <Moby/MemoryAccounting.h>
 
 using boost::shared_ptr;
 using Ravelin::Vector3d;
@@ -111,10 +113,23 @@ namespace Moby{
   bool OUTPUT_FRAME_RATE = false;
   bool OUTPUT_ITER_NUM = false;
   bool OUTPUT_SIM_RATE = false;
+  bool OUTPUT_MEMORY = false;
   
   /// Render Contact Points
   bool RENDER_CONTACT_POINTS = false;
   
+  /// The domain decomposition (if the scene is split among processes)
+  boost::shared_ptr<DomainDecomposition> DECOMP;
+
+  /// The domain decomposition argument (region:axis:cut,cut,...)
+  std::string DECOMP_ARG;
+
+  /// The name of the shared memory segment for the domain decomposition
+  std::string DECOMP_NAME = "moby-domain";
+
+  /// The ghost width for the domain decomposition (negative = default)
+  double DECOMP_GHOST_WIDTH = -1.0;
+
   /// The map of objects read from the simulation XML file
   std::map<std::string, BasePtr> READ_MAP;
   
@@ -230,6 +245,10 @@ namespace Moby{
       }
     }
     
+    // reset the peak memory usage so that it covers only this step
+    if (OUTPUT_MEMORY)
+      MemoryAccounting::reset_peaks();
+
     // step the simulator
     if(OUTPUT_SIM_RATE){
       // output the iteration / stepping rate
@@ -242,6 +261,17 @@ namespace Moby{
     } else {
       s->step(STEP_SIZE);
     }
+
+    // exchange states with the processes simulating the other regions
+    if (DECOMP)
+      DECOMP->exchange();
+
+    // output the memory allocated by each subsystem, if desired
+    if (OUTPUT_MEMORY)
+    {
+      std::cout << "memory (iteration " << ITER << "):" << std::endl;
+      MemoryAccounting::report(std::cout);
+    }
     
     
     // output the frame rate, if desired
@@ -581,6 +611,12 @@ namespace Moby{
         OUTPUT_ITER_NUM = true;
       else if (option.find("-or") != std::string::npos)
         OUTPUT_SIM_RATE = true;
+      else if (option.find("-om") != std::string::npos)
+      {
+        OUTPUT_MEMORY = true;
+        if (!MemoryAccounting::enabled())
+          std::cerr << "driver warning: Moby was not built with MEMORY_ACCOUNTING; memory will be reported as zero" << std::endl;
+      }
       else if (option.find("-w=") != std::string::npos)
       {
         PICKLE_IVAL = std::atoi(&argv[i][ONECHAR_ARG]);
@@ -653,6 +689,15 @@ namespace Moby{
         strcpy(THREED_EXT, &argv[i][ONECHAR_ARG]);
       } else if (option.find("-vcp") != std::string::npos)
         RENDER_CONTACT_POINTS = true;
+      else if (option.find("-dd=") != std::string::npos)
+        DECOMP_ARG = std::string(&argv[i][TWOCHAR_ARG]);
+      else if (option.find("-dn=") != std::string::npos)
+        DECOMP_NAME = std::string(&argv[i][TWOCHAR_ARG]);
+      else if (option.find("-dg=") != std::string::npos)
+      {
+        DECOMP_GHOST_WIDTH = std::atof(&argv[i][TWOCHAR_ARG]);
+        assert(DECOMP_GHOST_WIDTH >= 0.0);
+      }
       
     }
     
@@ -690,6 +735,25 @@ namespace Moby{
       return -1;
     }
     
+    // split the scene among processes, if desired
+    if (!DECOMP_ARG.empty())
+    {
+      std::vector<std::string> fields, cut_strs;
+      boost::split(fields, DECOMP_ARG, boost::is_any_of(":"));
+      if (fields.size() != 3)
+      {
+        std::cerr << "driver: domain decomposition must be given as -dd=<region>:<axis>:<cut>[,<cut>...]" << std::endl;
+        return -1;
+      }
+      std::vector<double> cuts;
+      boost::split(cut_strs, fields[2], boost::is_any_of(","));
+      for (unsigned i=0; i< cut_strs.size(); i++)
+        cuts.push_back(std::atof(cut_strs[i].c_str()));
+      DECOMP = boost::shared_ptr<DomainDecomposition>(new DomainDecomposition(s, DECOMP_NAME, std::atoi(fields[0].c_str()), std::atoi(fields[1].c_str()), cuts));
+      if (DECOMP_GHOST_WIDTH >= 0.0)
+        DECOMP->ghost_width = DECOMP_GHOST_WIDTH;
+    }
+
     // setup osg window if desired
 #ifdef USE_OSG
     if (ONSCREEN_RENDER)
@@ -771,6 +835,9 @@ namespace Moby{
   }
   
   int close(){
+    // disconnect from the other regions
+    DECOMP.reset();
+
     // close the loaded library
     for(size_t i = 0; i < handles.size(); ++i){
       dlclose(handles[i]);
@@ -0,0 +1,428 @@
+/*****************************************************************************
+ * A long-lived simulation server. Loads a simulation once (through the C API;
+ * see Moby/CAPI.h) and then serves step/reset/query commands from any number
+ * of clients over a Unix domain socket. State is published after every step
+ * into a shared-memory ring buffer (see Moby/StateRing.h) that readers can
+ * attach to without slowing the simulation.
+ *
+ * syntax: moby-server [-sock=<path>] [-shm=<name>] [-slots=<n>]
+ *                     [-s=<step size>] <xml/sdf file>
+ *
+ * Commands (one per line; each receives a one-line reply):
+ *   step [n]  - steps the simulation n (default 1) times
+ *   reset     - restores the simulation to its initial state
+ *   query     - replies with the current time, step, and ring geometry
+ *   pose <id> - replies with the pose of the given body
+ *   quit      - closes the connection
+ *
+ * Commands that arrive from all clients between two steps are batched: a
+ * reset requested by any client is applied once, and the largest number of
+ * steps requested by any client is taken once, before all replies are sent.
+ * Replies are queued for each client and written without blocking, so a
+ * client that does not read its replies cannot stall the server; a client
+ * whose queue grows beyond MAX_OUTPUT bytes is disconnected.
+ *****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <Moby/CAPI.h>
+#include <Moby/StateRing.h>
+
+using std::string;
+using std::vector;
+
+/// The default socket path
+const char* DEFAULT_SOCKET_PATH = "/tmp/moby-server.sock";
+
+/// The default shared memory name
+const char* DEFAULT_SHM_NAME = "/moby-server";
+
+/// The default number of slots in the state ring
+const unsigned DEFAULT_SLOTS = 64;
+
+/// The default simulation step size
+const double DEFAULT_STEP_SIZE = .001;
+
+/// The largest number of unsent reply bytes that a client may accumulate
+const size_t MAX_OUTPUT = 1 << 20;
+
+/// Set to false to shut down the server
+volatile sig_atomic_t RUNNING = 1;
+
+/// A connected client
+struct Client
+{
+  int fd;
+  string inbuf;
+  string outbuf;
+  bool closing;
+};
+
+/// A command waiting to be answered after the next batch executes
+struct PendingReply
+{
+  unsigned client;
+  string cmd;
+  string arg;
+};
+
+/// The simulation being served
+struct Served
+{
+  MobySimulation* sim;
+  const MobyState* state;
+  double step_size;
+  string error;
+  MobyStateRingHeader* ring;
+  size_t ring_bytes;
+};
+
+/// Handles SIGINT/SIGTERM
+void handle_signal(int)
+{
+  RUNNING = 0;
+}
+
+/// Creates the shared memory ring
+bool create_ring(Served& s, const char* name, unsigned n_slots)
+{
+  const MobyState& st = *s.state;
+  s.ring_bytes = moby_state_ring_bytes(st.n_bodies, st.n_joint_dofs, n_slots);
+  shm_unlink(name);
+  int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+  if (fd < 0)
+  {
+    std::cerr << "moby-server: unable to create shared memory " << name << ": " << strerror(errno) << std::endl;
+    return false;
+  }
+  if (ftruncate(fd, s.ring_bytes) != 0)
+  {
+    std::cerr << "moby-server: unable to size shared memory: " << strerror(errno) << std::endl;
+    ::close(fd);
+    return false;
+  }
+  void* mem = mmap(NULL, s.ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mem == MAP_FAILED)
+  {
+    std::cerr << "moby-server: unable to map shared memory: " << strerror(errno) << std::endl;
+    return false;
+  }
+
+  // setup the header; the magic number is written last so that readers
+  // never see a partially initialized ring
+  s.ring = (MobyStateRingHeader*) mem;
+  s.ring->version = MOBY_STATE_RING_VERSION;
+  s.ring->n_bodies = st.n_bodies;
+  s.ring->n_joint_dofs = st.n_joint_dofs;
+  s.ring->n_slots = n_slots;
+  s.ring->payload_size = moby_state_ring_payload_size(st.n_bodies, st.n_joint_dofs);
+  s.ring->write_seq = 0;
+  __sync_synchronize();
+  s.ring->magic = MOBY_STATE_RING_MAGIC;
+  return true;
+}
+
+/// Publishes the current state into the next ring slot (no allocation)
+/**
+ * The state arrays of the C API have the layout of the ring payload, so
+ * they are copied as they are.
+ */
+void publish(Served& s)
+{
+  const MobyState& st = *s.state;
+  double* payload = moby_state_ring_begin_write(s.ring);
+  *payload++ = st.time;
+  *payload++ = (double) st.step;
+  payload = std::copy(st.poses, st.poses + st.n_bodies*MOBY_POSE_STRIDE, payload);
+  payload = std::copy(st.velocities, st.velocities + st.n_bodies*MOBY_VELOCITY_STRIDE, payload);
+  payload = std::copy(st.joint_q, st.joint_q + st.n_joint_dofs, payload);
+  std::copy(st.joint_qd, st.joint_qd + st.n_joint_dofs, payload);
+  moby_state_ring_end_write(s.ring);
+}
+
+/// Creates the listening socket
+int create_socket(const char* path)
+{
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+  {
+    std::cerr << "moby-server: unable to create socket: " << strerror(errno) << std::endl;
+    return -1;
+  }
+
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path)-1);
+  unlink(path);
+  if (bind(fd, (sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, 16) != 0)
+  {
+    std::cerr << "moby-server: unable to listen on " << path << ": " << strerror(errno) << std::endl;
+    ::close(fd);
+    return -1;
+  }
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  return fd;
+}
+
+/// Writes as much of a client's queued output as the socket accepts without blocking
+/**
+ * \return false if the connection has failed
+ */
+bool flush_output(Client& c)
+{
+  while (!c.outbuf.empty())
+  {
+    ssize_t n = send(c.fd, c.outbuf.data(), c.outbuf.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n < 0)
+      return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+    c.outbuf.erase(0, n);
+  }
+  return true;
+}
+
+/// Queues a reply line for a client and writes what can be written now
+void send_reply(Client& c, const string& reply)
+{
+  c.outbuf += reply;
+  c.outbuf += '\n';
+  if (!flush_output(c) || c.outbuf.size() > MAX_OUTPUT)
+  {
+    c.outbuf.clear();
+    c.closing = true;
+  }
+}
+
+/// Gets the reply for a command after the batch has executed
+string make_reply(const Served& s, const PendingReply& r, const char* shm_name)
+{
+  const MobyState& st = *s.state;
+  std::ostringstream out;
+  if ((r.cmd == "step" || r.cmd == "reset") && !s.error.empty())
+    out << "error " << s.error;
+  else if (r.cmd == "step" || r.cmd == "reset")
+    out << "ok " << st.step << " " << st.time;
+  else if (r.cmd == "query")
+    out << "ok " << st.step << " " << st.time << " " << shm_name << " " << s.ring->n_bodies << " " << s.ring->n_joint_dofs << " " << s.ring->n_slots << " " << s.ring->write_seq;
+  else if (r.cmd == "pose")
+  {
+    const int IDX = moby_find_body(s.sim, r.arg.c_str());
+    if (IDX < 0)
+      out << "error no body " << r.arg;
+    else
+    {
+      const double* pose = st.poses + IDX*MOBY_POSE_STRIDE;
+      out << "ok";
+      for (unsigned i=0; i< MOBY_POSE_STRIDE; i++)
+        out << " " << pose[i];
+    }
+  }
+  else
+    out << "error unknown command " << r.cmd;
+  return out.str();
+}
+
+int main(int argc, char** argv)
+{
+  const unsigned SOCK_ARG = 6, SHM_ARG = 5, SLOTS_ARG = 7, STEP_ARG = 3;
+  const char* socket_path = DEFAULT_SOCKET_PATH;
+  const char* shm_name = DEFAULT_SHM_NAME;
+  unsigned n_slots = DEFAULT_SLOTS;
+  Served s;
+  s.step_size = DEFAULT_STEP_SIZE;
+
+  // process options
+  if (argc < 2)
+  {
+    std::cerr << "syntax: moby-server [-sock=<path>] [-shm=<name>] [-slots=<n>] [-s=<step size>] <xml/sdf file>" << std::endl;
+    return -1;
+  }
+  for (int i=1; i< argc-1; i++)
+  {
+    if (strncmp(argv[i], "-sock=", SOCK_ARG) == 0)
+      socket_path = &argv[i][SOCK_ARG];
+    else if (strncmp(argv[i], "-shm=", SHM_ARG) == 0)
+      shm_name = &argv[i][SHM_ARG];
+    else if (strncmp(argv[i], "-slots=", SLOTS_ARG) == 0)
+      n_slots = std::max(1, std::atoi(&argv[i][SLOTS_ARG]));
+    else if (strncmp(argv[i], "-s=", STEP_ARG) == 0)
+      s.step_size = std::atof(&argv[i][STEP_ARG]);
+    else
+      std::cerr << "moby-server: ignoring unknown option " << argv[i] << std::endl;
+  }
+  if (s.step_size <= 0.0)
+    s.step_size = DEFAULT_STEP_SIZE;
+
+  // load the simulation
+  s.sim = moby_create();
+  if (moby_load(s.sim, argv[argc-1]) != 0)
+  {
+    std::cerr << "moby-server: unable to load " << argv[argc-1] << ": " << moby_get_last_error(s.sim) << std::endl;
+    moby_destroy(s.sim);
+    return -1;
+  }
+  s.state = moby_get_state(s.sim);
+
+  // setup the state ring and the socket
+  if (!create_ring(s, shm_name, n_slots))
+    return -1;
+  int listen_fd = create_socket(socket_path);
+  if (listen_fd < 0)
+    return -1;
+  publish(s);
+
+  // setup signal handlers
+  signal(SIGINT, handle_signal);
+  signal(SIGTERM, handle_signal);
+  signal(SIGPIPE, SIG_IGN);
+
+  std::cerr << "moby-server: serving on " << socket_path << ", state in " << shm_name << std::endl;
+
+  // serve until told to stop
+  vector<Client> clients;
+  vector<pollfd> fds;
+  vector<PendingReply> pending;
+  const unsigned BUFSIZE = 4096;
+  char buffer[BUFSIZE];
+  while (RUNNING)
+  {
+    // wait for activity (and for clients with queued output to accept it)
+    fds.resize(clients.size()+1);
+    fds[0].fd = listen_fd;
+    fds[0].events = POLLIN;
+    for (unsigned i=0; i< clients.size(); i++)
+    {
+      fds[i+1].fd = clients[i].fd;
+      fds[i+1].events = (clients[i].closing) ? 0 : POLLIN;
+      if (!clients[i].outbuf.empty())
+        fds[i+1].events |= POLLOUT;
+    }
+    if (poll(&fds[0], fds.size(), -1) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+
+    // accept new clients (they are polled starting with the next iteration)
+    const unsigned n_polled = clients.size();
+    if (fds[0].revents & POLLIN)
+    {
+      int fd;
+      while ((fd = accept(listen_fd, NULL, NULL)) >= 0)
+      {
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        Client c;
+        c.fd = fd;
+        c.closing = false;
+        clients.push_back(c);
+      }
+    }
+
+    // write queued output and read all commands that are available from all
+    // clients
+    bool do_reset = false;
+    unsigned n_steps = 0;
+    pending.clear();
+    for (unsigned i=0; i< n_polled; i++)
+    {
+      if ((fds[i+1].revents & POLLOUT) && !flush_output(clients[i]))
+      {
+        clients[i].outbuf.clear();
+        clients[i].closing = true;
+      }
+      if (clients[i].closing || !(fds[i+1].revents & (POLLIN | POLLHUP | POLLERR)))
+        continue;
+      ssize_t n = recv(clients[i].fd, buffer, BUFSIZE, 0);
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        continue;
+      if (n <= 0)
+      {
+        clients[i].outbuf.clear();
+        clients[i].closing = true;
+        continue;
+      }
+      clients[i].inbuf.append(buffer, n);
+
+      // process complete lines
+      size_t eol;
+      while ((eol = clients[i].inbuf.find('\n')) != string::npos)
+      {
+        std::istringstream line(clients[i].inbuf.substr(0, eol));
+        clients[i].inbuf.erase(0, eol+1);
+        PendingReply r;
+        r.client = i;
+        line >> r.cmd >> r.arg;
+        if (r.cmd.empty())
+          continue;
+        if (r.cmd == "quit")
+        {
+          clients[i].closing = true;
+          break;
+        }
+        if (r.cmd == "step")
+          n_steps = std::max(n_steps, (r.arg.empty()) ? 1u : (unsigned) std::atoi(r.arg.c_str()));
+        else if (r.cmd == "reset")
+          do_reset = true;
+        pending.push_back(r);
+      }
+    }
+
+    // execute the batch
+    s.error.clear();
+    if (do_reset)
+    {
+      if (moby_reset(s.sim) != 0)
+        s.error = moby_get_last_error(s.sim);
+      publish(s);
+    }
+    for (unsigned i=0; i< n_steps && RUNNING && s.error.empty(); i++)
+    {
+      if (moby_step(s.sim, s.step_size, 1) != 0)
+        s.error = moby_get_last_error(s.sim);
+      publish(s);
+    }
+
+    // queue all replies
+    for (unsigned i=0; i< pending.size(); i++)
+      send_reply(clients[pending[i].client], make_reply(s, pending[i], shm_name));
+
+    // remove closed clients once their replies have been written
+    for (unsigned i=0; i< clients.size(); )
+      if (clients[i].closing && clients[i].outbuf.empty())
+      {
+        ::close(clients[i].fd);
+        clients[i] = clients.back();
+        clients.pop_back();
+      }
+      else
+        i++;
+  }
+
+  // clean up
+  for (unsigned i=0; i< clients.size(); i++)
+    ::close(clients[i].fd);
+  ::close(listen_fd);
+  unlink(socket_path);
+  munmap(s.ring, s.ring_bytes);
+  shm_unlink(shm_name);
+  moby_destroy(s.sim);
+
+  return 0;
+}
@@ -7,6 +7,7 @@
 #include <iostream>
 #include <boost/foreach.hpp>
 #include <queue>
+#include <limits>
 #include <Moby/XMLTree.h>
 #include <Moby/Joint.h>
 #include <Moby/Constants.h>
@@ -38,6 +39,56 @@ ArticulatedBody::ArticulatedBody()
 {
 }
 
+/// Determines the finite joint limits, keyed by joint, DOF, and upper/lower
+/**
+ * find_limit_constraints() only examines these limits. The set is recomputed
+ * automatically when a joint is replaced or the number of DOFs of a joint
+ * changes; call this method directly after changing a joint limit from
+ * infinite to finite.
+ */
+void ArticulatedBody::update_limit_dofs() const
+{
+  const double INF = std::numeric_limits<double>::max();
+
+  _limit_joints.clear();
+  _limit_dofs.clear();
+  _limit_upper.clear();
+  _limit_joint_set = _joints;
+  _limit_joint_ndof.resize(_joints.size());
+  for (unsigned i=0; i< _joints.size(); i++)
+  {
+    JointPtr joint = dynamic_pointer_cast<Joint>(_joints[i]);
+    _limit_joint_ndof[i] = joint->num_dof();
+    for (unsigned j=0; j< joint->num_dof(); j++)
+    {
+      if (joint->hilimit[j] < INF)
+      {
+        _limit_joints.push_back(joint);
+        _limit_dofs.push_back(j);
+        _limit_upper.push_back(true);
+      }
+      if (joint->lolimit[j] > -INF)
+      {
+        _limit_joints.push_back(joint);
+        _limit_dofs.push_back(j);
+        _limit_upper.push_back(false);
+      }
+    }
+  }
+}
+
+/// Determines whether the finite joint limits were determined for the current joints
+bool ArticulatedBody::limit_dofs_current() const
+{
+  if (_limit_joint_set.size() != _joints.size())
+    return false;
+  for (unsigned i=0; i< _joints.size(); i++)
+    if (_limit_joint_set[i] != _joints[i] || _limit_joint_ndof[i] != _joints[i]->num_dof())
+      return false;
+
+  return true;
+}
+
 /// Integrates a dynamic body
 /*
 void ArticulatedBody::integrate(double t, double h, shared_ptr<Integrator> integrator)
@@ -338,6 +389,9 @@ void ArticulatedBody::load_from_xml(shared_ptr<const XMLTree> node, std::map<str
     // set the joints and links
     set_links_and_joints(vector<shared_ptr<RigidBodyd> >(links.begin(), links.end()), vector<shared_ptr<Jointd> >(joints.begin(), joints.end()));
   }
+
+  // determine the limited joint DOFs
+  update_limit_dofs();
 }
 
 /// Saves this object to a XML tree
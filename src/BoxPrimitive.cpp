@@ -14,11 +14,13 @@
 #include <Moby/PlanePrimitive.h>
 #include <Moby/Polyhedron.h>
 #include <Moby/TriangleMeshPrimitive.h>
+#include <Moby/TetraMeshPrimitive.h>
 #include <Moby/OBB.h>
 #include <Moby/Constants.h>
 #include <Moby/CollisionGeometry.h>
 #include <Moby/HeightmapPrimitive.h>
 #include <Moby/QP.h>
+#include <Moby/MemoryAccounting.h>
 #include <Moby/BoxPrimitive.h>
 
 using namespace Ravelin;
@@ -175,6 +177,11 @@ double BoxPrimitive::calc_signed_dist(shared_ptr<const Primitive> p, Point3d& pt
   if (polyp)
     return PolyhedralPrimitive::calc_signed_dist(polyp, pthis, pp);
 
+  // try box/tetra mesh
+  shared_ptr<const TetraMeshPrimitive> tetp = dynamic_pointer_cast<const TetraMeshPrimitive>(p);
+  if (tetp)
+    return tetp->calc_signed_dist(dynamic_pointer_cast<const Primitive>(shared_from_this()), pp, pthis);
+
   // should never get here...
   assert(false);
   return 0.0;
@@ -714,6 +721,7 @@ void BoxPrimitive::calc_mass_properties()
 /// Gets the bounding volume for this plane
 BVPtr BoxPrimitive::get_BVH_root(CollisionGeometryPtr geom)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
   const unsigned X = 0, Y = 1, Z = 2;
 
   // get the pointer to the bounding box
@@ -0,0 +1,418 @@
+/****************************************************************************
+ * Copyright 2016 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/foreach.hpp>
+#include <Moby/XMLReader.h>
+#include <Moby/SDFReader.h>
+#include <Moby/RigidBody.h>
+#include <Moby/ArticulatedBody.h>
+#include <Moby/Joint.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/UnilateralConstraint.h>
+#include <Moby/TimeSteppingSimulator.h>
+#include <Moby/CAPI.h>
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
+using namespace Ravelin;
+using namespace Moby;
+
+/// The simulation behind a MobySimulation handle
+struct MobySimulation
+{
+  /// The simulator
+  shared_ptr<Simulator> sim;
+
+  /// The simulator as a constraint simulator (NULL if it is not one)
+  ConstraintSimulator* csim;
+
+  /// Objects read from the simulation file (keeps them alive)
+  map<string, BasePtr> read_map;
+
+  /// The tracked rigid bodies, in state order
+  vector<RigidBodyPtr> bodies;
+
+  /// The tracked rigid bodies, sorted by address, for contact lookups
+  vector<pair<const RigidBody*, int> > body_lookup;
+
+  /// The tracked joints, in state order
+  vector<JointPtr> joints;
+
+  /// Index of the first DOF of each tracked joint in the joint arrays
+  vector<unsigned> joint_offsets;
+
+  /// Top-level bodies and their initial generalized coordinates/velocities
+  vector<shared_ptr<DynamicBodyd> > dbodies;
+  vector<VectorNd> gc0, gv0;
+
+  /// Storage for the state arrays
+  vector<double> poses, velocities, joint_q, joint_qd, contacts;
+  vector<int> contact_bodies;
+
+  /// The state handed to the caller
+  MobyState state;
+
+  /// The last error message
+  string last_error;
+};
+
+/// Points the caller-visible state at the storage arrays
+static void bind_state(MobySimulation* s)
+{
+  MobyState& st = s->state;
+  st.n_bodies = s->bodies.size();
+  st.poses = (s->poses.empty()) ? NULL : &s->poses[0];
+  st.velocities = (s->velocities.empty()) ? NULL : &s->velocities[0];
+  st.n_joint_dofs = s->joint_q.size();
+  st.joint_q = (s->joint_q.empty()) ? NULL : &s->joint_q[0];
+  st.joint_qd = (s->joint_qd.empty()) ? NULL : &s->joint_qd[0];
+  st.contact_capacity = s->contact_bodies.size() / 2;
+  st.contacts = (s->contacts.empty()) ? NULL : &s->contacts[0];
+  st.contact_bodies = (s->contact_bodies.empty()) ? NULL : &s->contact_bodies[0];
+}
+
+/// Gets the state index of a rigid body (-1 if the body is not tracked)
+static int lookup_body(const MobySimulation* s, const RigidBody* rb)
+{
+  vector<pair<const RigidBody*, int> >::const_iterator i;
+  i = std::lower_bound(s->body_lookup.begin(), s->body_lookup.end(), std::make_pair(rb, -1));
+  return (i != s->body_lookup.end() && i->first == rb) ? i->second : -1;
+}
+
+/// Updates the state arrays in place (no allocation is performed)
+static void update_state(MobySimulation* s)
+{
+  MobyState& st = s->state;
+  st.time = s->sim->current_time;
+
+  // update poses and velocities
+  for (unsigned i=0; i< s->bodies.size(); i++)
+  {
+    const RigidBodyPtr& rb = s->bodies[i];
+    Pose3d P(*rb->get_pose());
+    P.update_relative_pose(GLOBAL);
+    double* pose = &s->poses[i*MOBY_POSE_STRIDE];
+    pose[0] = P.x[0];  pose[1] = P.x[1];  pose[2] = P.x[2];
+    pose[3] = P.q.x;   pose[4] = P.q.y;   pose[5] = P.q.z;  pose[6] = P.q.w;
+
+    SVelocityd v = Pose3d::transform(rb->get_mixed_pose(), rb->get_velocity());
+    Vector3d xd = v.get_linear();
+    Vector3d w = v.get_angular();
+    double* vel = &s->velocities[i*MOBY_VELOCITY_STRIDE];
+    vel[0] = xd[0];  vel[1] = xd[1];  vel[2] = xd[2];
+    vel[3] = w[0];   vel[4] = w[1];   vel[5] = w[2];
+  }
+
+  // update joint positions and velocities
+  for (unsigned i=0; i< s->joints.size(); i++)
+  {
+    const JointPtr& joint = s->joints[i];
+    for (unsigned j=0, k=s->joint_offsets[i]; j< joint->num_dof(); j++, k++)
+    {
+      s->joint_q[k] = joint->q[j];
+      s->joint_qd[k] = joint->qd[j];
+    }
+  }
+
+  // update contacts
+  st.n_contacts = 0;
+  st.n_contacts_dropped = 0;
+  if (!s->csim)
+    return;
+  const vector<UnilateralConstraint>& constraints = s->csim->get_rigid_constraints();
+  for (unsigned i=0; i< constraints.size(); i++)
+  {
+    const UnilateralConstraint& c = constraints[i];
+    if (c.constraint_type != UnilateralConstraint::eContact)
+      continue;
+    if (st.n_contacts == st.contact_capacity)
+    {
+      st.n_contacts_dropped++;
+      continue;
+    }
+
+    // store the contact data
+    const unsigned k = st.n_contacts++;
+    double* data = &s->contacts[k*MOBY_CONTACT_STRIDE];
+    Vector3d j = c.contact_impulse.get_linear();
+    for (unsigned m=0; m< 3; m++)
+    {
+      data[m] = c.contact_point[m];
+      data[m+3] = c.contact_normal[m];
+      data[m+6] = j[m];
+    }
+
+    // store the body indices
+    RigidBody* rb1 = dynamic_cast<RigidBody*>(c.contact_geom1->get_single_body().get());
+    RigidBody* rb2 = dynamic_cast<RigidBody*>(c.contact_geom2->get_single_body().get());
+    s->contact_bodies[k*2] = lookup_body(s, rb1);
+    s->contact_bodies[k*2+1] = lookup_body(s, rb2);
+  }
+}
+
+/// Records all bodies and joints in the simulator and allocates the state arrays
+static void setup_state(MobySimulation* s)
+{
+  // get all top-level bodies, links, and joints
+  BOOST_FOREACH(ControlledBodyPtr cb, s->sim->get_dynamic_bodies())
+  {
+    shared_ptr<DynamicBodyd> db = dynamic_pointer_cast<DynamicBodyd>(cb);
+    s->dbodies.push_back(db);
+    s->gc0.push_back(VectorNd());
+    s->gv0.push_back(VectorNd());
+    db->get_generalized_coordinates_euler(s->gc0.back());
+    db->get_generalized_velocity(DynamicBodyd::eSpatial, s->gv0.back());
+
+    ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(cb);
+    if (ab)
+    {
+      BOOST_FOREACH(shared_ptr<RigidBodyd> link, ab->get_links())
+        s->bodies.push_back(dynamic_pointer_cast<RigidBody>(link));
+      BOOST_FOREACH(shared_ptr<Jointd> joint, ab->get_joints())
+        s->joints.push_back(dynamic_pointer_cast<Joint>(joint));
+    }
+    else
+    {
+      RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(cb);
+      if (rb)
+        s->bodies.push_back(rb);
+    }
+  }
+
+  // setup the body lookup
+  for (unsigned i=0; i< s->bodies.size(); i++)
+    s->body_lookup.push_back(std::make_pair((const RigidBody*) s->bodies[i].get(), (int) i));
+  std::sort(s->body_lookup.begin(), s->body_lookup.end());
+
+  // setup the joint offsets
+  unsigned ndofs = 0;
+  for (unsigned i=0; i< s->joints.size(); i++)
+  {
+    s->joint_offsets.push_back(ndofs);
+    ndofs += s->joints[i]->num_dof();
+  }
+
+  // allocate the state arrays
+  s->poses.resize(s->bodies.size()*MOBY_POSE_STRIDE);
+  s->velocities.resize(s->bodies.size()*MOBY_VELOCITY_STRIDE);
+  s->joint_q.resize(ndofs);
+  s->joint_qd.resize(ndofs);
+  s->contacts.resize(MOBY_DEFAULT_CONTACT_CAPACITY*MOBY_CONTACT_STRIDE);
+  s->contact_bodies.resize(MOBY_DEFAULT_CONTACT_CAPACITY*2);
+  bind_state(s);
+}
+
+/// Removes any simulation from the handle
+static void clear(MobySimulation* s)
+{
+  s->sim.reset();
+  s->csim = NULL;
+  s->read_map.clear();
+  s->bodies.clear();
+  s->body_lookup.clear();
+  s->joints.clear();
+  s->joint_offsets.clear();
+  s->dbodies.clear();
+  s->gc0.clear();
+  s->gv0.clear();
+  s->poses.clear();
+  s->velocities.clear();
+  s->joint_q.clear();
+  s->joint_qd.clear();
+  s->contacts.clear();
+  s->contact_bodies.clear();
+  s->state.time = 0.0;
+  s->state.step = 0;
+  s->state.n_contacts = s->state.n_contacts_dropped = 0;
+  bind_state(s);
+}
+
+/// Creates a new (empty) simulation
+MobySimulation* moby_create(void)
+{
+  MobySimulation* s = new MobySimulation;
+  clear(s);
+  return s;
+}
+
+/// Destroys a simulation
+void moby_destroy(MobySimulation* sim)
+{
+  delete sim;
+}
+
+/// Loads a simulation from a Moby XML or SDF file
+/**
+ * \return 0 on success, -1 on failure (see moby_get_last_error())
+ */
+int moby_load(MobySimulation* s, const char* fname)
+{
+  // clear any existing simulation
+  clear(s);
+
+  try
+  {
+    // read the file
+    const string filename(fname);
+    if (filename.find(".sdf") != string::npos)
+    {
+      shared_ptr<TimeSteppingSimulator> tss = SDFReader::read(filename);
+      if (tss)
+        s->read_map[tss->id] = tss;
+    }
+    else
+      s->read_map = XMLReader::read(filename);
+
+    // get the (only) simulator
+    for (map<string, BasePtr>::const_iterator i = s->read_map.begin(); i != s->read_map.end(); i++)
+      if ((s->sim = dynamic_pointer_cast<Simulator>(i->second)))
+        break;
+    if (!s->sim)
+    {
+      s->last_error = "no simulator found in " + filename;
+      return -1;
+    }
+    s->csim = dynamic_cast<ConstraintSimulator*>(s->sim.get());
+
+    // setup and populate the state
+    setup_state(s);
+    update_state(s);
+  }
+  catch (std::exception& e)
+  {
+    s->last_error = e.what();
+    return -1;
+  }
+
+  return 0;
+}
+
+/// Restores all bodies to their states at load time and sets the time to zero
+/**
+ * Data that the simulator retains between steps (e.g., warm starts and
+ * pairwise distances) is discarded, so stepping after a reset reproduces
+ * stepping after the load.
+ * \return 0 on success, -1 on failure (see moby_get_last_error())
+ */
+int moby_reset(MobySimulation* s)
+{
+  if (!s->sim)
+  {
+    s->last_error = "no simulation loaded";
+    return -1;
+  }
+
+  try
+  {
+    for (unsigned i=0; i< s->dbodies.size(); i++)
+    {
+      s->dbodies[i]->set_generalized_coordinates_euler(s->gc0[i]);
+      s->dbodies[i]->set_generalized_velocity(DynamicBodyd::eSpatial, s->gv0[i]);
+    }
+    s->sim->reset_caches();
+    s->sim->current_time = 0.0;
+    s->state.step = 0;
+    update_state(s);
+  }
+  catch (std::exception& e)
+  {
+    s->last_error = e.what();
+    return -1;
+  }
+
+  return 0;
+}
+
+/// Steps the simulation n times by dt, updating the state afterward
+/**
+ * \return 0 on success, -1 on failure (see moby_get_last_error())
+ */
+int moby_step(MobySimulation* s, double dt, unsigned n)
+{
+  if (!s->sim)
+  {
+    s->last_error = "no simulation loaded";
+    return -1;
+  }
+
+  try
+  {
+    for (unsigned i=0; i< n; i++)
+    {
+      s->sim->step(dt);
+      s->state.step++;
+    }
+  }
+  catch (std::exception& e)
+  {
+    s->last_error = e.what();
+    update_state(s);
+    return -1;
+  }
+
+  update_state(s);
+  return 0;
+}
+
+/// Gets the state of the simulation (the pointer remains valid for the life of the handle)
+const MobyState* moby_get_state(const MobySimulation* s)
+{
+  return &s->state;
+}
+
+/// Sets the number of contacts that the state can hold
+/**
+ * \note this invalidates MobyState::contacts and MobyState::contact_bodies
+ */
+int moby_reserve_contacts(MobySimulation* s, unsigned capacity)
+{
+  s->contacts.resize(capacity*MOBY_CONTACT_STRIDE);
+  s->contact_bodies.resize(capacity*2);
+  bind_state(s);
+  if (s->state.n_contacts > capacity)
+    s->state.n_contacts = capacity;
+  return 0;
+}
+
+/// Gets the state index of the rigid body (or link) with the given id (-1 if not found)
+int moby_find_body(const MobySimulation* s, const char* id)
+{
+  for (unsigned i=0; i< s->bodies.size(); i++)
+    if (s->bodies[i]->id == id)
+      return (int) i;
+  return -1;
+}
+
+/// Gets the id of the rigid body at the given state index (NULL if out of range)
+const char* moby_get_body_id(const MobySimulation* s, unsigned index)
+{
+  return (index < s->bodies.size()) ? s->bodies[index]->id.c_str() : NULL;
+}
+
+/// Gets the index of the first DOF of the joint with the given id in the joint arrays (-1 if not found)
+int moby_find_joint(const MobySimulation* s, const char* id)
+{
+  for (unsigned i=0; i< s->joints.size(); i++)
+    if (s->joints[i]->id == id)
+      return (int) s->joint_offsets[i];
+  return -1;
+}
+
+/// Gets the last error message
+const char* moby_get_last_error(const MobySimulation* s)
+{
+  return s->last_error.c_str();
+}
+
@@ -28,6 +28,7 @@
 #include <Moby/CylinderPrimitive.h>
 #include <Moby/ConePrimitive.h>
 #include <Moby/TriangleMeshPrimitive.h>
+#include <Moby/TetraMeshPrimitive.h>
 #include <Moby/PlanePrimitive.h>
 #include <Moby/GaussianMixture.h>
 #include <Moby/CSG.h>
@@ -54,6 +55,7 @@ using namespace Moby;
 /// Constructs a collision detector with default tolerances
 CCD::CCD()
 {
+  _rebuild_bounds_vecs = true;
 }
 
 // TODO: remove this as integrator is Euler 8/11/15
@@ -703,6 +705,9 @@ void CCD::broad_phase(double dt, const vector<ControlledBodyPtr>& bodies, vector
 {
   FILE_LOG(LOG_COLDET) << "CCD::broad_phase() entered" << std::endl;
 
+  // remove the bounds of unregistered geometries
+  purge_removed_geometries();
+
   // clear the swept BVs
   _swept_BVs.clear();
 
@@ -755,15 +760,17 @@ void CCD::broad_phase(double dt, const vector<ControlledBodyPtr>& bodies, vector
     {
       RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(i->first->get_single_body());
       if (rb->is_enabled())
-      {
-        BVPtr old_bv = i->second;
         i->second = construct_bounding_sphere(i->first);
-        for (unsigned j=0; j< _x_bounds.size(); j++)
-        {
-          if (_x_bounds[j].second.bv == old_bv) _x_bounds[j].second.bv = i->second;
-          if (_y_bounds[j].second.bv == old_bv) _y_bounds[j].second.bv = i->second;
-          if (_z_bounds[j].second.bv == old_bv) _z_bounds[j].second.bv = i->second;
-        }
+    }
+
+    // point the bounds at the new bounding spheres
+    if (!_rebuild_bounds_vecs)
+    {
+      for (unsigned j=0; j< _x_bounds.size(); j++)
+      {
+        _x_bounds[j].second.bv = _bounding_spheres.find(_x_bounds[j].second.geom)->second;
+        _y_bounds[j].second.bv = _bounding_spheres.find(_y_bounds[j].second.geom)->second;
+        _z_bounds[j].second.bv = _bounding_spheres.find(_z_bounds[j].second.geom)->second;
       }
     }
   }
@@ -791,9 +798,11 @@ void CCD::broad_phase(double dt, const vector<ControlledBodyPtr>& bodies, vector
     }
     else
     {
-      // at the start of a bound
+      // at the start of a bound; pairs that do not pass the collision
+      // filter are never recorded
       BOOST_FOREACH(CollisionGeometryPtr cg, active_bounds)
-        overlaps[make_sorted_pair(cg, _x_bounds[i].second.geom)]++;
+        if (is_checked(cg, _x_bounds[i].second.geom))
+          overlaps[make_sorted_pair(cg, _x_bounds[i].second.geom)]++;
 
       // add the geometry to the active set
       active_bounds.insert(_x_bounds[i].second.geom);
@@ -811,9 +820,11 @@ void CCD::broad_phase(double dt, const vector<ControlledBodyPtr>& bodies, vector
     }
     else
     {
-      // at the start of a bound
+      // at the start of a bound; pairs that do not pass the collision
+      // filter are never recorded
       BOOST_FOREACH(CollisionGeometryPtr cg, active_bounds)
-        overlaps[make_sorted_pair(cg, _y_bounds[i].second.geom)]++;
+        if (is_checked(cg, _y_bounds[i].second.geom))
+          overlaps[make_sorted_pair(cg, _y_bounds[i].second.geom)]++;
 
       // add the geometry to the active set
       active_bounds.insert(_y_bounds[i].second.geom);
@@ -831,9 +842,11 @@ void CCD::broad_phase(double dt, const vector<ControlledBodyPtr>& bodies, vector
     }
     else
     {
-      // at the start of a bound
+      // at the start of a bound; pairs that do not pass the collision
+      // filter are never recorded
       BOOST_FOREACH(CollisionGeometryPtr cg, active_bounds)
-        overlaps[make_sorted_pair(cg, _z_bounds[i].second.geom)]++;
+        if (is_checked(cg, _z_bounds[i].second.geom))
+          overlaps[make_sorted_pair(cg, _z_bounds[i].second.geom)]++;
 
       // add the geometry to the active set
       active_bounds.insert(_z_bounds[i].second.geom);
@@ -849,10 +862,6 @@ void CCD::broad_phase(double dt, const vector<ControlledBodyPtr>& bodies, vector
     if (i->second < 3)
       continue;
 
-    // if the pair is disabled, continue looping
-    if (this->disabled_pairs.find(i->first) != this->disabled_pairs.end())
-      continue;
-
     // get the rigid bodies corresponding to the geometries
     RigidBodyPtr rb1 = dynamic_pointer_cast<RigidBody>(i->first.first->get_single_body());
     RigidBodyPtr rb2 = dynamic_pointer_cast<RigidBody>(i->first.second->get_single_body());
@@ -873,6 +882,119 @@ void CCD::broad_phase(double dt, const vector<ControlledBodyPtr>& bodies, vector
   FILE_LOG(LOG_COLDET) << "CCD::broad_phase() exited" << std::endl;
 }
 
+/// Registers a geometry with the broad phase without rebuilding the bounds vectors
+/**
+ * The new bounds are appended to the bounds vectors; their values are 
+ * computed, and the bounds moved into place by the insertion sort, during
+ * the next call to broad_phase().
+ */
+void CCD::add_collision_geometry(CollisionGeometryPtr geom)
+{
+  // remove the bounds of unregistered geometries (the geometry may be among
+  // them)
+  purge_removed_geometries();
+
+  // see whether the geometry is already registered
+  if (_bounding_spheres.find(geom) != _bounding_spheres.end())
+    return;
+
+  // get farthest distance on the geometry and construct the bounding sphere
+  _rmax[geom] = geom->get_farthest_point_distance();
+  BVPtr bv = construct_bounding_sphere(geom);
+  _bounding_spheres[geom] = bv;
+
+  // add the bounds (unless the vectors will be rebuilt anyway)
+  if (!_rebuild_bounds_vecs)
+  {
+    add_bounds(_x_bounds, geom, bv);
+    add_bounds(_y_bounds, geom, bv);
+    add_bounds(_z_bounds, geom, bv);
+  }
+}
+
+/// Unregisters a geometry from the broad phase without rebuilding the bounds vectors
+/**
+ * Only the geometry's map entries are removed here; its bounds and the
+ * minimum distances observed for pairs containing it are removed by
+ * purge_removed_geometries() before they are next used, so that removing
+ * many geometries (e.g., clearing a scene) takes a single pass over the
+ * bounds vectors rather than one per geometry.
+ */
+void CCD::remove_collision_geometry(CollisionGeometryPtr geom)
+{
+  // remove the bounding sphere
+  if (!_bounding_spheres.erase(geom))
+    return;
+  _rmax.erase(geom);
+  _swept_BVs.erase(geom);
+
+  // the bounds are removed later
+  _removed_geoms.push_back(geom);
+}
+
+/// Removes the bounds, and the minimum distances observed, of all geometries unregistered since the last call
+void CCD::purge_removed_geometries()
+{
+  if (_removed_geoms.empty())
+    return;
+
+  // sort the geometries so that they can be searched
+  std::sort(_removed_geoms.begin(), _removed_geoms.end());
+
+  // remove the bounds
+  remove_bounds(_x_bounds, _removed_geoms);
+  remove_bounds(_y_bounds, _removed_geoms);
+  remove_bounds(_z_bounds, _removed_geoms);
+
+  // remove the minimum distances observed for pairs containing the geometries
+  for (map<sorted_pair<CollisionGeometryPtr>, double>::iterator i = _min_dist_observed.begin(); i != _min_dist_observed.end(); )
+  {
+    if (std::binary_search(_removed_geoms.begin(), _removed_geoms.end(), i->first.first) ||
+        std::binary_search(_removed_geoms.begin(), _removed_geoms.end(), i->first.second))
+      _min_dist_observed.erase(i++);
+    else
+      i++;
+  }
+
+  _removed_geoms.clear();
+}
+
+/// Adds the start and end bounds of a geometry to a bounds vector
+void CCD::add_bounds(vector<pair<double, BoundsStruct> >& bounds, CollisionGeometryPtr geom, BVPtr bv)
+{
+  const double INF = std::numeric_limits<double>::max();
+
+  // setup the bounds structure
+  BoundsStruct bs;
+  bs.end = false;
+  bs.geom = geom;
+  bs.bv = bv;
+
+  // add the lower bound
+  bounds.push_back(make_pair(-INF, bs));
+
+  // modify the bounds structure to indicate the end bound
+  bs.end = true;
+  bounds.push_back(make_pair(INF, bs));
+}
+
+/// Removes the bounds of geometries from a bounds vector (preserving the order of the remaining bounds)
+/**
+ * \param geoms the geometries, sorted
+ */
+void CCD::remove_bounds(vector<pair<double, BoundsStruct> >& bounds, const vector<CollisionGeometryPtr>& geoms)
+{
+  unsigned j = 0;
+  for (unsigned i=0; i< bounds.size(); i++)
+    if (!std::binary_search(geoms.begin(), geoms.end(), bounds[i].second.geom))
+    {
+      if (i != j)
+        bounds[j] = bounds[i];
+      j++;
+    }
+  bounds.erase(bounds.begin()+j, bounds.end());
+}
+
 /// Gets the swept BV, creating it if necessary
 BVPtr CCD::get_swept_BV(CollisionGeometryPtr cg, BVPtr bv, double dt)
 {
@@ -989,34 +1111,13 @@ void CCD::update_bounds_vector(vector<pair<double, BoundsStruct> >& bounds, Axis
 
 void CCD::build_bv_vector(const vector<RigidBodyPtr>& rigid_bodies, vector<pair<double, BoundsStruct> >& bounds)
 {
-  const double INF = std::numeric_limits<double>::max();
-
   // clear the vector
   bounds.clear();
 
   // iterate over all collision geometries
   for (unsigned j=0; j< rigid_bodies.size(); j++)
     BOOST_FOREACH(CollisionGeometryPtr i, rigid_bodies[j]->geometries)
-    {
-      // get the primitive for the geometry
-      PrimitivePtr p = i->get_geometry();
-
-      // get the bounding sphere
-      BVPtr bv = _bounding_spheres.find(i)->second;
-
-      // setup the bounds structure
-      BoundsStruct bs;
-      bs.end = false;
-      bs.geom = i;
-      bs.bv = bv;
-
-      // add the lower bound
-      bounds.push_back(make_pair(-INF, bs));
-
-      // modify the bounds structure to indicate the end bound
-      bs.end = true;
-      bounds.push_back(make_pair(INF, bs));
-    }
+      add_bounds(bounds, i, _bounding_spheres.find(i)->second);
 }
 
 /// Constructs a bounding sphere for a given primitive type
@@ -1085,6 +1186,14 @@ BVPtr CCD::construct_bounding_sphere(CollisionGeometryPtr cg)
     return sph;
   }
 
+  // look for tetrahedral mesh primitive
+  shared_ptr<TetraMeshPrimitive> tm_p = dynamic_pointer_cast<TetraMeshPrimitive>(p);
+  if (tm_p)
+  {
+    sph->radius = tm_p->get_bounding_radius();
+    return sph;
+  }
+
   // look for heightmap primitive
   shared_ptr<HeightmapPrimitive> hm_p = dynamic_pointer_cast<HeightmapPrimitive>(p);
   if (hm_p)
@@ -14,6 +14,7 @@
 #include <Ravelin/LinAlgd.h>
 #include <Moby/XMLTree.h>
 #include <Moby/CollisionGeometry.h>
+#include <Moby/MemoryAccounting.h>
 #include <Moby/CSG.h>
 
 using std::endl;
@@ -194,6 +195,7 @@ double CSG::calc_dist(Primitive* p, Point3d& pcsg, Point3d& pp)
 /// Gets the bounding volume
 BVPtr CSG::get_BVH_root(CollisionGeometryPtr geom)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
   const unsigned THREE_D = 3;
 
   // CSG not applicable for deformable bodies 
@@ -5,6 +5,7 @@
  ****************************************************************************/
 
 #include <limits>
+#include <algorithm>
 #include <stack>
 #include <list>
 #include <set>
@@ -50,7 +51,64 @@ void CollisionDetection::broad_phase(double dt, const std::vector<ControlledBody
       for (unsigned j=i+1; j< rbs.size(); j++)
         if (rbs[i]->is_enabled() || rbs[j]->is_enabled())
           BOOST_FOREACH(CollisionGeometryPtr gj, rbs[j]->geometries)
-            to_check.push_back(std::make_pair(gi, gj));
+            if (is_checked(gi, gj))
+              to_check.push_back(std::make_pair(gi, gj));
+}
+
+/// Overrides the collision group filter for a pair of geometries
+/**
+ * \param enabled if <b>true</b>, the pair is checked regardless of the
+ *        geometries' collision groups and masks; otherwise, the pair is
+ *        never checked
+ */
+void CollisionDetection::set_pair_enabled(CollisionGeometryPtr cg1, CollisionGeometryPtr cg2, bool enabled)
+{
+  _pair_overrides[make_key(cg1, cg2)] = std::make_pair(make_sorted_pair(cg1, cg2), enabled);
+}
+
+/// Removes the override (if any) for a pair of geometries, so that the pair is filtered using collision groups and masks
+void CollisionDetection::clear_pair_override(CollisionGeometryPtr cg1, CollisionGeometryPtr cg2)
+{
+  _pair_overrides.erase(make_key(cg1, cg2));
+}
+
+/// Removes the overrides for all pairs that contain a geometry (e.g., when the geometry leaves the simulation)
+void CollisionDetection::clear_pair_overrides(CollisionGeometryPtr geom)
+{
+  for (PairOverrideMap::iterator i = _pair_overrides.begin(); i != _pair_overrides.end(); )
+  {
+    if (i->second.first.first == geom || i->second.first.second == geom)
+      i = _pair_overrides.erase(i);
+    else
+      i++;
+  }
+}
+
+/// Removes the overrides for all pairs that contain any of a sorted vector of geometries (in a single pass)
+void CollisionDetection::clear_pair_overrides(const vector<CollisionGeometryPtr>& geoms)
+{
+  for (PairOverrideMap::iterator i = _pair_overrides.begin(); i != _pair_overrides.end(); )
+  {
+    if (std::binary_search(geoms.begin(), geoms.end(), i->second.first.first) ||
+        std::binary_search(geoms.begin(), geoms.end(), i->second.first.second))
+      i = _pair_overrides.erase(i);
+    else
+      i++;
+  }
+}
+
+/// Computes conservative advancement steps for a number of pairs of geometries
+/**
+ * The default implementation processes the pairs one at a time; collision
+ * detectors that can process pairs concurrently override this method.
+ * \param pdi the pairwise distance information for each pair of geometries
+ * \param steps the conservative advancement step for each pair on return
+ */
+void CollisionDetection::calc_CA_Euler_steps(const vector<PairwiseDistInfo>& pdi, vector<double>& steps)
+{
+  steps.resize(pdi.size());
+  for (unsigned i=0; i< pdi.size(); i++)
+    steps[i] = calc_CA_Euler_step(pdi[i]);
 }
 
 /// Creates a contact constraint given the bare-minimum info
@@ -0,0 +1,1048 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <sstream>
+#include <Moby/Log.h>
+#include <Moby/Constants.h>
+#include <Moby/BV.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/RigidBody.h>
+#include <Moby/ArticulatedBody.h>
+#include <Moby/PlanePrimitive.h>
+#include <Moby/SpherePrimitive.h>
+#include <Moby/BoxPrimitive.h>
+#include <Moby/HeightmapPrimitive.h>
+#include <Moby/TriangleMeshPrimitive.h>
+#include <Moby/MemoryAccounting.h>
+#include <Moby/CollisionDetection.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
+using std::vector;
+using std::endl;
+using std::string;
+
+/****************************************************************************
+ The scene queries operate on a flat bounding box hierarchy that is built
+ over the bounding spheres of the geometries and reused by later batches
+ until the geometries or their poses change; geometries whose primitives
+ report no bounding radius (e.g., planes and heightmaps) are tested by every
+ query. Segments are intersected analytically with
+ planes, spheres, boxes and heightmaps, and triangle by triangle (through the
+ bounding volume hierarchy) with triangle meshes. Other casts find the first
+ hit along a segment using conservative advancement on the signed distances
+ of the primitives, so a hit is exact (to within the query tolerance) for
+ primitives whose signed distance is exact and conservative for those whose
+ signed distance underestimates; if advancement does not converge, the hit
+ is reported (conservatively) where advancement stopped.
+****************************************************************************/
+
+// the maximum number of geometries in a leaf of the query hierarchy
+static const unsigned MAX_LEAF_GEOMS = 2;
+
+// the maximum depth of the query hierarchy (sufficient for median splits)
+static const unsigned MAX_QUERY_DEPTH = 64;
+
+// the maximum number of conservative advancement steps for one geometry
+static const unsigned MAX_CA_ITER = 128;
+
+// the number of times that a cast box is split when bounding its distance
+static const unsigned MAX_BOX_SPLITS = 12;
+
+// a geometry in the query scene, with data precomputed for the batch
+struct QueryGeom
+{
+  CollisionGeometryPtr geom;     // the collision geometry
+  PrimitivePtr primitive;        // the primitive of the geometry
+  shared_ptr<const Pose3d> P;    // the pose of the primitive for the geometry
+  Transform3d pTg;               // transform from the global frame to P
+  Transform3d gTp;               // transform from P to the global frame
+  BVPtr bv;                      // the root of the primitive's BVH (if needed)
+  Transform3d bTg;               // transform from the global frame to the BV frame
+  shared_ptr<SingleBodyd> body;  // the body that the geometry belongs to
+  Origin3d center;               // the center of the bounding sphere (global frame)
+  double radius;                 // the radius of the bounding sphere (0 if unbounded)
+  double dist_scale;             // scales signed distances into lower bounds on the distance
+};
+
+// a node of the query hierarchy
+struct QueryNode
+{
+  double lo[3];     // the lower corner of the box
+  double hi[3];     // the upper corner of the box
+  int left;         // index of the left child (the right follows it); -1 for a leaf
+  unsigned first;   // index of the first geometry of the node
+  unsigned count;   // the number of geometries in the node
+
+  bool is_leaf() const { return left < 0; }
+};
+
+// the shape swept along a cast segment
+struct SweptShape
+{
+  bool box;           // whether the shape is a box (otherwise a sphere)
+  double radius;      // the radius of the sphere or the bounding radius of the box
+  Origin3d half;      // the half-lengths of the box
+  Origin3d axes[3];   // the axes of the box (global frame)
+};
+
+// compares geometry bounding sphere centers along an axis (for splitting hierarchy nodes)
+struct QueryGeomCenterComp
+{
+  QueryGeomCenterComp(const vector<QueryGeom>& g, unsigned axis) : _g(&g), _axis(axis) { }
+  bool operator()(unsigned i, unsigned j) const { return (*_g)[i].center[_axis] < (*_g)[j].center[_axis]; }
+
+  private:
+    const vector<QueryGeom>* _g;
+    unsigned _axis;
+};
+
+namespace Moby {
+
+// the geometries of a batch of queries and the hierarchy over them
+class QueryScene
+{
+  public:
+    QueryScene(const vector<ControlledBodyPtr>& bodies, unsigned mask, bool use_bvs);
+    bool is_current(const vector<ControlledBodyPtr>& bodies, unsigned mask) const;
+
+    unsigned mask;                 // the collision mask of the geometries
+    vector<QueryGeom> geoms;       // the geometries
+    vector<unsigned> unbounded;    // indices of the geometries that are tested by every query
+    vector<unsigned> order;        // indices of the bounded geometries, ordered so that each node covers a contiguous range
+    vector<QueryNode> nodes;       // the nodes of the hierarchy (the root is the first node)
+
+  private:
+    void build_node(unsigned idx, unsigned first, unsigned count);
+};
+
+} // end namespace
+
+// gets the rigid bodies (and articulated body links) among a set of bodies
+static void get_rigid_bodies(const vector<ControlledBodyPtr>& bodies, vector<RigidBodyPtr>& rbs)
+{
+  rbs.clear();
+  for (unsigned i=0; i< bodies.size(); i++)
+  {
+    ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(bodies[i]);
+    if (ab)
+    {
+      BOOST_FOREACH(shared_ptr<RigidBodyd> link, ab->get_links())
+        rbs.push_back(dynamic_pointer_cast<RigidBody>(link));
+    }
+    else
+    {
+      RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(bodies[i]);
+      if (rb)
+        rbs.push_back(rb);
+    }
+  }
+}
+
+// determines whether two transforms are identical
+static bool same_transform(const Transform3d& T1, const Transform3d& T2)
+{
+  return T1.x[0] == T2.x[0] && T1.x[1] == T2.x[1] && T1.x[2] == T2.x[2] &&
+         T1.q.x == T2.q.x && T1.q.y == T2.q.y && T1.q.z == T2.q.z && T1.q.w == T2.q.w;
+}
+
+// computes the factor that makes a primitive's signed distance a lower bound on the distance
+/**
+ * The signed distance of a heightmap is the height above it; the distance
+ * is at least that height scaled by 1/sqrt(1 + s^2), where s bounds the
+ * slope of the heightmap.
+ */
+static double calc_dist_scale(PrimitivePtr primitive)
+{
+  shared_ptr<HeightmapPrimitive> hm = dynamic_pointer_cast<HeightmapPrimitive>(primitive);
+  if (!hm)
+    return 1.0;
+
+  const double S = hm->get_max_slope();
+  return 1.0/std::sqrt(1.0 + S*S);
+}
+
+// collects the geometries of the bodies and builds the hierarchy over them
+QueryScene::QueryScene(const vector<ControlledBodyPtr>& bodies, unsigned mask, bool use_bvs)
+{
+  this->mask = mask;
+
+  // get the set of rigid bodies
+  vector<RigidBodyPtr> rbs;
+  get_rigid_bodies(bodies, rbs);
+
+  // setup the geometries (this is done serially, because the primitives
+  // may construct their bounding volume hierarchies lazily)
+  for (unsigned i=0; i< rbs.size(); i++)
+    BOOST_FOREACH(CollisionGeometryPtr cg, rbs[i]->geometries)
+    {
+      if ((cg->collision_group & mask) == 0)
+        continue;
+
+      geoms.push_back(QueryGeom());
+      QueryGeom& g = geoms.back();
+      g.geom = cg;
+      g.primitive = cg->get_geometry();
+      g.body = cg->get_single_body();
+      g.P = g.primitive->get_pose(cg);
+      g.pTg = Pose3d::calc_relative_pose(GLOBAL, g.P);
+      g.gTp = Pose3d::calc_relative_pose(g.P, GLOBAL);
+      g.center = Origin3d(g.gTp.transform_point(Point3d(0.0, 0.0, 0.0, g.P)));
+      g.radius = g.primitive->get_bounding_radius();
+      g.dist_scale = calc_dist_scale(g.primitive);
+      if (use_bvs)
+      {
+        // the bounding volume of a plane is finite (the plane is not), and a
+        // mesh's hierarchy is traversed when intersecting the mesh itself
+        BVPtr bv = g.primitive->get_BVH_root(cg);
+        if (bv && !dynamic_pointer_cast<PlanePrimitive>(g.primitive) && !dynamic_pointer_cast<TriangleMeshPrimitive>(g.primitive))
+        {
+          g.bv = bv;
+          g.bTg = Pose3d::calc_relative_pose(GLOBAL, g.bv->get_relative_pose());
+        }
+      }
+    }
+
+  // separate the unbounded geometries
+  for (unsigned i=0; i< geoms.size(); i++)
+    if (geoms[i].radius > 0.0)
+      order.push_back(i);
+    else
+      unbounded.push_back(i);
+
+  FILE_LOG(LOG_COLDET) << "QueryScene::QueryScene() - " << order.size() << " bounded and " << unbounded.size() << " unbounded geometries" << endl;
+
+  // build the hierarchy
+  if (!order.empty())
+  {
+    nodes.reserve(2*order.size()/MAX_LEAF_GEOMS + 1);
+    nodes.push_back(QueryNode());
+    build_node(0, 0, order.size());
+  }
+}
+
+// determines whether the scene was built for the same geometries (and primitives) of the given bodies, at the same poses
+bool QueryScene::is_current(const vector<ControlledBodyPtr>& bodies, unsigned mask) const
+{
+  if (mask != this->mask)
+    return false;
+
+  vector<RigidBodyPtr> rbs;
+  get_rigid_bodies(bodies, rbs);
+  unsigned k = 0;
+  for (unsigned i=0; i< rbs.size(); i++)
+    BOOST_FOREACH(CollisionGeometryPtr cg, rbs[i]->geometries)
+    {
+      if ((cg->collision_group & mask) == 0)
+        continue;
+      if (k == geoms.size())
+        return false;
+      const QueryGeom& g = geoms[k++];
+      if (g.geom != cg || g.primitive != cg->get_geometry())
+        return false;
+      if (!same_transform(Pose3d::calc_relative_pose(g.P, GLOBAL), g.gTp))
+        return false;
+    }
+
+  return k == geoms.size();
+}
+
+// gets the scene for a batch of queries, reusing the scene of the last batch if it is current
+const QueryScene& CollisionDetection::get_query_scene(const vector<ControlledBodyPtr>& bodies, unsigned mask, bool use_bvs)
+{
+  shared_ptr<QueryScene>& scene = _query_scenes[use_bvs ? 1 : 0];
+  if (!scene || !scene->is_current(bodies, mask))
+    scene = shared_ptr<QueryScene>(new QueryScene(bodies, mask, use_bvs));
+  return *scene;
+}
+
+// builds a node of the hierarchy (and, recursively, its children)
+void QueryScene::build_node(unsigned idx, unsigned first, unsigned count)
+{
+  const unsigned X = 0, Y = 1, Z = 2, THREE_D = 3;
+  const double INF = std::numeric_limits<double>::max();
+
+  // compute the bounding box of the spheres and of their centers
+  Origin3d lo(INF, INF, INF), hi(-INF, -INF, -INF);
+  Origin3d clo(INF, INF, INF), chi(-INF, -INF, -INF);
+  for (unsigned i=first; i< first+count; i++)
+  {
+    const QueryGeom& g = geoms[order[i]];
+    for (unsigned k=0; k< THREE_D; k++)
+    {
+      lo[k] = std::min(lo[k], g.center[k] - g.radius);
+      hi[k] = std::max(hi[k], g.center[k] + g.radius);
+      clo[k] = std::min(clo[k], g.center[k]);
+      chi[k] = std::max(chi[k], g.center[k]);
+    }
+  }
+
+  // setup the node
+  QueryNode& node = nodes[idx];
+  for (unsigned k=0; k< THREE_D; k++)
+  {
+    node.lo[k] = lo[k];
+    node.hi[k] = hi[k];
+  }
+  node.first = first;
+  node.count = count;
+  node.left = -1;
+  if (count <= MAX_LEAF_GEOMS)
+    return;
+
+  // split at the median center along the axis of greatest extent
+  Origin3d ext = chi - clo;
+  unsigned axis = (ext[X] > ext[Y]) ? ((ext[X] > ext[Z]) ? X : Z) : ((ext[Y] > ext[Z]) ? Y : Z);
+  const unsigned half = count/2;
+  std::nth_element(order.begin()+first, order.begin()+first+half, order.begin()+first+count, QueryGeomCenterComp(geoms, axis));
+
+  // create the children (this may invalidate 'node')
+  const unsigned left = nodes.size();
+  nodes[idx].left = (int) left;
+  nodes.push_back(QueryNode());
+  nodes.push_back(QueryNode());
+  build_node(left, first, half);
+  build_node(left+1, first+half, count-half);
+}
+
+// clips the segment a + d*t, t in [t0, t1], against a node's box inflated by r
+static bool clip_segment(const QueryNode& node, const Origin3d& a, const Origin3d& d, double r, double& t0, double& t1)
+{
+  const unsigned THREE_D = 3;
+
+  for (unsigned k=0; k< THREE_D; k++)
+  {
+    const double lo = node.lo[k] - r, hi = node.hi[k] + r;
+    if (std::fabs(d[k]) < NEAR_ZERO)
+    {
+      if (a[k] < lo || a[k] > hi)
+        return false;
+    }
+    else
+    {
+      const double ood = 1.0/d[k];
+      double ta = (lo - a[k])*ood;
+      double tb = (hi - a[k])*ood;
+      if (ta > tb)
+        std::swap(ta, tb);
+      t0 = std::max(t0, ta);
+      t1 = std::min(t1, tb);
+      if (t0 > t1)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+// computes the distance from a point to a node's box
+static double calc_node_dist(const QueryNode& node, const Origin3d& p)
+{
+  const unsigned THREE_D = 3;
+
+  double dsq = 0.0;
+  for (unsigned k=0; k< THREE_D; k++)
+  {
+    double delta = 0.0;
+    if (p[k] < node.lo[k])
+      delta = node.lo[k] - p[k];
+    else if (p[k] > node.hi[k])
+      delta = p[k] - node.hi[k];
+    dsq += delta*delta;
+  }
+
+  return std::sqrt(dsq);
+}
+
+// computes the signed distance from a point (global frame) to a geometry
+static double calc_point_dist(const QueryGeom& g, const Origin3d& x)
+{
+  return g.primitive->calc_signed_dist(g.pTg.transform_point(Point3d(x, GLOBAL)));
+}
+
+// computes a lower bound on the signed distance from a box to a geometry
+/**
+ * The box is split recursively along its longest axis wherever the bound
+ * from its bounding sphere is not greater than the tolerance; on return,
+ * closest contains the center of the cell that attains the bound.
+ */
+static double calc_box_dist(const QueryGeom& g, const SweptShape& s, const Origin3d& c, const Origin3d& half, unsigned splits, double tol, Origin3d& closest)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  closest = c;
+  const double d = calc_point_dist(g, c)*g.dist_scale;
+  const double lb = d - half.norm();
+  if (lb > tol || d <= tol || splits == 0)
+    return lb;
+
+  // split along the longest axis
+  const unsigned axis = (half[X] > half[Y]) ? ((half[X] > half[Z]) ? X : Z) : ((half[Y] > half[Z]) ? Y : Z);
+  Origin3d h = half;
+  h[axis] *= 0.5;
+  const Origin3d offset = s.axes[axis]*h[axis];
+
+  // bound each half, returning as soon as a cell is found to be in contact
+  Origin3d c1, c2;
+  const double lb1 = calc_box_dist(g, s, c - offset, h, splits-1, tol, c1);
+  if (lb1 <= tol && calc_point_dist(g, c1)*g.dist_scale <= tol)
+  {
+    closest = c1;
+    return lb1;
+  }
+  const double lb2 = calc_box_dist(g, s, c + offset, h, splits-1, tol, c2);
+  closest = (lb1 < lb2) ? c1 : c2;
+  return std::min(lb1, lb2);
+}
+
+// computes (a lower bound on) the signed distance from the swept shape at x to a geometry
+static double calc_shape_dist(const QueryGeom& g, const SweptShape& s, const Origin3d& x, double tol, Origin3d& closest)
+{
+  if (s.box)
+    return calc_box_dist(g, s, x, s.half, MAX_BOX_SPLITS, tol, closest);
+
+  closest = x;
+  return calc_point_dist(g, x)*g.dist_scale - s.radius;
+}
+
+// advances the shape along the segment a + d*t from t toward tmax, until it hits the geometry
+/**
+ * If advancement has not converged after the maximum number of steps, the
+ * hit is reported (conservatively) at the last parameter reached, since the
+ * shape can not have passed through the geometry before it.
+ */
+static bool advance(const QueryGeom& g, const SweptShape& s, const Origin3d& a, const Origin3d& d, double t, double tmax, double tol, double& thit, Origin3d& closest)
+{
+  const double LEN = d.norm();
+
+  for (unsigned iter=0; t <= tmax; iter++)
+  {
+    const double dist = calc_shape_dist(g, s, a + d*t, tol, closest);
+    if (dist <= tol)
+    {
+      thit = t;
+      return true;
+    }
+
+    // a degenerate segment can not move any closer
+    if (LEN < NEAR_ZERO)
+      return false;
+
+    // report a hit if advancement is not converging
+    if (iter+1 == MAX_CA_ITER)
+    {
+      FILE_LOG(LOG_COLDET) << "advance() - conservative advancement did not converge after " << MAX_CA_ITER << " steps; reporting hit at t=" << t << endl;
+      thit = t;
+      return true;
+    }
+
+    t += dist/LEN;
+  }
+
+  return false;
+}
+
+// computes the height above a heightmap of the point a + d*t (in the heightmap frame)
+static double calc_height_along(const HeightmapPrimitive& hm, const Point3d& a, const Vector3d& d, double t)
+{
+  return hm.calc_signed_dist(a + d*t);
+}
+
+// finds the first crossing of a heightmap by the segment a + d*t, t in [t0, t1] (in the heightmap frame)
+/**
+ * The segment is split where it crosses the lines of the height grid; within
+ * each cell the height along the segment is (at most) quadratic, so the
+ * height is sampled at the ends, the middle, and the extremum of the
+ * quadratic through those samples, and the first sign change is bisected.
+ */
+static bool intersect_heightmap(const HeightmapPrimitive& hm, const Point3d& a, const Vector3d& d, double t0, double t1, double tol, double& thit)
+{
+  const unsigned X = 0, Z = 2;
+  const unsigned MAX_BISECT_ITER = 64;
+  const MatrixNd& heights = hm.get_heights();
+
+  // check whether the segment starts beneath the surface
+  double fa = calc_height_along(hm, a, d, t0);
+  if (fa <= 0.0)
+  {
+    thit = t0;
+    return true;
+  }
+
+  // get the parameters where the segment crosses the grid lines
+  vector<double> ts;
+  ts.push_back(t0);
+  ts.push_back(t1);
+  const unsigned NDIM[2] = { heights.rows(), heights.columns() };
+  const double EXTENT[2] = { hm.get_width(), hm.get_depth() };
+  const unsigned AXIS[2] = { X, Z };
+  for (unsigned k=0; k< 2; k++)
+  {
+    if (NDIM[k] < 2 || std::fabs(d[AXIS[k]]) < NEAR_ZERO)
+      continue;
+    for (unsigned i=0; i< NDIM[k]; i++)
+    {
+      const double line = -EXTENT[k]*0.5 + EXTENT[k]*i/(NDIM[k]-1);
+      const double t = (line - a[AXIS[k]])/d[AXIS[k]];
+      if (t > t0 && t < t1)
+        ts.push_back(t);
+    }
+  }
+  std::sort(ts.begin(), ts.end());
+
+  // process each cell that the segment passes through
+  for (unsigned i=1; i< ts.size(); i++)
+  {
+    const double ta = ts[i-1], tb = ts[i];
+    if (tb - ta < NEAR_ZERO)
+      continue;
+
+    // sample the ends and middle of the cell and the extremum of the
+    // quadratic through the samples
+    const double tm = (ta + tb)*0.5;
+    const double fm = calc_height_along(hm, a, d, tm), fb = calc_height_along(hm, a, d, tb);
+    double samples[4] = { ta, tm, tb, tb };
+    double values[4] = { fa, fm, fb, fb };
+    unsigned nsamples = 3;
+    const double h = tm - ta;
+    const double curv = fa - 2.0*fm + fb;
+    if (std::fabs(curv) > NEAR_ZERO)
+    {
+      const double te = tm - 0.5*h*(fb - fa)/curv;
+      if (te > ta && te < tb)
+      {
+        const double fe = calc_height_along(hm, a, d, te);
+        if (te < tm)
+        {
+          samples[3] = tb; values[3] = fb;
+          samples[2] = tm; values[2] = fm;
+          samples[1] = te; values[1] = fe;
+        }
+        else
+        {
+          samples[3] = tb; values[3] = fb;
+          samples[2] = te; values[2] = fe;
+        }
+        nsamples = 4;
+      }
+    }
+
+    // find the first sign change and bisect it
+    for (unsigned j=1; j< nsamples; j++)
+    {
+      if (values[j] > 0.0)
+        continue;
+      double lo = samples[j-1], hi = samples[j];
+      for (unsigned iter=0; iter< MAX_BISECT_ITER && (hi - lo)*d.norm() > tol; iter++)
+      {
+        const double mid = (lo + hi)*0.5;
+        if (calc_height_along(hm, a, d, mid) > 0.0)
+          lo = mid;
+        else
+          hi = mid;
+      }
+      thit = hi;
+      return true;
+    }
+
+    fa = fb;
+  }
+
+  return false;
+}
+
+// finds the first intersection of the segment a + d*t, t in [t0, t1], with a geometry analytically
+/**
+ * \return <b>true</b> if the primitive of the geometry supports analytical
+ *         intersection (in which case hit indicates whether it was hit),
+ *         <b>false</b> otherwise
+ */
+static bool intersect_seg(const QueryGeom& g, const Origin3d& ga, const Origin3d& gd, double t0, double t1, double tol, bool& hit, double& thit)
+{
+  const unsigned Y = 1, THREE_D = 3;
+
+  // transform the segment to the frame of the primitive
+  const Point3d a = g.pTg.transform_point(Point3d(ga, GLOBAL));
+  const Vector3d d = g.pTg.transform_vector(Vector3d(gd, GLOBAL));
+  hit = false;
+
+  // plane: the segment hits where its height crosses zero
+  if (dynamic_pointer_cast<PlanePrimitive>(g.primitive))
+  {
+    const double y0 = a[Y] + d[Y]*t0;
+    if (y0 <= 0.0)
+      thit = t0;
+    else if (d[Y] < -NEAR_ZERO)
+      thit = -a[Y]/d[Y];
+    else
+      return true;
+    hit = (thit <= t1);
+    return true;
+  }
+
+  // sphere: solve the quadratic for the first crossing of the surface
+  shared_ptr<SpherePrimitive> sph = dynamic_pointer_cast<SpherePrimitive>(g.primitive);
+  if (sph)
+  {
+    const double R = sph->get_radius();
+    const Vector3d a0 = a + d*t0;
+    const double A = d.norm_sq(), B = a0.dot(d), C = a0.norm_sq() - R*R;
+    if (C <= 0.0)
+      thit = t0;
+    else
+    {
+      const double disc = B*B - A*C;
+      if (A < NEAR_ZERO || disc < 0.0 || B > 0.0)
+        return true;
+      thit = t0 + (-B - std::sqrt(disc))/A;
+    }
+    hit = (thit <= t1);
+    return true;
+  }
+
+  // box: clip the segment against the slabs
+  shared_ptr<BoxPrimitive> box = dynamic_pointer_cast<BoxPrimitive>(g.primitive);
+  if (box)
+  {
+    const double ext[THREE_D] = { box->get_x_len()*0.5, box->get_y_len()*0.5, box->get_z_len()*0.5 };
+    double tmin = t0, tmax = t1;
+    for (unsigned k=0; k< THREE_D; k++)
+    {
+      if (std::fabs(d[k]) < NEAR_ZERO)
+      {
+        if (a[k] < -ext[k] || a[k] > ext[k])
+          return true;
+      }
+      else
+      {
+        double ta = (-ext[k] - a[k])/d[k];
+        double tb = (ext[k] - a[k])/d[k];
+        if (ta > tb)
+          std::swap(ta, tb);
+        tmin = std::max(tmin, ta);
+        tmax = std::min(tmax, tb);
+        if (tmin > tmax)
+          return true;
+      }
+    }
+    thit = tmin;
+    hit = true;
+    return true;
+  }
+
+  // heightmap: search the cells that the segment passes through
+  shared_ptr<HeightmapPrimitive> hm = dynamic_pointer_cast<HeightmapPrimitive>(g.primitive);
+  if (hm)
+  {
+    hit = intersect_heightmap(*hm, a, d, t0, t1, tol, thit);
+    return true;
+  }
+
+  // triangle mesh: intersect the triangles through the hierarchy
+  shared_ptr<TriangleMeshPrimitive> tm = dynamic_pointer_cast<TriangleMeshPrimitive>(g.primitive);
+  if (tm && t1 > t0)
+  {
+    LineSeg3 seg(a + d*t0, a + d*t1);
+    double s;
+    Point3d isect;
+    Vector3d normal;
+    if (tm->intersect_seg(g.geom, seg, s, isect, normal))
+    {
+      thit = t0 + s*(t1 - t0);
+      hit = true;
+    }
+    return true;
+  }
+
+  return false;
+}
+
+// computes the point on a geometry closest to x and the normal there (both in the global frame)
+static void calc_point_and_normal(const QueryGeom& g, const Origin3d& x, Point3d& point, Vector3d& normal)
+{
+  vector<Vector3d> normals;
+  const Point3d px = g.pTg.transform_point(Point3d(x, GLOBAL));
+  const double dist = g.primitive->calc_dist_and_normal(px, normals);
+  if (normals.empty())
+  {
+    point = Point3d(x, GLOBAL);
+    normal = Vector3d(0.0, 0.0, 0.0, GLOBAL);
+    return;
+  }
+
+  Vector3d n(Origin3d(normals.front()), g.P);
+  n.normalize();
+  normal = g.gTp.transform_vector(n);
+  point = g.gTp.transform_point(px - n*dist);
+}
+
+// the first hit found so far by a cast
+struct CastHit
+{
+  double t;           // the parameter of the hit
+  int geom;           // the index of the geometry hit (-1 if none)
+  Origin3d closest;   // the point of the shape closest to the geometry at the hit
+};
+
+// casts a shape along the segment a + d*t against a single geometry, starting from t0
+static void cast_geom(const QueryScene& scene, unsigned j, const SweptShape& s, const Origin3d& a, const Origin3d& d, double t0, double tol, const SingleBodyd* ignored, CastHit& hit)
+{
+  const QueryGeom& g = scene.geoms[j];
+
+  // skip the geometries of the ignored body
+  if (ignored && g.body.get() == ignored)
+    return;
+
+  // segments can be culled using the BVH of the primitive
+  if (!s.box && s.radius == 0.0 && g.bv)
+  {
+    LineSeg3 bseg(g.bTg.transform_point(Point3d(a, GLOBAL)), g.bTg.transform_point(Point3d(a + d, GLOBAL)));
+    double tmin = 0.0;
+    Point3d q;
+    if (!g.bv->intersects(bseg, tmin, 1.0, q))
+      return;
+  }
+
+  // segments are intersected analytically where possible
+  double t;
+  Origin3d closest;
+  bool found;
+  if (!s.box && s.radius == 0.0 && intersect_seg(g, a, d, t0, hit.t, tol, found, t))
+    closest = a + d*t;
+  else
+    found = advance(g, s, a, d, t0, hit.t, tol, t, closest);
+
+  if (found && (hit.geom < 0 || t < hit.t))
+  {
+    hit.t = t;
+    hit.geom = (int) j;
+    hit.closest = closest;
+  }
+}
+
+// throws an exception for the first query that failed (if any)
+static void report_errors(const char* fname, const vector<string>& errors)
+{
+  unsigned nfailed = 0;
+  for (unsigned i=0; i< errors.size(); i++)
+    if (!errors[i].empty())
+      nfailed++;
+  if (nfailed == 0)
+    return;
+
+  for (unsigned i=0; i< errors.size(); i++)
+    if (!errors[i].empty())
+    {
+      std::ostringstream oss;
+      oss << fname << "() - " << nfailed << " of " << errors.size() << " queries failed; query " << i << ": " << errors[i];
+      throw std::runtime_error(oss.str());
+    }
+}
+
+// casts a shape along each of a number of segments
+static void cast(const QueryScene& scene, const vector<LineSeg3>& segs, const SweptShape& s, double tol, const vector<RigidBodyPtr>* ignored, SceneQueryResults& results)
+{
+  results.resize(segs.size());
+
+  // exceptions can not propagate out of a parallel region, so they are
+  // recorded for each query and reported afterward
+  vector<string> errors(segs.size());
+
+  // worker threads do not inherit the subsystem current in this thread
+  const MemoryAccounting::Subsystem MEM_SUBSYSTEM = MemoryAccounting::get_current();
+  #ifdef _OPENMP
+  #pragma omp parallel for
+  #endif
+  for (int i=0; i< (int) segs.size(); i++)
+  {
+    MemoryAccounting::Scope mem_scope(MEM_SUBSYSTEM);
+    try
+    {
+      const Origin3d a(Pose3d::transform_point(GLOBAL, segs[i].first));
+      const Origin3d d = Origin3d(Pose3d::transform_point(GLOBAL, segs[i].second)) - a;
+      const SingleBodyd* ignored_body = NULL;
+      if (ignored)
+        ignored_body = (*ignored)[i].get();
+      CastHit hit;
+      hit.t = 1.0;
+      hit.geom = -1;
+
+      // process the unbounded geometries
+      for (unsigned j=0; j< scene.unbounded.size(); j++)
+        cast_geom(scene, scene.unbounded[j], s, a, d, 0.0, tol, ignored_body, hit);
+
+      // traverse the hierarchy, skipping nodes that the (inflated) segment
+      // enters after the first hit found so far
+      if (!scene.nodes.empty())
+      {
+        unsigned stack[MAX_QUERY_DEPTH+1];
+        unsigned top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+          const QueryNode& node = scene.nodes[stack[--top]];
+          double t0 = 0.0, t1 = hit.t;
+          if (!clip_segment(node, a, d, s.radius, t0, t1))
+            continue;
+
+          if (node.is_leaf())
+          {
+            for (unsigned k=node.first; k< node.first+node.count; k++)
+              cast_geom(scene, scene.order[k], s, a, d, t0, tol, ignored_body, hit);
+          }
+          else
+          {
+            stack[top++] = (unsigned) node.left;
+            stack[top++] = (unsigned) node.left+1;
+          }
+        }
+      }
+
+      // record the hit
+      if (hit.geom >= 0)
+      {
+        const QueryGeom& g = scene.geoms[hit.geom];
+        results.geoms[i] = g.geom;
+        results.t[i] = hit.t;
+        calc_point_and_normal(g, hit.closest, results.points[i], results.normals[i]);
+      }
+    }
+    catch (std::exception& e)
+    {
+      errors[i] = e.what();
+    }
+    catch (...)
+    {
+      errors[i] = "unknown exception";
+    }
+  }
+
+  report_errors("CollisionDetection::cast", errors);
+}
+
+/// Finds the first geometry hit by each of a number of line segments
+/**
+ * A segment that starts inside a geometry hits it at its first point, except
+ * that a segment starting inside a triangle mesh hits the mesh where it
+ * leaves.
+ * \param bodies the bodies whose geometries are queried
+ * \param segs the line segments
+ * \param results on return, the first geometry hit by each segment (if any),
+ *        the parameter of the hit (0 at the first point of the segment, 1
+ *        at the second), and the point and normal on the geometry
+ * \param mask only geometries whose collision group intersects this mask
+ *        are queried
+ * \param ignored if non-NULL, the body (one per segment, NULL for none)
+ *        whose geometries each segment passes through (e.g., the body that
+ *        a sensor casting the segment is attached to)
+ */
+void CollisionDetection::cast_segments(const vector<ControlledBodyPtr>& bodies, const vector<LineSeg3>& segs, SceneQueryResults& results, unsigned mask, const vector<RigidBodyPtr>* ignored)
+{
+  if (ignored && ignored->size() != segs.size())
+    throw std::runtime_error("CollisionDetection::cast_segments() - number of segments and ignored bodies do not match");
+
+  SweptShape s;
+  s.box = false;
+  s.radius = 0.0;
+  const QueryScene& scene = get_query_scene(bodies, mask, true);
+  cast(scene, segs, s, query_tolerance, ignored, results);
+}
+
+/// Finds the first geometry hit by each of a number of rays
+/**
+ * \param bodies the bodies whose geometries are queried
+ * \param origins the origins of the rays
+ * \param dirs the directions of the rays (need not be normalized)
+ * \param max_dist the (finite) length of every ray
+ * \param results on return, the first geometry hit by each ray (if any), the
+ *        distance from the origin to the hit, and the point and normal on the
+ *        geometry
+ * \param mask only geometries whose collision group intersects this mask
+ *        are queried
+ */
+void CollisionDetection::cast_rays(const vector<ControlledBodyPtr>& bodies, const vector<Point3d>& origins, const vector<Vector3d>& dirs, double max_dist, SceneQueryResults& results, unsigned mask)
+{
+  if (origins.size() != dirs.size())
+    throw std::runtime_error("CollisionDetection::cast_rays() - number of origins and directions do not match");
+
+  // convert the rays to segments
+  vector<LineSeg3> segs(origins.size());
+  for (unsigned i=0; i< origins.size(); i++)
+  {
+    Vector3d dir = Pose3d::transform_vector(GLOBAL, dirs[i]);
+    dir.normalize();
+    segs[i].first = Pose3d::transform_point(GLOBAL, origins[i]);
+    segs[i].second = segs[i].first + dir*max_dist;
+  }
+
+  // cast the segments and convert the parameters to distances
+  cast_segments(bodies, segs, results, mask);
+  for (unsigned i=0; i< results.size(); i++)
+    if (results.geoms[i])
+      results.t[i] *= max_dist;
+}
+
+/// Finds the first geometry hit by a sphere swept along each of a number of line segments
+/**
+ * \param bodies the bodies whose geometries are queried
+ * \param segs the paths of the sphere center
+ * \param radius the radius of the sphere
+ * \param results on return, the first geometry hit by each sweep (if any),
+ *        the parameter of the hit, and the point and normal on the geometry
+ * \param mask only geometries whose collision group intersects this mask
+ *        are queried
+ */
+void CollisionDetection::cast_spheres(const vector<ControlledBodyPtr>& bodies, const vector<LineSeg3>& segs, double radius, SceneQueryResults& results, unsigned mask)
+{
+  if (radius < 0.0)
+    throw std::runtime_error("CollisionDetection::cast_spheres() - radius is negative");
+
+  SweptShape s;
+  s.box = false;
+  s.radius = radius;
+  const QueryScene& scene = get_query_scene(bodies, mask, false);
+  cast(scene, segs, s, query_tolerance, NULL, results);
+}
+
+/// Finds the first geometry hit by a box translated along each of a number of line segments
+/**
+ * Contact between the box and a geometry is determined by bounding the
+ * distance from cells of the (recursively split) box, so a hit may be
+ * reported early by at most the half-diagonal of the finest cell.
+ * \param bodies the bodies whose geometries are queried
+ * \param segs the paths of the box center
+ * \param half_lengths the half-lengths of the box
+ * \param q the orientation of the box (relative to the global frame)
+ * \param results on return, the first geometry hit by each sweep (if any),
+ *        the parameter of the hit, and the point and normal on the geometry
+ * \param mask only geometries whose collision group intersects this mask
+ *        are queried
+ */
+void CollisionDetection::cast_boxes(const vector<ControlledBodyPtr>& bodies, const vector<LineSeg3>& segs, const Origin3d& half_lengths, const Quatd& q, SceneQueryResults& results, unsigned mask)
+{
+  const unsigned THREE_D = 3;
+
+  SweptShape s;
+  s.box = true;
+  s.half = half_lengths;
+  s.radius = half_lengths.norm();
+  Matrix3d R = q;
+  for (unsigned i=0; i< THREE_D; i++)
+  {
+    Origin3d e(0.0, 0.0, 0.0);
+    e[i] = 1.0;
+    s.axes[i] = R * e;
+  }
+
+  const QueryScene& scene = get_query_scene(bodies, mask, false);
+  cast(scene, segs, s, query_tolerance, NULL, results);
+}
+
+/// Finds the closest geometry to each of a number of points
+/**
+ * \param bodies the bodies whose geometries are queried
+ * \param points the query points
+ * \param max_dist geometries farther than this distance are not reported
+ * \param results on return, the geometry with the smallest signed distance
+ *        to each point (if any within max_dist), that signed distance, and
+ *        the closest point and normal on the geometry
+ * \param mask only geometries whose collision group intersects this mask
+ *        are queried
+ */
+void CollisionDetection::calc_point_distances(const vector<ControlledBodyPtr>& bodies, const vector<Point3d>& points, double max_dist, SceneQueryResults& results, unsigned mask)
+{
+  const QueryScene& scene = get_query_scene(bodies, mask, false);
+  results.resize(points.size());
+
+  // exceptions are recorded for each query and reported afterward
+  vector<string> errors(points.size());
+
+  // worker threads do not inherit the subsystem current in this thread
+  const MemoryAccounting::Subsystem MEM_SUBSYSTEM = MemoryAccounting::get_current();
+  #ifdef _OPENMP
+  #pragma omp parallel for
+  #endif
+  for (int i=0; i< (int) points.size(); i++)
+  {
+    MemoryAccounting::Scope mem_scope(MEM_SUBSYSTEM);
+    try
+    {
+      const Origin3d p(Pose3d::transform_point(GLOBAL, points[i]));
+      double dbest = max_dist;
+      int best = -1;
+
+      // process the unbounded geometries
+      for (unsigned j=0; j< scene.unbounded.size(); j++)
+      {
+        const double dist = calc_point_dist(scene.geoms[scene.unbounded[j]], p);
+        if (dist <= dbest)
+        {
+          dbest = dist;
+          best = (int) scene.unbounded[j];
+        }
+      }
+
+      // traverse the hierarchy; a node can only be pruned if its distance is
+      // positive, since geometries containing the point are farther inside
+      if (!scene.nodes.empty())
+      {
+        unsigned stack[MAX_QUERY_DEPTH+1];
+        unsigned top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+          const QueryNode& node = scene.nodes[stack[--top]];
+          const double lb = calc_node_dist(node, p);
+          if (lb > 0.0 && lb > dbest)
+            continue;
+
+          if (node.is_leaf())
+          {
+            for (unsigned k=node.first; k< node.first+node.count; k++)
+            {
+              const double dist = calc_point_dist(scene.geoms[scene.order[k]], p);
+              if (dist <= dbest)
+              {
+                dbest = dist;
+                best = (int) scene.order[k];
+              }
+            }
+          }
+          else
+          {
+            stack[top++] = (unsigned) node.left;
+            stack[top++] = (unsigned) node.left+1;
+          }
+        }
+      }
+
+      // record the closest geometry
+      if (best >= 0)
+      {
+        const QueryGeom& g = scene.geoms[best];
+        results.geoms[i] = g.geom;
+        results.t[i] = dbest;
+        calc_point_and_normal(g, p, results.points[i], results.normals[i]);
+      }
+    }
+    catch (std::exception& e)
+    {
+      errors[i] = e.what();
+    }
+    catch (...)
+    {
+      errors[i] = "unknown exception";
+    }
+  }
+
+  report_errors("CollisionDetection::calc_point_distances", errors);
+}
+
@@ -4,9 +4,12 @@
  * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
  ****************************************************************************/
 
+#include <cstdlib>
+#include <limits>
 #include <stdexcept>
 #include <iostream>
 #include <stack>
+#include <algorithm>
 #include <fstream>
 #include <Moby/TessellatedPolyhedron.h>
 #include <Moby/CompGeom.h>
@@ -14,6 +17,7 @@
 #include <Moby/Constants.h>
 #include <Moby/XMLTree.h>
 #include <Moby/CollisionGeometry.h>
+#include <Moby/MemoryAccounting.h>
 
 using std::vector;
 using boost::dynamic_pointer_cast;
@@ -26,6 +30,8 @@ using namespace Moby;
 CollisionGeometry::CollisionGeometry()
 {
   _F = shared_ptr<Pose3d>(new Pose3d);
+  collision_group = 1;
+  collision_mask = std::numeric_limits<unsigned>::max();
 }
 
 /// Gets a supporting point for this geometry in a particular direction
@@ -49,6 +55,10 @@ Point3d CollisionGeometry::get_supporting_point(const Vector3d& d) const
 }
 
 /// Gets the farthest point from this geometry
+/**
+ * The coarser levels of detail are included, so that the distance bounds
+ * every level.
+ */
 double CollisionGeometry::get_farthest_point_distance() const
 {
   // get the primitive from this
@@ -63,8 +73,17 @@ double CollisionGeometry::get_farthest_point_distance() const
   CollisionGeometryPtr cg = const_pointer_cast<CollisionGeometry>(cg_const);
   shared_ptr<const Pose3d> P = primitive->get_pose(cg);
   Transform3d rbTp = Pose3d::calc_relative_pose(P, rb->get_pose());
+  double dist = r + rbTp.x.norm();
+
+  // check the coarser levels of detail
+  for (unsigned i=0; i< _detail_levels.size(); i++)
+  {
+    PrimitivePtr level = _detail_levels[i].first;
+    rbTp = Pose3d::calc_relative_pose(level->get_pose(cg), rb->get_pose());
+    dist = std::max(dist, level->get_bounding_radius() + rbTp.x.norm());
+  }
 
-  return r + rbTp.x.norm();
+  return dist;
 }
 
 /// Sets the single body associated with this CollisionGeometry
@@ -84,6 +103,7 @@ void CollisionGeometry::set_single_body(shared_ptr<SingleBodyd> s)
  */
 PrimitivePtr CollisionGeometry::set_geometry(PrimitivePtr primitive)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
   Quatd EYE;
 
   if (_single_body.expired())
@@ -108,6 +128,76 @@ PrimitivePtr CollisionGeometry::set_geometry(PrimitivePtr primitive)
   return primitive;
 }
 
+/// Adds a coarser level of detail for this geometry
+/**
+ * \param primitive a primitive enclosing the geometry (and any finer levels
+ *        of detail), e.g., a bounding sphere or the convex hull of a mesh
+ * \param switch_dist the distance at and below which this level is not used;
+ *        coarser levels must have larger switching distances
+ */
+void CollisionGeometry::add_detail_level(PrimitivePtr primitive, double switch_dist)
+{
+  if (_single_body.expired())
+    throw std::runtime_error("CollisionGeometry::add_detail_level() called before single body set!");
+  if (switch_dist < 0.0)
+    throw std::runtime_error("CollisionGeometry::add_detail_level() - switching distance must be non-negative");
+
+  // keep the levels ordered from coarsest (largest switching distance) to finest
+  std::vector<std::pair<PrimitivePtr, double> >::iterator i = _detail_levels.begin();
+  while (i != _detail_levels.end() && i->second > switch_dist)
+    i++;
+  _detail_levels.insert(i, std::make_pair(primitive, switch_dist));
+
+  // add this to the primitive
+  CollisionGeometryPtr cg = dynamic_pointer_cast<CollisionGeometry>(shared_from_this());
+  primitive->add_collision_geometry(cg);
+}
+
+/// Calculates the signed distance between two geometries using their coarser levels of detail
+/**
+ * Levels are refined (coarsest first, refining the geometry whose level
+ * switches at the larger distance) until the distance between the levels
+ * exceeds both switching distances plus the margin.
+ * \param margin the additional distance that the levels must be apart
+ *        (e.g., the distance that the geometries can travel toward each
+ *        other over a step)
+ * \param dist the (lower bound on the) signed distance, on return
+ * \param pA the closest point on the level of gA, on return
+ * \param pB the closest point on the level of gB, on return
+ * \return <b>true</b> if a level was used; <b>false</b> if the distance
+ *         must be computed using the geometries themselves
+ */
+bool CollisionGeometry::calc_coarse_signed_dist(CollisionGeometryPtr gA, CollisionGeometryPtr gB, double margin, double& dist, Point3d& pA, Point3d& pB)
+{
+  const unsigned NA = gA->_detail_levels.size();
+  const unsigned NB = gB->_detail_levels.size();
+
+  // level indices equal to NA / NB indicate the geometries themselves
+  unsigned i = 0, j = 0;
+  while (i < NA || j < NB)
+  {
+    PrimitivePtr primA = (i < NA) ? gA->_detail_levels[i].first : gA->get_geometry();
+    PrimitivePtr primB = (j < NB) ? gB->_detail_levels[j].first : gB->get_geometry();
+    const double SWITCH_A = (i < NA) ? gA->_detail_levels[i].second : 0.0;
+    const double SWITCH_B = (j < NB) ? gB->_detail_levels[j].second : 0.0;
+
+    // compute the distance between the levels
+    pA.pose = primA->get_pose(gA);
+    pB.pose = primB->get_pose(gB);
+    dist = primA->calc_signed_dist(primB, pA, pB);
+    if (dist > std::max(SWITCH_A, SWITCH_B) + margin)
+      return true;
+
+    // refine the level that switches at the larger distance
+    if (i < NA && (j == NB || SWITCH_A >= SWITCH_B))
+      i++;
+    else
+      j++;
+  }
+
+  return false;
+}
+
 /// Gets vertices for a primitive
 void CollisionGeometry::get_vertices(std::vector<Point3d>& vertices) const
 {
@@ -333,6 +423,14 @@ void CollisionGeometry::load_from_xml(shared_ptr<const XMLTree> node, std::map<s
     TR.q = rel_rpy_attr->get_rpy_value();
   set_relative_pose(TR);
 
+  // read the collision group and mask (decimal or hexadecimal), if specified
+  XMLAttrib* group_attr = node->get_attrib("collision-group");
+  XMLAttrib* mask_attr = node->get_attrib("collision-mask");
+  if (group_attr)
+    collision_group = (unsigned) std::strtoul(group_attr->get_string_value().c_str(), NULL, 0);
+  if (mask_attr)
+    collision_mask = (unsigned) std::strtoul(mask_attr->get_string_value().c_str(), NULL, 0);
+
   // read the primitive ID, if any
   XMLAttrib* primitive_id_attrib = node->get_attrib("primitive-id");
   if (primitive_id_attrib)
@@ -358,6 +456,35 @@ void CollisionGeometry::load_from_xml(shared_ptr<const XMLTree> node, std::map<s
         id_map[id] = newpc;
     }  
   }
+
+  // read any coarser levels of detail
+  std::list<shared_ptr<const XMLTree> > level_nodes = node->find_child_nodes("DetailLevel");
+  for (std::list<shared_ptr<const XMLTree> >::const_iterator i = level_nodes.begin(); i != level_nodes.end(); i++)
+  {
+    XMLAttrib* level_id_attr = (*i)->get_attrib("primitive-id");
+    XMLAttrib* switch_dist_attr = (*i)->get_attrib("switch-dist");
+    if (!level_id_attr || !switch_dist_attr)
+    {
+      std::cerr << "CollisionGeometry::load_from_xml() - 'DetailLevel' node requires 'primitive-id' and 'switch-dist'" << std::endl;
+      continue;
+    }
+
+    // search for the primitive
+    const std::string& id = level_id_attr->get_string_value();
+    std::map<std::string, BasePtr>::const_iterator id_iter = id_map.find(id);
+    PrimitivePtr level;
+    if (id_iter != id_map.end())
+      level = boost::dynamic_pointer_cast<Primitive>(id_iter->second);
+    if (!level)
+    {
+      std::cerr << "CollisionGeometry::load_from_xml() - primitive with ID '";
+      std::cerr << id << "'" << std::endl << "  not found in offending node: ";
+      std::cerr << std::endl << **i;
+      continue;
+    }
+
+    add_detail_level(level, switch_dist_attr->get_real_value());
+  }
 }
 
 /// Implements Base::save_to_xml()
@@ -373,11 +500,25 @@ void CollisionGeometry::save_to_xml(XMLTreePtr node, std::list<shared_ptr<const
   node->attribs.insert(XMLAttrib("relative-origin", _F->x));
   node->attribs.insert(XMLAttrib("relative-quat", _F->q));
 
+  // save the collision group and mask
+  node->attribs.insert(XMLAttrib("collision-group", collision_group));
+  node->attribs.insert(XMLAttrib("collision-mask", collision_mask));
+
   // save the ID of the primitive and add the primitive to the shared list
   if (_geometry)
   {
     node->attribs.insert(XMLAttrib("primitive-id", _geometry->id));
     shared_objects.push_back(_geometry);
   }
+
+  // save the coarser levels of detail
+  for (unsigned i=0; i< _detail_levels.size(); i++)
+  {
+    XMLTreePtr level_node(new XMLTree("DetailLevel"));
+    level_node->attribs.insert(XMLAttrib("primitive-id", _detail_levels[i].first->id));
+    level_node->attribs.insert(XMLAttrib("switch-dist", _detail_levels[i].second));
+    node->add_child(level_node);
+    shared_objects.push_back(_detail_levels[i].first);
+  }
 }
 
@@ -18,8 +18,10 @@
 #include <Moby/OBB.h>
 #include <Moby/SpherePrimitive.h>
 #include <Moby/TriangleMeshPrimitive.h>
+#include <Moby/TetraMeshPrimitive.h>
 #include <Moby/HeightmapPrimitive.h>
 #include <Moby/GJK.h>
+#include <Moby/MemoryAccounting.h>
 #include <Moby/ConePrimitive.h>
 
 using namespace Ravelin;
@@ -552,6 +554,11 @@ double ConePrimitive::calc_signed_dist(shared_ptr<const Primitive> p, Point3d& p
     return GJK::do_gjk(bthis, p, Pbox, Pgeneric, pthis, pp);
   }
 
+  // try cone/tetra mesh
+  shared_ptr<const TetraMeshPrimitive> tetp = dynamic_pointer_cast<const TetraMeshPrimitive>(p);
+  if (tetp)
+    return tetp->calc_signed_dist(dynamic_pointer_cast<const Primitive>(shared_from_this()), pp, pthis);
+
   // try cone/(non-convex) trimesh
   shared_ptr<const TriangleMeshPrimitive> trip = dynamic_pointer_cast<const TriangleMeshPrimitive>(p);
   if (trip)
@@ -654,6 +661,7 @@ void ConePrimitive::get_vertices(CollisionGeometryPtr geom, std::vector<const Po
 /// Gets the OBB
 BVPtr ConePrimitive::get_BVH_root(CollisionGeometryPtr geom)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
   const unsigned X = 0, Y = 1, Z = 2;
 
   // get the pointer to the bounding box
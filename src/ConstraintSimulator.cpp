@@ -13,13 +13,16 @@
 #include <Moby/ControlledBody.h>
 #include <Moby/CollisionGeometry.h>
 #include <Moby/CollisionDetection.h>
+#include <Moby/C2ACCD.h>
 #include <Moby/ContactParameters.h>
 #include <Moby/ImpactToleranceException.h>
 #include <Moby/SustainedUnilateralConstraintSolveFailException.h>
 #include <Moby/InvalidStateException.h>
 #include <Moby/InvalidVelocityException.h>
 #include <Moby/ConstraintStabilization.h>
+#include <Moby/RaySensor.h>
 #include <Moby/ConstraintSimulator.h>
+#include <Moby/MemoryAccounting.h>
 
 #ifdef USE_OSG
 #include <osg/Geometry>
@@ -54,9 +57,27 @@ ConstraintSimulator::ConstraintSimulator()
 
   // setup contact distance thresholds
   contact_dist_thresh = 1e-6;
+  lod_lookahead = 0.01;
+
+  // clear the step statistics
+  reset_step_statistics();
 
   // setup the collision detector
   _coldet = shared_ptr<CollisionDetection>(new CCD);
+
+  // setup the contact visualization
+  _contact_vdata = NULL;
+  _contact_geode = NULL;
+  _n_visualized_contacts = 0;
+  create_contact_visualization_mesh();
+}
+
+ConstraintSimulator::~ConstraintSimulator()
+{
+  #ifdef USE_OSG
+  _contact_geode->unref();
+  _contact_vdata->unref();
+  #endif
 }
 
 /// Gets the contact data between a pair of geometries (if any)
@@ -154,34 +175,32 @@ shared_ptr<ContactParameters> ConstraintSimulator::get_contact_parameters(Collis
   return shared_ptr<ContactParameters>();
 }
 
-/// Draws a ray directed from a contact point along the contact normal
-void ConstraintSimulator::visualize_contact( UnilateralConstraint& constraint ) 
+/// Creates the mesh shared by all contact visualization instances
+void ConstraintSimulator::create_contact_visualization_mesh()
 {
   #ifdef USE_OSG
 
-  // random color for this contact visualization
-  double r = (double) rand() / (double) RAND_MAX;
-  double g = (double) rand() / (double) RAND_MAX;
-  double b = (double) rand() / (double) RAND_MAX;
-  osg::Vec4 color = osg::Vec4( r, g, b, 1.0 );
-
   // knobs for tweaking
   const double point_radius = 0.75;
-  const double point_scale = 0.01;
   const double line_length = 5.0;
   const double line_radius = 0.1;
   const double head_radius = 0.5;
   const double head_height = 2.0;
 
-  // the osg node this constraint visualization will attach to
-  osg::Group* contact_root = new osg::Group();
+  // the contact color
+  osg::Vec4 color = osg::Vec4( 1.0, 0.0, 0.0, 1.0 );
+
+  // the group that all contact instances will attach to
+  _contact_vdata = new osg::Group();
+  _contact_vdata->ref();
 
-  // turn off lighting for this node
-  osg::StateSet *contact_state = contact_root->getOrCreateStateSet();
+  // turn off lighting for the contact visualization 
+  osg::StateSet *contact_state = _contact_vdata->getOrCreateStateSet();
   contact_state->setMode( GL_LIGHTING, osg::StateAttribute::PROTECTED | osg::StateAttribute::OFF );
 
-  // a geode for the visualization geometry
-  osg::Geode* contact_geode = new osg::Geode();
+  // the geode shared by all instances
+  _contact_geode = new osg::Geode();
+  _contact_geode->ref();
 
   // add some hints to reduce the polygonal complexity of the visualization
   osg::TessellationHints *hints = new osg::TessellationHints();
@@ -193,103 +212,144 @@ void ConstraintSimulator::visualize_contact( UnilateralConstraint& constraint )
   osg::Sphere* point_geometry = new osg::Sphere( osg::Vec3( 0, 0, 0 ), point_radius );
   osg::ShapeDrawable* point_shape = new osg::ShapeDrawable( point_geometry, hints );
   point_shape->setColor( color );
-  contact_geode->addDrawable( point_shape );
+  _contact_geode->addDrawable( point_shape );
 
   // add the contact normal as a cylinder in the geode's frame
   osg::Cylinder* line_geometry = new osg::Cylinder( osg::Vec3( 0.0, 0.0, line_length / 2 ), line_radius, line_length );
   osg::ShapeDrawable* line_shape = new osg::ShapeDrawable( line_geometry, hints );
   line_shape->setColor( color );
-  contact_geode->addDrawable( line_shape );
+  _contact_geode->addDrawable( line_shape );
 
   // add the arrow head as a cone in the geode's frame
   osg::Cone* head_geometry = new osg::Cone( osg::Vec3( 0, 0, line_length ), head_radius, head_height );
   osg::ShapeDrawable* head_shape = new osg::ShapeDrawable( head_geometry, hints );
   head_shape->setColor( color );
-  contact_geode->addDrawable( head_shape );
+  _contact_geode->addDrawable( head_shape );
 
-  // calculate the orientation based upon the direction of the normal vector.
-  // Note: the default orientation of the osg model is along the z-axis
-  double theta;
-  Vector3d z = Vector3d( 0.0, 0.0, 1.0 );
-  Vector3d axis = Vector3d::cross( constraint.contact_normal, z );
-  if( axis.norm_inf() < NEAR_ZERO) {
-    // z and normal are parallel, axis ill defined
-    if( constraint.contact_normal[2] > 0 ) {
-      // normal is z
-      axis = Vector3d( 0.0, 1.0, 0.0 );
-      theta = 0.0;
-    } else {
-      // normal is -z
-      axis = Vector3d( 0.0, 1.0, 0.0 );
-      theta = osg::PI;
+  // the mesh never changes
+  _contact_geode->setDataVariance( osg::Object::STATIC );
+
+  // attach the contact visualization to the persistent visualization data
+  _persistent_vdata->addChild( _contact_vdata );
+
+  #endif // USE_OSG
+}
+
+/// Hides all contact visualization instances used on the last step 
+/**
+ * Instances are kept in the scene graph (with a zero node mask) so that 
+ * they can be reused on subsequent steps without any allocation.
+ */
+void ConstraintSimulator::reset_contact_visualization()
+{
+  #ifdef USE_OSG
+  for (unsigned i=0; i< _n_visualized_contacts; i++)
+    _contact_xforms[i]->setNodeMask( 0 );
+  #endif // USE_OSG
+
+  _n_visualized_contacts = 0;
+}
+
+/// Updates all sensors that are due at the current time
+/**
+ * Sensors that do not cast rays are updated one at a time. The rays of all
+ * ray sensors that are due (and that share a collision mask) are cast in a
+ * single batch, which the collision detector distributes over its threads.
+ * \param dt the size of the step that was just taken
+ */
+void ConstraintSimulator::update_sensors(double dt)
+{
+  if (sensors.empty())
+    return;
+
+  // update the sensors that do not cast rays and prepare those that do
+  vector<shared_ptr<RaySensor> > ray_sensors;
+  for (unsigned i=0; i< sensors.size(); i++)
+  {
+    if (!sensors[i]->is_due(current_time))
+      continue;
+
+    shared_ptr<RaySensor> rs = dynamic_pointer_cast<RaySensor>(sensors[i]);
+    if (rs)
+    {
+      rs->prepare(current_time);
+      ray_sensors.push_back(rs);
     }
-  } else {
-    // axis is well defined
-    axis = Vector3d::normalize(axis);
-    theta = -std::acos( Vector3d::dot( constraint.contact_normal, z ) );
-    // Note: theta calculation works but is not robust, could be rotated in opposite direction
+    else
+      sensors[i]->update(this, dt);
+    sensors[i]->set_updated(current_time);
   }
-  osg::Quat q = osg::Quat( axis[0]*std::sin(theta/2), axis[1]*std::sin(theta/2), axis[2]*std::sin(theta/2), std::cos(theta/2) );
-
-  // create the visualization transform
-  osg::PositionAttitudeTransform* contact_transform = new osg::PositionAttitudeTransform();
-  contact_transform->setPosition( osg::Vec3( constraint.contact_point[0], constraint.contact_point[1], constraint.contact_point[2] ) );
-  contact_transform->setScale( osg::Vec3( point_scale, point_scale, point_scale ) );
-  contact_transform->setAttitude( q );
 
-  // add the geode to the transform
-  contact_transform->addChild( contact_geode );
+  // cast the rays of the ray sensors, one batch per collision mask
+  vector<bool> done(ray_sensors.size(), false);
+  for (unsigned i=0; i< ray_sensors.size(); i++)
+  {
+    if (done[i])
+      continue;
 
-  // add the transform to the root
-  contact_root->addChild( contact_transform );
+    // gather the rays
+    const unsigned MASK = ray_sensors[i]->collision_mask;
+    _sensor_rays.clear();
+    _sensor_ignored.clear();
+    for (unsigned j=i; j< ray_sensors.size(); j++)
+      if (!done[j] && ray_sensors[j]->collision_mask == MASK)
+      {
+        ray_sensors[j]->get_rays(_sensor_rays);
+        ray_sensors[j]->get_ignored_bodies(_sensor_ignored);
+      }
 
-  // add the root to the transient data scene graph
-  add_transient_vdata( contact_root );
+    FILE_LOG(LOG_SIMULATOR) << "ConstraintSimulator::update_sensors() - casting " << _sensor_rays.size() << " rays with collision mask " << MASK << std::endl;
 
-  // JRT : remove validator once theta 100% proven
-  // -----------------------------------------
-  // Rotational Validator
-  // -----------------------------------------
+    // cast the rays and distribute the results
+    _coldet->cast_segments(get_dynamic_bodies(), _sensor_rays, _sensor_results, MASK, &_sensor_ignored);
+    for (unsigned j=i, offset=0; j< ray_sensors.size(); j++)
+      if (!done[j] && ray_sensors[j]->collision_mask == MASK)
+      {
+        ray_sensors[j]->set_ray_results(_sensor_results, offset);
+        offset += ray_sensors[j]->num_rays();
+        done[j] = true;
+      }
+  }
+}
 
-  // Validator is a simple sphere translated along the normal
-  // such that the visualization above should point at the center
-  // of the validator.  If it doesn't, then the calculation of
-  // theta in the rotational code above needs correction for that case
+/// Draws a ray directed from a contact point along the contact normal
+/**
+ * The visualization reuses a pool of transforms that all reference a single
+ * shared mesh; the pool only grows when the number of contacts exceeds the
+ * largest number visualized so far.
+ */
+void ConstraintSimulator::visualize_contact( UnilateralConstraint& constraint ) 
+{
+  #ifdef USE_OSG
 
   // knobs for tweaking
-  const double validator_scale = point_scale / 3;
-  const double validator_ray_length = line_length * 2.5;
-
-  // a root for the validator
-  osg::Group* validator_root = new osg::Group();
-
-  // turn off lighting for this node
-  osg::StateSet *validator_state = validator_root->getOrCreateStateSet();
-  validator_state->setMode( GL_LIGHTING, osg::StateAttribute::PROTECTED | osg::StateAttribute::OFF );
-
-  // colocate the validator position to the contact point
-  osg::PositionAttitudeTransform* validator_transform = new osg::PositionAttitudeTransform();
-  validator_transform->setPosition( osg::Vec3( constraint.contact_point[0], constraint.contact_point[1], constraint.contact_point[2] ) );
-  validator_transform->setScale( osg::Vec3( validator_scale, validator_scale, validator_scale ) );
-  validator_root->addChild( validator_transform );
-
-  // validator geometry
-  osg::Sphere* validator_geometry = new osg::Sphere( osg::Vec3( 0, 0, 0 ), 1.0 );
-  osg::ShapeDrawable* validator_shape = new osg::ShapeDrawable( validator_geometry, hints );
-  validator_shape->setColor( color );
-
-  // validator transform follows the normal out to a distance of validator_ray_length
-  // Note: the validator is not rotated at all.  It is translated from the point along the normal
-  osg::PositionAttitudeTransform* validator_end_transform = new osg::PositionAttitudeTransform();
-  validator_end_transform->setPosition( osg::Vec3( constraint.contact_normal[0] * validator_ray_length, constraint.contact_normal[1] * validator_ray_length, constraint.contact_normal[2] * validator_ray_length ) );
-  validator_transform->addChild( validator_end_transform );
-
-  // add all validator constituents to the group
-  osg::Geode* validator_geode = new osg::Geode();
-  validator_transform->addChild( validator_end_transform );
-  validator_end_transform->addChild( validator_geode );
-  validator_geode->addDrawable( validator_shape );
-  add_transient_vdata( validator_root );
+  const double point_scale = 0.01;
+
+  // grow the pool, if necessary
+  if (_n_visualized_contacts == _contact_xforms.size())
+  {
+    osg::PositionAttitudeTransform* contact_transform = new osg::PositionAttitudeTransform();
+    contact_transform->setScale( osg::Vec3( point_scale, point_scale, point_scale ) );
+    contact_transform->setDataVariance( osg::Object::DYNAMIC );
+    contact_transform->addChild( _contact_geode );
+    _contact_vdata->addChild( contact_transform );
+    _contact_xforms.push_back( contact_transform );
+  }
+
+  // get the next instance
+  osg::PositionAttitudeTransform* contact_transform = _contact_xforms[_n_visualized_contacts++];
+
+  // calculate the orientation based upon the direction of the normal vector.
+  // Note: the default orientation of the osg model is along the z-axis
+  const Vector3d& n = constraint.contact_normal;
+  osg::Quat q;
+  q.makeRotate( osg::Vec3d( 0.0, 0.0, 1.0 ), osg::Vec3d( n[0], n[1], n[2] ) );
+
+  // update the instance transform in place 
+  const Point3d& p = constraint.contact_point;
+  contact_transform->setPosition( osg::Vec3( p[0], p[1], p[2] ) );
+  contact_transform->setAttitude( q );
+  contact_transform->setNodeMask( ~0 );
 
   #endif // USE_OSG
 }
@@ -335,6 +395,7 @@ void ConstraintSimulator::calc_impacting_unilateral_constraint_forces(double dt)
   _impact_constraint_handler._simulator = dynamic_pointer_cast<ConstraintSimulator>(shared_from_this());
 
   // compute impulses here...
+  const unsigned long PIVOTS = _impact_constraint_handler._lcp.total_pivots;
   try
   {
     _impact_constraint_handler.process_constraints(_rigid_constraints);
@@ -348,6 +409,7 @@ void ConstraintSimulator::calc_impacting_unilateral_constraint_forces(double dt)
       std::cerr << "warning: constraint tolerances exceeded; constraint velocity violation " << e.violation << std::endl;
     #endif
   }
+  step_pivots += _impact_constraint_handler._lcp.total_pivots - PIVOTS;
 
   // call the post application callback, if any
   if (constraint_post_callback_fn)
@@ -357,6 +419,7 @@ void ConstraintSimulator::calc_impacting_unilateral_constraint_forces(double dt)
 /// Computes compliant contact forces 
 void ConstraintSimulator::calc_compliant_unilateral_constraint_forces()
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eConstraints);
   // if there are no compliant constraints, quit now
   if (_compliant_constraints.empty())
     return;
@@ -415,27 +478,177 @@ void ConstraintSimulator::preprocess_constraint(UnilateralConstraint& e)
   }
 }
 
-/// Sets up the list of collision geometries
+/// Gets the collision geometries of a rigid or articulated body
+void ConstraintSimulator::get_geometries(ControlledBodyPtr body, vector<CollisionGeometryPtr>& geoms)
+{
+  geoms.clear();
+  RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(body);
+  if (rb)
+    geoms.insert(geoms.end(), rb->geometries.begin(), rb->geometries.end());
+  else
+  {
+    ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(body);
+    BOOST_FOREACH(shared_ptr<RigidBodyd> rbd, ab->get_links())
+    {
+      RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(rbd);
+      geoms.insert(geoms.end(), rb->geometries.begin(), rb->geometries.end());
+    }
+  }
+}
+
+// determines whether a collision geometry (or cached data) refers to one of a sorted vector of geometries
+static bool refers_to(const CollisionGeometryPtr& g, const vector<CollisionGeometryPtr>& geoms) { return std::binary_search(geoms.begin(), geoms.end(), g); }
+static bool refers_to(const std::pair<CollisionGeometryPtr, CollisionGeometryPtr>& p, const vector<CollisionGeometryPtr>& geoms) { return refers_to(p.first, geoms) || refers_to(p.second, geoms); }
+static bool refers_to(const PairwiseDistInfo& pdi, const vector<CollisionGeometryPtr>& geoms) { return refers_to(pdi.a, geoms) || refers_to(pdi.b, geoms); }
+static bool refers_to(const UnilateralConstraint& c, const vector<CollisionGeometryPtr>& geoms) { return refers_to(c.contact_geom1, geoms) || refers_to(c.contact_geom2, geoms); }
+
+// removes all entries that refer to any of a sorted vector of collision geometries (preserving order)
+template <class T>
+static void remove_geometry_refs(vector<T>& v, const vector<CollisionGeometryPtr>& geoms)
+{
+  unsigned j = 0;
+  for (unsigned i=0; i< v.size(); i++)
+    if (!refers_to(v[i], geoms))
+    {
+      if (i != j)
+        v[j] = v[i];
+      j++;
+    }
+  v.erase(v.begin()+j, v.end());
+}
+
+/// Adds a dynamic body to the simulator
+/**
+ * The body's collision geometries are registered incrementally with the
+ * geometry list and with the collision detector, so no global rebuild is
+ * necessary.
+ */
+void ConstraintSimulator::add_dynamic_body(ControlledBodyPtr body)
+{
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eBroadPhase);
+  // if the body is already present in the simulator, skip it
+  if (std::binary_search(_bodies.begin(), _bodies.end(), body))
+    return;
+
+  // finish removing any removed geometries (the body's may be among them)
+  purge_removed_geometries();
+
+  // add the body
+  Simulator::add_dynamic_body(body);
+  if (_dissipator)
+    _dissipator->invalidate();
+
+  // add the geometries, keeping the list sorted 
+  vector<CollisionGeometryPtr> geoms;
+  get_geometries(body, geoms);
+  for (unsigned i=0; i< geoms.size(); i++)
+  {
+    vector<CollisionGeometryPtr>::iterator j = std::lower_bound(_geometries.begin(), _geometries.end(), geoms[i]);
+    if (j != _geometries.end() && *j == geoms[i])
+      continue;
+    _geometries.insert(j, geoms[i]);
+    if (_coldet)
+      _coldet->add_collision_geometry(geoms[i]);
+  }
+}
+
+/// Removes a dynamic body from the simulator
+/**
+ * The body's collision geometries are unregistered from the geometry list
+ * and the collision detector, and cached pairs, distances, constraints, and
+ * per-pair collision overrides that refer to them are discarded. The
+ * geometries are only recorded here and are discarded, for all bodies
+ * removed since, in a single pass by purge_removed_geometries(), so removing
+ * many bodies (e.g., clearing a scene) is not quadratic in their number.
+ */
+void ConstraintSimulator::remove_dynamic_body(ControlledBodyPtr body)
+{
+  // if the body is not in the simulator, skip it
+  if (!std::binary_search(_bodies.begin(), _bodies.end(), body))
+    return;
+
+  // remove the body
+  Simulator::remove_dynamic_body(body);
+  if (_dissipator)
+    _dissipator->invalidate();
+
+  // unregister the geometries (the cached data is removed later)
+  vector<CollisionGeometryPtr> geoms;
+  get_geometries(body, geoms);
+  for (unsigned i=0; i< geoms.size(); i++)
+  {
+    if (!std::binary_search(_geometries.begin(), _geometries.end(), geoms[i]))
+      continue;
+    _removed_geometries.push_back(geoms[i]);
+    if (_coldet)
+      _coldet->remove_collision_geometry(geoms[i]);
+  }
+}
+
+/// Discards the geometries removed since the last call, and all cached data that refers to them, from the geometry list
+void ConstraintSimulator::purge_removed_geometries()
+{
+  if (_removed_geometries.empty())
+    return;
+
+  // sort the geometries so that they can be searched
+  std::sort(_removed_geometries.begin(), _removed_geometries.end());
+  _removed_geometries.erase(std::unique(_removed_geometries.begin(), _removed_geometries.end()), _removed_geometries.end());
+
+  // remove the geometries and the cached data
+  remove_geometry_refs(_geometries, _removed_geometries);
+  remove_geometry_refs(_pairs_to_check, _removed_geometries);
+  remove_geometry_refs(_pairwise_distances, _removed_geometries);
+  remove_geometry_refs(_rigid_constraints, _removed_geometries);
+  remove_geometry_refs(_compliant_constraints, _removed_geometries);
+  if (_coldet)
+    _coldet->clear_pair_overrides(_removed_geometries);
+
+  _removed_geometries.clear();
+}
+
+/// Discards the data that the simulator retains between steps
+/**
+ * In addition to the data discarded by Simulator::reset_caches(), this
+ * discards the pairwise distances, the constraints and contacts of the last
+ * step, the impact solver's warm start data, and the dissipator's per-DOF
+ * coefficients.
+ */
+void ConstraintSimulator::reset_caches()
+{
+  Simulator::reset_caches();
+  purge_removed_geometries();
+  _pairs_to_check.clear();
+  _pairwise_distances.clear();
+  _rigid_constraints.clear();
+  _compliant_constraints.clear();
+  _step_contacts.clear();
+  _impact_constraint_handler.clear_warm_start_data();
+  if (_dissipator)
+    _dissipator->invalidate();
+}
+
+/// Sets up the list of collision geometries from scratch
+/**
+ * Bodies added and removed through add_dynamic_body() and
+ * remove_dynamic_body() keep the list current; this only needs to be called
+ * if geometries are added to (or removed from) a body already in the
+ * simulator.
+ */
 void ConstraintSimulator::determine_geometries()
 {
+  // finish removing any removed geometries
+  purge_removed_geometries();
+
   // clear the list at first
   _geometries.clear();
 
   // determine all geometries
+  vector<CollisionGeometryPtr> geoms;
   BOOST_FOREACH(ControlledBodyPtr db, _bodies)
   {
-    RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(db);
-    if (rb)
-      _geometries.insert(_geometries.end(), rb->geometries.begin(), rb->geometries.end());
-    else
-    {
-      ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(db);
-      BOOST_FOREACH(shared_ptr<RigidBodyd> rbd, ab->get_links())
-      {
-        RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(rbd);
-        _geometries.insert(_geometries.end(), rb->geometries.begin(), rb->geometries.end());
-      }
-    }
+    get_geometries(db, geoms);
+    _geometries.insert(_geometries.end(), geoms.begin(), geoms.end());
   }
 
   // sort and remove duplicates
@@ -443,12 +656,31 @@ void ConstraintSimulator::determine_geometries()
   _geometries.erase(std::unique(_geometries.begin(), _geometries.end()), _geometries.end());
 }
 
+/// Computes an upper bound on the speed of any point of a geometry
+static double calc_max_speed(CollisionGeometryPtr cg)
+{
+  RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(cg->get_single_body());
+  if (!rb || !rb->is_enabled())
+    return 0.0;
+
+  // get the velocity at the origin of the body frame
+  SVelocityd v = Pose3d::transform(rb->get_pose(), rb->get_velocity());
+  return v.get_linear().norm() + v.get_angular().norm()*cg->get_farthest_point_distance();
+}
+
 /// Computes pairwise distances of geometries at their current poses, using broad phase results to determine which pairs should be checked
 /**
+ * Pairs of geometries with coarser levels of detail use the coarsest levels
+ * that remain apart (see CollisionGeometry::calc_coarse_signed_dist());
+ * the resulting distances and closest points are then conservative, and
+ * PairwiseDistInfo::coarse is set.
  * \param pairwise_distances on return, contains the pairwise distances
  */
 void ConstraintSimulator::calc_pairwise_distances()
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
+  double start = get_current_time();
+
   // clear the vector
   _pairwise_distances.clear();
 
@@ -457,7 +689,15 @@ void ConstraintSimulator::calc_pairwise_distances()
     PairwiseDistInfo pdi;
     pdi.a = _pairs_to_check[i].first;
     pdi.b = _pairs_to_check[i].second;
-    pdi.dist = _coldet->calc_signed_dist(pdi.a, pdi.b, pdi.pa, pdi.pb);
+
+    // use coarser levels of detail where they are far enough apart
+    if (pdi.a->num_detail_levels() > 0 || pdi.b->num_detail_levels() > 0)
+    {
+      double margin = lod_lookahead*(calc_max_speed(pdi.a) + calc_max_speed(pdi.b));
+      pdi.coarse = CollisionGeometry::calc_coarse_signed_dist(pdi.a, pdi.b, margin, pdi.dist, pdi.pa, pdi.pb);
+    }
+    if (!pdi.coarse)
+      pdi.dist = _coldet->calc_signed_dist(pdi.a, pdi.b, pdi.pa, pdi.pb);
     Pose3d poseA(*pdi.a->get_pose());
     Pose3d poseB(*pdi.b->get_pose());
     poseA.update_relative_pose(GLOBAL);
@@ -465,28 +705,74 @@ void ConstraintSimulator::calc_pairwise_distances()
     FILE_LOG(LOG_SIMULATOR) << "ConstraintSimulator::calc_pairwise_distances() - signed distance between " << pdi.a->get_single_body()->body_id << " and " << pdi.b->get_single_body()->body_id << ": " << pdi.dist << std::endl;
     _pairwise_distances.push_back(pdi);
   }
+
+  narrow_phase_time += get_current_time() - start;
 }
 
 /// Does broad phase collision detection, identifying which pairs of geometries may come into contact over time step of dt
 void ConstraintSimulator::broad_phase(double dt)
 {
-  // call the broad phase
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eBroadPhase);
+  double start = get_current_time();
+
+  // call the broad phase (which also applies the collision filter)
   _coldet->broad_phase(dt, _bodies, _pairs_to_check);
 
-  // remove pairs that are unchecked
-  for (unsigned i=0; i< _pairs_to_check.size(); )
-    if (unchecked_pairs.find(make_sorted_pair(_pairs_to_check[i].first, _pairs_to_check[i].second)) != unchecked_pairs.end())
+  broad_phase_time += get_current_time() - start;
+}
+
+/// Records the contacts that applied impulses or forces during a mini-step (for the sensors)
+/**
+ * \param constraints the constraints (only contacts are recorded)
+ * \param h if positive, each contact applied its contact_force for this
+ *        amount of time; otherwise, each contact applied its contact_impulse
+ */
+void ConstraintSimulator::record_step_contacts(const vector<UnilateralConstraint>& constraints, double h)
+{
+  if (sensors.empty())
+    return;
+
+  for (unsigned i=0; i< constraints.size(); i++)
+  {
+    const UnilateralConstraint& c = constraints[i];
+    if (c.constraint_type != UnilateralConstraint::eContact)
+      continue;
+
+    _step_contacts.push_back(c);
+    if (h > 0.0)
     {
-      _pairs_to_check[i] = _pairs_to_check.back();
-      _pairs_to_check.pop_back();
+      SMomentumd& j = _step_contacts.back().contact_impulse;
+      SForced f = Pose3d::transform(GLOBAL, c.contact_force);
+      j.set_zero(GLOBAL);
+      j.set_linear(f.get_force()*h);
+      j.set_angular(f.get_torque()*h);
     }
-    else
-      i++;
+  }
+}
+
+/// Clears the timings, counts, and recorded contacts for a new step
+void ConstraintSimulator::reset_step_statistics()
+{
+  _step_contacts.clear();
+  dynamics_time = 0.0;
+  broad_phase_time = 0.0;
+  narrow_phase_time = 0.0;
+  constraint_time = 0.0;
+  stabilization_time = 0.0;
+  step_contacts = 0;
+  step_pivots = 0;
 }
 
 /// Finds the set of unilateral constraints
-void ConstraintSimulator::find_unilateral_constraints(double contact_dist_thresh)
+/**
+ * \param contact_dist_thresh the distance below which contacts are sought
+ * \param limit_lookahead joint limits that would be crossed within this
+ *        time (at current joint velocities) generate speculative limit
+ *        constraints
+ */
+void ConstraintSimulator::find_unilateral_constraints(double contact_dist_thresh, double limit_lookahead)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eConstraints);
   FILE_LOG(LOG_SIMULATOR) << "ConstraintSimulator::find_unilateral_constraints() entered" << std::endl;
 
   // clear the vectors of constraints
@@ -502,7 +788,7 @@ void ConstraintSimulator::find_unilateral_constraints(double contact_dist_thresh
       continue;
 
      // get limit constraints
-    ab->find_limit_constraints(std::back_inserter(_rigid_constraints));
+    ab->find_limit_constraints(std::back_inserter(_rigid_constraints), limit_lookahead);
   }
 
   // find contact constraints
@@ -548,6 +834,9 @@ void ConstraintSimulator::load_from_xml(shared_ptr<const XMLTree> node, map<std:
   // first, load all data specified to the Simulator object
   Simulator::load_from_xml(node, id_map);
 
+  // the list of bodies may have been replaced; determine the geometries
+  determine_geometries();
+
   // read the dissipator, if any
   XMLAttrib* dissipator_attrib = node->get_attrib("dissipator-id");
   if (dissipator_attrib)
@@ -591,6 +880,11 @@ void ConstraintSimulator::load_from_xml(shared_ptr<const XMLTree> node, map<std:
   if (contact_dist_thresh_attrib)
     contact_dist_thresh = contact_dist_thresh_attrib->get_real_value();
 
+  // read the level of detail lookahead time, if any
+  XMLAttrib* lod_lookahead_attrib = node->get_attrib("lod-lookahead");
+  if (lod_lookahead_attrib)
+    lod_lookahead = lod_lookahead_attrib->get_real_value();
+
   // read in any ContactParameters
   child_nodes = node->find_child_nodes("ContactParameters");
   if (!child_nodes.empty())
@@ -602,10 +896,44 @@ void ConstraintSimulator::load_from_xml(shared_ptr<const XMLTree> node, map<std:
     contact_params[cd->objects] = cd;
   }
 
-  // read all disabled pairs
+  // read all sensors -- note: sensors must already have been read
+  child_nodes = node->find_child_nodes("Sensor");
+  if (!child_nodes.empty())
+    sensors.clear();
+  for (list<shared_ptr<const XMLTree> >::const_iterator i = child_nodes.begin(); i != child_nodes.end(); i++)
+  {
+    XMLAttrib* id_attr = (*i)->get_attrib("sensor-id");
+    if (!id_attr)
+    {
+      std::cerr << "ConstraintSimulator::load_from_xml() - no sensor-id ";
+      std::cerr << "attribute in tag: " << std::endl << **i;
+      continue;
+    }
+
+    // look for the sensor with that ID
+    const std::string& id = id_attr->get_string_value();
+    SensorPtr sensor;
+    if ((id_iter = id_map.find(id)) != id_map.end())
+      sensor = dynamic_pointer_cast<Sensor>(id_iter->second);
+    if (!sensor)
+    {
+      std::cerr << "ConstraintSimulator::load_from_xml() - could not find" << std::endl;
+      std::cerr << "  sensor w/ID: " << id << " from offending node: " << std::endl << **i;
+      continue;
+    }
+    sensors.push_back(sensor);
+  }
+
+  // read all disabled (and enabled) pairs; these override the collision
+  // groups and masks of the geometries
   child_nodes = node->find_child_nodes("DisabledPair");
+  list<shared_ptr<const XMLTree> > enabled_nodes = node->find_child_nodes("EnabledPair");
+  child_nodes.insert(child_nodes.end(), enabled_nodes.begin(), enabled_nodes.end());
   for (std::list<shared_ptr<const XMLTree> >::const_iterator i = child_nodes.begin(); i != child_nodes.end(); i++)
   {
+    // determine whether the pair is enabled or disabled
+    bool enabled = (strcasecmp((*i)->name.c_str(), "EnabledPair") == 0);
+
     // get the two ID attributes
     XMLAttrib* id1_attrib = (*i)->get_attrib("object1-id");
     XMLAttrib* id2_attrib = (*i)->get_attrib("object2-id");
@@ -699,11 +1027,11 @@ void ConstraintSimulator::load_from_xml(shared_ptr<const XMLTree> node, map<std:
     }
 
 
-   // add the pairs to the unchecked pairs list
+   // add the pairs to the collision filter
    BOOST_FOREACH(CollisionGeometryPtr cg1, disabled1)
      BOOST_FOREACH(CollisionGeometryPtr cg2, disabled2)
        if (cg1 != cg2 && cg1->get_single_body() != cg2->get_single_body())
-         unchecked_pairs.insert(make_sorted_pair(cg1, cg2));
+         _coldet->set_pair_enabled(cg1, cg2, enabled);
   }
 }
 
@@ -728,8 +1056,9 @@ void ConstraintSimulator::save_to_xml(XMLTreePtr node, list<shared_ptr<const Bas
     shared_objects.push_back(_dissipator);
   }
 
-  // save any collision detection plugins
-  if (!dynamic_pointer_cast<CCD>(_coldet))
+  // save any collision detection plugins (or collision detectors other than
+  // the default)
+  if (!dynamic_pointer_cast<CCD>(_coldet) || dynamic_pointer_cast<C2ACCD>(_coldet))
   {
     node->attribs.insert(XMLAttrib("collision-detection-plugin", _coldet->id));
     shared_objects.push_back(_coldet);
@@ -737,6 +1066,7 @@ void ConstraintSimulator::save_to_xml(XMLTreePtr node, list<shared_ptr<const Bas
 
   // save the distance thresholds
   node->attribs.insert(XMLAttrib("contact-dist-thesh", contact_dist_thresh));
+  node->attribs.insert(XMLAttrib("lod-lookahead", lod_lookahead));
 
   // save all ContactParameters
   for (map<sorted_pair<BasePtr>, shared_ptr<ContactParameters> >::const_iterator i = contact_params.begin(); i != contact_params.end(); i++)
@@ -746,12 +1076,22 @@ void ConstraintSimulator::save_to_xml(XMLTreePtr node, list<shared_ptr<const Bas
     i->second->save_to_xml(new_node, shared_objects);
   }
 
-  // save all disabled pairs
-  for (std::set<sorted_pair<CollisionGeometryPtr> >::const_iterator i = unchecked_pairs.begin(); i != unchecked_pairs.end(); i++)
+  // save the IDs of all sensors
+  BOOST_FOREACH(SensorPtr sensor, sensors)
+  {
+    XMLTreePtr child_node(new XMLTree("Sensor"));
+    node->add_child(child_node);
+    child_node->attribs.insert(XMLAttrib("sensor-id", sensor->id));
+    shared_objects.push_back(sensor);
+  }
+
+  // save all disabled and enabled pairs
+  const CollisionDetection::PairOverrideMap& overrides = _coldet->get_pair_overrides();
+  for (CollisionDetection::PairOverrideMap::const_iterator i = overrides.begin(); i != overrides.end(); i++)
   {
-    XMLTreePtr child_node(new XMLTree("DisabledPair"));
-    child_node->attribs.insert(XMLAttrib("object1-id", i->first->id));
-    child_node->attribs.insert(XMLAttrib("object2-id", i->second->id));
+    XMLTreePtr child_node(new XMLTree((i->second.second) ? "EnabledPair" : "DisabledPair"));
+    child_node->attribs.insert(XMLAttrib("object1-id", i->second.first.first->id));
+    child_node->attribs.insert(XMLAttrib("object2-id", i->second.first.second->id));
     node->add_child(child_node);
   }
 }
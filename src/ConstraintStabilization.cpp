@@ -33,6 +33,7 @@
 #include <Moby/ConstraintSimulator.h>
 #include <Moby/RCArticulatedBody.h>
 #include <Moby/ConstraintStabilization.h>
+#include <Moby/MemoryAccounting.h>
 #include <boost/algorithm/minmax_element.hpp>
 #include <utility>
 
@@ -166,6 +167,7 @@ double ConstraintStabilization::evaluate_bilateral_constraints(shared_ptr<Constr
 /// Stabilizes the constraints in the simulator
 void ConstraintStabilization::stabilize(shared_ptr<ConstraintSimulator> sim)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eSolver);
   FILE_LOG(LOG_SIMULATOR)<< "======constraint stabilization start======"<<std::endl;
   VectorNd dq, q, v;
   std::vector<UnilateralConstraintProblemData> pd;
@@ -360,19 +362,10 @@ void ConstraintStabilization::compute_problem_data(std::vector<UnilateralConstra
   // get the collision detection mechanism
   shared_ptr<CollisionDetection> coldet = sim->get_collision_detection();
 
-  // do broad phase collision detection here
+  // do broad phase collision detection here (this also applies the
+  // collision filter)
   coldet->broad_phase(0.0, bodies, _pairs_to_check);
 
-  // remove pairs that are unchecked
-  for (unsigned i=0; i< _pairs_to_check.size(); )
-    if (sim->unchecked_pairs.find(make_sorted_pair(_pairs_to_check[i].first, _pairs_to_check[i].second)) != sim->unchecked_pairs.end())
-    {
-      _pairs_to_check[i] = _pairs_to_check.back();
-      _pairs_to_check.pop_back();
-    }
-    else
-      i++;
-
   // now add contact constraints for each checked pair
   typedef std::pair<CollisionGeometryPtr, CollisionGeometryPtr> CheckPair;
   BOOST_FOREACH(CheckPair& to_check, _pairs_to_check)
@@ -393,7 +386,7 @@ void ConstraintStabilization::compute_problem_data(std::vector<UnilateralConstra
   // find islands
   list<vector<shared_ptr<DynamicBodyd> > > remaining_islands;
   list<pair<list<UnilateralConstraint*>, list<shared_ptr<SingleBodyd> > > > islands;
-  UnilateralConstraint::determine_connected_constraints(constraints, sim->implicit_joints, islands, remaining_islands);
+  UnilateralConstraint::determine_connected_constraints(constraints, sim->implicit_joints, sim->coupling_constraints, islands, remaining_islands);
 
   // process unilateral constraint islands
   typedef pair<list<UnilateralConstraint*>, list<shared_ptr<SingleBodyd> > > IslandType;
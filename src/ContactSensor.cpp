@@ -0,0 +1,97 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#include <algorithm>
+#include <Moby/XMLTree.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/ConstraintSimulator.h>
+#include <Moby/ContactSensor.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using std::map;
+using std::list;
+using std::vector;
+using boost::shared_ptr;
+
+/// Constructs a contact sensor that can report up to sixteen contacts
+ContactSensor::ContactSensor()
+{
+  _n = _dropped = 0;
+  set_capacity(16);
+}
+
+/// Sets the maximum number of contacts that can be reported (and allocates the buffers)
+void ContactSensor::set_capacity(unsigned n)
+{
+  _points.resize(n);
+  _normals.resize(n);
+  _forces.resize(n);
+  _n = std::min(_n, n);
+}
+
+/// Records the contacts on the body over the last step
+void ContactSensor::update(ConstraintSimulator* sim, double dt)
+{
+  _n = _dropped = 0;
+  if (!_body || dt <= 0.0)
+    return;
+
+  const vector<UnilateralConstraint>& constraints = sim->get_step_contacts();
+  for (unsigned i=0; i< constraints.size(); i++)
+  {
+    const UnilateralConstraint& c = constraints[i];
+    if (c.constraint_type != UnilateralConstraint::eContact)
+      continue;
+
+    // the impulse is applied to the first body; its reverse to the second
+    double sign;
+    if (c.contact_geom1->get_single_body() == _body)
+      sign = 1.0;
+    else if (c.contact_geom2->get_single_body() == _body)
+      sign = -1.0;
+    else
+      continue;
+
+    if (_n == _points.size())
+    {
+      _dropped++;
+      continue;
+    }
+
+    // store the contact data
+    _points[_n] = c.contact_point;
+    _normals[_n] = c.contact_normal*sign;
+    _forces[_n] = c.contact_impulse.get_linear()*(sign/dt);
+    _n++;
+  }
+}
+
+/// Implements Base::load_from_xml()
+void ContactSensor::load_from_xml(shared_ptr<const XMLTree> node, map<std::string, BasePtr>& id_map)
+{
+  // load the parent data
+  Sensor::load_from_xml(node, id_map);
+
+  // read the capacity
+  XMLAttrib* capacity_attr = node->get_attrib("capacity");
+  if (capacity_attr)
+    set_capacity(capacity_attr->get_unsigned_value());
+}
+
+/// Implements Base::save_to_xml()
+void ContactSensor::save_to_xml(XMLTreePtr node, list<shared_ptr<const Base> >& shared_objects) const
+{
+  // save the parent data
+  Sensor::save_to_xml(node, shared_objects);
+
+  // (re)set the name of this node
+  node->name = "ContactSensor";
+
+  // save the capacity
+  node->attribs.insert(XMLAttrib("capacity", get_capacity()));
+}
+
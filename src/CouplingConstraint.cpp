@@ -0,0 +1,253 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#include <iostream>
+#include <algorithm>
+#include <Ravelin/RCArticulatedBodyd.h>
+#include <Moby/XMLTree.h>
+#include <Moby/CouplingConstraint.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using std::map;
+using std::vector;
+using std::list;
+using std::cerr;
+using std::endl;
+using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
+
+/// Constructs a coupling with no terms and no backlash
+CouplingConstraint::CouplingConstraint()
+{
+  backlash = 0.0;
+  offset = 0.0;
+  lambda = 0.0;
+}
+
+/// Determines whether a joint's coordinates are generalized coordinates of its articulated body
+/**
+ * Only explicit joints of reduced-coordinate articulated bodies have
+ * coordinates (starting at the joint's coordinate index) in the generalized
+ * coordinates of their bodies; joints of bodies that have not been set up
+ * yet are accepted and checked again when the coupling row is formed.
+ */
+static bool is_explicit_joint(JointPtr joint, bool allow_no_body)
+{
+  shared_ptr<ArticulatedBodyd> ab = joint->get_articulated_body();
+  if (!ab)
+    return allow_no_body;
+  shared_ptr<RCArticulatedBodyd> rcab = dynamic_pointer_cast<RCArticulatedBodyd>(ab);
+  if (!rcab)
+    return false;
+  const vector<shared_ptr<Jointd> >& ejoints = rcab->get_explicit_joints();
+  return std::find(ejoints.begin(), ejoints.end(), joint) != ejoints.end();
+}
+
+/// Adds a term to the coupling
+/**
+ * \param joint the joint (an explicit joint of a reduced-coordinate
+ *        articulated body)
+ * \param dof the degree-of-freedom of the joint
+ * \param ratio the ratio that multiplies the joint coordinate
+ */
+void CouplingConstraint::add_term(JointPtr joint, unsigned dof, double ratio)
+{
+  if (!joint)
+    throw std::runtime_error("CouplingConstraint::add_term() - joint is NULL");
+  if (dof >= joint->num_dof())
+    throw std::runtime_error("CouplingConstraint::add_term() - invalid degree-of-freedom");
+  if (!is_explicit_joint(joint, true))
+    throw std::runtime_error("CouplingConstraint::add_term() - joint is not an explicit joint of a reduced-coordinate articulated body");
+
+  Term term;
+  term.joint = joint;
+  term.dof = dof;
+  term.ratio = ratio;
+  _terms.push_back(term);
+}
+
+/// Computes the position error of the coupling (sum_i r_i * q_i - offset)
+double CouplingConstraint::calc_position_error() const
+{
+  double e = -offset;
+  for (unsigned i=0; i< _terms.size(); i++)
+    e += _terms[i].ratio * _terms[i].joint->q[_terms[i].dof];
+  return e;
+}
+
+/// Computes the velocity of the coupling (sum_i r_i * qd_i)
+double CouplingConstraint::calc_velocity() const
+{
+  double v = 0.0;
+  for (unsigned i=0; i< _terms.size(); i++)
+    v += _terms[i].ratio * _terms[i].joint->qd[_terms[i].dof];
+  return v;
+}
+
+/// Gets the sign of the coupling row
+/**
+ * \return 1 for a bilateral coupling; for a coupling with backlash, 1 (or
+ *         -1) if the position error has reached the upper (or lower) end of
+ *         the free play, and 0 otherwise. The coupling row multiplied by this
+ *         sign gives the velocity at which the free play is being exceeded.
+ */
+int CouplingConstraint::get_direction() const
+{
+  if (is_bilateral())
+    return 1;
+
+  const double e = calc_position_error();
+  if (e >= backlash*0.5)
+    return 1;
+  else if (e <= -backlash*0.5)
+    return -1;
+  else
+    return 0;
+}
+
+/// Determines whether the coupling is currently transmitting motion
+bool CouplingConstraint::is_engaged() const
+{
+  return get_direction() != 0;
+}
+
+/// Gets the super bodies that the coupling acts upon
+void CouplingConstraint::get_super_bodies(vector<shared_ptr<DynamicBodyd> >& bodies) const
+{
+  bodies.clear();
+  for (unsigned i=0; i< _terms.size(); i++)
+    bodies.push_back(dynamic_pointer_cast<DynamicBodyd>(_terms[i].joint->get_articulated_body()));
+  std::sort(bodies.begin(), bodies.end());
+  bodies.erase(std::unique(bodies.begin(), bodies.end()), bodies.end());
+}
+
+/// Adds the (signed) row of the coupling to a sparse Jacobian
+/**
+ * Each term contributes a single 1x1 block at the generalized coordinate of
+ * its joint degree-of-freedom; terms on bodies that are not found in gc_map
+ * are ignored. Throws std::runtime_error if a term's joint is not an
+ * explicit joint of a reduced-coordinate articulated body (its degree-of-
+ * freedom would then have no generalized coordinate).
+ * \param gc_map the starting generalized coordinate index of each super body
+ * \param row the row of the Jacobian
+ * \param J the Jacobian to which the blocks are added
+ */
+void CouplingConstraint::add_to_Jacobian(const map<shared_ptr<DynamicBodyd>, unsigned>& gc_map, unsigned row, SparseJacobian& J) const
+{
+  const double SIGN = (double) get_direction();
+
+  for (unsigned i=0; i< _terms.size(); i++)
+  {
+    shared_ptr<DynamicBodyd> ab = dynamic_pointer_cast<DynamicBodyd>(_terms[i].joint->get_articulated_body());
+    map<shared_ptr<DynamicBodyd>, unsigned>::const_iterator gc_iter = gc_map.find(ab);
+    if (gc_iter == gc_map.end())
+      continue;
+    if (!is_explicit_joint(_terms[i].joint, false))
+      throw std::runtime_error("CouplingConstraint::add_to_Jacobian() - joint is not an explicit joint of a reduced-coordinate articulated body");
+
+    J.blocks.push_back(MatrixBlock());
+    J.blocks.back().block.resize(1,1);
+    J.blocks.back().block(0,0) = SIGN * _terms[i].ratio;
+    J.blocks.back().st_row_idx = row;
+    J.blocks.back().st_col_idx = gc_iter->second + _terms[i].joint->get_coord_index() + _terms[i].dof;
+  }
+}
+
+/// Implements Base::load_from_xml()
+/**
+ * The coupling is specified by Term child nodes, each with joint-id, dof
+ * (default 0), and ratio (default 1) attributes.
+ */
+void CouplingConstraint::load_from_xml(shared_ptr<const XMLTree> node, map<std::string, BasePtr>& id_map)
+{
+  map<std::string, BasePtr>::const_iterator id_iter;
+
+  // load the parent data
+  Base::load_from_xml(node, id_map);
+
+  // read the backlash and offset
+  XMLAttrib* backlash_attr = node->get_attrib("backlash");
+  if (backlash_attr)
+    backlash = backlash_attr->get_real_value();
+  XMLAttrib* offset_attr = node->get_attrib("offset");
+  if (offset_attr)
+    offset = offset_attr->get_real_value();
+
+  // read the terms
+  _terms.clear();
+  list<shared_ptr<const XMLTree> > term_nodes = node->find_child_nodes("Term");
+  for (list<shared_ptr<const XMLTree> >::const_iterator i = term_nodes.begin(); i != term_nodes.end(); i++)
+  {
+    XMLAttrib* id_attr = (*i)->get_attrib("joint-id");
+    if (!id_attr)
+    {
+      cerr << "CouplingConstraint::load_from_xml() - Term node has no joint-id attribute!" << endl;
+      cerr << "  offending node: " << endl << *node;
+      continue;
+    }
+
+    // look for the joint
+    const std::string& ID = id_attr->get_string_value();
+    if ((id_iter = id_map.find(ID)) == id_map.end())
+    {
+      cerr << "CouplingConstraint::load_from_xml() - joint id: " << ID << " not found!" << endl;
+      cerr << "  offending node: " << endl << *node;
+      continue;
+    }
+    JointPtr joint = dynamic_pointer_cast<Joint>(id_iter->second);
+    if (!joint)
+    {
+      cerr << "CouplingConstraint::load_from_xml() - object with id: " << ID << " is not a joint" << endl;
+      cerr << "  offending node: " << endl << *node;
+      continue;
+    }
+
+    // read the degree-of-freedom and the ratio
+    unsigned dof = 0;
+    double ratio = 1.0;
+    XMLAttrib* dof_attr = (*i)->get_attrib("dof");
+    if (dof_attr)
+      dof = dof_attr->get_unsigned_value();
+    XMLAttrib* ratio_attr = (*i)->get_attrib("ratio");
+    if (ratio_attr)
+      ratio = ratio_attr->get_real_value();
+
+    if (dof >= joint->num_dof())
+    {
+      cerr << "CouplingConstraint::load_from_xml() - invalid dof for joint: " << ID << endl;
+      cerr << "  offending node: " << endl << *node;
+      continue;
+    }
+
+    add_term(joint, dof, ratio);
+  }
+}
+
+/// Implements Base::save_to_xml()
+void CouplingConstraint::save_to_xml(XMLTreePtr node, list<shared_ptr<const Base> >& shared_objects) const
+{
+  // save the parent data
+  Base::save_to_xml(node, shared_objects);
+
+  // (re)set the name of this node
+  node->name = "CouplingConstraint";
+
+  // save the backlash and offset
+  node->attribs.insert(XMLAttrib("backlash", backlash));
+  node->attribs.insert(XMLAttrib("offset", offset));
+
+  // save the terms
+  for (unsigned i=0; i< _terms.size(); i++)
+  {
+    XMLTreePtr child_node(new XMLTree("Term"));
+    node->add_child(child_node);
+    child_node->attribs.insert(XMLAttrib("joint-id", _terms[i].joint->id));
+    child_node->attribs.insert(XMLAttrib("dof", _terms[i].dof));
+    child_node->attribs.insert(XMLAttrib("ratio", _terms[i].ratio));
+  }
+}
+
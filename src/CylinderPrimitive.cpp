@@ -19,7 +19,9 @@
 #include <Moby/CollisionGeometry.h>
 #include <Moby/HeightmapPrimitive.h>
 #include <Moby/TriangleMeshPrimitive.h>
+#include <Moby/TetraMeshPrimitive.h>
 #include <Moby/GJK.h>
+#include <Moby/MemoryAccounting.h>
 #include <Moby/CylinderPrimitive.h>
 
 using namespace Ravelin;
@@ -113,6 +115,11 @@ double CylinderPrimitive::calc_signed_dist(shared_ptr<const Primitive> p, Point3
     return GJK::do_gjk(cthis, p, Pcyl, Pgeneric, pthis, pp);
   }
 
+  // try cylinder/tetra mesh
+  shared_ptr<const TetraMeshPrimitive> tetp = dynamic_pointer_cast<const TetraMeshPrimitive>(p);
+  if (tetp)
+    return tetp->calc_signed_dist(dynamic_pointer_cast<const Primitive>(shared_from_this()), pp, pthis);
+
   // try cylinder/(non-convex) trimesh
   shared_ptr<const TriangleMeshPrimitive> trip = dynamic_pointer_cast<const TriangleMeshPrimitive>(p);
   if (trip)
@@ -549,6 +556,7 @@ void CylinderPrimitive::calc_mass_properties()
 /// Gets the OBB
 BVPtr CylinderPrimitive::get_BVH_root(CollisionGeometryPtr geom)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
   const unsigned X = 0, Y = 1, Z = 2;
 
   // get the pointer to the bounding box
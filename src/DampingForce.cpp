@@ -111,6 +111,46 @@ void DampingForce::add_force(shared_ptr<DynamicBodyd> body)
   }
 }
 
+/// Gets a damping constant for a body, if one is given
+double DampingForce::get_constant(const map<shared_ptr<DynamicBodyd>, double>& k, shared_ptr<DynamicBodyd> body, double default_value)
+{
+  map<shared_ptr<DynamicBodyd>, double>::const_iterator diter = k.find(body);
+  return (diter != k.end()) ? diter->second : default_value;
+}
+
+/// Adds damping force to a number of bodies
+/**
+ * The damping constants for every rigid body and link of an articulated body
+ * are resolved only when the set of bodies changes (or invalidate_batch() is
+ * called).
+ */
+void DampingForce::add_forces(const vector<shared_ptr<DynamicBodyd> >& bodies)
+{
+  // resolve the links and the damping constants, if necessary
+  if (update_batch(bodies))
+  {
+    get_links(bodies, _links, _owners);
+    _kl.resize(_links.size());
+    _ka.resize(_links.size());
+    _klsq.resize(_links.size());
+    _kasq.resize(_links.size());
+    for (unsigned i=0; i< _links.size(); i++)
+    {
+      // constants for the body are overridden by constants for the link
+      shared_ptr<DynamicBodyd> body = bodies[_owners[i]];
+      shared_ptr<DynamicBodyd> link = dynamic_pointer_cast<DynamicBodyd>(_links[i]);
+      _kl[i] = get_constant(kl, link, get_constant(kl, body, 0.0));
+      _ka[i] = get_constant(ka, link, get_constant(ka, body, 0.0));
+      _klsq[i] = get_constant(klsq, link, get_constant(klsq, body, 0.0));
+      _kasq[i] = get_constant(kasq, link, get_constant(kasq, body, 0.0));
+    }
+  }
+
+  // add dampening to all links 
+  for (unsigned i=0; i< _links.size(); i++)
+    add_damping(_links[i], _kl[i], _ka[i], _klsq[i], _kasq[i]);
+}
+
 /// Implements Base::load_from_xml()
 void DampingForce::load_from_xml(shared_ptr<const XMLTree> node, map<std::string, BasePtr>& id_map)
 {
@@ -122,6 +162,9 @@ void DampingForce::load_from_xml(shared_ptr<const XMLTree> node, map<std::string
   // verify that the name of this node is correct
   assert(strcasecmp(node->name.c_str(), "DampingForce") == 0);
 
+  // damping constants must be resolved again
+  invalidate_batch();
+
   // get the sets of gains
   list<shared_ptr<const XMLTree> > gain_nodes = node->find_child_nodes("Gains");
   if (!gain_nodes.empty())
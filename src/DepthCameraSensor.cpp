@@ -0,0 +1,111 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#include <cmath>
+#include <limits>
+#include <Moby/XMLTree.h>
+#include <Moby/DepthCameraSensor.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using std::map;
+using std::list;
+using std::vector;
+using boost::shared_ptr;
+
+/// Constructs a 64x48 depth camera with a ninety degree field of view
+DepthCameraSensor::DepthCameraSensor()
+{
+  width = 64;
+  height = 48;
+  fov = M_PI_2;
+  min_range = 0.01;
+}
+
+/// Allocates the depth image and precomputes the pixel directions
+/**
+ * This method must be called after any of the image parameters change.
+ */
+void DepthCameraSensor::setup()
+{
+  const double INF = std::numeric_limits<double>::max();
+
+  if (width == 0 || height == 0)
+    throw std::runtime_error("DepthCameraSensor::setup() - image dimensions must be positive");
+  if (fov <= 0.0 || fov >= M_PI)
+    throw std::runtime_error("DepthCameraSensor::setup() - field of view must lie in (0, pi)");
+
+  _depths.assign(width*height, INF);
+
+  // compute the direction through the center of each pixel
+  const double F = 0.5*width/std::tan(0.5*fov);
+  _dirs.resize(width*height);
+  for (unsigned i=0, k=0; i< height; i++)
+    for (unsigned j=0; j< width; j++, k++)
+      _dirs[k] = Origin3d((j + 0.5 - 0.5*width)/F, (i + 0.5 - 0.5*height)/F, 1.0);
+}
+
+/// Allocates the buffers if they have not yet been allocated
+void DepthCameraSensor::prepare(double t)
+{
+  if (_depths.size() != width*height)
+    setup();
+}
+
+/// Appends the ray through each pixel, clipped to the near and far depths
+void DepthCameraSensor::get_rays(vector<LineSeg3>& segs) const
+{
+  Transform3d gTs = Pose3d::calc_relative_pose(_F, GLOBAL);
+  for (unsigned i=0; i< _dirs.size(); i++)
+    append_ray(gTs, _dirs[i], min_range, max_range, segs);
+}
+
+/// Sets the depth of each pixel
+void DepthCameraSensor::set_ray_results(const SceneQueryResults& results, unsigned offset)
+{
+  const double INF = std::numeric_limits<double>::max();
+
+  // the directions have unit depth, so depth is linear in the ray parameter
+  for (unsigned i=0, k=offset; i< _depths.size(); i++, k++)
+    _depths[i] = (results.geoms[k]) ? min_range + results.t[k]*(max_range - min_range) : INF;
+}
+
+/// Implements Base::load_from_xml()
+void DepthCameraSensor::load_from_xml(shared_ptr<const XMLTree> node, map<std::string, BasePtr>& id_map)
+{
+  // load the parent data
+  RaySensor::load_from_xml(node, id_map);
+
+  // read the image parameters
+  XMLAttrib* width_attr = node->get_attrib("width");
+  if (width_attr)
+    width = width_attr->get_unsigned_value();
+  XMLAttrib* height_attr = node->get_attrib("height");
+  if (height_attr)
+    height = height_attr->get_unsigned_value();
+  XMLAttrib* fov_attr = node->get_attrib("fov");
+  if (fov_attr)
+    fov = fov_attr->get_real_value();
+
+  // allocate the buffers
+  setup();
+}
+
+/// Implements Base::save_to_xml()
+void DepthCameraSensor::save_to_xml(XMLTreePtr node, list<shared_ptr<const Base> >& shared_objects) const
+{
+  // save the parent data
+  RaySensor::save_to_xml(node, shared_objects);
+
+  // (re)set the name of this node
+  node->name = "DepthCamera";
+
+  // save the image parameters
+  node->attribs.insert(XMLAttrib("width", width));
+  node->attribs.insert(XMLAttrib("height", height));
+  node->attribs.insert(XMLAttrib("fov", fov));
+}
+
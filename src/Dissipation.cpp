@@ -4,6 +4,9 @@
  * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
  ****************************************************************************/
 
+#include <cmath>
+#include <set>
+#include <algorithm>
 #include <Moby/RCArticulatedBody.h>
 #include <Moby/ControlledBody.h>
 #include <Moby/Dissipation.h>
@@ -24,32 +27,153 @@ using namespace Moby;
 
 Dissipation::Dissipation()
 {
+  _friction = false;
 }
 
-void Dissipation::apply(const std::vector<shared_ptr<DynamicBodyd> >& bodies)
+/// Gets the coefficient for a body
+double Dissipation::get_coeff(const map<shared_ptr<DynamicBodyd>, double>& coeffs, shared_ptr<DynamicBodyd> body, double default_value)
+{
+  map<shared_ptr<DynamicBodyd>, double>::const_iterator body_iter = coeffs.find(body);
+  return (body_iter != coeffs.end()) ? body_iter->second : default_value;
+}
+
+/// Gets the number of joint degrees of freedom of an articulated body
+unsigned Dissipation::num_joint_dof(shared_ptr<RCArticulatedBody> ab)
+{
+  const vector<shared_ptr<Jointd> >& joints = ab->get_joints();
+  unsigned ndof = 0;
+  for (unsigned j=0; j< joints.size(); j++)
+    ndof += joints[j]->num_dof();
+  return ndof;
+}
+
+/// Determines whether the per-DOF coefficient arrays were built for the given bodies and the current coefficients
+/**
+ * Bodies are tracked by weak pointers, so a body that has been destroyed is
+ * never mistaken for a new body allocated at the same address.
+ */
+bool Dissipation::is_current(const vector<shared_ptr<DynamicBodyd> >& bodies) const
+{
+  // check the bodies
+  if (bodies.size() != _bodies.size())
+    return false;
+  for (unsigned i=0; i< bodies.size(); i++)
+    if (_bodies[i].lock() != bodies[i])
+      return false;
+
+  // check the joint DOF of the articulated bodies (the coefficients are
+  // uniform over a body, so only the layout matters)
+  for (unsigned i=0; i< _abodies.size(); i++)
+    if (num_joint_dof(_abodies[i].lock()) != _abody_ndof[i])
+      return false;
+
+  // check the coefficients
+  return _coeffs == _setup_coeffs && _viscous_coeffs == _setup_viscous_coeffs && _coulomb_coeffs == _setup_coulomb_coeffs;
+}
+
+/// Builds the per-DOF coefficient arrays for the given bodies
+void Dissipation::setup(const vector<shared_ptr<DynamicBodyd> >& bodies)
 {
   const double DECAY = 0.99;
 
+  // clear the arrays
+  _bodies.resize(bodies.size());
+  _abodies.clear();
+  _abody_ndof.clear();
+  _decay.clear();
+  _viscous.clear();
+  _coulomb.clear();
+  _friction = false;
+
+  // record the coefficients
+  _setup_coeffs = _coeffs;
+  _setup_viscous_coeffs = _viscous_coeffs;
+  _setup_coulomb_coeffs = _coulomb_coeffs;
+
   // loop through all bodies
   for (unsigned i=0; i< bodies.size(); i++)
   {
+    _bodies[i] = bodies[i];
+
     // see whether the body is articulated
     RCArticulatedBodyPtr ab = dynamic_pointer_cast<RCArticulatedBody>(bodies[i]);
     if (!ab)
       continue;
 
-    // get the decay 
-    double decay = DECAY;
-    std::map<shared_ptr<DynamicBodyd>, double>::const_iterator body_iter;
-    if ((body_iter = _coeffs.find(bodies[i])) != _coeffs.end())
-      decay = body_iter->second;
+    // get the coefficients
+    const double decay = get_coeff(_coeffs, bodies[i], DECAY);
+    const double viscous = get_coeff(_viscous_coeffs, bodies[i], 0.0);
+    const double coulomb = get_coeff(_coulomb_coeffs, bodies[i], 0.0);
+    if (viscous > 0.0 || coulomb > 0.0)
+      _friction = true;
 
-    // apply the decay 
-    const vector<shared_ptr<Jointd> >& joints = ab->get_joints();
+    // add the coefficients for each joint DOF
+    const unsigned NDOF = num_joint_dof(ab);
+    _abodies.push_back(ab);
+    _abody_ndof.push_back(NDOF);
+    _decay.insert(_decay.end(), NDOF, decay);
+    _viscous.insert(_viscous.end(), NDOF, viscous);
+    _coulomb.insert(_coulomb.end(), NDOF, coulomb);
+  }
+
+  _qd.resize(_decay.size());
+}
+
+/// Dissipates energy from the joints of the articulated bodies
+/**
+ * \param bodies the bodies in the simulator
+ * \param dt the step size (used for joint friction)
+ */
+void Dissipation::apply(const std::vector<shared_ptr<DynamicBodyd> >& bodies, double dt)
+{
+  // rebuild the per-DOF arrays if the bodies or coefficients have changed
+  if (!is_current(bodies))
+    setup(bodies);
+
+  // gather the joint velocities
+  const unsigned NABODIES = _abodies.size();
+  for (unsigned i=0, k=0; i< NABODIES; i++)
+  {
+    const vector<shared_ptr<Jointd> >& joints = _abodies[i].lock()->get_joints();
     for (unsigned j=0; j< joints.size(); j++)
-     joints[j]->qd *= decay;
+    {
+      const VectorNd& qd = joints[j]->qd;
+      std::copy(qd.begin(), qd.end(), _qd.begin() + k);
+      k += qd.size();
+    }
+  }
+
+  // apply the decay
+  const unsigned NDOF = _qd.size();
+  double* qd = (NDOF > 0) ? &_qd[0] : NULL;
+  const double* decay = (NDOF > 0) ? &_decay[0] : NULL;
+  for (unsigned i=0; i< NDOF; i++)
+    qd[i] *= decay[i];
+
+  // apply viscous and Coulomb friction (neither reverses the velocity)
+  if (_friction)
+  {
+    const double* viscous = &_viscous[0];
+    const double* coulomb = &_coulomb[0];
+    for (unsigned i=0; i< NDOF; i++)
+    {
+      const double speed = std::fabs(qd[i]);
+      const double reduced = std::max(speed - (viscous[i]*speed + coulomb[i])*dt, 0.0);
+      qd[i] = (qd[i] < 0.0) ? -reduced : reduced;
+    }
+  }
 
-    // update link velocities
+  // scatter the joint velocities and update the link velocities
+  for (unsigned i=0, k=0; i< NABODIES; i++)
+  {
+    RCArticulatedBodyPtr ab = _abodies[i].lock();
+    const vector<shared_ptr<Jointd> >& joints = ab->get_joints();
+    for (unsigned j=0; j< joints.size(); j++)
+    {
+      VectorNd& qd = joints[j]->qd;
+      std::copy(_qd.begin() + k, _qd.begin() + k + qd.size(), qd.begin());
+      k += qd.size();
+    }
     ab->update_link_velocities();
   }
 }
@@ -90,17 +214,27 @@ void Dissipation::load_from_xml(shared_ptr<const XMLTree> node, std::map<std::st
       continue;
     }
 
-    // get lambda
+    // get lambda and the joint friction coefficients
     XMLAttrib* coeff_attr = (*i)->get_attrib("lambda");
-    if (!coeff_attr)
+    XMLAttrib* viscous_attr = (*i)->get_attrib("viscous");
+    XMLAttrib* coulomb_attr = (*i)->get_attrib("coulomb");
+    if (!coeff_attr && !viscous_attr && !coulomb_attr)
     {
-      std::cerr << "Dissipation::load_from_xml() - no 'lambda' specified in 'Body' node" << std::endl;
+      std::cerr << "Dissipation::load_from_xml() - no 'lambda', 'viscous', or 'coulomb' specified in 'Body' node" << std::endl;
       continue;
     }
 
-    // all checks passed; add it to the map 
-    _coeffs[db] = coeff_attr->get_real_value();
+    // all checks passed; add it to the maps
+    if (coeff_attr)
+      _coeffs[db] = coeff_attr->get_real_value();
+    if (viscous_attr)
+      _viscous_coeffs[db] = viscous_attr->get_real_value();
+    if (coulomb_attr)
+      _coulomb_coeffs[db] = coulomb_attr->get_real_value();
   }
+
+  // the per-DOF coefficients must be rebuilt
+  invalidate();
 }
 
 /// Implements Base::save_to_xml()
@@ -112,11 +246,27 @@ void Dissipation::save_to_xml(XMLTreePtr node, std::list<shared_ptr<const Base>
   // (re)set the name of this node
   node->name = "Dissipation";
 
-  // loop through all bodies
+  // get all bodies with coefficients
+  std::set<shared_ptr<DynamicBodyd> > bodies;
   for (std::map<shared_ptr<DynamicBodyd>, double>::const_iterator i = _coeffs.begin(); i != _coeffs.end(); i++)
+    bodies.insert(i->first);
+  for (std::map<shared_ptr<DynamicBodyd>, double>::const_iterator i = _viscous_coeffs.begin(); i != _viscous_coeffs.end(); i++)
+    bodies.insert(i->first);
+  for (std::map<shared_ptr<DynamicBodyd>, double>::const_iterator i = _coulomb_coeffs.begin(); i != _coulomb_coeffs.end(); i++)
+    bodies.insert(i->first);
+
+  // loop through all bodies
+  for (std::set<shared_ptr<DynamicBodyd> >::const_iterator i = bodies.begin(); i != bodies.end(); i++)
   {
     XMLTreePtr child_node(new XMLTree("Body"));
-    child_node->attribs.insert(XMLAttrib(i->first->body_id, i->second));
+    child_node->attribs.insert(XMLAttrib("id", (*i)->body_id));
+    std::map<shared_ptr<DynamicBodyd>, double>::const_iterator j;
+    if ((j = _coeffs.find(*i)) != _coeffs.end())
+      child_node->attribs.insert(XMLAttrib("lambda", j->second));
+    if ((j = _viscous_coeffs.find(*i)) != _viscous_coeffs.end())
+      child_node->attribs.insert(XMLAttrib("viscous", j->second));
+    if ((j = _coulomb_coeffs.find(*i)) != _coulomb_coeffs.end())
+      child_node->attribs.insert(XMLAttrib("coulomb", j->second));
     node->add_child(child_node);
   }
 }
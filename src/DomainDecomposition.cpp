@@ -0,0 +1,578 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <cstring>
+#include <sstream>
+#include <limits>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/foreach.hpp>
+#include <Moby/Constants.h>
+#include <Moby/Log.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/RigidBody.h>
+#include <Moby/ArticulatedBody.h>
+#include <Moby/Simulator.h>
+#include <Moby/DomainDecomposition.h>
+
+using std::endl;
+using std::map;
+using std::pair;
+using std::make_pair;
+using std::vector;
+using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
+using namespace Ravelin;
+using namespace Moby;
+
+/// Value written to the segment header once the segment is initialized
+static const unsigned MAGIC = 0x4d6f6279;
+
+/// The number of doubles in the state of a rigid body (position, orientation, and spatial velocity)
+static const unsigned RB_STATE_SIZE = 13;
+
+/// The number of times a waiting process yields before it starts sleeping
+static const unsigned N_SPINS = 1000;
+
+/// The time that a waiting process sleeps between polls (in microseconds)
+static const useconds_t POLL_USEC = 100;
+
+/// The header of the shared memory segment (followed by the process ids of the regions and the two state buffers)
+struct DomainDecomposition::Header
+{
+  volatile unsigned magic;
+  unsigned n_regions;
+  unsigned n_state;
+
+  /// The process that created the segment (region 0)
+  volatile pid_t creator;
+
+  /// Nonzero identifier of the run, published last by region 0
+  volatile unsigned long generation;
+
+  /// The number of processes that have reached the barrier
+  volatile unsigned arrived;
+
+  /// The number of times that the barrier has been passed
+  volatile unsigned epoch;
+};
+
+/// Gets the current time (in seconds)
+static double get_time()
+{
+  timeval t;
+  gettimeofday(&t, NULL);
+  return t.tv_sec + t.tv_usec*1e-6;
+}
+
+/// Determines whether a process exists
+static bool is_alive(pid_t pid)
+{
+  return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+/// Gets the inode of the shared memory segment with the given name (0 if there is none)
+static ino_t get_segment_inode(const std::string& name)
+{
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    return 0;
+  struct stat st;
+  ino_t inode = (fstat(fd, &st) == 0) ? st.st_ino : 0;
+  close(fd);
+  return inode;
+}
+
+/// Sets up the decomposition and connects to the shared memory segment
+/**
+ * \param sim the simulator (all processes must load the same scene)
+ * \param name the name of the shared memory segment (the same for all
+ *        processes)
+ * \param region the region of this process; region 0 creates the segment
+ * \param axis the axis (0=x, 1=y, 2=z) along which the world is split
+ * \param cuts the boundaries between regions along the axis
+ */
+DomainDecomposition::DomainDecomposition(shared_ptr<Simulator> sim, const std::string& name, unsigned region, unsigned axis, const vector<double>& cuts)
+{
+  // verify the arguments
+  if (!sim)
+    throw std::runtime_error("DomainDecomposition::DomainDecomposition() - null simulator");
+  if (axis > 2)
+    throw std::runtime_error("DomainDecomposition::DomainDecomposition() - axis must be 0, 1, or 2");
+  if (region > cuts.size())
+    throw std::runtime_error("DomainDecomposition::DomainDecomposition() - region index out of range");
+
+  // set the members
+  ghost_width = 0.5;
+  timeout = 60.0;
+  _sim = sim;
+  _region = region;
+  _axis = axis;
+  _cuts = cuts;
+  std::sort(_cuts.begin(), _cuts.end());
+  _segment = NULL;
+  _segment_size = 0;
+  _header = NULL;
+  _pids = NULL;
+  _generation = 0;
+  _buffers[0] = _buffers[1] = NULL;
+  _parity = 0;
+
+  // get the index of each body in the simulator; processes that load the
+  // same scene agree on these indices (but not on the order of the islands)
+  const vector<ControlledBodyPtr>& bodies = sim->get_dynamic_bodies();
+  map<shared_ptr<DynamicBodyd>, unsigned> index;
+  for (unsigned i=0; i< bodies.size(); i++)
+    index[dynamic_pointer_cast<DynamicBodyd>(bodies[i])] = i;
+
+  // find the islands and put them (and their bodies) in simulator order
+  vector<vector<shared_ptr<DynamicBodyd> > > islands;
+  sim->find_islands(islands);
+  vector<pair<unsigned, unsigned> > island_order;
+  for (unsigned i=0; i< islands.size(); i++)
+  {
+    vector<pair<unsigned, shared_ptr<DynamicBodyd> > > ordered;
+    for (unsigned j=0; j< islands[i].size(); j++)
+      ordered.push_back(make_pair(index[islands[i][j]], islands[i][j]));
+    std::sort(ordered.begin(), ordered.end());
+    for (unsigned j=0; j< ordered.size(); j++)
+      islands[i][j] = ordered[j].second;
+    if (!ordered.empty())
+      island_order.push_back(make_pair(ordered.front().first, i));
+  }
+  std::sort(island_order.begin(), island_order.end());
+  for (unsigned i=0; i< island_order.size(); i++)
+    _islands.push_back(islands[island_order[i].second]);
+
+  // lay out the states and get the collision geometries of each island
+  _n_state = 0;
+  _offsets.resize(_islands.size());
+  _geoms.resize(_islands.size());
+  for (unsigned i=0; i< _islands.size(); i++)
+    for (unsigned j=0; j< _islands[i].size(); j++)
+    {
+      _offsets[i].push_back(_n_state);
+      _n_state += state_size(_islands[i][j]);
+
+      vector<shared_ptr<RigidBodyd> > links;
+      shared_ptr<ArticulatedBodyd> ab = dynamic_pointer_cast<ArticulatedBodyd>(_islands[i][j]);
+      if (ab)
+        links = ab->get_links();
+      else
+        links.push_back(dynamic_pointer_cast<RigidBodyd>(_islands[i][j]));
+      for (unsigned k=0; k< links.size(); k++)
+      {
+        RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(links[k]);
+        if (!rb)
+          continue;
+        BOOST_FOREACH(CollisionGeometryPtr cg, rb->geometries)
+          _geoms[i].push_back(make_pair(cg, cg->collision_group));
+      }
+    }
+
+  // connect to the shared memory segment
+  open_segment(name);
+
+  // determine the initial owners (all islands are active initially)
+  _owner.resize(_islands.size());
+  for (unsigned i=0; i< _islands.size(); i++)
+    _owner[i] = find_region(calc_island_position(i));
+  _active.resize(_islands.size(), true);
+  update_ownership();
+}
+
+/// Disconnects from the shared memory segment
+DomainDecomposition::~DomainDecomposition()
+{
+  unmap_segment();
+
+  // the creating process removes the segment
+  if (_region == 0)
+    shm_unlink(_name.c_str());
+}
+
+/// Creates (region 0) or opens (other regions) the shared memory segment
+/**
+ * Region 0 removes any segment left over from an earlier run, creates a new
+ * one, and publishes a generation for the run once the segment is
+ * initialized. Other regions wait (for at most timeout seconds) until a
+ * segment with a published generation exists whose creator is alive; a
+ * segment that has been replaced or removed while waiting (e.g., one left
+ * over from a crashed run) is abandoned and the name is opened again.
+ */
+void DomainDecomposition::open_segment(const std::string& name)
+{
+  const unsigned N_REGIONS = num_regions();
+  const useconds_t OPEN_POLL_USEC = 1000;
+  const size_t ALIGN = 16;
+
+  // the process ids of the regions follow the header; the state buffers follow those
+  const size_t PIDS_OFFSET = ((sizeof(Header) + ALIGN - 1)/ALIGN)*ALIGN;
+  const size_t BUFFER_OFFSET = ((PIDS_OFFSET + sizeof(pid_t)*N_REGIONS + ALIGN - 1)/ALIGN)*ALIGN;
+
+  // shared memory names must begin with a slash
+  _name = (!name.empty() && name[0] == '/') ? name : "/" + name;
+  _segment_size = BUFFER_OFFSET + sizeof(double)*_n_state*2;
+
+  if (_region == 0)
+  {
+    // remove any segment left over from an earlier run, and create the segment
+    shm_unlink(_name.c_str());
+    int fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0 || ftruncate(fd, _segment_size) != 0)
+    {
+      if (fd >= 0)
+        close(fd);
+      throw std::runtime_error("DomainDecomposition::open_segment() - unable to create shared memory segment " + _name);
+    }
+    map_segment(fd, PIDS_OFFSET, BUFFER_OFFSET);
+
+    // write the header; the generation is published last
+    _header->magic = MAGIC;
+    _header->n_regions = N_REGIONS;
+    _header->n_state = _n_state;
+    _header->creator = getpid();
+    _header->arrived = 0;
+    _header->epoch = 0;
+    _pids[0] = getpid();
+    timeval t;
+    gettimeofday(&t, NULL);
+    _generation = ((unsigned long) getpid() << 20) ^ (unsigned long) t.tv_sec ^ ((unsigned long) t.tv_usec << 12);
+    if (_generation == 0)
+      _generation = 1;
+    __sync_synchronize();
+    _header->generation = _generation;
+    return;
+  }
+
+  // wait for region 0 to create and initialize the segment of this run
+  const double START = get_time();
+  while (true)
+  {
+    if (get_time() - START > timeout)
+      throw std::runtime_error("DomainDecomposition::open_segment() - timed out waiting for region 0 to initialize shared memory segment " + _name);
+
+    // open the segment and wait for it to be sized
+    int fd = shm_open(_name.c_str(), O_RDWR, S_IRUSR | S_IWUSR);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t) st.st_size < _segment_size)
+    {
+      if (fd >= 0)
+        close(fd);
+      usleep(OPEN_POLL_USEC);
+      continue;
+    }
+    const ino_t INODE = st.st_ino;
+    map_segment(fd, PIDS_OFFSET, BUFFER_OFFSET);
+
+    // wait for the generation to be published; give up on the segment if its
+    // creator has exited or the name now refers to another segment
+    bool stale = false;
+    while (_header->generation == 0 && !stale && get_time() - START <= timeout)
+    {
+      usleep(OPEN_POLL_USEC);
+      stale = (get_segment_inode(_name) != INODE || (_header->creator != 0 && !is_alive(_header->creator)));
+    }
+    __sync_synchronize();
+    if (_header->generation != 0 && !stale)
+      stale = (get_segment_inode(_name) != INODE || !is_alive(_header->creator));
+    if (_header->generation == 0 || stale)
+    {
+      FILE_LOG(LOG_SIMULATOR) << "DomainDecomposition::open_segment() - abandoning stale or uninitialized segment " << _name << endl;
+      unmap_segment();
+      continue;
+    }
+
+    // verify that the processes agree on the scene, and register
+    if (_header->magic != MAGIC)
+      throw std::runtime_error("DomainDecomposition::open_segment() - shared memory segment " + _name + " was not created by DomainDecomposition");
+    if (_header->n_regions != N_REGIONS || _header->n_state != _n_state)
+      throw std::runtime_error("DomainDecomposition::open_segment() - processes disagree on the regions or the scene");
+    _generation = _header->generation;
+    _pids[_region] = getpid();
+    __sync_synchronize();
+    return;
+  }
+}
+
+/// Maps the segment open in the given descriptor (and closes the descriptor)
+void DomainDecomposition::map_segment(int fd, size_t pids_offset, size_t buffer_offset)
+{
+  _segment = mmap(NULL, _segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (_segment == MAP_FAILED)
+  {
+    _segment = NULL;
+    throw std::runtime_error("DomainDecomposition::open_segment() - unable to map shared memory segment " + _name);
+  }
+  _header = (Header*) _segment;
+  _pids = (volatile pid_t*) ((char*) _segment + pids_offset);
+  _buffers[0] = (double*) ((char*) _segment + buffer_offset);
+  _buffers[1] = _buffers[0] + _n_state;
+}
+
+/// Unmaps the segment
+void DomainDecomposition::unmap_segment()
+{
+  if (_segment)
+    munmap(_segment, _segment_size);
+  _segment = NULL;
+  _header = NULL;
+  _pids = NULL;
+  _buffers[0] = _buffers[1] = NULL;
+}
+
+/// Waits until every process has reached this point
+/**
+ * Waiting processes check that the other registered processes are still
+ * alive and that the segment still belongs to this run; a runtime_error is
+ * thrown if either check fails or if the other processes do not arrive
+ * within timeout seconds.
+ */
+void DomainDecomposition::wait_for_all()
+{
+  const unsigned N_REGIONS = num_regions();
+
+  // the epoch must be read before arriving: it cannot advance until this
+  // process has arrived
+  const unsigned EPOCH = _header->epoch;
+  __sync_synchronize();
+
+  // the last process to arrive releases the others
+  if (__sync_add_and_fetch(&_header->arrived, 1) == N_REGIONS)
+  {
+    _header->arrived = 0;
+    __sync_synchronize();
+    __sync_add_and_fetch(&_header->epoch, 1);
+    return;
+  }
+
+  const double START = get_time();
+  for (unsigned i=0; _header->epoch == EPOCH; i++)
+  {
+    if (i < N_SPINS)
+    {
+      sched_yield();
+      continue;
+    }
+    usleep(POLL_USEC);
+
+    // check the liveness of the other processes
+    if (_header->generation != _generation)
+      throw std::runtime_error("DomainDecomposition::exchange() - shared memory segment " + _name + " was reinitialized by another run");
+    for (unsigned j=0; j< N_REGIONS; j++)
+      if (_pids[j] != 0 && !is_alive(_pids[j]))
+      {
+        std::ostringstream msg;
+        msg << "DomainDecomposition::exchange() - the process of region " << j << " (pid " << _pids[j] << ") has exited";
+        throw std::runtime_error(msg.str());
+      }
+    if (get_time() - START > timeout)
+    {
+      std::ostringstream msg;
+      msg << "DomainDecomposition::exchange() - timed out after " << timeout << "s waiting for the other regions (" << _header->arrived << " of " << N_REGIONS << " arrived)";
+      throw std::runtime_error(msg.str());
+    }
+  }
+  __sync_synchronize();
+}
+
+/// Exchanges island states with the other processes and migrates islands
+/**
+ * Must be called by every process after every step. The state buffers
+ * alternate between exchanges, so a process that finishes reading late
+ * cannot have its buffer overwritten by a process that is a step ahead, and
+ * a single barrier per exchange suffices.
+ */
+void DomainDecomposition::exchange()
+{
+  double* buffer = _buffers[_parity];
+
+  // write the states of the owned islands
+  for (unsigned i=0; i< _islands.size(); i++)
+    if (_owner[i] == _region)
+      for (unsigned j=0; j< _islands[i].size(); j++)
+        write_state(_islands[i][j], buffer + _offsets[i][j]);
+
+  // wait for all processes to write their states
+  wait_for_all();
+
+  // read the states of all other islands (including the disabled ones, so
+  // that their positions determine ownership)
+  for (unsigned i=0; i< _islands.size(); i++)
+    if (_owner[i] != _region)
+      for (unsigned j=0; j< _islands[i].size(); j++)
+        read_state(_islands[i][j], buffer + _offsets[i][j]);
+
+  // switch buffers for the next exchange
+  _parity = 1 - _parity;
+
+  // every process now has the same states, so all agree on the new owners
+  update_ownership();
+}
+
+/// Determines whether this process owns the island containing the given body
+bool DomainDecomposition::owns(shared_ptr<DynamicBodyd> body) const
+{
+  for (unsigned i=0; i< _islands.size(); i++)
+    if (std::find(_islands[i].begin(), _islands[i].end(), body) != _islands[i].end())
+      return _owner[i] == _region;
+
+  return false;
+}
+
+/// Determines the owner of each island and enables the owned and ghost islands
+void DomainDecomposition::update_ownership()
+{
+  const double INF = std::numeric_limits<double>::max();
+
+  // get the extent of this region
+  const double LO = (_region == 0) ? -INF : _cuts[_region-1] - ghost_width;
+  const double HI = (_region == _cuts.size()) ? INF : _cuts[_region] + ghost_width;
+
+  for (unsigned i=0; i< _islands.size(); i++)
+  {
+    const double X = calc_island_position(i);
+    const unsigned OWNER = find_region(X);
+    if (OWNER != _owner[i])
+    {
+      FILE_LOG(LOG_SIMULATOR) << "DomainDecomposition::update_ownership() - island " << i << " migrated from region " << _owner[i] << " to region " << OWNER << endl;
+      _owner[i] = OWNER;
+    }
+    set_active(i, OWNER == _region || (X > LO && X < HI));
+  }
+}
+
+/// Enables or disables an island in this process
+/**
+ * Disabled rigid bodies are removed from the islands of the simulator and
+ * the collision geometries of disabled islands are placed into no collision
+ * group, so they are neither integrated nor checked for contact.
+ * Articulated bodies are only excluded from collision detection.
+ */
+void DomainDecomposition::set_active(unsigned island, bool active)
+{
+  if (_active[island] == active)
+    return;
+  _active[island] = active;
+
+  for (unsigned j=0; j< _islands[island].size(); j++)
+  {
+    shared_ptr<RigidBodyd> rb = dynamic_pointer_cast<RigidBodyd>(_islands[island][j]);
+    if (rb)
+      rb->set_enabled(active);
+  }
+
+  for (unsigned j=0; j< _geoms[island].size(); j++)
+    _geoms[island][j].first->collision_group = (active) ? _geoms[island][j].second : 0;
+}
+
+/// Finds the region containing the given coordinate
+unsigned DomainDecomposition::find_region(double x) const
+{
+  return std::upper_bound(_cuts.begin(), _cuts.end(), x) - _cuts.begin();
+}
+
+/// Computes the mean position of the bodies of an island along the axis
+double DomainDecomposition::calc_island_position(unsigned island) const
+{
+  double x = 0.0;
+  for (unsigned j=0; j< _islands[island].size(); j++)
+  {
+    // articulated bodies are located by their base link
+    shared_ptr<RigidBodyd> rb = dynamic_pointer_cast<RigidBodyd>(_islands[island][j]);
+    shared_ptr<ArticulatedBodyd> ab = dynamic_pointer_cast<ArticulatedBodyd>(_islands[island][j]);
+    if (ab && !ab->get_links().empty())
+      rb = ab->get_links().front();
+    if (!rb)
+      continue;
+
+    Pose3d P(*rb->get_pose());
+    P.update_relative_pose(GLOBAL);
+    x += P.x[_axis];
+  }
+
+  return x/_islands[island].size();
+}
+
+/// Gets the number of doubles in the state of a body
+unsigned DomainDecomposition::state_size(shared_ptr<DynamicBodyd> body)
+{
+  if (dynamic_pointer_cast<RigidBodyd>(body))
+    return RB_STATE_SIZE;
+  else
+    return body->num_generalized_coordinates(DynamicBodyd::eEuler) +
+           body->num_generalized_coordinates(DynamicBodyd::eSpatial);
+}
+
+/// Writes the state of a body
+/**
+ * Rigid bodies are written as their global pose and spatial velocity
+ * (generalized coordinates are unavailable for disabled rigid bodies);
+ * articulated bodies are written as their generalized coordinates and
+ * velocities.
+ */
+void DomainDecomposition::write_state(shared_ptr<DynamicBodyd> body, double* state)
+{
+  shared_ptr<RigidBodyd> rb = dynamic_pointer_cast<RigidBodyd>(body);
+  if (rb)
+  {
+    Pose3d P(*rb->get_pose());
+    P.update_relative_pose(GLOBAL);
+    SVelocityd v = Pose3d::transform(GLOBAL, rb->get_velocity());
+    Vector3d xd = v.get_linear(), w = v.get_angular();
+    state[0] = P.x[0];  state[1] = P.x[1];  state[2] = P.x[2];
+    state[3] = P.q.w;   state[4] = P.q.x;   state[5] = P.q.y;   state[6] = P.q.z;
+    state[7] = xd[0];   state[8] = xd[1];   state[9] = xd[2];
+    state[10] = w[0];   state[11] = w[1];   state[12] = w[2];
+  }
+  else
+  {
+    VectorNd q, qd;
+    body->get_generalized_coordinates_euler(q);
+    body->get_generalized_velocity(DynamicBodyd::eSpatial, qd);
+    std::copy(q.begin(), q.end(), state);
+    std::copy(qd.begin(), qd.end(), state + q.size());
+  }
+}
+
+/// Reads the state of a body
+void DomainDecomposition::read_state(shared_ptr<DynamicBodyd> body, const double* state)
+{
+  shared_ptr<RigidBodyd> rb = dynamic_pointer_cast<RigidBodyd>(body);
+  if (rb)
+  {
+    // set the pose, expressed relative to the body's current reference pose
+    Pose3d P(GLOBAL);
+    P.x = Origin3d(state[0], state[1], state[2]);
+    P.q = Quatd(state[3], state[4], state[5], state[6]);
+    P.update_relative_pose(rb->get_pose()->rpose);
+    rb->set_pose(P);
+
+    // set the velocity
+    SVelocityd v(GLOBAL);
+    v.set_linear(Vector3d(state[7], state[8], state[9], GLOBAL));
+    v.set_angular(Vector3d(state[10], state[11], state[12], GLOBAL));
+    rb->set_velocity(v);
+  }
+  else
+  {
+    const unsigned NQ = body->num_generalized_coordinates(DynamicBodyd::eEuler);
+    const unsigned NV = body->num_generalized_coordinates(DynamicBodyd::eSpatial);
+    body->set_generalized_coordinates_euler(VectorNd(NQ, state));
+    body->set_generalized_velocity(DynamicBodyd::eSpatial, VectorNd(NV, state + NQ));
+  }
+}
+
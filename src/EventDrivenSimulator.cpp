@@ -4,39 +4,29 @@
  * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
  ****************************************************************************/
 
-#include <unistd.h>
-#include <boost/tuple/tuple.hpp>
+#include <cmath>
+#include <limits>
 #include <Moby/XMLTree.h>
 #include <Moby/ArticulatedBody.h>
 #include <Moby/RigidBody.h>
+#include <Moby/Dissipation.h>
 #include <Moby/ControlledBody.h>
 #include <Moby/CollisionGeometry.h>
 #include <Moby/CollisionDetection.h>
-#include <Moby/ContactParameters.h>
-#include <Moby/VariableStepIntegrator.h>
-#include <Moby/ImpactToleranceException.h>
+#include <Moby/ImpactConstraintHandler.h>
+#include <Moby/SignedDistDot.h>
 #include <Moby/SustainedUnilateralConstraintSolveFailException.h>
-#include <Moby/InvalidStateException.h>
-#include <Moby/InvalidVelocityException.h>
+#include <Moby/MemoryAccounting.h>
 #include <Moby/EventDrivenSimulator.h>
 
 #ifdef USE_OSG
-#include <osg/Geometry>
-#include <osg/Geode>
-#include <osg/ShapeDrawable>
-#include <osg/PositionAttitudeTransform>
-#include <osg/Quat>
+#include <osg/Group>
 #endif // USE_OSG
 
 using std::endl;
-using std::set;
 using std::list;
 using std::vector;
 using std::map;
-using std::make_pair;
-using std::multimap;
-using std::pair;
-using boost::tuple;
 using boost::shared_ptr;
 using boost::dynamic_pointer_cast;
 using namespace Ravelin;
@@ -47,697 +37,490 @@ EventDrivenSimulator::EventDrivenSimulator()
 {
   // setup the standard Euler step
   euler_step = 1e-3;
-}
 
-/// Compares two unilateral constraints for purposes of mapping velocity tolerances
-bool EventDrivenSimulator::UnilateralConstraintCmp::operator()(const UnilateralConstraint& e1, const UnilateralConstraint& e2)
- const
-{
-  if (e1.constraint_type == UnilateralConstraint::eLimit)
-  {
-    // we'll place limit constraints before contact constraints
-    if (e2.constraint_type == UnilateralConstraint::eContact)
-      return true;
-
-    // if here, both are limit constraints
-    unsigned lj1 = e1.limit_joint->get_coord_index() + e1.limit_dof;
-    unsigned lj2 = e2.limit_joint->get_coord_index() + e2.limit_dof;
-    return (lj1 < lj2);
-  }
-  else
-  {
-    // first constraint is contact; check to see whether the second constraint is a contact
-    if (e2.constraint_type == UnilateralConstraint::eContact)
-    {
-      long cg11 = (long) e1.contact_geom1.get();
-      long cg12 = (long) e1.contact_geom2.get();
-      long cg21 = (long) e2.contact_geom1.get();
-      long cg22 = (long) e2.contact_geom2.get();
-      return (cg11+cg12 < cg21+cg22);
-    }
-    else
-      return false; // limits returned before contacts
-  }
+  // setup the maximum number of root finding iterations
+  max_event_iterations = 50;
 }
 
-/// Updates constraint violation at beginning of integration step
-void EventDrivenSimulator::update_constraint_violations(const vector<PairwiseDistInfo>& pairwise_distances)
+/// Steps the simulator forward by the given step size
+double EventDrivenSimulator::step(double step_size)
 {
-  FILE_LOG(LOG_SIMULATOR) << "EventDrivenSimulator::update_constraint_violations() entered" << std::endl;
+  // clear one-step visualization data
+  #ifdef USE_OSG
+  _transient_vdata->removeChildren(0, _transient_vdata->getNumChildren());
+  #endif
 
-  // set possible constraint violation
-  BOOST_FOREACH(const PairwiseDistInfo& pdi, pairwise_distances)
-  {
-    // only process if neither of the bodies is compliant
-    RigidBodyPtr rba = dynamic_pointer_cast<RigidBody>(pdi.a->get_single_body());
-    RigidBodyPtr rbb = dynamic_pointer_cast<RigidBody>(pdi.b->get_single_body());
-    if (rba->compliance == RigidBody::eCompliant || 
-        rbb->compliance == RigidBody::eCompliant)
-      continue; 
+  // hide contact visualization from the last step
+  reset_contact_visualization();
 
-    _ip_tolerances[make_sorted_pair(pdi.a, pdi.b)] = std::min(pdi.dist, -NEAR_ZERO);
-  }
+  // clear stored derivatives
+  _current_dx.resize(0);
 
-  // update joint constraint interpenetration
-  BOOST_FOREACH(ControlledBodyPtr db, _bodies)
-  {
-    ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(db);
-    if (ab)
-      ab->update_joint_constraint_violations();
-  }
+  // clear the timings and counts from the last step
+  reset_step_statistics();
 
-  FILE_LOG(LOG_SIMULATOR) << "EventDrivenSimulator::update_constraint_violations() exited" << std::endl;
-}
+  // finish removing any bodies removed since the last step
+  purge_removed_geometries();
 
-/// Handles sustained rigid unilateral constraints 
-void EventDrivenSimulator::calc_rigid_sustained_unilateral_constraint_forces()
-{
-  // if there are no constraints, quit now
-  if (_rigid_constraints.empty())
-    return;
+  FILE_LOG(LOG_SIMULATOR) << "+stepping simulation from time: " << this->current_time << " by " << step_size << std::endl;
 
-  // remove velocity-level constraints
-  std::vector<UnilateralConstraint> velocity_constraints;
-  for (unsigned i=0; i< _rigid_constraints.size(); )
+  // step until the requisite time has elapsed
+  double h = 0.0;
+  while (h < step_size)
   {
-    if (_rigid_constraints[i].deriv_type == UnilateralConstraint::eVel)
+    // get amount remaining to step
+    double dt = step_size - h;
+
+    // if dt is sufficiently small, do Euler step
+    if (dt <= euler_step)
     {
-      velocity_constraints.push_back(_rigid_constraints[i]);
-      _rigid_constraints[i] = _rigid_constraints.back();
-      _rigid_constraints.pop_back();
+      FILE_LOG(LOG_SIMULATOR) << "  - step size really small; doing semi-implicit step" << std::endl;
+      step_si_Euler(dt);
+      h += dt;
     }
     else
-      i++;  
+      h += do_event_step(dt);
   }
 
-  // call the callback function, if any
-  if (constraint_callback_fn)
-    (*constraint_callback_fn)(_rigid_constraints, constraint_callback_data);
-
-  // preprocess constraints
-  for (unsigned i=0; i< _rigid_constraints.size(); i++)
-    preprocess_constraint(_rigid_constraints[i]);
+  // update the sensors (before the callback, so that it sees their output)
+  update_sensors(step_size);
 
-  // compute forces here...
-  _rigid_unilateral_constraint_handler.process_constraints(_rigid_constraints);
+  // call the callback
+  if (post_step_callback_fn)
+    post_step_callback_fn(this);
 
-  // call the post-force application callback, if any
-  if (constraint_post_callback_fn)
-    (*constraint_post_callback_fn)(_rigid_constraints, constraint_post_callback_data);
+  // do constraint stabilization
+  stabilize_constraints();
 
-  // add velocity level constraints back in
-  _rigid_constraints.insert(_rigid_constraints.end(), velocity_constraints.begin(), velocity_constraints.end());
+  return step_size;
 }
 
-/// Computes the ODE for systems with sustained unilateral constraints
-VectorNd& EventDrivenSimulator::ode_sustained_constraints(const VectorNd& x, double t, double dt, void* data, VectorNd& dx)
+/// Integrates the bodies to the next event or by dt, whichever comes first
+/**
+ * \return the amount of time integrated
+ */
+double EventDrivenSimulator::do_event_step(double dt)
 {
-  FILE_LOG(LOG_SIMULATOR) << "EventDrivenSimulator::ode_sustained_constraints(t=" << t << ") entered" << std::endl;
+  FILE_LOG(LOG_SIMULATOR) << "EventDrivenSimulator::do_event_step() entered" << std::endl;
 
-  // get the simulator
-  shared_ptr<EventDrivenSimulator>& s = *((shared_ptr<EventDrivenSimulator>*) data);
+  // do not step past the next joint limit
+  dt = std::min(dt, std::max(calc_next_limit_time(), min_step_size));
 
-  // initialize the ODE index
-  unsigned idx = 0;
+  // do broad phase collision detection and compute pairwise distances
+  broad_phase(dt);
+  calc_pairwise_distances();
 
-  // resize dx
-  dx.resize(x.size());
+  // event localization brackets roots of the exact signed distances, so
+  // distances from coarser levels of detail are replaced
+  BOOST_FOREACH(PairwiseDistInfo& pdi, _pairwise_distances)
+    if (pdi.coarse)
+    {
+      pdi.dist = _coldet->calc_signed_dist(pdi.a, pdi.b, pdi.pa, pdi.pb);
+      pdi.coarse = false;
+    }
 
-  // loop through all bodies, preparing to compute the ODE
-  BOOST_FOREACH(ControlledBodyPtr db, s->_bodies)
+  // handle any impacts at the current time
+  double start = get_current_time();
+  find_unilateral_constraints(contact_dist_thresh);
+  for (unsigned i=0; i< _rigid_constraints.size(); i++)
+    if (_rigid_constraints[i].constraint_type == UnilateralConstraint::eContact)
+      step_contacts++;
+  calc_impacting_unilateral_constraint_forces(-1.0);
+  record_step_contacts(_rigid_constraints, 0.0);
+  constraint_time += get_current_time() - start;
+
+  // compute the accelerations, which are held constant until the event; if
+  // that is not possible, take a time stepping step instead
+  start = get_current_time();
+  try
   {
-    if (db->get_kinematic())
-      continue;
-
-    // get the number of generalized coordinates and velocities
-    const unsigned NGC = db->num_generalized_coordinates(DynamicBodyd::eEuler);
-    const unsigned NGV = db->num_generalized_coordinates(DynamicBodyd::eSpatial);
-
-    // get x for the body
-    SharedConstVectorNd xsub = x.segment(idx, idx+NGC+NGV);
-
-    FILE_LOG(LOG_SIMULATOR) << "evaluating derivative for body " << db->id << " at state " << xsub << std::endl;
-
-    // compute the ODE
-    db->prepare_to_calc_ode_sustained_constraints(xsub, t, dt, &db);
-
-    // update idx
-    idx += NGC+NGV;
+    calc_event_accelerations(dt);
   }
-
-  // update the velocity bounds
-  s->update_bounds();
-
-  // check pairwise constraint violations
-  s->calc_pairwise_distances();
-  double min_dist = s->check_pairwise_constraint_violations(t);
-
-  // find unilateral constraints
-  s->find_unilateral_constraints(s->contact_dist_thresh);
-  if (s->_rigid_constraints.empty())
+  catch (SustainedUnilateralConstraintSolveFailException e)
   {
-    if (LOGGING(LOG_SIMULATOR))
-    {
-      FILE_LOG(LOG_SIMULATOR) << " *** constraints vector is empty " << std::endl;
-
-      // find contact constraints
-      BOOST_FOREACH(const PairwiseDistInfo& pdi, s->_pairwise_distances)
-        FILE_LOG(LOG_SIMULATOR) << " -- signed distance between " << pdi.a->get_single_body()->id << " and " << pdi.b->get_single_body()->id << ": " << pdi.dist << std::endl;
-    }
+    dynamics_time += get_current_time() - start;
+    FILE_LOG(LOG_SIMULATOR) << " -- constraint forces could not be computed at the acceleration level (" << e.what() << "); doing a time stepping step" << std::endl;
+    return do_mini_step(std::min(dt, euler_step));
   }
+  dynamics_time += get_current_time() - start;
 
-  // check velocity violations for constraints
-  s->check_constraint_velocity_violations(t);
+  // save the state at the start of the interval
+  save_state();
 
-  // convert rigid constraints to acceleration constraints
-  for (unsigned i=0; i< s->_rigid_constraints.size(); i++)
-    if (std::fabs(s->_rigid_constraints[i].calc_constraint_vel()) < s->_rigid_constraints[i].sustained_tol)
-      s->_rigid_constraints[i].deriv_type = UnilateralConstraint::eAccel;
-
-  // loop through all bodies, computing forward dynamics
-  BOOST_FOREACH(ControlledBodyPtr db, s->_bodies)
+  // compute the time derivatives of the signed distances for pairs of
+  // geometries that are not in contact
+  _phi_dot.clear();
+  BOOST_FOREACH(const PairwiseDistInfo& pdi, _pairwise_distances)
   {
-    if (db->get_kinematic())
+    // only process if neither of the bodies is compliant
+    RigidBodyPtr rba = dynamic_pointer_cast<RigidBody>(pdi.a->get_single_body());
+    RigidBodyPtr rbb = dynamic_pointer_cast<RigidBody>(pdi.b->get_single_body());
+    if (rba->compliance == RigidBody::eCompliant ||
+        rbb->compliance == RigidBody::eCompliant)
       continue;
 
-    db->calc_fwd_dyn();
+    if (pdi.dist >= contact_dist_thresh)
+      _phi_dot[make_sorted_pair(pdi.a, pdi.b)] = SignedDistDot::calc_signed_dist_dot(pdi, _coldet);
   }
 
-  // compute compliant contact forces
-  s->calc_compliant_unilateral_constraint_forces();
-
-  // compute rigid unilateral constraint forces
-  s->calc_rigid_sustained_unilateral_constraint_forces();
+  // integrate all bodies to the end of the interval
+  integrate_bodies(dt);
 
-  // get super bodies for constraints
-  vector<ControlledBodyPtr> bodies;
-  BOOST_FOREACH(const UnilateralConstraint& e, s->_rigid_constraints)
-    e.get_super_bodies(std::back_inserter(bodies));
-  BOOST_FOREACH(const UnilateralConstraint& e, s->_compliant_constraints)
-    e.get_super_bodies(std::back_inserter(bodies));
-  std::sort(bodies.begin(), bodies.end());
-  bodies.erase(std::unique(bodies.begin(), bodies.end()), bodies.end());
-
-   // recompute forward dynamics for bodies in constraints
-   BOOST_FOREACH(ControlledBodyPtr body, bodies)
-     body->calc_fwd_dyn();
-
-  // report accelerations
-  if (LOGGING(LOG_CONSTRAINT))
+  // localize the earliest contact event
+  double te = dt;
+  BOOST_FOREACH(const PairwiseDistInfo& pdi, _pairwise_distances)
   {
-    FILE_LOG(LOG_CONSTRAINT) << " -- post-contact acceleration (all contacts): " << std::endl;
-    BOOST_FOREACH(const UnilateralConstraint& e, s->_rigid_constraints)
-      FILE_LOG(LOG_CONSTRAINT) << e;
-  }
+    map<sorted_pair<CollisionGeometryPtr>, double>::const_iterator phi_dot_iter = _phi_dot.find(make_sorted_pair(pdi.a, pdi.b));
+    if (phi_dot_iter == _phi_dot.end())
+      continue;
+    const double phi_dot = phi_dot_iter->second;
 
-  // debugging code for checking numerical acceleration 
-  #ifndef NDEBUG
-  static double last_t = -1.0;
-  static std::vector<double> last_vels; 
-  std::vector<double> this_vels(s->_rigid_constraints.size());
-  for (unsigned i=0; i< s->_rigid_constraints.size(); i++)
-    this_vels[i] = s->_rigid_constraints[i].calc_constraint_vel();
-  if (last_vels.size() == this_vels.size())
-  {
-    double h = t - last_t;
-    for (unsigned i=0; i< this_vels.size(); i++)
+    // get the signed distance at the current bound on the event time
+    double phi = calc_signed_dist(pdi, te);
+    double t_hi = te;
+    if (phi >= contact_dist_thresh)
     {
-      FILE_LOG(LOG_CONSTRAINT) << "Velocity at " << last_t << ": " << last_vels[i] << std::endl;
-      FILE_LOG(LOG_CONSTRAINT) << "Velocity at " << t << ": " << this_vels[i] << std::endl;
-      FILE_LOG(LOG_CONSTRAINT) << "Numerically computed acceleration: " << (this_vels[i] - last_vels[i])/h << std::endl;
+      // look for an event that is missed by checking only the end of the
+      // interval, using the linear prediction of the time of contact
+      if (phi_dot >= 0.0)
+        continue;
+      t_hi = (0.5*contact_dist_thresh - pdi.dist)/phi_dot;
+      if (t_hi >= te)
+        continue;
+      phi = calc_signed_dist(pdi, t_hi);
+      if (phi >= contact_dist_thresh)
+        continue;
     }
-  }
-  last_t = t;
-  last_vels = this_vels;
-  #endif
 
-  // reset idx
-  idx = 0;
+    // find the time of the event
+    te = std::min(te, find_event_time(pdi, phi_dot, t_hi, phi));
+    FILE_LOG(LOG_SIMULATOR) << " -- event between " << pdi.a->get_single_body()->body_id << " and " << pdi.b->get_single_body()->body_id << " localized; next event time: " << te << std::endl;
+  }
 
-  // loop through all bodies, computing the ODE
-  BOOST_FOREACH(ControlledBodyPtr db, s->_bodies)
+  // verify that geometries in contact do not interpenetrate over the interval
+  BOOST_FOREACH(const PairwiseDistInfo& pdi, _pairwise_distances)
   {
-    if (db->get_kinematic())
+    if (pdi.dist >= contact_dist_thresh)
       continue;
 
-    // get the number of generalized coordinates and velocities
-    const unsigned NGC = db->num_generalized_coordinates(DynamicBodyd::eEuler);
-    const unsigned NGV = db->num_generalized_coordinates(DynamicBodyd::eSpatial);
-
-    // get dx for the body
-    SharedVectorNd dxsub = dx.segment(idx, idx+NGC+NGV);
-
-    // compute the ODE
-    db->ode(t, dt, &db, dxsub);
-
-    FILE_LOG(LOG_SIMULATOR) << " ODE evaluation for body " << db->id << ": " << dxsub << std::endl;
+    // only process if neither of the bodies is compliant
+    RigidBodyPtr rba = dynamic_pointer_cast<RigidBody>(pdi.a->get_single_body());
+    RigidBodyPtr rbb = dynamic_pointer_cast<RigidBody>(pdi.b->get_single_body());
+    if (rba->compliance == RigidBody::eCompliant ||
+        rbb->compliance == RigidBody::eCompliant)
+      continue;
 
-    // update idx
-    idx += NGC+NGV;
+    const double MIN_DIST = std::min(pdi.dist, 0.0) - contact_dist_thresh;
+    while (te > euler_step && calc_signed_dist(pdi, te) < MIN_DIST)
+      te *= 0.5;
   }
 
-  FILE_LOG(LOG_SIMULATOR) << "EventDrivenSimulator::ode_sustained_constraints(t=" << t << ") exited" << std::endl;
+  // always make some progress
+  te = std::max(te, min_step_size);
 
-  // return the ODE
-  return dx;
-}
+  FILE_LOG(LOG_SIMULATOR) << " -- integrating to event time: " << te << std::endl;
 
-/// Steps the simulator forward by the given step size
-double EventDrivenSimulator::step(double step_size)
-{
-  const double INF = std::numeric_limits<double>::max();
-
-  // determine the set of collision geometries
-  determine_geometries();
-
-  // clear one-step visualization data
-  #ifdef USE_OSG
-  _transient_vdata->removeChildren(0, _transient_vdata->getNumChildren());
-  #endif
+  // integrate all bodies to the event time
+  integrate_bodies(te);
 
-  // setup the time stepped
-  double h = 0.0;
+  // the compliant and sustained constraint forces were applied until the
+  // event time
+  record_step_contacts(_compliant_constraints, te);
+  record_step_contacts(_sustained_constraints, te);
 
-  // step until the requisite time has elapsed
-  while (h < step_size)
+  // dissipate some energy
+  if (_dissipator)
   {
-    // clear stored derivatives
-    _current_dx.resize(0);
-
-    FILE_LOG(LOG_SIMULATOR) << "+stepping simulation from time: " << this->current_time << " by " << (step_size - h) << std::endl;
-    if (LOGGING(LOG_SIMULATOR))
-    {
-      VectorNd q, qd;
-      BOOST_FOREACH(ControlledBodyPtr db, _bodies)
-      {
-        db->get_generalized_coordinates(DynamicBodyd::eEuler, q);
-        db->get_generalized_velocity(DynamicBodyd::eSpatial, qd);
-        FILE_LOG(LOG_SIMULATOR) << " body " << db->id << " Euler coordinates (before): " << q << std::endl;
-        FILE_LOG(LOG_SIMULATOR) << " body " << db->id << " spatial velocity (before): " << qd << std::endl;
-      }
-    }
-
-    // start with initial estimates
-    reset_limit_estimates();
-
-    // get amount remaining to step
-    double dt = step_size - h;
-
-    // do broad phase collision detection (must be done before any Euler steps)
-    broad_phase(dt);
-
-    // compute pairwise distances at the current configuration
-    calc_pairwise_distances();
-
-    // if dt is sufficiently small, do Euler step
-    if (dt <= euler_step)
-    {
-      FILE_LOG(LOG_SIMULATOR) << "  - step size really small; doing semi-implicit step" << std::endl;
+    vector<shared_ptr<DynamicBodyd> > bodies;
+    BOOST_FOREACH(ControlledBodyPtr cb, _bodies)
+      bodies.push_back(dynamic_pointer_cast<DynamicBodyd>(cb));
+    _dissipator->apply(bodies, te);
+  }
 
-      // do the Euler step
-      step_si_Euler(dt);
-      h += dt;
+  // update the time
+  current_time += te;
 
-       // call the mini-callback
-      if (post_mini_step_callback_fn)
-        post_mini_step_callback_fn(this);
+  // call the mini-callback
+  if (post_mini_step_callback_fn)
+    post_mini_step_callback_fn(this);
 
-      // break out of the while loop (could just call continue)
-      break;
-    }
-
-    // update constraint violations
-    update_constraint_violations(_pairwise_distances);
+  FILE_LOG(LOG_SIMULATOR) << "EventDrivenSimulator::do_event_step() exited" << std::endl;
 
-    // if there are any impacts at the current time, handle them
-    FILE_LOG(LOG_SIMULATOR) << "  - preparing to handle any impacts at the current time" << std::endl;
-    find_unilateral_constraints(contact_dist_thresh);
-    calc_impacting_unilateral_constraint_forces(-1.0);
+  return te;
+}
 
-restart_with_new_limits:
+/// Computes the bodies' accelerations at the start of an event step
+/**
+ * Contacts and joint limits that are neither separating nor approaching
+ * (i.e., those with normal speeds no greater than sustained_contact_vel_tol)
+ * are handled by the SustainedUnilateralConstraintHandler; contacts with
+ * tangential speeds above that tolerance are treated as sliding.
+ * \throws SustainedUnilateralConstraintSolveFailException if some constraint
+ *         cannot be handled at the acceleration level (an approaching
+ *         constraint that the impact solve did not resolve, a limit on a
+ *         body that is not a reduced-coordinate articulated body, or a
+ *         sustained constraint in a simulation with implicit joints) or the
+ *         sustained constraint forces cannot be computed
+ */
+void EventDrivenSimulator::calc_event_accelerations(double dt)
+{
+  // determine the sustained constraints
+  _sustained_constraints.clear();
+  for (unsigned i=0; i< _rigid_constraints.size(); i++)
+  {
+    const UnilateralConstraint& e = _rigid_constraints[i];
 
-    // mark velocity estimates as valid
-    validate_limit_estimates();
+    // separating constraints are ignored
+    double vn = e.calc_constraint_vel();
+    if (vn > sustained_contact_vel_tol)
+      continue;
 
-    // determine the maximum step according to conservative advancement
-    double safe_dt = std::min(calc_CA_step(), dt);
-    FILE_LOG(LOG_SIMULATOR) << "  - conservative advancement step: " << safe_dt << std::endl;
+    // approaching constraints should have been resolved by the impact solve
+    if (vn < -sustained_contact_vel_tol)
+      throw SustainedUnilateralConstraintSolveFailException("approaching constraints cannot be handled by EventDrivenSimulator");
 
-    // get next possible constraint time
-    double next_event_time = calc_next_CA_step(contact_dist_thresh);
-    FILE_LOG(LOG_SIMULATOR) << "  - *next* conservative advancement step: " << next_event_time << std::endl;
+    _sustained_constraints.push_back(e);
+  }
 
-    // we know that the current time is safe, so if the conservative
-    // advancement step is zero, set it to the next event time
-    if (safe_dt == 0.0)
-      safe_dt = std::min(dt, next_event_time);
+  // the sustained constraint handler does not account for implicit joints
+  // or coupling constraints
+  if (!_sustained_constraints.empty() && (!implicit_joints.empty() || !coupling_constraints.empty()))
+    throw SustainedUnilateralConstraintSolveFailException("sustained constraints cannot be handled by EventDrivenSimulator with implicit joints or coupling constraints");
 
-    // if (the distance between bodies is small [next_event_time will be
-    // < INF if there is an event at the current time] and the next time of
-    // contact is greater than an Euler step) or (safe_dt is greater than the
-    // Euler step), we can *try* generic integration
-    if ((next_event_time < INF && next_event_time > euler_step) ||
-        safe_dt > euler_step)
-    {
-      // try the integration
-      IntegrationResult istat = integrate_generic(safe_dt);
-
-      // if limits were exceeded during integration, compute the conservative
-      // advancement step and redo
-      if (istat == eVelocityLimitExceeded)
-        goto restart_with_new_limits;
-      else if (istat == eMinStepReached)
-      {
-        // do Euler step; if we're here, we know euler_step < dt
-        step_si_Euler(euler_step);
-        h += euler_step;
+  // prepare to calculate forward dynamics
+  precalc_fwd_dyn();
 
-      }
-      else
-      {
-        assert(istat == eIntegrationSuccessful);
-        h += safe_dt;
-      }
-    }
-    else
-    {
-      // do Euler step
-      step_si_Euler(dt);
-      h += dt;
-    }
+  // apply compliant unilateral constraint forces
+  calc_compliant_unilateral_constraint_forces();
 
-    // call the mini-callback
-    if (post_mini_step_callback_fn)
-      post_mini_step_callback_fn(this);
-  }
+  // compute forward dynamics
+  calc_fwd_dyn(dt);
 
-  // call the callback
-  if (post_step_callback_fn)
-    post_step_callback_fn(this);
+  // compute sustained constraint forces (this also discards warm starting
+  // data for contacts that are no longer sustained)
+  _sustained_constraint_handler.process_constraints(_sustained_constraints, sustained_contact_vel_tol);
 
-  return step_size;
+  // recompute forward dynamics
+  if (!_sustained_constraints.empty())
+    calc_fwd_dyn(dt);
 }
 
-/// Finds the next event time
-/**
- * This method assumes an event is occurring at the current time. If an event
- * is not occuring at the current time, this method will return INF.
- * \note proper operation of this function is critical. If the function
- *       improperly designates an event as not occuring at the current time,
- *       calc_next_CA_step(.) will return a small value and prevent large
- *       integration steps from being taken. If the function improperly
- *       designates an event as occuring at the current time, constraint
- *       violation could occur.
- */
-double EventDrivenSimulator::calc_next_CA_step(double contact_dist_thresh) const
+/// Saves the state and accelerations of all bodies at the start of an event step
+void EventDrivenSimulator::save_state()
 {
-  const double INF = std::numeric_limits<double>::max();
-  bool found_one = false;
-  double next_event_time = INF;
+  _q0.resize(_bodies.size());
+  _qd0_euler.resize(_bodies.size());
+  _qd0.resize(_bodies.size());
+  _qdd0.resize(_bodies.size());
+  _body_index.clear();
 
-  // process each articulated body, looking for next joint events
   for (unsigned i=0; i< _bodies.size(); i++)
   {
-    // see whether the i'th body is articulated
-    ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(_bodies[i]);
-    if (!ab)
-      continue;
-
-    // if the body is kinematically controlled, do nothing
-    if (ab->get_kinematic())
-      continue;
-
-    // TODO: we need to modify this so we can see whether any joint limit
-    // events are active. We should be able to remove
-    // find_next_joint_limit_time(.) and add a CA step for each joint
-
-    // get limit events in [t, t+dt] (if any)
-    next_event_time = std::min(next_event_time, ab->find_next_joint_limit_time());
-  }
-
-  // if the distance between any pair of bodies is sufficiently small
-  // get next possible event time
-  BOOST_FOREACH(const PairwiseDistInfo& pdi, _pairwise_distances)
-  {
-    // only process if neither of the bodies is compliant
-    RigidBodyPtr rba = dynamic_pointer_cast<RigidBody>(pdi.a->get_single_body());
-    RigidBodyPtr rbb = dynamic_pointer_cast<RigidBody>(pdi.b->get_single_body());
-    if (rba->compliance == RigidBody::eCompliant || 
-        rbb->compliance == RigidBody::eCompliant)
-      continue; 
-
-    // if the distance is below the threshold, we have found a current event
-    if (pdi.dist < contact_dist_thresh)
-      found_one = true;
-    else
-      // not a current event, find when it could become active
-      next_event_time = std::min(next_event_time, _coldet->calc_CA_step(pdi));
+    shared_ptr<DynamicBodyd> db = dynamic_pointer_cast<DynamicBodyd>(_bodies[i]);
+    db->get_generalized_coordinates_euler(_q0[i]);
+    db->get_generalized_velocity(DynamicBodyd::eEuler, _qd0_euler[i]);
+    db->get_generalized_velocity(DynamicBodyd::eSpatial, _qd0[i]);
+    db->get_generalized_acceleration(_qdd0[i]);
+    _body_index[db] = i;
   }
-
-  if (!found_one)
-    return INF;
-  else
-    return next_event_time;
 }
 
-/// Attempts to do "generic" integration (i.e., trying not to pay attention to state violations)
+/// Sets the state of the i'th body to that at time t into the event step
 /**
- * \param dt the time step to attempt to integrate, on output the step taken
+ * Positions are integrated using the velocities at the start of the step
+ * and velocities using the (constant) accelerations, as in
+ * TimeSteppingSimulator::do_mini_step().
  */
-EventDrivenSimulator::IntegrationResult EventDrivenSimulator::integrate_generic(double& dt)
+void EventDrivenSimulator::integrate_body(unsigned i, double t)
 {
-  do
-  {
-    // save the state of the system
-    save_state();
+  VectorNd q, qd;
 
-    try
-    {
-      // do "smart" integration (watching for state violation)
-      integrate_with_sustained_constraints(dt);
-
-      FILE_LOG(LOG_SIMULATOR) << "Integration with sustained constraints successful" << std::endl;
-
-      // check whether velocity estimates have been exceeded
-      BOOST_FOREACH(ControlledBodyPtr db, _bodies)
-      {
-        if (db->limit_estimates_exceeded())
-        {
-          FILE_LOG(LOG_SIMULATOR) << " ** limit estimates exceeded for body " << db->id << "; retrying with new estimates" << std::endl;
+  shared_ptr<DynamicBodyd> db = dynamic_pointer_cast<DynamicBodyd>(_bodies[i]);
 
-          // reset the state of all bodies
-          restore_state();
-
-          return eVelocityLimitExceeded;
-        }
-      }
-
-      // update the time
-      current_time += dt;
-
-      return eIntegrationSuccessful;
-    }
-    catch (InvalidStateException e)
-    {
-      FILE_LOG(LOG_SIMULATOR) << " ** attempted to evaluate derivative at invalid state; halving acceleration step size to " << (dt*0.5) << std::endl;
-    }
-    catch (InvalidVelocityException e)
-    {
-      FILE_LOG(LOG_SIMULATOR) << " ** attempted to evaluate derivative at invalid velocity; halfing acceleration step size to " << (dt*0.5) << std::endl;
-    }
-    catch (SustainedUnilateralConstraintSolveFailException e)
-    {
-      FILE_LOG(LOG_SIMULATOR) << " ** failed to solve an LCP; halving step size" << std::endl;
-    }
-
-    // ********************************************************
-    // if we're still here, we caught an exception
-    // ********************************************************
-
-    // restore the state of the system (generalized coords/velocities)
-    restore_state();
-
-    // half the step size
-    dt *= 0.5;
-  }
-  while (dt > euler_step);
+  // integrate the position
+  q = _qd0_euler[i];
+  q *= t;
+  q += _q0[i];
+  db->set_generalized_coordinates_euler(q);
 
-  // if we're still here, step size has become too small
-  return eMinStepReached;
+  // integrate the velocity
+  qd = _qdd0[i];
+  qd *= t;
+  qd += _qd0[i];
+  db->set_generalized_velocity(DynamicBodyd::eSpatial, qd);
 }
 
-/// Validates limit estimates
-void EventDrivenSimulator::validate_limit_estimates()
-{
-  BOOST_FOREACH(ControlledBodyPtr body, _bodies)
-    body->validate_limit_estimates();
-}
-
-/// Saves the state of the system (all dynamic bodies) at the current time
-void EventDrivenSimulator::save_state()
+/// Sets the states of all bodies to those at time t into the event step
+/**
+ * Bodies are independent between events, so they are integrated
+ * concurrently.
+ */
+void EventDrivenSimulator::integrate_bodies(double t)
 {
-  // resize the vector if necessary
-  _qsave.resize(_bodies.size());
-  _qdsave.resize(_bodies.size());
+  const int N = (int) _bodies.size();
 
-  for (unsigned i=0; i< _bodies.size(); i++)
+  // worker threads do not inherit the subsystem current in this thread
+  const MemoryAccounting::Subsystem MEM_SUBSYSTEM = MemoryAccounting::get_current();
+  #ifdef _OPENMP
+  #pragma omp parallel for
+  #endif
+  for (int i=0; i< N; i++)
   {
-    _bodies[i]->get_generalized_coordinates(DynamicBodyd::eEuler, _qsave[i]);
-    _bodies[i]->get_generalized_velocity(DynamicBodyd::eSpatial, _qdsave[i]);
+    MemoryAccounting::Scope mem_scope(MEM_SUBSYSTEM);
+    integrate_body((unsigned) i, t);
   }
 }
 
-/// Restores the state of the 'system' (all dynamic bodies)
-void EventDrivenSimulator::restore_state()
+/// Sets the states of the bodies of a pair of geometries to those at time t into the event step
+void EventDrivenSimulator::integrate_pair(const PairwiseDistInfo& pdi, double t)
 {
-  for (unsigned i=0; i< _bodies.size(); i++)
-  {
-    _bodies[i]->set_generalized_coordinates(DynamicBodyd::eEuler, _qsave[i]);
-    _bodies[i]->set_generalized_velocity(DynamicBodyd::eSpatial, _qdsave[i]);
-  }
+  // get the two super bodies
+  shared_ptr<DynamicBodyd> sup1 = ImpactConstraintHandler::get_super_body(pdi.a->get_single_body());
+  shared_ptr<DynamicBodyd> sup2 = ImpactConstraintHandler::get_super_body(pdi.b->get_single_body());
+
+  // integrate them
+  map<shared_ptr<DynamicBodyd>, unsigned>::const_iterator iter;
+  if ((iter = _body_index.find(sup1)) != _body_index.end())
+    integrate_body(iter->second, t);
+  if (sup1 != sup2 && (iter = _body_index.find(sup2)) != _body_index.end())
+    integrate_body(iter->second, t);
 }
 
-/// Checks whether bodies violate contact constraint velocity tolerances
-void EventDrivenSimulator::check_constraint_velocity_violations(double t)
+/// Computes the signed distance between a pair of geometries at time t into the event step
+double EventDrivenSimulator::calc_signed_dist(const PairwiseDistInfo& pdi, double t)
 {
-  FILE_LOG(LOG_SIMULATOR) << "EventDrivenSimulator::check_constraint_velocity_violations() entered" << std::endl;
-
-  // loop over all constraints
-  for (unsigned i=0; i< _rigid_constraints.size(); i++)
-  {
-    // get the constraint velocity
-    double ev = _rigid_constraints[i].calc_constraint_vel();
+  Point3d pa, pb;
 
-    // look for the constraint in the mapping
-    std::map<UnilateralConstraint, double, UnilateralConstraintCmp>::const_iterator zv_tol = _zero_velocity_tolerances.find(_rigid_constraints[i]);
-    if (zv_tol == _zero_velocity_tolerances.end())
-    {
-      _zero_velocity_tolerances[_rigid_constraints[i]] = NEAR_ZERO;
-      zv_tol = _zero_velocity_tolerances.find(_rigid_constraints[i]);
-    }
-
-    FILE_LOG(LOG_SIMULATOR) << " -- constraint velocity: " << ev << std::endl;
-
-    // check whether it is larger than allowed
-    if (ev < -zv_tol->second - NEAR_ZERO)
-    {
-      FILE_LOG(LOG_SIMULATOR) << "EventDrivenSimulator::check_constraint_velocity_violations() about to throw exception..." << std::endl;
-      throw InvalidVelocityException(t);
-    }
-  }
-
-  FILE_LOG(LOG_SIMULATOR) << "EventDrivenSimulator::check_constraint_velocity_violations() exiting" << std::endl;
+  integrate_pair(pdi, t);
+  return _coldet->calc_signed_dist(pdi.a, pdi.b, pa, pb);
 }
 
-/// Checks whether bodies violate interpenetration constraints
-double EventDrivenSimulator::check_pairwise_constraint_violations(double t)
+/// Localizes the time at which two geometries come into contact
+/**
+ * The signed distance must be no smaller than the contact distance threshold
+ * at the start of the interval and smaller than the threshold at t_hi.
+ * Roots of phi(t) - contact_dist_thresh/2 are found using regula falsi
+ * (Illinois variant), with a Newton step from the start of the interval as
+ * the first iterate; the iteration stops once the signed distance lies in
+ * [0, contact_dist_thresh).
+ * \param pdi the pair of geometries and their signed distance at the start
+ *        of the interval
+ * \param phi_dot the time derivative of the signed distance at the start of
+ *        the interval
+ * \param t_hi the upper end of the bracket
+ * \param phi_hi the signed distance at t_hi
+ * \return the time of contact
+ */
+double EventDrivenSimulator::find_event_time(const PairwiseDistInfo& pdi, double phi_dot, double t_hi, double phi_hi)
 {
-  double min_dist = std::numeric_limits<double>::max();
+  const double TARGET = 0.5*contact_dist_thresh;
 
-  // update constraint violation due to increasing interpenetration
-  // loop over all pairs of geometries
-  for (unsigned i=0; i< _pairwise_distances.size(); i++)
-  {
-    // get the two collision geometries
-    CollisionGeometryPtr cg1 = _pairwise_distances[i].a;
-    CollisionGeometryPtr cg2 = _pairwise_distances[i].b;
-
-    // get the two rigid bodies
-    RigidBodyPtr rb1 = dynamic_pointer_cast<RigidBody>(cg1->get_single_body());
-    RigidBodyPtr rb2 = dynamic_pointer_cast<RigidBody>(cg2->get_single_body());
-
-    // only process if neither of the bodies is compliant
-    if (rb1->compliance == RigidBody::eCompliant || 
-        rb2->compliance == RigidBody::eCompliant)
-      continue; 
+  // setup the bracket
+  double t_lo = 0.0;
+  double g_lo = pdi.dist - TARGET;
+  double g_hi = phi_hi - TARGET;
+  if (std::fabs(g_hi) <= TARGET)
+    return t_hi;
 
-    // compute the distance between the two bodies
-    Point3d p1, p2;
-    double d = _coldet->calc_signed_dist(cg1, cg2, p1, p2);
+  // the first iterate is a Newton step from the start of the interval
+  double t = (phi_dot < 0.0) ? -g_lo/phi_dot : (t_lo*g_hi - t_hi*g_lo)/(g_hi - g_lo);
 
-    if (d <= _ip_tolerances[make_sorted_pair(cg1, cg2)] - NEAR_ZERO)
+  // iterate
+  int last_side = 0;
+  for (unsigned i=0; i< max_event_iterations; i++)
+  {
+    // keep the iterate strictly within the bracket
+    if (!(t > t_lo && t < t_hi))
+      t = 0.5*(t_lo + t_hi);
+
+    // evaluate the function
+    double g = calc_signed_dist(pdi, t) - TARGET;
+    FILE_LOG(LOG_SIMULATOR) << "    signed distance at " << t << ": " << (g + TARGET) << std::endl;
+    if (std::fabs(g) <= TARGET)
+      return t;
+
+    // update the bracket; the function value at an endpoint that is retained
+    // twice in a row is halved
+    if (g > 0.0)
     {
-      FILE_LOG(LOG_SIMULATOR) << "Interpenetration detected between " << cg1->get_single_body()->id << " and " << cg2->get_single_body()->id << ": " << d << std::endl;
-      throw InvalidStateException();
+      t_lo = t;
+      g_lo = g;
+      if (last_side > 0)
+        g_hi *= 0.5;
+      last_side = 1;
     }
+    else
+    {
+      t_hi = t;
+      g_hi = g;
+      if (last_side < 0)
+        g_lo *= 0.5;
+      last_side = -1;
+    }
+
+    // stop if the bracket has become too small
+    if (t_hi - t_lo < min_step_size)
+      break;
 
-    // update the minimum distance
-    min_dist = std::min(d, min_dist);
+    // get the next iterate
+    t = (t_lo*g_hi - t_hi*g_lo)/(g_hi - g_lo);
   }
 
-  return std::max(0.0, min_dist);
+  // the event could not be localized to the distance tolerance; use the
+  // last time at which the geometries are known to be separated, unless no
+  // progress would be made
+  return (t_lo > 0.0) ? t_lo : t_hi;
 }
 
-/// Computes a conservative advancement step
-double EventDrivenSimulator::calc_CA_step()
+/// Computes the time until a joint reaches a limit (assuming constant velocity)
+double EventDrivenSimulator::calc_next_limit_time() const
 {
-  // setup safe amount to step
-  double dt = std::numeric_limits<double>::max();
+  double next_event_time = std::numeric_limits<double>::max();
 
-  // do joint limit CA step first (it's faster)
-  BOOST_FOREACH(ControlledBodyPtr db, _bodies)
+  // process each articulated body, looking for next joint events
+  for (unsigned i=0; i< _bodies.size(); i++)
   {
-    // try to get it as an articulated body
-    ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(db);
+    // see whether the i'th body is articulated
+    ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(_bodies[i]);
     if (!ab)
       continue;
 
-    // compute best dt
-    dt = std::min(dt, ab->calc_CA_time_for_joints());
-    if (dt <= 0.0)
-      return dt;
-  }
-
-  // do narrow-phase collision detection here
-  BOOST_FOREACH(const PairwiseDistInfo& pdi, _pairwise_distances)
-  {
-    // only process if neither of the bodies is compliant
-    RigidBodyPtr rba = dynamic_pointer_cast<RigidBody>(pdi.a->get_single_body());
-    RigidBodyPtr rbb = dynamic_pointer_cast<RigidBody>(pdi.b->get_single_body());
-    if (rba->compliance == RigidBody::eCompliant || 
-        rbb->compliance == RigidBody::eCompliant)
-      continue; 
-
-    // if the distance between the two is zero, two are in contact already
-    if (pdi.dist < contact_dist_thresh)
-      return 0.0;
-
-    // call conservative advancement method
-    double step = _coldet->calc_CA_step(pdi);
-    dt = std::min(dt, step);
-    if (dt <= 0.0)
-      return dt;
+    // get limit events (if any)
+    const vector<shared_ptr<Jointd> >& joints = ab->get_joints();
+    for (unsigned j=0; j< joints.size(); j++)
+    {
+      JointPtr joint = dynamic_pointer_cast<Joint>(joints[j]);
+      for (unsigned k=0; k< joint->num_dof(); k++)
+      {
+        if (joint->q[k] < joint->hilimit[k] && joint->qd[k] > 0.0)
+          next_event_time = std::min(next_event_time, (joint->hilimit[k] - joint->q[k])/joint->qd[k]);
+        if (joint->q[k] > joint->lolimit[k] && joint->qd[k] < 0.0)
+          next_event_time = std::min(next_event_time, (joint->lolimit[k] - joint->q[k])/joint->qd[k]);
+      }
+    }
   }
 
-  return dt;
-}
-
-void EventDrivenSimulator::reset_limit_estimates() const
-{
-  // now compute the bounds
-  BOOST_FOREACH(ControlledBodyPtr db, _bodies)
-  {
-    // first, reset the limit estimates
-    db->reset_limit_estimates();
-  }
+  return next_event_time;
 }
 
 /// Implements Base::load_from_xml()
 void EventDrivenSimulator::load_from_xml(shared_ptr<const XMLTree> node, map<std::string, BasePtr>& id_map)
 {
-  list<shared_ptr<const XMLTree> > child_nodes;
-  map<std::string, BasePtr>::const_iterator id_iter;
-
   // verify node name b/c this is not abstract class
   assert(strcasecmp(node->name.c_str(), "EventDrivenSimulator") == 0);
 
   // first, load all data specified to the parent object
   TimeSteppingSimulator::load_from_xml(node, id_map);
- 
+
   // read the maximum Euler step
   XMLAttrib* Euler_step_attrib = node->get_attrib("Euler-step");
   if (Euler_step_attrib)
     euler_step = Euler_step_attrib->get_real_value();
+
+  // read the maximum number of root finding iterations
+  XMLAttrib* max_iter_attrib = node->get_attrib("max-event-iterations");
+  if (max_iter_attrib)
+    max_event_iterations = max_iter_attrib->get_unsigned_value();
 }
 
 /// Implements Base::save_to_xml()
@@ -749,8 +532,8 @@ void EventDrivenSimulator::save_to_xml(XMLTreePtr node, list<shared_ptr<const Ba
   // reset the node's name
   node->name = "EventDrivenSimulator";
 
-  // save the maximum Euler step
+  // save the maximum Euler step and number of root finding iterations
   node->attribs.insert(XMLAttrib("Euler-step", euler_step));
+  node->attribs.insert(XMLAttrib("max-event-iterations", max_event_iterations));
 }
 
-
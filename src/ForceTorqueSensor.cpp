@@ -0,0 +1,61 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#include <Moby/XMLTree.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/ConstraintSimulator.h>
+#include <Moby/ForceTorqueSensor.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using std::list;
+using std::vector;
+using boost::shared_ptr;
+
+/// Constructs a force/torque sensor
+ForceTorqueSensor::ForceTorqueSensor()
+{
+  _wrench.set_zero(_F);
+}
+
+/// Measures the net contact wrench on the body, averaged over the last step
+void ForceTorqueSensor::update(ConstraintSimulator* sim, double dt)
+{
+  // sum the contact impulses on the body over the step (in the global frame)
+  SForced w;
+  w.set_zero(GLOBAL);
+  if (_body && dt > 0.0)
+  {
+    const vector<UnilateralConstraint>& constraints = sim->get_step_contacts();
+    for (unsigned i=0; i< constraints.size(); i++)
+    {
+      const UnilateralConstraint& c = constraints[i];
+      if (c.constraint_type != UnilateralConstraint::eContact)
+        continue;
+
+      // the impulse is applied to the first body; its reverse to the second
+      if (c.contact_geom1->get_single_body() == _body)
+        w += SForced(c.contact_impulse);
+      else if (c.contact_geom2->get_single_body() == _body)
+        w -= SForced(c.contact_impulse);
+    }
+    w *= 1.0/dt;
+  }
+
+  // express the wrench in the sensor frame
+  _wrench = Pose3d::transform(_F, w);
+}
+
+/// Implements Base::save_to_xml()
+void ForceTorqueSensor::save_to_xml(XMLTreePtr node, list<shared_ptr<const Base> >& shared_objects) const
+{
+  // save the parent data
+  Sensor::save_to_xml(node, shared_objects);
+
+  // (re)set the name of this node
+  node->name = "ForceTorqueSensor";
+}
+
@@ -6,6 +6,7 @@
 #include <Moby/CompGeom.h>
 #include <Moby/TessellatedPolyhedron.h>
 #include <Moby/XMLTree.h>
+#include <Moby/MemoryAccounting.h>
 #include <Moby/GaussianMixture.h>
 #include <Moby/CollisionGeometry.h>
 #include <Moby/OBB.h>
@@ -147,6 +148,7 @@ GaussianMixture::Gauss GaussianMixture::read_gauss_node(shared_ptr<const XMLTree
 /// Gets the BVH root
 BVPtr GaussianMixture::get_BVH_root(CollisionGeometryPtr geom)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
   // verify that the geometry matches the stored geometry, if any
   if (_geom)
     assert(geom == _geom);
@@ -68,6 +68,38 @@ void GravityForce::add_force(shared_ptr<DynamicBodyd> body)
   }
 }
 
+/// Adds gravity to a number of bodies
+/**
+ * The rigid bodies and links of articulated bodies are determined (and the
+ * frames in which gravity is applied are allocated) only when the set of
+ * bodies changes.
+ */
+void GravityForce::add_forces(const std::vector<shared_ptr<DynamicBodyd> >& bodies)
+{
+  // resolve the links, if necessary
+  if (update_batch(bodies))
+  {
+    get_links(bodies, _links, _owners);
+    _poses.resize(_links.size());
+    for (unsigned i=0; i< _poses.size(); i++)
+      _poses[i] = shared_ptr<Pose3d>(new Pose3d);
+  }
+
+  FILE_LOG(LOG_DYNAMICS) << "Adding gravitational force to " << _links.size() << " links" << std::endl;
+
+  // apply gravity force to all links
+  for (unsigned i=0; i< _links.size(); i++)
+  {
+    Pose3d& P = *_poses[i];
+    P = *_links[i]->get_pose();
+    P.update_relative_pose(GLOBAL);
+    P.q.set_identity();
+    SForced w(boost::const_pointer_cast<const Pose3d>(_poses[i]));
+    w.set_force(gravity * _links[i]->get_mass());
+    _links[i]->add_force(w);
+  }
+}
+
 /// Implements Base::load_from_xml()
 void GravityForce::load_from_xml(shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map)
 {
@@ -12,6 +12,7 @@
 #include <osg/Material>
 #include <osg/LightModel>
 #endif
+#include <cmath>
 #include <boost/algorithm/minmax_element.hpp>
 #include <Moby/Constants.h>
 #include <Moby/CompGeom.h>
@@ -20,6 +21,7 @@
 #include <Moby/BoundingSphere.h>
 #include <Moby/CollisionGeometry.h>
 #include <Moby/SpherePrimitive.h>
+#include <Moby/MemoryAccounting.h>
 #include <Moby/HeightmapPrimitive.h>
 
 using namespace Ravelin;
@@ -37,12 +39,56 @@ using std::make_pair;
 HeightmapPrimitive::HeightmapPrimitive()
 {
   _width = _depth = 0.0;
+  _max_slope = 0.0;
 }
 
 /// Initializes the heightmap primitive
 HeightmapPrimitive::HeightmapPrimitive(const Ravelin::Pose3d& T) : Primitive(T)
 {
   _width = _depth = 0.0;
+  _max_slope = 0.0;
+}
+
+/// Sets the heights of the heightmap
+/**
+ * \param heights the heights at the grid points; rows are spaced uniformly
+ *        over the width (along x) and columns over the depth (along z)
+ * \param width the extent of the heightmap along x (centered at the origin)
+ * \param depth the extent of the heightmap along z (centered at the origin)
+ */
+void HeightmapPrimitive::set_heights(const MatrixNd& heights, double width, double depth)
+{
+  _heights = heights;
+  _width = width;
+  _depth = depth;
+
+  // the bounding volumes must be recomputed
+  _obbs.clear();
+
+  // compute the slope
+  calc_max_slope();
+}
+
+/// Computes an upper bound on the magnitude of the heightmap's gradient from the largest slopes along each axis
+void HeightmapPrimitive::calc_max_slope()
+{
+  _max_slope = 0.0;
+  if (_heights.rows() < 2 || _heights.columns() < 2)
+    return;
+
+  const double DX = _width/(_heights.rows()-1);
+  const double DZ = _depth/(_heights.columns()-1);
+  double sx = 0.0, sz = 0.0;
+  for (unsigned i=0; i< _heights.rows(); i++)
+    for (unsigned j=0; j< _heights.columns(); j++)
+    {
+      if (i+1 < _heights.rows())
+        sx = std::max(sx, std::fabs(_heights(i+1,j) - _heights(i,j))/DX);
+      if (j+1 < _heights.columns())
+        sz = std::max(sz, std::fabs(_heights(i,j+1) - _heights(i,j))/DZ);
+    }
+
+  _max_slope = std::sqrt(sx*sx + sz*sz);
 }
 
 /// Gets the supporting point
@@ -64,6 +110,7 @@ double HeightmapPrimitive::calc_signed_dist(const Point3d& p) const
 /// Gets the BVH root for the heightmap
 BVPtr HeightmapPrimitive::get_BVH_root(CollisionGeometryPtr geom)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
   const unsigned X = 0, Y = 1, Z = 2;
 
   // get the pointer to the geometry
@@ -525,6 +572,9 @@ void HeightmapPrimitive::load_from_xml(shared_ptr<const XMLTree> node, std::map<
   XMLAttrib* depth_attr = node->get_attrib("depth");
   if (depth_attr)
     _depth = depth_attr->get_unsigned_value();
+
+  // compute the slope
+  calc_max_slope();
 }
 
 /// Implements Base::save_to_xml() for serialization
@@ -24,7 +24,9 @@
 #include <Moby/NumericalException.h>
 #include <Moby/ImpactConstraintHandler.h>
 #include <Moby/ConstraintSimulator.h>
+#include <Moby/CouplingConstraint.h>
 #include <Moby/SignedDistDot.h>
+#include <Moby/MemoryAccounting.h>
 #ifdef HAVE_IPOPT
 #include <Moby/NQP_IPOPT.h>
 #include <Moby/LCP_IPOPT.h>
@@ -65,6 +67,7 @@ ImpactConstraintHandler::ImpactConstraintHandler()
   // setup the nonlinear IP solver
   _ipsolver = Ipopt::SmartPtr<NQP_IPOPT>(new NQP_IPOPT);
   _lcpsolver = Ipopt::SmartPtr<LCP_IPOPT>(new LCP_IPOPT);
+  _nqp_initialized = false;
   #endif
 }
 
@@ -74,6 +77,7 @@ ImpactConstraintHandler::ImpactConstraintHandler()
  */
 void ImpactConstraintHandler::process_constraints(const vector<UnilateralConstraint>& constraints)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eSolver);
   FILE_LOG(LOG_CONSTRAINT) << "*************************************************************";
   FILE_LOG(LOG_CONSTRAINT) << endl;
   FILE_LOG(LOG_CONSTRAINT) << "ImpactConstraintHandler::process_constraints() entered";
@@ -81,6 +85,12 @@ void ImpactConstraintHandler::process_constraints(const vector<UnilateralConstra
   FILE_LOG(LOG_CONSTRAINT) << "*************************************************************";
   FILE_LOG(LOG_CONSTRAINT) << endl;
 
+  // NQP solutions from the last call are used for warm starting
+  _nqp_last_contacts.swap(_nqp_contacts);
+  _nqp_last_limits.swap(_nqp_limits);
+  _nqp_contacts.clear();
+  _nqp_limits.clear();
+
   // apply the method to all contacts
   apply_model(constraints);
 
@@ -89,6 +99,21 @@ void ImpactConstraintHandler::process_constraints(const vector<UnilateralConstra
   FILE_LOG(LOG_CONSTRAINT) << "*************************************************************" << endl;
 }
 
+/// Discards the solutions (and solver state) retained for warm starting
+void ImpactConstraintHandler::clear_warm_start_data()
+{
+  _nqp_contacts.clear();
+  _nqp_limits.clear();
+  _nqp_last_contacts.clear();
+  _nqp_last_limits.clear();
+  #ifdef HAVE_IPOPT
+  _nqp_initialized = false;
+  #endif
+  #if defined(USE_QPOASES) && !defined(USE_QLCPD)
+  _qp.clear_problems();
+  #endif
+}
+
 /// Applies the model to a set of constraints
 /**
  * \param constraints a set of constraints
@@ -104,7 +129,7 @@ void ImpactConstraintHandler::apply_model(const vector<UnilateralConstraint>& co
   // **********************************************************
   list<vector<shared_ptr<DynamicBodyd> > > remaining_islands;
   list<pair<list<UnilateralConstraint*>, list<shared_ptr<SingleBodyd> > > > groups;
-  UnilateralConstraint::determine_connected_constraints(constraints, _simulator->implicit_joints, groups, remaining_islands);
+  UnilateralConstraint::determine_connected_constraints(constraints, _simulator->implicit_joints, _simulator->coupling_constraints, groups, remaining_islands);
   UnilateralConstraint::remove_inactive_groups(groups);
 
   // **********************************************************
@@ -237,29 +262,43 @@ void ImpactConstraintHandler::apply_no_slip_model_to_connected_constraints(const
 {
   FILE_LOG(LOG_CONSTRAINT) << "ImpactConstraintHandler::apply_no_slip_model_to_connected_constraints() entered" << endl;
 
-  // reset problem data
-  _epd.reset();
+  // solve until no coupling with backlash needs to pull
+  _released_couplings.clear();
+  for (bool first = true; ; first = false)
+  {
+    // reset problem data
+    _epd.reset();
 
-  // set the simulator
-  _epd.simulator = _simulator;
+    // set the simulator
+    _epd.simulator = _simulator;
 
-  // save the constraints
-  _epd.constraints = vector<UnilateralConstraint*>(constraints.begin(), constraints.end());
+    // save the constraints
+    _epd.constraints = vector<UnilateralConstraint*>(constraints.begin(), constraints.end());
 
-  // determine sets of contact and limit constraints
-  _epd.partition_constraints();
+    // determine sets of contact and limit constraints
+    _epd.partition_constraints();
 
-  // compute all constraint cross-terms
-  compute_problem_data(_epd, single_bodies);
+    // compute all constraint cross-terms
+    compute_problem_data(_epd, single_bodies);
 
-  // clear all impulses
-  for (unsigned i=0; i< _epd.N_CONTACTS; i++)
-    _epd.contact_constraints[i]->contact_impulse.set_zero(GLOBAL);
-  for (unsigned i=0; i< _epd.N_LIMITS; i++)
-    _epd.limit_constraints[i]->limit_impulse = 0.0;
+    // save the state so that the island can be solved again
+    if (first && !_epd.island_couplings.empty())
+      save_island_state(_epd);
 
-  // solve the no slip model
-  apply_no_slip_model(_epd);
+    // clear all impulses
+    for (unsigned i=0; i< _epd.N_CONTACTS; i++)
+      _epd.contact_constraints[i]->contact_impulse.set_zero(GLOBAL);
+    for (unsigned i=0; i< _epd.N_LIMITS; i++)
+      _epd.limit_constraints[i]->limit_impulse = 0.0;
+
+    // solve the no slip model
+    apply_no_slip_model(_epd);
+
+    // release couplings that pulled and solve again without them
+    if (!release_pulling_couplings(_epd))
+      break;
+    restore_island_state(_epd);
+  }
 
   // determine velocities due to impulse application
   update_constraint_velocities_from_impulses(_epd);
@@ -387,13 +426,16 @@ MatrixNd tmp;
   lambda.set_zero(q.N_CONSTRAINT_EQNS_IMP);
   lambda.set(q.active, q.lambda);
 
-  // push lambda back into individual joint lambdas
-  for (unsigned i=0, j=0; i< q.island_ijoints.size(); i++)
+  // push lambda back into individual joint and coupling lambdas
+  unsigned j = 0;
+  for (unsigned i=0; i< q.island_ijoints.size(); i++)
   {
     const unsigned NEQ = q.island_ijoints[i]->num_constraint_eqns();
     q.island_ijoints[i]->lambda = lambda.segment(j, j+NEQ);
     j += NEQ;
   }
+  for (unsigned i=0; i< q.island_couplings.size(); i++)
+    q.island_couplings[i]->lambda = lambda[j++];
 }
 
 /// Updates determined impulses in UnilateralConstraintProblemData based on a QP/NQP solution
@@ -523,6 +565,62 @@ bool ImpactConstraintHandler::apply_restitution(UnilateralConstraintProblemData&
   return changed;
 }
 
+/// Releases engaged couplings with backlash that the last solution required to pull
+/**
+ * A coupling with backlash can only push, so its row is unilateral: the
+ * impulse along its engaged direction must be non-negative. The row is
+ * first solved as an equality; each coupling whose multiplier is negative
+ * (pulling) is released, and the island must then be solved again without
+ * it. This is the same active set strategy that Simulator uses for couplings
+ * in forward dynamics.
+ * \return <b>true</b> if any coupling was released
+ */
+bool ImpactConstraintHandler::release_pulling_couplings(const UnilateralConstraintProblemData& q)
+{
+  bool released = false;
+  for (unsigned i=0; i< q.island_couplings.size(); i++)
+  {
+    CouplingConstraintPtr c = q.island_couplings[i];
+    if (c->is_bilateral() || c->lambda >= 0.0)
+      continue;
+    FILE_LOG(LOG_CONSTRAINT) << "ImpactConstraintHandler::release_pulling_couplings() - releasing coupling with multiplier " << c->lambda << endl;
+    c->lambda = 0.0;
+    _released_couplings.push_back(c);
+    released = true;
+  }
+
+  return released;
+}
+
+/// Saves the island's generalized velocities and constraint impulses so that the island can be solved again
+void ImpactConstraintHandler::save_island_state(const UnilateralConstraintProblemData& q)
+{
+  _saved_gv.resize(q.super_bodies.size());
+  for (unsigned i=0; i< q.super_bodies.size(); i++)
+    q.super_bodies[i]->get_generalized_velocity(DynamicBodyd::eSpatial, _saved_gv[i]);
+
+  _saved_contact_impulses.resize(q.constraints.size());
+  _saved_limit_impulses.resize(q.constraints.size());
+  for (unsigned i=0; i< q.constraints.size(); i++)
+  {
+    _saved_contact_impulses[i] = q.constraints[i]->contact_impulse;
+    _saved_limit_impulses[i] = q.constraints[i]->limit_impulse;
+  }
+}
+
+/// Restores the island's generalized velocities and constraint impulses saved by save_island_state()
+void ImpactConstraintHandler::restore_island_state(const UnilateralConstraintProblemData& q)
+{
+  for (unsigned i=0; i< q.super_bodies.size(); i++)
+    q.super_bodies[i]->set_generalized_velocity(DynamicBodyd::eSpatial, _saved_gv[i]);
+
+  for (unsigned i=0; i< q.constraints.size(); i++)
+  {
+    q.constraints[i]->contact_impulse = _saved_contact_impulses[i];
+    q.constraints[i]->limit_impulse = _saved_limit_impulses[i];
+  }
+}
+
 /**
  * Applies method of Drumwright and Shell to a set of connected constraints
  * \param constraints a set of connected constraints
@@ -533,40 +631,54 @@ void ImpactConstraintHandler::apply_model_to_connected_constraints(const list<Un
 
   FILE_LOG(LOG_CONSTRAINT) << "ImpactConstraintHandler::apply_model_to_connected_constraints() entered" << endl;
 
-  // reset problem data
-  _epd.reset();
+  // solve until no coupling with backlash needs to pull
+  _released_couplings.clear();
+  for (bool first = true; ; first = false)
+  {
+    // reset problem data
+    _epd.reset();
 
-  // set the simulator
-  _epd.simulator = _simulator;
+    // set the simulator
+    _epd.simulator = _simulator;
 
-  // save the constraints
-  _epd.constraints = vector<UnilateralConstraint*>(constraints.begin(), constraints.end());
+    // save the constraints
+    _epd.constraints = vector<UnilateralConstraint*>(constraints.begin(), constraints.end());
 
-  // determine sets of contact and limit constraints
-  _epd.partition_constraints();
+    // determine sets of contact and limit constraints
+    _epd.partition_constraints();
 
-  // compute all constraint cross-terms
-  compute_problem_data(_epd, single_bodies);
+    // compute all constraint cross-terms
+    compute_problem_data(_epd, single_bodies);
 
-  // compute energy
-  if (LOGGING(LOG_CONSTRAINT))
-  {
-    for (unsigned i=0; i< _epd.super_bodies.size(); i++)
+    // compute energy
+    if (first && LOGGING(LOG_CONSTRAINT))
     {
-      double ke = _epd.super_bodies[i]->calc_kinetic_energy();
-      FILE_LOG(LOG_CONSTRAINT) << "  body " << _epd.super_bodies[i]->body_id << " pre-constraint handling KE: " << ke << endl;
-      ke_minus += ke;
+      for (unsigned i=0; i< _epd.super_bodies.size(); i++)
+      {
+        double ke = _epd.super_bodies[i]->calc_kinetic_energy();
+        FILE_LOG(LOG_CONSTRAINT) << "  body " << _epd.super_bodies[i]->body_id << " pre-constraint handling KE: " << ke << endl;
+        ke_minus += ke;
+      }
     }
-  }
 
-  // use QP / NQP solver with warm starting to find the solution
-  if (use_qp_solver(_epd))
-    solve_qp(_z, _epd);
-  else
-    solve_nqp(_z, _epd);
+    // save the state so that the island can be solved again
+    if (first && !_epd.island_couplings.empty())
+      save_island_state(_epd);
+
+    // use QP / NQP solver with warm starting to find the solution
+    if (use_qp_solver(_epd))
+      solve_qp(_z, _epd);
+    else
+      solve_nqp(_z, _epd);
+
+    // update the impulses from z
+    update_from_stacked(_epd, _z);
 
-  // update the impulses from z
-  update_from_stacked(_epd, _z);
+    // release couplings that pulled and solve again without them
+    if (!release_pulling_couplings(_epd))
+      break;
+    restore_island_state(_epd);
+  }
 
   // determine velocities due to impulse application
   update_constraint_velocities_from_impulses(_epd);
@@ -1405,13 +1517,16 @@ void ImpactConstraintHandler::apply_no_slip_model(UnilateralConstraintProblemDat
   lambda.set_zero(q.N_CONSTRAINT_EQNS_IMP);
   lambda.set(q.active, q.lambda);
 
-  // push lambda back into individual joint lambdas
-  for (unsigned i=0, j=0; i< q.island_ijoints.size(); i++)
+  // push lambda back into individual joint and coupling lambdas
+  unsigned j = 0;
+  for (unsigned i=0; i< q.island_ijoints.size(); i++)
   {
     const unsigned NEQ = q.island_ijoints[i]->num_constraint_eqns();
     q.island_ijoints[i]->lambda = lambda.segment(j, j+NEQ);
     j += NEQ;
   }
+  for (unsigned i=0; i< q.island_couplings.size(); i++)
+    q.island_couplings[i]->lambda = lambda[j++];
 
   FILE_LOG(LOG_CONSTRAINT) << "ImpactConstraintHandler::solve_no_slip_lcp() exited" << std::endl;
 }
@@ -1777,6 +1892,7 @@ void ImpactConstraintHandler::compute_limit_components(const MatrixNd& X, Unilat
     q.L_v[i] = u.limit_joint->qd[u.limit_dof];
     if (u.limit_upper)
       q.L_v[i] = -q.L_v[i];
+    q.L_v[i] += u.limit_speculative_vel;
   }
 }
 
@@ -1962,6 +2078,25 @@ void ImpactConstraintHandler::compute_problem_data(UnilateralConstraintProblemDa
     }
   }
 
+  // add engaged coupling constraints on island bodies; couplings with
+  // backlash are added unless they are separating or have been released
+  // because they would need to pull (see release_pulling_couplings())
+  for (unsigned i=0; i< q.simulator->coupling_constraints.size(); i++)
+  {
+    CouplingConstraintPtr c = q.simulator->coupling_constraints[i];
+    const int DIR = c->get_direction();
+    if (c->num_terms() == 0 || DIR == 0 || (!c->is_bilateral() && DIR*c->calc_velocity() < -NEAR_ZERO))
+      continue;
+    if (std::find(_released_couplings.begin(), _released_couplings.end(), c) != _released_couplings.end())
+      continue;
+    shared_ptr<DynamicBodyd> body = c->get_joint(0)->get_articulated_body();
+    if (std::binary_search(q.super_bodies.begin(), q.super_bodies.end(), body))
+    {
+      q.island_couplings.push_back(c);
+      q.N_CONSTRAINT_EQNS_IMP++;
+    }
+  }
+
   // set total number of generalized coordinates
   q.N_GC = 0;
   for (unsigned i=0; i< q.super_bodies.size(); i++)
@@ -2063,6 +2198,7 @@ void ImpactConstraintHandler::compute_problem_data(UnilateralConstraintProblemDa
   unsigned n_implicit_eqns = 0;
   for (unsigned i=0; i< q.island_ijoints.size(); i++)
     n_implicit_eqns += q.island_ijoints[i]->num_constraint_eqns();
+  n_implicit_eqns += q.island_couplings.size();
 
   // prepare to setup Jacobian
   q.Jfull.rows = n_implicit_eqns;
@@ -2103,6 +2239,10 @@ void ImpactConstraintHandler::compute_problem_data(UnilateralConstraintProblemDa
     eq_idx += q.island_ijoints[i]->num_constraint_eqns();
   } 
 
+  // add one (sparse) row for each coupling constraint
+  for (unsigned i=0, eq_idx=n_implicit_eqns-q.island_couplings.size(); i< q.island_couplings.size(); i++)
+    q.island_couplings[i]->add_to_Jacobian(gc_map, eq_idx++, q.Jfull);
+
   // determine active set of implicit constraints
   get_full_rank_implicit_constraints(q.Jfull, q.active);
 
@@ -75,21 +75,22 @@ void ImpactConstraintHandler::solve_nqp(VectorNd& z, UnilateralConstraintProblem
 
 /// Solves the nonlinearly constrained quadratic program (does all of the work)
 /**
+ * The solve is warm started from the impulses and multipliers found for the
+ * same contacts (and limits) at the last call to process_constraints(), and
+ * IPOPT is reoptimized (rather than set up anew) when the sparsity structure
+ * of the problem is unchanged from the last solve.
  * \param x the solution is returned here; zeros will be returned at appropriate indices for inactive contacts
  */
 void ImpactConstraintHandler::solve_nqp_work(UnilateralConstraintProblemData& q, VectorNd& x)
 {
-  const double INF = std::numeric_limits<double>::max();
-
   // setup constants
   const unsigned N_CONTACTS = q.N_CONTACTS;
   const unsigned N_LIMITS = q.N_LIMITS;
-  const unsigned N_CONSTRAINT_EQNS_IMP = q.N_CONSTRAINT_EQNS_IMP; 
   const unsigned CN_IDX = 0;
   const unsigned CS_IDX = N_CONTACTS;
   const unsigned CT_IDX = CS_IDX + N_CONTACTS;
   const unsigned CL_IDX = CT_IDX + N_CONTACTS;
-  const unsigned NVARS = N_LIMITS + CL_IDX; 
+  const unsigned NVARS = N_LIMITS + CL_IDX;
 
   // setup the optimization data
   _ipsolver->epd = &q;
@@ -105,235 +106,151 @@ void ImpactConstraintHandler::solve_nqp_work(UnilateralConstraintProblemData& q,
   }
 
   // setup matrices
-  MatrixNd& R = _ipsolver->R;
   MatrixNd& H = _ipsolver->H;
-  VectorNd& c = _ipsolver->c; 
-  VectorNd& z = _ipsolver->z; 
-
-  // init z (particular solution) 
-  z.set_zero(NVARS);
-
-  // first, compute the appropriate nullspace 
-  if (N_CONSTRAINT_EQNS_IMP > 0)
-  {
-    // compute the homogeneous solution
-    _A = q.Jx_iM_JxT;
-    (_workv = q.Jx_v).negate();
-    try
-    {
-      _LA.solve_LS_fast1(_A, _workv);
-    }
-    catch (NumericalException e)
-    {
-      _A = q.Jx_iM_JxT;
-      _LA.solve_LS_fast2(_A, _workv);
-    }
-    z.set_sub_vec(q.ALPHA_X_IDX, _workv);
-
-    // setup blocks of A
-    _A.resize(N_CONSTRAINT_EQNS_IMP, NVARS);
-    SharedMatrixNd b1 = _A.block(0, N_CONSTRAINT_EQNS_IMP, 0, N_CONTACTS);
-    SharedMatrixNd b2 = _A.block(0, N_CONSTRAINT_EQNS_IMP, N_CONTACTS, N_CONTACTS*2);
-    SharedMatrixNd b3 = _A.block(0, N_CONSTRAINT_EQNS_IMP, N_CONTACTS*2, N_CONTACTS*3);
-    SharedMatrixNd b4 = _A.block(0, N_CONSTRAINT_EQNS_IMP, N_CONTACTS*3, N_CONTACTS*3+N_LIMITS);
-
-    // compute the nullspace
-    MatrixNd::transpose(q.Cn_iM_JxT, b1);
-    MatrixNd::transpose(q.Cs_iM_JxT, b2);
-    MatrixNd::transpose(q.Ct_iM_JxT, b3);
-    MatrixNd::transpose(q.L_iM_JxT, b4);
-    _LA.nullspace(_A, R);
-  }
-  else
-    // clear the nullspace 
-    R.resize(0,0);
-
-  // get number of qp variables
-  const unsigned N_PRIMAL = (R.columns() > 0) ? R.columns() : NVARS;
-
-  // setup number of nonlinear inequality constraints
-  const unsigned NONLIN_INEQUAL = N_CONTACTS;
+  VectorNd& c = _ipsolver->c;
 
   // init the QP matrix and vector
-  H.resize(N_PRIMAL, N_PRIMAL);
+  H.resize(NVARS, NVARS);
   c.resize(H.rows());
 
-  // setup row (block) 1 -- Cn * iM * [Cn' Cs Ct' L']
+  // setup row (block) 1 -- Cn * X * [Cn' Cs Ct' L']
   unsigned col_start = 0, col_end = N_CONTACTS;
   unsigned row_start = 0, row_end = N_CONTACTS;
-  SharedMatrixNd Cn_iM_CnT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd Cn_X_CnT = H.block(row_start, row_end, col_start, col_end);
   col_start = col_end; col_end += N_CONTACTS;
-  SharedMatrixNd Cn_iM_CsT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd Cn_X_CsT = H.block(row_start, row_end, col_start, col_end);
   col_start = col_end; col_end += N_CONTACTS;
-  SharedMatrixNd Cn_iM_CtT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd Cn_X_CtT = H.block(row_start, row_end, col_start, col_end);
   col_start = col_end; col_end += N_LIMITS;
-  SharedMatrixNd Cn_iM_LT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd Cn_X_LT = H.block(row_start, row_end, col_start, col_end);
 
-  // setup row (block) 2 -- Cs * iM * [Cn' Cs' Ct' L']
+  // setup row (block) 2 -- Cs * X * [Cn' Cs' Ct' L']
   row_start = row_end; row_end += N_CONTACTS;
   col_start = 0; col_end = N_CONTACTS;
-  SharedMatrixNd Cs_iM_CnT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd Cs_X_CnT = H.block(row_start, row_end, col_start, col_end);
   col_start = col_end; col_end += N_CONTACTS;
-  SharedMatrixNd Cs_iM_CsT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd Cs_X_CsT = H.block(row_start, row_end, col_start, col_end);
   col_start = col_end; col_end += N_CONTACTS;
-  SharedMatrixNd Cs_iM_CtT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd Cs_X_CtT = H.block(row_start, row_end, col_start, col_end);
   col_start = col_end; col_end += N_LIMITS;
-  SharedMatrixNd Cs_iM_LT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd Cs_X_LT = H.block(row_start, row_end, col_start, col_end);
 
-  // setup row (block) 3 -- Ct * iM * [Cn' Cs' Ct' L']
+  // setup row (block) 3 -- Ct * X * [Cn' Cs' Ct' L']
   row_start = row_end; row_end += N_CONTACTS;
   col_start = 0; col_end = N_CONTACTS;
-  SharedMatrixNd Ct_iM_CnT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd Ct_X_CnT = H.block(row_start, row_end, col_start, col_end);
   col_start = col_end; col_end += N_CONTACTS;
-  SharedMatrixNd Ct_iM_CsT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd Ct_X_CsT = H.block(row_start, row_end, col_start, col_end);
   col_start = col_end; col_end += N_CONTACTS;
-  SharedMatrixNd Ct_iM_CtT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd Ct_X_CtT = H.block(row_start, row_end, col_start, col_end);
   col_start = col_end; col_end += N_LIMITS;
-  SharedMatrixNd Ct_iM_LT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd Ct_X_LT = H.block(row_start, row_end, col_start, col_end);
 
-  // setup row (block 4) -- L * iM * [Cn' Cs' Ct' L']
+  // setup row (block 4) -- L * X * [Cn' Cs' Ct' L']
   row_start = row_end; row_end += N_LIMITS;
   col_start = 0; col_end = N_CONTACTS;
-  SharedMatrixNd L_iM_CnT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd L_X_CnT = H.block(row_start, row_end, col_start, col_end);
   col_start = col_end; col_end += N_CONTACTS;
-  SharedMatrixNd L_iM_CsT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd L_X_CsT = H.block(row_start, row_end, col_start, col_end);
   col_start = col_end; col_end += N_CONTACTS;
-  SharedMatrixNd L_iM_CtT = H.block(row_start, row_end, col_start, col_end);
+  SharedMatrixNd L_X_CtT = H.block(row_start, row_end, col_start, col_end);
   col_start = col_end; col_end += N_LIMITS;
-  SharedMatrixNd L_iM_LT = H.block(row_start, row_end, col_start, col_end);
-  SharedMatrixNd L_block = H.block(row_start, row_end, 0, col_end);
+  SharedMatrixNd L_X_LT = H.block(row_start, row_end, col_start, col_end);
 
   // copy to row block 1 (contact normals)
-  q.Cn_iM_CnT.get_sub_mat(0, N_CONTACTS, 0, N_CONTACTS, Cn_iM_CnT);
-  q.Cn_iM_CsT.get_sub_mat(0, N_CONTACTS, 0, N_CONTACTS, Cn_iM_CsT);
-  q.Cn_iM_CtT.get_sub_mat(0, N_CONTACTS, 0, N_CONTACTS, Cn_iM_CtT);
-  q.Cn_iM_LT.get_sub_mat(0, N_CONTACTS, 0, N_LIMITS, Cn_iM_LT);
-  
+  q.Cn_X_CnT.get_sub_mat(0, N_CONTACTS, 0, N_CONTACTS, Cn_X_CnT);
+  q.Cn_X_CsT.get_sub_mat(0, N_CONTACTS, 0, N_CONTACTS, Cn_X_CsT);
+  q.Cn_X_CtT.get_sub_mat(0, N_CONTACTS, 0, N_CONTACTS, Cn_X_CtT);
+  q.Cn_X_LT.get_sub_mat(0, N_CONTACTS, 0, N_LIMITS, Cn_X_LT);
+
   // copy to row block 2 (first contact tangents)
-  MatrixNd::transpose(Cn_iM_CsT, Cs_iM_CnT);
-  q.Cs_iM_CsT.get_sub_mat(0, N_CONTACTS, 0, N_CONTACTS, Cs_iM_CsT);
-  q.Cs_iM_CtT.get_sub_mat(0, N_CONTACTS, 0, N_CONTACTS, Cs_iM_CtT);
-  q.Cs_iM_LT.get_sub_mat(0, N_CONTACTS, 0, N_LIMITS, Cs_iM_LT);
+  MatrixNd::transpose(Cn_X_CsT, Cs_X_CnT);
+  q.Cs_X_CsT.get_sub_mat(0, N_CONTACTS, 0, N_CONTACTS, Cs_X_CsT);
+  q.Cs_X_CtT.get_sub_mat(0, N_CONTACTS, 0, N_CONTACTS, Cs_X_CtT);
+  q.Cs_X_LT.get_sub_mat(0, N_CONTACTS, 0, N_LIMITS, Cs_X_LT);
 
   // copy to row block 3 (second contact tangents)
-  MatrixNd::transpose(Cn_iM_CtT, Ct_iM_CnT);
-  MatrixNd::transpose(Cs_iM_CtT, Ct_iM_CsT);
-  q.Ct_iM_CtT.get_sub_mat(0, N_CONTACTS, 0, N_CONTACTS, Ct_iM_CtT);
-  q.Ct_iM_LT.get_sub_mat(0, N_CONTACTS, 0, N_LIMITS, Ct_iM_LT);
+  MatrixNd::transpose(Cn_X_CtT, Ct_X_CnT);
+  MatrixNd::transpose(Cs_X_CtT, Ct_X_CsT);
+  q.Ct_X_CtT.get_sub_mat(0, N_CONTACTS, 0, N_CONTACTS, Ct_X_CtT);
+  q.Ct_X_LT.get_sub_mat(0, N_CONTACTS, 0, N_LIMITS, Ct_X_LT);
 
-  // copy to row block 6 (limits)
-  MatrixNd::transpose(Cn_iM_LT, L_iM_CnT);
-  MatrixNd::transpose(Cs_iM_LT, L_iM_CsT);
-  MatrixNd::transpose(Ct_iM_LT, L_iM_CtT);
-  q.L_iM_LT.get_sub_mat(0, N_LIMITS, 0, N_LIMITS, L_iM_LT);
+  // copy to row block 4 (limits)
+  MatrixNd::transpose(Cn_X_LT, L_X_CnT);
+  MatrixNd::transpose(Cs_X_LT, L_X_CsT);
+  MatrixNd::transpose(Ct_X_LT, L_X_CtT);
+  q.L_X_LT.get_sub_mat(0, N_LIMITS, 0, N_LIMITS, L_X_LT);
 
   // get components of c
-  SharedVectorNd Cn_v = c.segment(0, N_CONTACTS); 
-  SharedVectorNd Cs_v = c.segment(N_CONTACTS, N_CONTACTS*2); 
-  SharedVectorNd Ct_v = c.segment(N_CONTACTS*2, N_CONTACTS*3); 
-  SharedVectorNd L_v = c.segment(N_CONTACTS*3, N_CONTACTS*3+N_LIMITS); 
+  SharedVectorNd Cn_v = c.segment(CN_IDX, CS_IDX);
+  SharedVectorNd Cs_v = c.segment(CS_IDX, CT_IDX);
+  SharedVectorNd Ct_v = c.segment(CT_IDX, CL_IDX);
+  SharedVectorNd L_v = c.segment(CL_IDX, NVARS);
 
-  // setup c 
+  // setup c
   q.Cn_v.get_sub_vec(0, N_CONTACTS, Cn_v);
   q.Cs_v.get_sub_vec(0, N_CONTACTS, Cs_v);
   q.Ct_v.get_sub_vec(0, N_CONTACTS, Ct_v);
   L_v = q.L_v;
 
-  // ****** now setup linear inequality constraints ******
-
-  // determine whether to use kappa constraint
-  const unsigned KAPPA = 1;
-
-  // determine number of linear inequality constraints
-  const unsigned N_INEQUAL = q.N_CONTACTS + N_LIMITS + KAPPA;
-
-  // get Cn sub blocks
-  SharedConstMatrixNd sub_Cn_Cn = q.Cn_iM_CnT.block(0, q.N_CONTACTS, 0, q.N_CONTACTS);
-  SharedConstMatrixNd sub_Cn_Cs = q.Cn_iM_CsT.block(0, q.N_CONTACTS, 0, q.N_CONTACTS);
-  SharedConstMatrixNd sub_Cn_Ct = q.Cn_iM_CtT.block(0, q.N_CONTACTS, 0, q.N_CONTACTS);
-  SharedConstMatrixNd sub_Cn_L = q.Cn_iM_LT.block(0, q.N_CONTACTS, 0, q.N_LIMITS);
-
-  // setup Cn block
-  MatrixNd& Cn_block = _ipsolver->Cn_block;
-  Cn_block.resize(q.N_CONTACTS, NVARS);
-  Cn_block.set_sub_mat(0, 0, sub_Cn_Cn); 
-  Cn_block.set_sub_mat(0, N_CONTACTS, sub_Cn_Cs); 
-  Cn_block.set_sub_mat(0, N_CONTACTS*2, sub_Cn_Ct); 
-  Cn_block.set_sub_mat(0, N_CONTACTS*3, sub_Cn_L); 
-
-  // verify that L_block can be reset
-  _ipsolver->L_block.reset();
-  _ipsolver->Cn_v.reset();
-  _ipsolver->L_block = L_block;
-  _ipsolver->Cn_v = q.Cn_v.segment(0, N_CONTACTS);
-
-  // setup optimizations in nullspace (if necessary)
-  if (R.columns() > 0)
-  {
-    R.transpose_mult(H, _RTH);
-    _RTH.mult(R, H);
-    R.transpose_mult(c, _workv);
-    c = _workv;
-    _RTH.mult(z, _workv);
-    c += _workv;
-  }
-
-   FILE_LOG(LOG_CONSTRAINT) << "ImpactConstraintHandler::solve_nqp_work() entered" << std::endl;
-  FILE_LOG(LOG_CONSTRAINT) << "  Cn * inv(M) * Cn': " << std::endl << q.Cn_iM_CnT;
-  FILE_LOG(LOG_CONSTRAINT) << "  Cn * inv(M) * Cs': " << std::endl << q.Cn_iM_CsT;
-  FILE_LOG(LOG_CONSTRAINT) << "  Cn * inv(M) * Ct': " << std::endl << q.Cn_iM_CtT;
-  FILE_LOG(LOG_CONSTRAINT) << "  Cn * inv(M) * L': " << std::endl << q.Cn_iM_LT;
-  FILE_LOG(LOG_CONSTRAINT) << "  Cn * inv(M) * Jx': " << std::endl << q.Cn_iM_JxT;
-  FILE_LOG(LOG_CONSTRAINT) << "  Cs * inv(M) * Cs': " << std::endl << q.Cs_iM_CsT;
-  FILE_LOG(LOG_CONSTRAINT) << "  Cs * inv(M) * Ct': " << std::endl << q.Cs_iM_CtT;
-  FILE_LOG(LOG_CONSTRAINT) << "  Cs * inv(M) * L': " << std::endl << q.Cs_iM_LT;
-  FILE_LOG(LOG_CONSTRAINT) << "  Cs * inv(M) * Jx': " << std::endl << q.Cs_iM_JxT;
-  FILE_LOG(LOG_CONSTRAINT) << "  Ct * inv(M) * Ct': " << std::endl << q.Ct_iM_CtT;
-  FILE_LOG(LOG_CONSTRAINT) << "  Ct * inv(M) * L': " << std::endl << q.Ct_iM_LT;
-  FILE_LOG(LOG_CONSTRAINT) << "  Ct * inv(M) * Jx': " << std::endl << q.Ct_iM_JxT;
-  FILE_LOG(LOG_CONSTRAINT) << "  L * inv(M) * L': " << std::endl << q.L_iM_LT;
-  FILE_LOG(LOG_CONSTRAINT) << "  L * inv(M) * Jx': " << std::endl << q.L_iM_JxT;
-  FILE_LOG(LOG_CONSTRAINT) << "  Jx * inv(M) * Jx': " << std::endl << q.Jx_iM_JxT;
-  FILE_LOG(LOG_CONSTRAINT) << "  Cn * v: " << q.Cn_v << std::endl;
-  FILE_LOG(LOG_CONSTRAINT) << "  Cs * v: " << q.Cs_v << std::endl;
-  FILE_LOG(LOG_CONSTRAINT) << "  Ct * v: " << q.Ct_v << std::endl;
-  FILE_LOG(LOG_CONSTRAINT) << "  L * v: " << q.L_v << std::endl;
-  FILE_LOG(LOG_CONSTRAINT) << "  Jx * v: " << q.Jx_v << std::endl;
+  FILE_LOG(LOG_CONSTRAINT) << "ImpactConstraintHandler::solve_nqp_work() entered" << std::endl;
   FILE_LOG(LOG_CONSTRAINT) << "H matrix: " << std::endl << H;
   FILE_LOG(LOG_CONSTRAINT) << "c vector: " << c << std::endl;
 
+  // warm start from the last solution for the same contacts and limits
+  set_nqp_starting_point(q);
+
+  // setup the sparse problem; IPOPT can be reoptimized if the structure has
+  // not changed since the last solve
+  bool same_structure = _ipsolver->setup_sparse() && _nqp_initialized;
+
   // setup ipopt options
   _app.Options()->SetIntegerValue("print_level", 0);
   _app.Options()->SetNumericValue("constr_viol_tol", 0.0005);
+  _app.Options()->SetStringValue("warm_start_init_point", (_ipsolver->warm_start) ? "yes" : "no");
+  _app.Options()->SetNumericValue("mu_init", (_ipsolver->warm_start) ? 1e-6 : 0.1);
 //  _app.Options()->SetIntegerValue("max_iter", 10000);
 //  _app.Options()->SetStringValue("derivative_test", "second-order");
 
-  // set the ipsolver tolerance on the Coulomb friction and kappa constraints
-  _ipsolver->_tol = 0.0;
-
-  // solve the nonlinear QP using the interior-point algorithm 
-  _app.Initialize();
-  Ipopt::ApplicationReturnStatus status = _app.OptimizeTNLP(_ipsolver);
+  // solve the nonlinear QP using the interior-point algorithm
+  Ipopt::ApplicationReturnStatus status;
+  if (same_structure)
+  {
+    FILE_LOG(LOG_CONSTRAINT) << " -- problem structure unchanged; reoptimizing" << std::endl;
+    status = _app.ReOptimizeTNLP(_ipsolver);
+  }
+  else
+  {
+    _app.Initialize();
+    status = _app.OptimizeTNLP(_ipsolver);
+    _nqp_initialized = true;
+  }
 
   // look for acceptable solve conditions
-  if (!(status == Ipopt::Solve_Succeeded || 
-        status == Ipopt::Solved_To_Acceptable_Level)) 
+  if (!(status == Ipopt::Solve_Succeeded ||
+        status == Ipopt::Solved_To_Acceptable_Level))
+  {
+    _nqp_initialized = false;
     throw std::runtime_error("Could not solve nonlinearly constrained QP");
+  }
+
+  // save the solution for warm starting
+  save_nqp_solution(q);
 
   // get the final solution out
-  SharedVectorNd cn = _ipsolver->z.segment(0, N_CONTACTS);
-  SharedVectorNd cs = _ipsolver->z.segment(N_CONTACTS, N_CONTACTS*2);
-  SharedVectorNd ct = _ipsolver->z.segment(N_CONTACTS*2, N_CONTACTS*3);
-  SharedVectorNd l =  _ipsolver->z.segment(N_CONTACTS*3, N_CONTACTS*3+q.N_LIMITS);
+  SharedVectorNd cn = _ipsolver->z.segment(CN_IDX, CS_IDX);
+  SharedVectorNd cs = _ipsolver->z.segment(CS_IDX, CT_IDX);
+  SharedVectorNd ct = _ipsolver->z.segment(CT_IDX, CL_IDX);
+  SharedVectorNd l =  _ipsolver->z.segment(CL_IDX, NVARS);
 
   // put x in the expected format
-  x.resize(q.N_VARS);
+  x.set_zero(q.N_VARS);
   x.set_sub_vec(q.CN_IDX, cn);
   x.set_sub_vec(q.CS_IDX, cs);
   x.set_sub_vec(q.CT_IDX, ct);
   x.set_sub_vec(q.L_IDX, l);
 
-  FILE_LOG(LOG_CONSTRAINT) << "nonlinear QP solution: " << x << std::endl; 
+  FILE_LOG(LOG_CONSTRAINT) << "nonlinear QP solution: " << x << std::endl;
   if (LOGGING(LOG_CONSTRAINT))
   {
     VectorNd workv;
@@ -344,5 +261,131 @@ void ImpactConstraintHandler::solve_nqp_work(UnilateralConstraintProblemData& q,
   }
   FILE_LOG(LOG_CONSTRAINT) << "ImpactConstraintHandler::solve_nqp() exited" << std::endl;
 }
+
+/// Sets the starting point of the nonlinear QP from the last solution for the same contacts and limits
+/**
+ * Contacts persist if they are between the same pair of geometries; each
+ * contact takes the values of the closest (not yet taken) contact between
+ * the pair at the last call to process_constraints().
+ */
+void ImpactConstraintHandler::set_nqp_starting_point(const UnilateralConstraintProblemData& q)
+{
+  const unsigned N_CONTACTS = q.N_CONTACTS;
+  const unsigned N_LIMITS = q.N_LIMITS;
+  const unsigned NVARS = N_CONTACTS*3 + N_LIMITS;
+
+  // setup the starting point
+  VectorNd& z0 = _ipsolver->z0;
+  VectorNd& lambda0 = _ipsolver->lambda0;
+  VectorNd& z_L0 = _ipsolver->z_L0;
+  z0.set_zero(NVARS);
+  lambda0.set_zero(N_CONTACTS*2 + N_LIMITS);
+  z_L0.set_zero(NVARS);
+  _ipsolver->warm_start = false;
+
+  // copy the values for persistent contacts (preferring values from an
+  // earlier solve during this call to process_constraints())
+  std::set<const NQPContactSolution*> taken;
+  for (unsigned i=0; i< N_CONTACTS; i++)
+  {
+    const UnilateralConstraint& e = *q.contact_constraints[i];
+    NQPContactKey key(e.contact_geom1.get(), e.contact_geom2.get());
+    std::pair<NQPContactMap::const_iterator, NQPContactMap::const_iterator> range = _nqp_contacts.equal_range(key);
+    if (range.first == range.second)
+      range = _nqp_last_contacts.equal_range(key);
+
+    // find the closest contact
+    const NQPContactSolution* closest = NULL;
+    double closest_dist = std::numeric_limits<double>::max();
+    for (NQPContactMap::const_iterator j = range.first; j != range.second; j++)
+    {
+      if (taken.find(&j->second) != taken.end())
+        continue;
+      double dist = (j->second.point - e.contact_point).norm();
+      if (dist < closest_dist)
+      {
+        closest_dist = dist;
+        closest = &j->second;
+      }
+    }
+    if (!closest)
+      continue;
+
+    // copy the values
+    z0[i] = closest->cn;
+    z0[i+N_CONTACTS] = closest->cs;
+    z0[i+N_CONTACTS*2] = closest->ct;
+    z_L0[i] = closest->z_cn;
+    lambda0[i] = closest->lambda_cn;
+    lambda0[i+N_CONTACTS+N_LIMITS] = closest->lambda_mu;
+    _ipsolver->warm_start = true;
+
+    // do not use the same contact twice
+    taken.insert(closest);
+  }
+
+  // copy the values for persistent limits
+  for (unsigned i=0; i< N_LIMITS; i++)
+  {
+    const UnilateralConstraint& e = *q.limit_constraints[i];
+    NQPLimitKey key(e.limit_joint.get(), e.limit_dof*2 + (e.limit_upper ? 1 : 0));
+    NQPLimitMap::const_iterator j = _nqp_limits.find(key);
+    if (j == _nqp_limits.end())
+    {
+      j = _nqp_last_limits.find(key);
+      if (j == _nqp_last_limits.end())
+        continue;
+    }
+
+    // copy the values
+    z0[i+N_CONTACTS*3] = j->second.l;
+    z_L0[i+N_CONTACTS*3] = j->second.z_l;
+    lambda0[i+N_CONTACTS] = j->second.lambda_l;
+    _ipsolver->warm_start = true;
+  }
+}
+
+/// Saves the solution to the nonlinear QP for warm starting the next solve
+void ImpactConstraintHandler::save_nqp_solution(const UnilateralConstraintProblemData& q)
+{
+  const unsigned N_CONTACTS = q.N_CONTACTS;
+  const unsigned N_LIMITS = q.N_LIMITS;
+  const VectorNd& z = _ipsolver->z;
+  const VectorNd& lambda = _ipsolver->lambda;
+  const VectorNd& z_L = _ipsolver->z_L;
+
+  // remove the values from any earlier solve for the same contacts
+  for (unsigned i=0; i< N_CONTACTS; i++)
+  {
+    const UnilateralConstraint& e = *q.contact_constraints[i];
+    _nqp_contacts.erase(NQPContactKey(e.contact_geom1.get(), e.contact_geom2.get()));
+  }
+
+  // save the contact values
+  for (unsigned i=0; i< N_CONTACTS; i++)
+  {
+    const UnilateralConstraint& e = *q.contact_constraints[i];
+    NQPContactSolution s;
+    s.point = e.contact_point;
+    s.cn = z[i];
+    s.cs = z[i+N_CONTACTS];
+    s.ct = z[i+N_CONTACTS*2];
+    s.z_cn = z_L[i];
+    s.lambda_cn = lambda[i];
+    s.lambda_mu = lambda[i+N_CONTACTS+N_LIMITS];
+    _nqp_contacts.insert(std::make_pair(NQPContactKey(e.contact_geom1.get(), e.contact_geom2.get()), s));
+  }
+
+  // save the limit values
+  for (unsigned i=0; i< N_LIMITS; i++)
+  {
+    const UnilateralConstraint& e = *q.limit_constraints[i];
+    NQPLimitSolution s;
+    s.l = z[i+N_CONTACTS*3];
+    s.z_l = z_L[i+N_CONTACTS*3];
+    s.lambda_l = lambda[i+N_CONTACTS];
+    _nqp_limits[NQPLimitKey(e.limit_joint.get(), e.limit_dof*2 + (e.limit_upper ? 1 : 0))] = s;
+  }
+}
 #endif // #ifndef HAVE_IPOPT
 
@@ -166,6 +166,23 @@ void ImpactConstraintHandler::solve_qp_work(UnilateralConstraintProblemData& epd
   VectorNd lb(c.size()), ub(c.size());
   lb.set_zero();
   ub.set_one() *= 1e+29;
+  #if !defined(USE_QLCPD)
+  // identify the constraints forming the QP so that qpOASES can hot start
+  // from the last solution to a QP formed by the same constraints
+  QPOASES::Topology topology;
+  topology.reserve(epd.contact_constraints.size()*2 + epd.limit_constraints.size());
+  for (unsigned i=0; i< epd.contact_constraints.size(); i++)
+  {
+    topology.push_back(std::make_pair((const void*) epd.contact_constraints[i]->contact_geom1.get(), 0));
+    topology.push_back(std::make_pair((const void*) epd.contact_constraints[i]->contact_geom2.get(), 0));
+  }
+  for (unsigned i=0; i< epd.limit_constraints.size(); i++)
+  {
+    const UnilateralConstraint& limit = *epd.limit_constraints[i];
+    topology.push_back(std::make_pair((const void*) limit.limit_joint.get(), limit.limit_dof*2 + (limit.limit_upper ? 1 : 0)));
+  }
+  _qp.set_topology(topology);
+  #endif
   if (!_qp.qp_activeset(H, c, lb, ub, M, q, A, b, z))
   {
     FILE_LOG(LOG_CONSTRAINT) << "QLCPD failed to solve; finding closest feasible point" << std::endl;
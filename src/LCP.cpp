@@ -35,6 +35,8 @@ using boost::shared_ptr;
 // Sole constructor
 LCP::LCP()
 {
+  pivots = 0;
+  total_pivots = 0;
 }
 
 /// Fast pivoting algorithm for denerate, monotone LCPs with few nonzero, nonbasic variables 
@@ -107,6 +109,8 @@ bool LCP::lcp_fast(const MatrixNd& M, const VectorNd& q, VectorNd& z, double zer
   const unsigned MAX_PIV = 2*N;
   for (pivots=0; pivots < MAX_PIV; pivots++)
   {
+    total_pivots++;
+
     // select nonbasic indices
     M.select_square(_nonbas.begin(), _nonbas.end(), _Msub);
     M.select(_bas.begin(), _bas.end(), _nonbas.begin(), _nonbas.end(), _Mmix);
@@ -788,6 +792,8 @@ restart: // solver restarts from here when basis becomes bad
   // main iterations begin here
   for (pivots=0; pivots< MAXITER; pivots++)
   {
+    total_pivots++;
+
     if (LOGGING(LOG_OPT))
     {
       std::ostringstream basic;
@@ -1250,6 +1256,8 @@ bool LCP::lcp_lemke(const SparseMatrixNd& M, const VectorNd& q, VectorNd& z, dou
   // main iterations begin here
   for (unsigned iter=0; iter < MAXITER; iter++)
   {
+    total_pivots++;
+
     // check whether done; if not, get new entering variable
     if (leaving == t)
     {
@@ -1432,6 +1440,8 @@ bool LCP::fast_pivoting(const MatrixNd& M, const VectorNd& q, VectorNd& z, doubl
   // start the pivoting algorithm
   for (unsigned i=0; i< MAX_PIVOTS; i++)
   {
+    total_pivots++;
+
     // solve for nonbasic z
     M.select_square(_nonbas.begin(), _nonbas.end(), _M);
     q.select(_nonbas.begin(), _nonbas.end(), _qprime);
@@ -1,24 +1,58 @@
 /****************************************************************************
  * Copyright 2015 Evan Drumwright
- * This library is distributed under the terms of the Apache V2.0 
+ * This library is distributed under the terms of the Apache V2.0
  * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
  ****************************************************************************/
 
+#include <cmath>
 #include <limits>
+#include <algorithm>
 #include <Moby/Constants.h>
 #include <Moby/Log.h>
+#include <Moby/PerThread.h>
 #include <Moby/LP.h>
 
 using std::endl;
 using std::vector;
-using boost::shared_ptr;
 using namespace Ravelin;
 using namespace Moby;
 
+// static variables
+unsigned LP::seed = 0;
+
+/// The workspace retained between calls by each thread
+struct LPWorkspace
+{
+  // the (row-major) problem, subproblems, and scratch space
+  vector<double> work;
+
+  // the order in which the constraints are processed
+  vector<unsigned> perm;
+
+  // the arguments filled in by lp_seidel() and lsq_seidel()
+  MatrixNd C;
+  VectorNd c, e, l, u;
+};
+
+static PerThread<LPWorkspace> _workspace;
+
+/// Gets the next number from a linear congruential generator
+static unsigned next_random(unsigned long long& state)
+{
+  state = state*6364136223846793005ULL + 1442695040888963407ULL;
+  return (unsigned) (state >> 33);
+}
+
+/// Computes the tolerance used to decide whether a constraint a'x <= b is satisfied
+static double constraint_tol(double b)
+{
+  return NEAR_ZERO*(1.0 + std::fabs(b));
+}
+
 /// Solves a linear program using the method of Seidel
 /**
- * This method exhibits complexity of O(d!n), where d is the dimension of the
- * variables and n is the number of constraints.
+ * This method exhibits expected complexity of O(d!n), where d is the
+ * dimension of the variables and n is the number of constraints.
  * \param A the matrix for which Ax < b
  * \param b the vector for which Ax < b
  * \param c the optimization vector (maximizes c'x)
@@ -31,310 +65,449 @@ using namespace Moby;
  */
 bool LP::lp_seidel(const MatrixNd& A, const VectorNd& b, const VectorNd& c, const VectorNd& l, const VectorNd& u, VectorNd& x)
 {
-  // get number of rows and columns in A
-  unsigned n = A.rows();
-  unsigned d = A.columns();
+  LPWorkspace& ws = _workspace.get();
+  MatrixNd& C = ws.C;
+  VectorNd& e = ws.e;
 
-  FILE_LOG(LOG_OPT) << "LP::lp() entered" << endl;
+  FILE_LOG(LOG_OPT) << "LP::lp_seidel() entered" << endl;
   FILE_LOG(LOG_OPT) << "A: " << endl << A;
   FILE_LOG(LOG_OPT) << "b: " << b << endl;
   FILE_LOG(LOG_OPT) << "c: " << c << endl;
   FILE_LOG(LOG_OPT) << "l: " << l << endl;
   FILE_LOG(LOG_OPT) << "u: " << u << endl;
 
-  // base case d = 1
-  if (d == 1)
-  {
-    FILE_LOG(LOG_OPT) << "base case, d = 1" << endl;
+  // there is no least-squares term
+  C.resize(0, A.columns());
+  e.resize(0);
+  bool result = solve(A, b, c, l, u, C, e, x);
 
-    double high = u[0]; 
-    double low = l[0];
+  FILE_LOG(LOG_OPT) << "LP::lp_seidel() exited" << endl;
 
-    for (unsigned i=0; i< n; i++)
-    {
-      if (A(i,0) > std::numeric_limits<double>::epsilon())
-        high = std::min(high, b[i]/A(i,0));
-      else if (A(i,0) < -std::numeric_limits<double>::epsilon())
-        low = std::max(low, b[i]/A(i,0));
-      else if (b[i] < -std::numeric_limits<double>::epsilon())
-      {
-        FILE_LOG(LOG_OPT) << "infeasible; b is negative and A is zero" << endl;
+  return result;
+}
 
-        return false; 
-      }
-    }
+/// Solves a least-squares program using the method of Seidel
+/**
+ * Minimizes ||Cx + e|| subject to Ax <= b. The minimizer need not be
+ * unique; in that case, one of the minimizers is returned.
+ * This method exhibits expected complexity of O(d!n), where d is the
+ * dimension of the variables and n is the number of constraints.
+ * \param A the matrix for which Ax < b
+ * \param b the vector for which Ax < b
+ * \param C the matrix of the least-squares objective
+ * \param e the vector of the least-squares objective
+ * \param x the optimal solution (on successful return)
+ * \return <b>true</b> if successful, <b>false</b> otherwise (if the
+ *         constraints are infeasible)
+ */
+bool LP::lsq_seidel(const MatrixNd& A, const VectorNd& b, const MatrixNd& C, const VectorNd& e, VectorNd& x)
+{
+  const double INF = std::numeric_limits<double>::max();
+  LPWorkspace& ws = _workspace.get();
+  VectorNd& c = ws.c;
+  VectorNd& l = ws.l;
+  VectorNd& u = ws.u;
 
-    // do a check for infeasibility
-    if (high < low)
-    {
-      FILE_LOG(LOG_OPT) << "infeasible; high (" << high << ") < low (" << low << ")" << endl;
+  FILE_LOG(LOG_OPT) << "LP::lsq_seidel() entered" << endl;
+  FILE_LOG(LOG_OPT) << "A: " << endl << A;
+  FILE_LOG(LOG_OPT) << "b: " << b << endl;
+  FILE_LOG(LOG_OPT) << "C: " << endl << C;
+  FILE_LOG(LOG_OPT) << "e: " << e << endl;
 
-      return false; 
-    }
-  
-    // set x
-    x.resize(1);
-    x[0] = (c[0] >= 0.0) ? high : low;
+  // the variables are unbounded and there is no linear term
+  const unsigned D = A.columns();
+  c.set_zero(D);
+  l.set_one(D) *= -INF;
+  u.set_one(D) *= INF;
+  bool result = solve(A, b, c, l, u, C, e, x);
 
-    FILE_LOG(LOG_OPT) << "optimal 1D x=" << x << endl;
-    FILE_LOG(LOG_OPT) << "LP::lp() exited" << endl;
+  FILE_LOG(LOG_OPT) << "LP::lsq_seidel() exited" << endl;
 
-    // otherwise, good return
-    return true; 
-  }
+  return result;
+}
 
-  // all work variables
-  vector<VectorNd> aac;
-  vector<VectorNd> aa;
-  vector<unsigned> permut;
-  vector<double> bbc;
-  MatrixNd Aprime;
-  VectorNd bb, aak, cprime, lprime, uprime, bprime, workv, f, g;
+/// Solves min 1/2||Cx + e||^2 - c'x s.t. Ax <= b, l <= x <= u
+/**
+ * If C has any rows, c must be zero and l and u must be -/+ DBL_MAX.
+ */
+bool LP::solve(const MatrixNd& A, const VectorNd& b, const VectorNd& c, const VectorNd& l, const VectorNd& u, const MatrixNd& C, const VectorNd& e, VectorNd& x)
+{
+  const unsigned n = A.rows();
+  const unsigned d = A.columns();
+  const unsigned m = C.rows();
 
-  // pick a random shuffle for A and b
-  permut.resize(n);
+  // handle the trivial case
+  if (d == 0)
+  {
+    x.resize(0);
+    for (unsigned i=0; i< n; i++)
+      if (b[i] < -constraint_tol(b[i]))
+        return false;
+    return true;
+  }
+
+  // determine the size of the workspace: scratch space for
+  // solve_unconstrained(), the top-level problem, and the subproblem at
+  // each lower dimension (a subproblem has at most two more constraints than
+  // its parent)
+  const unsigned SCRATCH = 2*m*m + 2*m;
+  unsigned sz = SCRATCH + n*d + n + 3*d + m*d + m + d;
+  for (unsigned k=d-1; k > 0; k--)
+  {
+    const unsigned R = n + 2*(d-k);
+    sz += R*k + R + 3*k + m*k + m + k;
+  }
+  LPWorkspace& ws = _workspace.get();
+  if (ws.work.size() < sz)
+    ws.work.resize(sz);
+
+  // partition the workspace
+  double* scratch = &ws.work[0];
+  double* AA = scratch + SCRATCH;
+  double* bb = AA + n*d;
+  double* cc = bb + n;
+  double* ll = cc + d;
+  double* uu = ll + d;
+  double* CC = uu + d;
+  double* ee = CC + m*d;
+  double* xx = ee + m;
+  double* stack = xx + d;
+
+  // determine a (reproducible) random order for the constraints
+  vector<unsigned>& perm = ws.perm;
+  perm.resize(n);
   for (unsigned i=0; i< n; i++)
-    permut[i] = i;
-  std::random_shuffle(permut.begin(), permut.end());
+    perm[i] = i;
+  unsigned long long state = seed;
+  for (unsigned i=n; i > 1; i--)
+    std::swap(perm[i-1], perm[next_random(state) % i]);
 
-  // setup aa and bb
-  aa.resize(n);
-  bb.resize(n);
+  // copy the problem (row-major)
   for (unsigned i=0; i< n; i++)
   {
-    A.get_row(permut[i], aa[i]);
-    bb[i] = b[permut[i]];
+    for (unsigned j=0; j< d; j++)
+      AA[i*d+j] = A(perm[i],j);
+    bb[i] = finitize(b[perm[i]]);
+  }
+  for (unsigned j=0; j< d; j++)
+  {
+    cc[j] = c[j];
+    ll[j] = finitize(l[j]);
+    uu[j] = finitize(u[j]);
+  }
+  for (unsigned i=0; i< m; i++)
+  {
+    for (unsigned j=0; j< d; j++)
+      CC[i*d+j] = C(i,j);
+    ee[i] = e[i];
   }
 
-  FILE_LOG(LOG_OPT) << "A (permuted): " << endl;
-  for (unsigned i=0; i< n; i++)
-    FILE_LOG(LOG_OPT) << aa[i] << endl;
-  FILE_LOG(LOG_OPT) << "b (permuted): " << bb << endl;
+  // solve
+  if (!seidel(d, n, AA, bb, cc, ll, uu, m, CC, ee, xx, stack, scratch))
+  {
+    FILE_LOG(LOG_OPT) << "problem is infeasible" << endl;
+    return false;
+  }
 
-  // setup optimum vector
+  // copy the solution
   x.resize(d);
-  for (unsigned i=0; i< d; i++)
-    if (c[i] > 0.0)
-        x[i] = u[i];
-    else if (c[i] < 0.0) 
-        x[i] = l[i];
-    else
-        x[i] = (std::fabs(l[i]) < std::fabs(u[i])) ? l[i] : u[i];
+  for (unsigned j=0; j< d; j++)
+    x[j] = xx[j];
+
+  // verify that half-plane constraints still met
+  if (LOGGING(LOG_OPT))
+  {
+    for (unsigned i=0; i< b.rows(); i++)
+      FILE_LOG(LOG_OPT) << i << ": b - A*x = " << (b[i] - VectorNd::dot(A.row(i), x)) << endl;
+  }
+
+  FILE_LOG(LOG_OPT) << "all halfspace constraints satisfied; optimum found!" << endl;
+  FILE_LOG(LOG_OPT) << "optimum = " << x << endl;
+
+  return true;
+}
+
+/// Solves the (row-major) problem min 1/2||Cx + e||^2 - c'x s.t. Ax <= b, l <= x <= u
+/**
+ * Constraints are added one at a time, in the order given. If the optimum
+ * for the constraints processed so far violates constraint i, an optimum
+ * for the first i+1 constraints lies on the boundary of constraint i; one
+ * variable is then eliminated using that boundary and the first i
+ * constraints are solved recursively in one fewer dimension.
+ * \param stack workspace for the subproblems
+ * \param scratch workspace for solve_unconstrained()
+ */
+bool LP::seidel(unsigned d, unsigned n, const double* A, const double* b, const double* c, const double* l, const double* u, unsigned m, const double* C, const double* e, double* x, double* stack, double* scratch)
+{
+  const double INF = std::numeric_limits<double>::max();
 
-  FILE_LOG(LOG_OPT) << "initial x=" << x << endl;
+  // base case d = 1
+  if (d == 1)
+    return seidel_1d(n, A, b, c[0], l[0], u[0], m, C, e, x[0]);
+
+  // setup the optimum without halfspace constraints
+  solve_unconstrained(d, c, l, u, m, C, e, x, scratch);
 
-  // process half-space constraints 
+  // process halfspace constraints
   for (unsigned i=0; i< n; i++)
   {
-    FILE_LOG(LOG_OPT) << "-- processing halfspace constraint " << i << endl;
+    const double* ai = A + i*d;
 
     // if x respects new halfspace constraint, nothing else to do..
-    double val = bb[i] - VectorNd::dot(aa[i], x);
-    if (val >= -EPS_DOUBLE)
-    {    
-      FILE_LOG(LOG_OPT) << "  ** constraint already satisfied!" << endl;
+    double val = b[i];
+    for (unsigned j=0; j< d; j++)
+      val -= ai[j]*x[j];
+    if (val >= -constraint_tol(b[i]))
       continue;
-    }
-
-    FILE_LOG(LOG_OPT) << "  -- constraint not satisfied (" << val << "); solving recursively" << endl;
 
     // search for maximum value in the a vector
-    unsigned k = std::numeric_limits<unsigned>::max();
-    double maximal = -std::numeric_limits<double>::max();
-    for (unsigned j=0; j< d; j++)
-      if (std::fabs(aa[i][j]) > maximal && aa[i][j] != 0.0)
-      {
-        maximal = std::fabs(aa[i][j]);
+    unsigned k = 0;
+    for (unsigned j=1; j< d; j++)
+      if (std::fabs(ai[j]) > std::fabs(ai[k]))
         k = j;
-      }
-
-    FILE_LOG(LOG_OPT) << "  -- determined k: " << k << endl;
 
     // look for infeasibility
-    if (k == std::numeric_limits<unsigned>::max())
+    if (std::fabs(ai[k]) < std::numeric_limits<double>::epsilon())
     {
-      FILE_LOG(LOG_OPT) << "  -- k is infeasible; problem is infeasible" << endl;
-
-      return false; 
+      FILE_LOG(LOG_OPT) << "infeasible; b is negative and A is zero" << endl;
+      return false;
     }
 
-    // setup useful vector and constant
-    aak = aa[i];
-    aak /= aa[i][k];
-    double bak = bb[i]/aa[i][k];
-
-    FILE_LOG(LOG_OPT) << "  -- vector a/a(k): " << aak << " " << bak << endl;
+    // x[k] = bak - sum_{j != k} aak[j]*x[j] on the boundary of constraint i
+    const double ak = ai[k];
+    const double bak = b[i]/ak;
+
+    // partition the workspace for the subproblem
+    const unsigned dc = d-1;
+    const unsigned nc = i + ((u[k] < INF) ? 1 : 0) + ((l[k] > -INF) ? 1 : 0);
+    double* Ac = stack;
+    double* bc = Ac + nc*dc;
+    double* cc = bc + nc;
+    double* lc = cc + dc;
+    double* uc = lc + dc;
+    double* Cc = uc + dc;
+    double* ec = Cc + m*dc;
+    double* xc = ec + m;
+    double* next = xc + dc;
+
+    // setup constraints for the bounds on x[k] (processed first)
+    unsigned r = 0;
+    if (u[k] < INF)
+    {
+      for (unsigned j=0, jj=0; j< d; j++)
+        if (j != k)
+          Ac[r*dc + jj++] = -ai[j]/ak;
+      bc[r++] = finitize(u[k] - bak);
+    }
+    if (l[k] > -INF)
+    {
+      for (unsigned j=0, jj=0; j< d; j++)
+        if (j != k)
+          Ac[r*dc + jj++] = ai[j]/ak;
+      bc[r++] = finitize(bak - l[k]);
+    }
 
-    // copy vectors aa and bb
-    aac.resize(i);
-    bbc.resize(i);
-    for (unsigned j=0; j< i; j++)
+    // eliminate x[k] from the previous constraints
+    for (unsigned h=0; h< i; h++, r++)
     {
-      aac[j] = aa[j];
-      bbc[j] = bb[j];
+      const double* ah = A + h*d;
+      for (unsigned j=0, jj=0; j< d; j++)
+        if (j != k)
+          Ac[r*dc + jj++] = ah[j] - ah[k]*ai[j]/ak;
+      bc[r] = finitize(b[h] - ah[k]*bak);
     }
 
-    // modify copy of vector aa
-    for (unsigned j=0; j< i; j++)
+    // eliminate x[k] from the objective and the variable bounds
+    for (unsigned j=0, jj=0; j< d; j++)
     {
-      workv = aak;
-      workv *= aa[j][k];
-      aac[j] -= workv;
-      assert(std::fabs(aac[j][k]) < EPS_DOUBLE);
-      aac[j] = remove_component(aac[j], k, workv);
+      if (j == k)
+        continue;
+      cc[jj] = c[j] - c[k]*ai[j]/ak;
+      lc[jj] = l[j];
+      uc[jj] = u[j];
+      for (unsigned q=0; q< m; q++)
+        Cc[q*dc + jj] = C[q*d + j] - C[q*d + k]*ai[j]/ak;
+      jj++;
     }
+    for (unsigned q=0; q< m; q++)
+      ec[q] = e[q] + C[q*d + k]*bak;
 
-    // modify copy of vector bb 
-    for (unsigned j=0; j< i; j++)
+    // solve the (d-1)-dimensional problem and ``lift'' the solution
+    if (!seidel(dc, nc, Ac, bc, cc, lc, uc, m, Cc, ec, xc, next, scratch))
+      return false;
+    double xk = bak;
+    for (unsigned j=0, jj=0; j< d; j++)
     {
-      bbc[j] -= bak * aa[j][k];
-      if (std::isinf(bbc[j]))
-        bbc[j] = finitize(bbc[j]);
+      if (j == k)
+        continue;
+      x[j] = xc[jj++];
+      xk -= ai[j]/ak*x[j];
     }
+    x[k] = xk;
+  }
 
-    // modify copy of c
-    assert(std::fabs((c[k] - aak[k]*c[k])) < EPS_DOUBLE);
-    workv = aak;
-    workv *= c[k];
-    workv -= c;
-    workv.negate(); 
-    remove_component(workv, k, cprime);  
-
-    // generate new lower and upper bounds for variables
-    remove_component(l, k, lprime);
-    remove_component(u, k, uprime);
-
-    // setup two new constraints 
-    f.set_zero(d);
-    g.set_zero(d);
-    f[k] = 1;
-    g[k] = -1;
-    assert(std::fabs((f[k] - aak[k])) < EPS_DOUBLE);
-    assert(std::fabs((g[k] + aak[k])) < EPS_DOUBLE);
-    f = remove_component(f -= aak, k, workv);
-    g = remove_component(g += aak, k, workv);
-    double bf = u[k] - bak;
-    double bg = -l[k] + bak;
-    if (std::isinf(bf))
-      bf = finitize(bf);
-    if (std::isinf(bg))
-      bg = finitize(bg);
-    aac.push_back(f);
-    bbc.push_back(bf);
-    aac.push_back(g);
-    bbc.push_back(bg);
-
-    // create the Aprime matrix from aac
-    Aprime.resize(aac.size(), d-1);  
-    for (unsigned j=0; j< aac.size(); j++)
-      Aprime.set_row(j, aac[j]);
-
-    // create the bprime vector from bbc
-    bprime.resize(bbc.size());
-    for (unsigned j=0; j< bbc.size(); j++)
-      bprime[j] = bbc[j];
-
-    FILE_LOG(LOG_OPT) << "  -- A': " << endl << Aprime;
-    FILE_LOG(LOG_OPT) << "  -- b': " << bprime << endl;
-    FILE_LOG(LOG_OPT) << "  -- c': " << cprime << endl;
-    FILE_LOG(LOG_OPT) << "  -- u': " << uprime << endl;
-    FILE_LOG(LOG_OPT) << "  -- l': " << lprime << endl;
-    FILE_LOG(LOG_OPT) << "  -- f: " << f << " " << bf << endl;
-    FILE_LOG(LOG_OPT) << "  -- g: " << g << " " << bg << endl;
-    FILE_LOG(LOG_OPT) << " + solving recursive subproblem" << endl;
+  return true;
+}
 
-    // solve the (d-1)-dimensional problem and ``lift'' the solution
-    if (!lp_seidel(Aprime,bprime,cprime,lprime,uprime,x))
+/// Solves the one-dimensional problem min 1/2||Cx + e||^2 - cx s.t. Ax <= b, l <= x <= u
+bool LP::seidel_1d(unsigned n, const double* A, const double* b, double c, double l, double u, unsigned m, const double* C, const double* e, double& x)
+{
+  double high = u;
+  double low = l;
+
+  for (unsigned i=0; i< n; i++)
+  {
+    if (A[i] > std::numeric_limits<double>::epsilon())
+      high = std::min(high, b[i]/A[i]);
+    else if (A[i] < -std::numeric_limits<double>::epsilon())
+      low = std::max(low, b[i]/A[i]);
+    else if (b[i] < -constraint_tol(b[i]))
+    {
+      FILE_LOG(LOG_OPT) << "infeasible; b is negative and A is zero" << endl;
       return false;
+    }
+  }
 
-    FILE_LOG(LOG_OPT) << "  -- recursively determined x: " << x << endl;
-    FILE_LOG(LOG_OPT) << "  -- k: " << k << endl;
-
-    // insert a zero into the k'th dimension of x
-    x = insert_component(x, k, workv);
-    FILE_LOG(LOG_OPT) << "  -- x w/inserted component at k: " << x << endl;
-
-    // solve for the proper k'th value of x
-    x[k] = (bb[i] - VectorNd::dot(aa[i], x))/aa[i][k];
-    FILE_LOG(LOG_OPT) << "  -- optimal x (to this point): " << x << endl;
-/*
-    // verify that half-plane constraints still met
-    for (unsigned j=0; j<= i; j++)
-      assert(VectorNd::dot(aa[j], x) - bb[j] <= EPS_DOUBLE);
-
-    // verify that lower constraints still met
-    for (unsigned j=0; j< l.size(); j++)
-      assert(x[j] >= l[j] - EPS_DOUBLE);
-
-    // verify that upper constraints still met
-    for (unsigned j=0; j< l.size(); j++)
-      assert(x[j] <= u[j] + EPS_DOUBLE);
-*/
+  // do a check for infeasibility
+  if (high < low)
+  {
+    if (low - high > constraint_tol(std::max(std::fabs(low), std::fabs(high))))
+    {
+      FILE_LOG(LOG_OPT) << "infeasible; high (" << high << ") < low (" << low << ")" << endl;
+      return false;
+    }
+    high = low = 0.5*(low + high);
   }
 
-  // verify that half-plane constraints still met
-  if (LOGGING(LOG_OPT))
+  // get the curvature and the slope of the objective at zero
+  double H = 0.0, g = c;
+  for (unsigned i=0; i< m; i++)
   {
-    for (unsigned i=0; i< b.rows(); i++)
-      FILE_LOG(LOG_OPT) << i << ": b - A*x = " << (b[i] - VectorNd::dot(A.row(i), x)) << endl;
+    H += C[i]*C[i];
+    g -= C[i]*e[i];
   }
-/*
-  for (unsigned j=0; j < n; j++)
-    assert(VectorNd::dot(aa[j], x) - bb[j] <= EPS_DOUBLE);
-  // verify that lower constraints still met
-  for (unsigned i=0; i< l.size(); i++)
-    assert(x[i] >= l[i] - EPS_DOUBLE);
-
-  // verify that upper constraints still met
-  for (unsigned i=0; i< l.size(); i++)
-    assert(x[i] <= u[i] + EPS_DOUBLE);
-*/
 
-  FILE_LOG(LOG_OPT) << "all halfspace constraints satisfied; optimum found!" << endl;
-  FILE_LOG(LOG_OPT) << "optimum = " << x << endl;
-  FILE_LOG(LOG_OPT) << "LP::lp_seidel() exited" << endl;
+  // set x
+  if (H > std::numeric_limits<double>::epsilon())
+    x = std::min(std::max(g/H, low), high);
+  else if (g > 0.0)
+    x = high;
+  else if (g < 0.0)
+    x = low;
+  else
+    x = std::min(std::max(0.0, low), high);
 
-  return true; 
+  return true;
 }
 
-/// Inserts a component (value will be zero) at the k'th position in the given vector and returns a new vector
-VectorNd& LP::insert_component(const VectorNd& x, unsigned k, VectorNd& xn)
+/// Computes the optimum of min 1/2||Cx + e||^2 - c'x s.t. l <= x <= u
+void LP::solve_unconstrained(unsigned d, const double* c, const double* l, const double* u, unsigned m, const double* C, const double* e, double* x, double* scratch)
 {
-  xn.resize(x.size()+1);
+  const unsigned MAX_SWEEPS = 50;
 
-  if (k == 0)
-    xn.set_sub_vec(1, x);
-  else if (k == x.size())
-    xn.set_sub_vec(0, x);
-  else
+  // linear objective: pick the best corner of the box
+  if (m == 0)
   {
-    xn.set_sub_vec(0,x.segment(0,k));
-    xn.set_sub_vec(k+1,x.segment(k,x.size()));
-  }  
-  xn[k] = 0;
-  
-  return xn;
-}
+    for (unsigned j=0; j< d; j++)
+    {
+      if (c[j] > 0.0)
+        x[j] = u[j];
+      else if (c[j] < 0.0)
+        x[j] = l[j];
+      else
+        x[j] = std::min(std::max(0.0, l[j]), u[j]);
+    }
+    return;
+  }
 
-/// Gets a subvector with the k'th component removed
-/**
- * \note for use by lp()
- */
-VectorNd& LP::remove_component(const VectorNd& v, unsigned k, VectorNd& vp)
-{
-  const unsigned d = v.size();
+  // least-squares objective (the variables are unbounded): the minimum norm
+  // minimizer is x = -C'*pinv(C*C')*e; compute C*C' = V*diag(lambda)*V'
+  // using Jacobi rotations
+  double* G = scratch;
+  double* V = G + m*m;
+  double* y = V + m*m;
+  double* t = y + m;
+  for (unsigned i=0; i< m; i++)
+    for (unsigned j=0; j< m; j++)
+    {
+      double dot = 0.0;
+      for (unsigned k=0; k< d; k++)
+        dot += C[i*d+k]*C[j*d+k];
+      G[i*m+j] = dot;
+      V[i*m+j] = (i == j) ? 1.0 : 0.0;
+    }
+  for (unsigned sweep=0; sweep < MAX_SWEEPS; sweep++)
+  {
+    // check for convergence
+    double off = 0.0, diag = 0.0;
+    for (unsigned i=0; i< m; i++)
+    {
+      diag += G[i*m+i]*G[i*m+i];
+      for (unsigned j=i+1; j< m; j++)
+        off += G[i*m+j]*G[i*m+j];
+    }
+    if (off <= std::numeric_limits<double>::epsilon()*std::numeric_limits<double>::epsilon()*diag)
+      break;
 
-  if (k == 0)
-    return v.get_sub_vec(1,d,vp);
-  else if (k == d-1)
-    return v.get_sub_vec(0,d-1,vp);
-  else
+    // do a sweep
+    for (unsigned p=0; p< m; p++)
+      for (unsigned q=p+1; q< m; q++)
+      {
+        if (G[p*m+q] == 0.0)
+          continue;
+        double theta = (G[q*m+q] - G[p*m+p])/(2.0*G[p*m+q]);
+        double tn = ((theta >= 0.0) ? 1.0 : -1.0)/(std::fabs(theta) + std::sqrt(theta*theta + 1.0));
+        double cs = 1.0/std::sqrt(tn*tn + 1.0);
+        double sn = tn*cs;
+        for (unsigned k=0; k< m; k++)
+        {
+          double gkp = G[k*m+p], gkq = G[k*m+q];
+          G[k*m+p] = cs*gkp - sn*gkq;
+          G[k*m+q] = sn*gkp + cs*gkq;
+        }
+        for (unsigned k=0; k< m; k++)
+        {
+          double gpk = G[p*m+k], gqk = G[q*m+k];
+          G[p*m+k] = cs*gpk - sn*gqk;
+          G[q*m+k] = sn*gpk + cs*gqk;
+        }
+        for (unsigned k=0; k< m; k++)
+        {
+          double vkp = V[k*m+p], vkq = V[k*m+q];
+          V[k*m+p] = cs*vkp - sn*vkq;
+          V[k*m+q] = sn*vkp + cs*vkq;
+        }
+      }
+  }
+
+  // compute y = pinv(C*C')*e
+  double lambda_max = 0.0;
+  for (unsigned i=0; i< m; i++)
+    lambda_max = std::max(lambda_max, G[i*m+i]);
+  const double ZERO_TOL = m*std::numeric_limits<double>::epsilon()*lambda_max;
+  for (unsigned i=0; i< m; i++)
   {
-    // setup v w/component k removed
-    vp.resize(d-1);    
-    vp.set_sub_vec(0, v.segment(0, k));
-    vp.set_sub_vec(k, v.segment(k+1, d)); 
-    return vp;
+    t[i] = 0.0;
+    if (G[i*m+i] > ZERO_TOL)
+    {
+      for (unsigned k=0; k< m; k++)
+        t[i] += V[k*m+i]*e[k];
+      t[i] /= G[i*m+i];
+    }
+  }
+  for (unsigned i=0; i< m; i++)
+  {
+    y[i] = 0.0;
+    for (unsigned k=0; k< m; k++)
+      y[i] += V[i*m+k]*t[k];
+  }
+
+  // compute x = -C'*y
+  for (unsigned j=0; j< d; j++)
+  {
+    x[j] = 0.0;
+    for (unsigned i=0; i< m; i++)
+      x[j] -= C[i*d+j]*y[i];
   }
 }
 
@@ -353,4 +526,3 @@ double LP::finitize(double x)
     return x;
 }
 
-
@@ -0,0 +1,199 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#include <cmath>
+#include <limits>
+#include <Moby/Constants.h>
+#include <Moby/XMLTree.h>
+#include <Moby/LidarSensor.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using std::map;
+using std::list;
+using std::vector;
+using boost::shared_ptr;
+
+/// Constructs a solid state, planar lidar with one sample per degree
+LidarSensor::LidarSensor()
+{
+  horizontal_samples = 360;
+  vertical_samples = 1;
+  min_azimuth = -M_PI;
+  max_azimuth = M_PI;
+  min_elevation = max_elevation = 0.0;
+  spin_rate = 0.0;
+  _col0 = _ncols = 0;
+  _last_tick = -1;
+}
+
+/// Allocates the range buffer and precomputes the sample angles
+/**
+ * This method must be called after any of the sampling parameters change.
+ */
+void LidarSensor::setup()
+{
+  const double INF = std::numeric_limits<double>::max();
+
+  if (horizontal_samples == 0 || vertical_samples == 0)
+    throw std::runtime_error("LidarSensor::setup() - number of samples must be positive");
+
+  _ranges.assign(horizontal_samples*vertical_samples, INF);
+  _saz.resize(horizontal_samples);
+  _caz.resize(horizontal_samples);
+  for (unsigned i=0; i< horizontal_samples; i++)
+  {
+    const double AZ = get_azimuth(i);
+    _saz[i] = std::sin(AZ);
+    _caz[i] = std::cos(AZ);
+  }
+  _sel.resize(vertical_samples);
+  _cel.resize(vertical_samples);
+  for (unsigned i=0; i< vertical_samples; i++)
+  {
+    const double EL = get_elevation(i);
+    _sel[i] = std::sin(EL);
+    _cel[i] = std::cos(EL);
+  }
+
+  _col0 = 0;
+  _ncols = horizontal_samples;
+  _last_tick = -1;
+}
+
+/// Gets the azimuth of a column
+double LidarSensor::get_azimuth(unsigned col) const
+{
+  // a spinning lidar covers a full revolution
+  if (spin_rate != 0.0)
+    return 2.0*M_PI*col/horizontal_samples;
+
+  // do not sample the same direction twice for a full revolution
+  const double SPAN = max_azimuth - min_azimuth;
+  if (SPAN >= 2.0*M_PI - NEAR_ZERO)
+    return min_azimuth + SPAN*col/horizontal_samples;
+  else if (horizontal_samples > 1)
+    return min_azimuth + SPAN*col/(horizontal_samples-1);
+  else
+    return 0.5*(min_azimuth + max_azimuth);
+}
+
+/// Gets the elevation of a row
+double LidarSensor::get_elevation(unsigned row) const
+{
+  if (vertical_samples > 1)
+    return min_elevation + (max_elevation - min_elevation)*row/(vertical_samples-1);
+  else
+    return 0.5*(min_elevation + max_elevation);
+}
+
+/// Selects the columns to be sampled for an update at time t
+void LidarSensor::prepare(double t)
+{
+  if (_ranges.size() != horizontal_samples*vertical_samples)
+    setup();
+
+  // a solid state lidar samples every column
+  if (spin_rate == 0.0)
+  {
+    _col0 = 0;
+    _ncols = horizontal_samples;
+    return;
+  }
+
+  // determine the number of columns that the head has passed
+  const long TICK = (long) std::floor(std::fabs(spin_rate)*t/(2.0*M_PI)*horizontal_samples);
+  if (_last_tick < 0 || TICK - _last_tick >= (long) horizontal_samples)
+  {
+    _col0 = (unsigned) ((TICK+1) % horizontal_samples);
+    _ncols = horizontal_samples;
+  }
+  else
+  {
+    _col0 = (unsigned) ((_last_tick+1) % horizontal_samples);
+    _ncols = (unsigned) std::max(TICK - _last_tick, 0L);
+  }
+  _last_tick = TICK;
+}
+
+/// Appends the rays for the columns selected by prepare()
+void LidarSensor::get_rays(vector<LineSeg3>& segs) const
+{
+  Transform3d gTs = Pose3d::calc_relative_pose(_F, GLOBAL);
+  for (unsigned i=0; i< vertical_samples; i++)
+    for (unsigned j=0; j< _ncols; j++)
+    {
+      const unsigned COL = (_col0 + j) % horizontal_samples;
+      Origin3d dir(_cel[i]*_caz[COL], _cel[i]*_saz[COL], _sel[i]);
+      append_ray(gTs, dir, min_range, max_range, segs);
+    }
+}
+
+/// Sets the ranges of the columns selected by prepare()
+void LidarSensor::set_ray_results(const SceneQueryResults& results, unsigned offset)
+{
+  const double INF = std::numeric_limits<double>::max();
+
+  for (unsigned i=0, k=offset; i< vertical_samples; i++)
+    for (unsigned j=0; j< _ncols; j++, k++)
+    {
+      const unsigned COL = (_col0 + j) % horizontal_samples;
+      _ranges[i*horizontal_samples + COL] = (results.geoms[k]) ? min_range + results.t[k]*(max_range - min_range) : INF;
+    }
+}
+
+/// Implements Base::load_from_xml()
+void LidarSensor::load_from_xml(shared_ptr<const XMLTree> node, map<std::string, BasePtr>& id_map)
+{
+  // load the parent data
+  RaySensor::load_from_xml(node, id_map);
+
+  // read the sampling parameters
+  XMLAttrib* hsamples_attr = node->get_attrib("horizontal-samples");
+  if (hsamples_attr)
+    horizontal_samples = hsamples_attr->get_unsigned_value();
+  XMLAttrib* vsamples_attr = node->get_attrib("vertical-samples");
+  if (vsamples_attr)
+    vertical_samples = vsamples_attr->get_unsigned_value();
+  XMLAttrib* min_az_attr = node->get_attrib("min-azimuth");
+  if (min_az_attr)
+    min_azimuth = min_az_attr->get_real_value();
+  XMLAttrib* max_az_attr = node->get_attrib("max-azimuth");
+  if (max_az_attr)
+    max_azimuth = max_az_attr->get_real_value();
+  XMLAttrib* min_el_attr = node->get_attrib("min-elevation");
+  if (min_el_attr)
+    min_elevation = min_el_attr->get_real_value();
+  XMLAttrib* max_el_attr = node->get_attrib("max-elevation");
+  if (max_el_attr)
+    max_elevation = max_el_attr->get_real_value();
+  XMLAttrib* spin_attr = node->get_attrib("spin-rate");
+  if (spin_attr)
+    spin_rate = spin_attr->get_real_value();
+
+  // allocate the buffers
+  setup();
+}
+
+/// Implements Base::save_to_xml()
+void LidarSensor::save_to_xml(XMLTreePtr node, list<shared_ptr<const Base> >& shared_objects) const
+{
+  // save the parent data
+  RaySensor::save_to_xml(node, shared_objects);
+
+  // (re)set the name of this node
+  node->name = "Lidar";
+
+  // save the sampling parameters
+  node->attribs.insert(XMLAttrib("horizontal-samples", horizontal_samples));
+  node->attribs.insert(XMLAttrib("vertical-samples", vertical_samples));
+  node->attribs.insert(XMLAttrib("min-azimuth", min_azimuth));
+  node->attribs.insert(XMLAttrib("max-azimuth", max_azimuth));
+  node->attribs.insert(XMLAttrib("min-elevation", min_elevation));
+  node->attribs.insert(XMLAttrib("max-elevation", max_elevation));
+  node->attribs.insert(XMLAttrib("spin-rate", spin_rate));
+}
+
@@ -0,0 +1,298 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+#include <iomanip>
+#include <Moby/MemoryAccounting.h>
+
+using namespace Moby;
+
+/// Index of the counters for all subsystems together
+static const unsigned TOTAL = MemoryAccounting::eNumSubsystems;
+
+/// The bytes currently allocated by each subsystem (and in total)
+static volatile long _bytes[MemoryAccounting::eNumSubsystems+1];
+
+/// The peak bytes allocated by each subsystem (and in total) since the last reset
+static volatile long _peaks[MemoryAccounting::eNumSubsystems+1];
+
+#ifdef MEMORY_ACCOUNTING
+/// The current subsystem of each thread
+static __thread int _current = MemoryAccounting::eOther;
+
+/// Raises a peak to the given value, if it is larger
+static void update_peak(unsigned i, long bytes)
+{
+  long peak = _peaks[i];
+  while (bytes > peak && !__sync_bool_compare_and_swap(&_peaks[i], peak, bytes))
+    peak = _peaks[i];
+}
+
+/// Charges (or credits, if bytes is negative) a subsystem for memory
+static void charge(unsigned s, long bytes)
+{
+  update_peak(s, __sync_add_and_fetch(&_bytes[s], bytes));
+  update_peak(TOTAL, __sync_add_and_fetch(&_bytes[TOTAL], bytes));
+}
+
+/// The header placed before each allocation (padded to keep alignment)
+union AllocationHeader
+{
+  struct
+  {
+    size_t size;
+    int subsystem;
+    unsigned offset;    // from the start of the malloc'd block to the memory
+  } info;
+  char padding[16];
+};
+
+/// Allocates memory (with the given alignment) and charges the current subsystem for it
+/**
+ * Memory is returned at an offset of the header size (or of the alignment,
+ * if that is larger) from the start of the underlying block.
+ */
+static void* allocate(size_t n, size_t alignment = 0)
+{
+  const size_t OFFSET = std::max(alignment, sizeof(AllocationHeader));
+  while (true)
+  {
+    void* block = NULL;
+    if (alignment <= sizeof(AllocationHeader))
+      block = std::malloc(OFFSET + n);
+    else if (posix_memalign(&block, alignment, OFFSET + n) != 0)
+      block = NULL;
+    if (block)
+    {
+      AllocationHeader* h = ((AllocationHeader*) ((char*) block + OFFSET)) - 1;
+      h->info.size = n;
+      h->info.subsystem = _current;
+      h->info.offset = (unsigned) OFFSET;
+      charge(_current, (long) n);
+      return h+1;
+    }
+
+    // give the new handler a chance to free memory
+    std::new_handler handler = std::set_new_handler(0);
+    std::set_new_handler(handler);
+    if (!handler)
+      return NULL;
+    handler();
+  }
+}
+
+/// Frees memory, crediting the subsystem that allocated it
+static void deallocate(void* p)
+{
+  if (!p)
+    return;
+  AllocationHeader* h = ((AllocationHeader*) p) - 1;
+  charge(h->info.subsystem, -(long) h->info.size);
+  std::free((char*) p - h->info.offset);
+}
+
+#if __cplusplus >= 201103L
+#define THROW_BAD_ALLOC
+#define NO_THROW noexcept
+#else
+#define THROW_BAD_ALLOC throw(std::bad_alloc)
+#define NO_THROW throw()
+#endif
+
+void* operator new(size_t n) THROW_BAD_ALLOC
+{
+  void* p = allocate(n);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t n) THROW_BAD_ALLOC
+{
+  void* p = allocate(n);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new(size_t n, const std::nothrow_t&) NO_THROW
+{
+  try
+  {
+    return allocate(n);
+  }
+  catch (...)
+  {
+    return NULL;
+  }
+}
+
+void* operator new[](size_t n, const std::nothrow_t&) NO_THROW
+{
+  try
+  {
+    return allocate(n);
+  }
+  catch (...)
+  {
+    return NULL;
+  }
+}
+
+void operator delete(void* p) NO_THROW { deallocate(p); }
+void operator delete[](void* p) NO_THROW { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) NO_THROW { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) NO_THROW { deallocate(p); }
+
+// the aligned forms (C++17) must be replaced as well; otherwise, memory for
+// over-aligned types would be allocated by the default operators and then
+// freed by the replaced ones (the sized forms of delete call the unsized
+// forms, so they need not be replaced)
+#if __cplusplus >= 201703L
+void* operator new(size_t n, std::align_val_t a)
+{
+  void* p = allocate(n, (size_t) a);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t n, std::align_val_t a)
+{
+  void* p = allocate(n, (size_t) a);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new(size_t n, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+  try
+  {
+    return allocate(n, (size_t) a);
+  }
+  catch (...)
+  {
+    return NULL;
+  }
+}
+
+void* operator new[](size_t n, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+  try
+  {
+    return allocate(n, (size_t) a);
+  }
+  catch (...)
+  {
+    return NULL;
+  }
+}
+
+void operator delete(void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(p); }
+#endif
+#endif // MEMORY_ACCOUNTING
+
+/// Determines whether allocations are being accounted for (i.e., whether Moby was built with MEMORY_ACCOUNTING)
+bool MemoryAccounting::enabled()
+{
+  #ifdef MEMORY_ACCOUNTING
+  return true;
+  #else
+  return false;
+  #endif
+}
+
+/// Makes a subsystem current in this thread
+/**
+ * \return the previously current subsystem
+ */
+MemoryAccounting::Subsystem MemoryAccounting::set_current(Subsystem s)
+{
+  #ifdef MEMORY_ACCOUNTING
+  Subsystem last = (Subsystem) _current;
+  _current = s;
+  return last;
+  #else
+  return eOther;
+  #endif
+}
+
+/// Gets the subsystem that is current in this thread
+MemoryAccounting::Subsystem MemoryAccounting::get_current()
+{
+  #ifdef MEMORY_ACCOUNTING
+  return (Subsystem) _current;
+  #else
+  return eOther;
+  #endif
+}
+
+/// Gets the number of bytes currently allocated by a subsystem
+size_t MemoryAccounting::get_bytes(Subsystem s)
+{
+  return (_bytes[s] > 0) ? (size_t) _bytes[s] : 0;
+}
+
+/// Gets the peak number of bytes allocated by a subsystem since the last call to reset_peaks()
+size_t MemoryAccounting::get_peak_bytes(Subsystem s)
+{
+  return (_peaks[s] > 0) ? (size_t) _peaks[s] : 0;
+}
+
+/// Gets the number of bytes currently allocated
+size_t MemoryAccounting::get_total_bytes()
+{
+  return (_bytes[TOTAL] > 0) ? (size_t) _bytes[TOTAL] : 0;
+}
+
+/// Gets the peak number of bytes allocated since the last call to reset_peaks()
+size_t MemoryAccounting::get_total_peak_bytes()
+{
+  return (_peaks[TOTAL] > 0) ? (size_t) _peaks[TOTAL] : 0;
+}
+
+/// Resets the peaks to the current allocations (e.g., before each step)
+void MemoryAccounting::reset_peaks()
+{
+  for (unsigned i=0; i<= TOTAL; i++)
+    _peaks[i] = _bytes[i];
+}
+
+/// Gets the name of a subsystem
+const char* MemoryAccounting::get_name(Subsystem s)
+{
+  switch (s)
+  {
+    case eGeometry:           return "geometry";
+    case eBroadPhase:         return "broad phase";
+    case eConstraints:        return "constraints";
+    case eSolver:             return "solver";
+    case eArticulatedBodies:  return "articulated bodies";
+    case eIO:                 return "I/O";
+    default:                  return "other";
+  }
+}
+
+/// Writes the current and peak allocations (in kilobytes) of each subsystem
+void MemoryAccounting::report(std::ostream& out)
+{
+  const double KB = 1.0/1024;
+
+  out << std::setw(20) << std::left << "subsystem" << std::setw(14) << std::right << "current (kB)" << std::setw(14) << "peak (kB)" << std::endl;
+  for (unsigned i=0; i< eNumSubsystems; i++)
+  {
+    Subsystem s = (Subsystem) i;
+    out << std::setw(20) << std::left << get_name(s) << std::setw(14) << std::right << get_bytes(s)*KB << std::setw(14) << get_peak_bytes(s)*KB << std::endl;
+  }
+  out << std::setw(20) << std::left << "total" << std::setw(14) << std::right << get_total_bytes()*KB << std::setw(14) << get_total_peak_bytes()*KB << std::endl;
+}
+
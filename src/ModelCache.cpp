@@ -0,0 +1,244 @@
+/****************************************************************************
+ * Copyright 2016 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <Moby/XMLTree.h>
+#include <Moby/IndexedTriArray.h>
+#include <Moby/CompGeom.h>
+#include <Moby/Polyhedron.h>
+#include <Moby/TessellatedPolyhedron.h>
+#include <Moby/MemoryAccounting.h>
+#include <Moby/ModelCache.h>
+
+using std::map;
+using std::string;
+using std::vector;
+using boost::shared_ptr;
+using namespace Ravelin;
+using namespace Moby;
+
+// static variables
+bool ModelCache::enabled = true;
+unsigned ModelCache::max_trees = 32;
+map<string, shared_ptr<const IndexedTriArray> > ModelCache::_meshes;
+map<string, shared_ptr<const Polyhedron> > ModelCache::_hulls;
+map<boost::weak_ptr<const IndexedTriArray>, shared_ptr<const IndexedTriArray> > ModelCache::_hull_meshes;
+map<string, ModelCache::CachedTree> ModelCache::_trees;
+unsigned long ModelCache::_tree_requests = 0;
+
+/// Gets the key that identifies a file (resolved path, size, and modification time)
+string ModelCache::get_file_key(const string& fname)
+{
+  char resolved[PATH_MAX];
+  struct stat st;
+  if (!realpath(fname.c_str(), resolved) || stat(resolved, &st) != 0)
+    return fname;
+
+  std::ostringstream key;
+  key << resolved << ":" << st.st_size << ":" << st.st_mtime;
+  return key.str();
+}
+
+/// Reads a mesh from a file (uncached)
+shared_ptr<const IndexedTriArray> ModelCache::load_mesh(const string& fname)
+{
+  return shared_ptr<const IndexedTriArray>(new IndexedTriArray(IndexedTriArray::read_from_obj(fname)));
+}
+
+/// Gets the mesh stored in the given Wavefront OBJ file
+shared_ptr<const IndexedTriArray> ModelCache::get_mesh(const string& fname)
+{
+  if (!enabled)
+    return load_mesh(fname);
+
+  const string key = get_file_key(fname);
+  map<string, shared_ptr<const IndexedTriArray> >::const_iterator i = _meshes.find(key);
+  if (i != _meshes.end())
+    return i->second;
+
+  shared_ptr<const IndexedTriArray> mesh = load_mesh(fname);
+  _meshes[key] = mesh;
+  return mesh;
+}
+
+/// Gets the convex hull of the mesh stored in the given Wavefront OBJ file
+shared_ptr<const Polyhedron> ModelCache::get_convex_hull(const string& fname)
+{
+  const string key = get_file_key(fname);
+  if (enabled)
+  {
+    map<string, shared_ptr<const Polyhedron> >::const_iterator i = _hulls.find(key);
+    if (i != _hulls.end())
+      return i->second;
+  }
+
+  // get all of the vertices and compute the convex hull (yielding a
+  // tessellated polyhedron)
+  shared_ptr<const IndexedTriArray> mesh = get_mesh(fname);
+  const vector<Origin3d>& vertices = mesh->get_vertices();
+  TessellatedPolyhedronPtr tessellated_poly = CompGeom::calc_convex_hull(vertices.begin(), vertices.end());
+
+  // convert the tessellated polyhedron to a standard polyhedron
+  shared_ptr<Polyhedron> poly(new Polyhedron);
+  tessellated_poly->to_polyhedron(*poly);
+
+  if (enabled)
+    _hulls[key] = poly;
+  return poly;
+}
+
+/// Gets the convex hull of a mesh (as a mesh)
+/**
+ * Hulls are keyed by the mesh object, so primitives that share a mesh (e.g.,
+ * a mesh returned by get_mesh()) compute its hull only once. Entries for
+ * meshes that no longer exist are discarded when a new hull is computed.
+ */
+shared_ptr<const IndexedTriArray> ModelCache::get_convex_hull_mesh(shared_ptr<const IndexedTriArray> mesh)
+{
+  if (enabled)
+  {
+    map<boost::weak_ptr<const IndexedTriArray>, shared_ptr<const IndexedTriArray> >::const_iterator i = _hull_meshes.find(mesh);
+    if (i != _hull_meshes.end())
+      return i->second;
+  }
+
+  // compute the convex hull
+  const vector<Origin3d>& verts = mesh->get_vertices();
+  TessellatedPolyhedronPtr poly = CompGeom::calc_convex_hull(verts.begin(), verts.end());
+  shared_ptr<const IndexedTriArray> hull(new IndexedTriArray(poly->get_mesh()));
+  if (!enabled)
+    return hull;
+
+  // discard hulls of meshes that no longer exist
+  for (map<boost::weak_ptr<const IndexedTriArray>, shared_ptr<const IndexedTriArray> >::iterator i = _hull_meshes.begin(); i != _hull_meshes.end(); )
+  {
+    if (i->first.expired())
+      _hull_meshes.erase(i++);
+    else
+      i++;
+  }
+
+  _hull_meshes[mesh] = hull;
+  return hull;
+}
+
+/// Clears the processed flags of a tree's nodes and attributes
+void ModelCache::clear_processed(shared_ptr<const XMLTree> node)
+{
+  const_cast<XMLTree*>(node.get())->processed = false;
+  for (std::set<XMLAttrib>::const_iterator i = node->attribs.begin(); i != node->attribs.end(); i++)
+    ((XMLAttrib*) &(*i))->processed = false;
+  for (std::list<XMLTreePtr>::const_iterator i = node->children.begin(); i != node->children.end(); i++)
+    clear_processed(*i);
+}
+
+/// Gets the XML tree stored in a model description file
+/**
+ * Trees are keyed by the resolved path, size, and modification time of the
+ * file, so loading the same model repeatedly parses it only once (and only
+ * stats the file on later loads). At most max_trees trees are kept; the
+ * least recently used tree is discarded to make room. Readers mark the nodes and attributes
+ * that they process, so those marks are cleared before a cached tree is
+ * returned.
+ */
+shared_ptr<const XMLTree> ModelCache::get_tree(const string& fname)
+{
+  if (!enabled)
+    return XMLTree::read_from_xml(fname);
+
+  // look for the tree
+  const string key = get_file_key(fname);
+  map<string, CachedTree>::iterator i = _trees.find(key);
+  if (i != _trees.end())
+  {
+    i->second.last_used = ++_tree_requests;
+    clear_processed(i->second.tree);
+    return i->second.tree;
+  }
+
+  // parse the tree
+  shared_ptr<const XMLTree> tree = XMLTree::read_from_xml(fname);
+  if (!tree || max_trees == 0)
+    return tree;
+
+  // discard the least recently used tree to make room, if necessary
+  if (_trees.size() >= max_trees)
+  {
+    map<string, CachedTree>::iterator lru = _trees.begin();
+    for (map<string, CachedTree>::iterator j = _trees.begin(); j != _trees.end(); j++)
+      if (j->second.last_used < lru->second.last_used)
+        lru = j;
+    _trees.erase(lru);
+  }
+
+  // store the tree
+  CachedTree& entry = _trees[key];
+  entry.tree = tree;
+  entry.last_used = ++_tree_requests;
+  return tree;
+}
+
+/// Loads all meshes that are not already cached, in parallel
+void ModelCache::prefetch_meshes(const vector<string>& fnames)
+{
+  if (!enabled)
+    return;
+
+  // determine the meshes that must be loaded (once each)
+  vector<string> to_load, keys;
+  for (unsigned i=0; i< fnames.size(); i++)
+  {
+    const string key = get_file_key(fnames[i]);
+    if (_meshes.find(key) != _meshes.end() || std::find(keys.begin(), keys.end(), key) != keys.end())
+      continue;
+    to_load.push_back(fnames[i]);
+    keys.push_back(key);
+  }
+
+  // load the meshes
+  vector<shared_ptr<const IndexedTriArray> > meshes(to_load.size());
+  vector<string> errors(to_load.size());
+  // worker threads do not inherit the subsystem current in this thread
+  const MemoryAccounting::Subsystem MEM_SUBSYSTEM = MemoryAccounting::get_current();
+  #ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic)
+  #endif
+  for (int i=0; i< (int) to_load.size(); i++)
+  {
+    MemoryAccounting::Scope mem_scope(MEM_SUBSYSTEM);
+    try
+    {
+      meshes[i] = load_mesh(to_load[i]);
+    }
+    catch (std::exception& e)
+    {
+      errors[i] = e.what();
+    }
+  }
+
+  // store the meshes
+  for (unsigned i=0; i< to_load.size(); i++)
+  {
+    if (!errors[i].empty())
+      throw std::runtime_error(errors[i]);
+    _meshes[keys[i]] = meshes[i];
+  }
+}
+
+/// Removes everything from the cache
+void ModelCache::clear()
+{
+  _meshes.clear();
+  _hulls.clear();
+  _hull_meshes.clear();
+  _trees.clear();
+}
+
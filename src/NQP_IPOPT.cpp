@@ -1,27 +1,12 @@
 /****************************************************************************
  * Copyright 2013 Evan Drumwright
- * This library is distributed under the terms of the Apache V2.0 
+ * This library is distributed under the terms of the Apache V2.0
  * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
  ****************************************************************************/
 
-#include <numeric>
+#include <limits>
 #include <Moby/NQP_IPOPT.h>
 
-extern "C"
-{
-void cblas_dcopy(const int N, const double *X, const int incX,
-                 double *Y, const int incY);
-void cblas_dgemv(const enum CBLAS_ORDER order,
-                 const enum CBLAS_TRANSPOSE TransA, const int M, const int N,
-                 const double alpha, const double *A, const int lda,
-                 const double *X, const int incX, const double beta,
-                 double *Y, const int incY);
-void cblas_dscal(const int N, const double alpha, double *X, const int incX);
-void cblas_daxpy(const int N, const double alpha, const double *X,
-                 const int incX, double *Y, const int incY);
-}
-
-using boost::shared_array;
 using namespace Moby;
 using namespace Ravelin;
 using namespace Ipopt;
@@ -30,276 +15,96 @@ static double sqr(double x) { return x*x; }
 
 NQP_IPOPT::NQP_IPOPT()
 {
-  _ZERO_EPS = NEAR_ZERO;
+  warm_start = false;
+  epd = NULL;
+  _n = _m = 0;
+  _cJac_constant = 0;
 }
 
-/// User should not call this method (for IPOPT)
-bool NQP_IPOPT::get_nlp_info(Index& n, Index& m, Index& nnz_jac_g, Index& nnz_h_lag, IndexStyleEnum& index_style)   
+/// Computes the sparse Hessian and constraint Jacobian from the problem data
+/**
+ * Must be called after H, c, and epd are set and before the problem is
+ * solved.
+ * \return <b>true</b> if the sparsity structure is identical to that from
+ *         the last call (so IPOPT may be reoptimized rather than set up)
+ */
+bool NQP_IPOPT::setup_sparse()
 {
   const unsigned N_CONTACTS = epd->N_CONTACTS;
-  const unsigned N_ACT_CONTACTS = epd->N_ACT_CONTACTS;
   const unsigned N_LIMITS = epd->N_LIMITS;
-  n = N_ACT_CONTACTS*3 + N_LIMITS;
-  m = N_CONTACTS + N_ACT_CONTACTS + N_LIMITS + 1;
-  MatrixNd t1, t2;
-
-  // compute nonzeros for objective part of Hessian 
-  nnz_h_lag = 0;
-  _nnz_h_obj = 0;
-  _nnz_h_con.clear();
-  _nnz_h_con.resize(N_ACT_CONTACTS, 0);
-
-  // clear constraint h indices
-  _h_con_indices.clear();
-  _h_con_indices.resize(N_ACT_CONTACTS);
-  _nnz_h_con.resize(N_ACT_CONTACTS);
-  _h_con.resize(N_ACT_CONTACTS);
-  std::map<std::pair<unsigned, unsigned>, unsigned> h_obj_nz_indices;
-
-  // determine whether the problem is dense or not
-  _dense = (R.columns() > 0);
-
-  // compute nonzeros for (friction) constraint part of Hessian
-  if (!_dense)
-  {
-    // compute nonzeros for objective part of Hessian
-    for (unsigned i=0, k=0; i< n; i++)
-      for (unsigned j=i; j< n; j++)
-        if (std::fabs(H(i,j)) > _ZERO_EPS)
-        {
-          h_obj_nz_indices[std::make_pair(i,j)] = k++;
-          _nnz_h_obj++;
-          nnz_h_lag++;
-        }
-
-    // compute nonzeros for Coulomb friction part of Hessian
-    for (unsigned i=0; i< N_ACT_CONTACTS; i++)
-    {
-      const unsigned N_IDX = i;
-      const unsigned S_IDX = i + N_ACT_CONTACTS;
-      const unsigned T_IDX = i + N_ACT_CONTACTS*2;
-
-      // setup nnz_h_con
-      _nnz_h_con[i] = 3;
-
-      // setup constraint indices
-      _h_con_indices[i].resize(3);
-      _h_con_indices[i][0] = h_obj_nz_indices[std::make_pair(N_IDX,N_IDX)];
-      _h_con_indices[i][1] = h_obj_nz_indices[std::make_pair(S_IDX,S_IDX)];
-      _h_con_indices[i][2] = h_obj_nz_indices[std::make_pair(T_IDX,T_IDX)];
-
-      // setup values for constraint Hessian
-      _h_con[i] = shared_array<double>(new double[3]);
-      _h_con[i][0] = 2.0*mu_c[i];
-      _h_con[i][1] = -2.0;
-      _h_con[i][2] = -2.0;
-    }
+  const unsigned L_IDX = N_CONTACTS*3;
+  const unsigned n = N_CONTACTS*3 + N_LIMITS;
+  const unsigned m = N_CONTACTS*2 + N_LIMITS;
+
+  // save the old structure
+  const unsigned old_n = _n, old_m = _m;
+  std::vector<unsigned> old_h_iRow, old_h_jCol, old_cJac_iRow, old_cJac_jCol;
+  old_h_iRow.swap(_h_iRow);
+  old_h_jCol.swap(_h_jCol);
+  old_cJac_iRow.swap(_cJac_iRow);
+  old_cJac_jCol.swap(_cJac_jCol);
+  _n = n;
+  _m = m;
+
+  // get the upper triangle of H; elements of H are exactly zero where the
+  // constraints share no bodies, and the diagonal is always kept (it is
+  // needed for the Coulomb friction constraint Hessians)
+  _h_obj.clear();
+  _h_diag.resize(n);
+  for (unsigned i=0; i< n; i++)
+    for (unsigned j=i; j< n; j++)
+      if (i == j || H(i,j) != 0.0)
+      {
+        if (i == j)
+          _h_diag[i] = _h_obj.size();
+        _h_iRow.push_back(i);
+        _h_jCol.push_back(j);
+        _h_obj.push_back(H(i,j));
+      }
 
-    // setup objective component of Hessian and indices
-    _h_obj = shared_array<double>(new double[_nnz_h_obj]);
-    _h_iRow = shared_array<unsigned>(new unsigned[nnz_h_lag]);  
-    _h_jCol = shared_array<unsigned>(new unsigned[nnz_h_lag]);
-    for (unsigned i=0, k=0; i< n; i++)
-      for (unsigned j=i; j< n; j++)
-        if (std::fabs(H(i,j)) > _ZERO_EPS)
-        {
-          _h_obj[k] = H(i,j);
-          _h_iRow[k] = i;
-          _h_jCol[k] = j;
-          k++;
-        }
-  }
-  else
+  // the noninterpenetration and joint limit constraints are the rows of H
+  // for cn and l (i.e., the constraint velocities after the impulses)
+  _cJac.clear();
+  for (unsigned i=0; i< N_CONTACTS + N_LIMITS; i++)
   {
-    // setup the constraint indices
-    for (unsigned k=0; k< N_ACT_CONTACTS; k++)
-    {
-      _h_con_indices[k].clear();
-      for (unsigned i=0, r=0; i< n; i++)
-        for (unsigned j=i; j< n; j++, r++)
-          _h_con_indices[k][r] = r;
-    }
-
-    // setup objective component of Hessian and indices
-    // NOTE we assume that the Hessian is dense
-    _nnz_h_obj = n*(n-1);
-    _h_obj = shared_array<double>(new double[_nnz_h_obj]);
-    _h_iRow = shared_array<unsigned>(new unsigned[nnz_h_lag]);  
-    _h_jCol = shared_array<unsigned>(new unsigned[nnz_h_lag]);
-    for (unsigned i=0, k=0; i< n; i++)
-      for (unsigned j=i; j< n; j++, k++)
+    const unsigned ROW = (i < N_CONTACTS) ? i : L_IDX + i - N_CONTACTS;
+    for (unsigned j=0; j< n; j++)
+      if (H(ROW,j) != 0.0)
       {
-        _h_iRow[k] = i;
-        _h_jCol[k] = j;
-        _h_obj[k] = H(i,j);
+        _cJac_iRow.push_back(i);
+        _cJac_jCol.push_back(j);
+        _cJac.push_back(H(ROW,j));
       }
-
-    // copy the constraint Hessians
-    for (unsigned i=0; i< N_ACT_CONTACTS; i++)
-    {
-      const unsigned N_IDX = i;
-      const unsigned S_IDX = i + N_ACT_CONTACTS;
-      const unsigned T_IDX = i + N_ACT_CONTACTS*2;
-
-      // compute the constraint Hessian
-      SharedConstVectorNd rn = R.row(N_IDX);
-      SharedConstVectorNd rs = R.row(S_IDX);
-      SharedConstVectorNd rt = R.row(T_IDX);
-      Opsd::outer_prod(rs, rs, t1);
-      Opsd::outer_prod(rt, rt, t2);
-      t1 += t2;
-      t1 *= -2.0;
-      Opsd::outer_prod(rn, rn, t2);
-      t2 *= (2.0 * mu_c[N_IDX]);
-      t1 += t2;
-
-      // copy the constraint Hessian
-      _h_con[i] = shared_array<double>(new double[n*(n-1)]);
-      for (unsigned i=0, k=0; i< t1.rows(); i++)
-        for (unsigned j=i; j< t1.columns(); j++, k++)
-          _h_con[i][k] = t1(i,j);
-    }
   }
+  _cJac_constant = _cJac.size();
 
-  // setup values for kappa constraint
-  _cJac_constant = n;
-
-  // count remaining non-zeros
-  if (!_dense)
-  {
-    // count number of non-zeros in the Cn_block 
-    for (RowIteratord_const i = Cn_block.row_iterator_begin(); i != i.end(); i++)
-      if (std::fabs(*i) > _ZERO_EPS)
-        _cJac_constant++; 
-
-    // determine number of non-zeros in L_block
-    for (RowIteratord_const i = L_block.row_iterator_begin(); i != i.end(); i++)
-      if (std::fabs(*i) > _ZERO_EPS)
-        _cJac_constant++; 
-  }
-  else
+  // setup *only indices* for Coulomb friction constraint
+  for (unsigned i=0; i< N_CONTACTS; i++)
   {
-    // count number of non-zeros in the Cn_block 
-    Cn_block.mult(R, _M);
-    for (RowIteratord_const i = _M.row_iterator_begin(); i != i.end(); i++)
-      if (std::fabs(*i) > _ZERO_EPS)
-        _cJac_constant++; 
-
-    // determine number of non-zeros in L_block
-    L_block.mult(R, _M);
-    for (RowIteratord_const i = _M.row_iterator_begin(); i != i.end(); i++)
-      if (std::fabs(*i) > _ZERO_EPS)
-        _cJac_constant++; 
+    const unsigned N_IDX = i;
+    const unsigned S_IDX = i + N_CONTACTS;
+    const unsigned T_IDX = i + N_CONTACTS*2;
+    const unsigned ROW = N_CONTACTS + N_LIMITS + i;
+    _cJac_iRow.push_back(ROW);
+    _cJac_jCol.push_back(N_IDX);
+    _cJac_iRow.push_back(ROW);
+    _cJac_jCol.push_back(S_IDX);
+    _cJac_iRow.push_back(ROW);
+    _cJac_jCol.push_back(T_IDX);
   }
 
-  // setup total number of nonzero Jacobian values
-  nnz_jac_g = _cJac_constant + ((!_dense) ? N_ACT_CONTACTS*3 : N_ACT_CONTACTS*n);
-
-  // setup constant Jacobian values
-  _cJac = shared_array<double>(new double[_cJac_constant]);
-  _cJac_iRow = shared_array<unsigned>(new unsigned[nnz_jac_g]);
-  _cJac_jCol = shared_array<unsigned>(new unsigned[nnz_jac_g]);
-  unsigned nv = 0;
-
-  // count remaining non-zeros
-  if (!_dense)
-  {
-    // count number of non-zeros in the Cn_block 
-    for (unsigned i = 0; i < Cn_block.rows(); i++)
-      for (unsigned j = 0; j < Cn_block.columns(); j++)
-        if (std::fabs(Cn_block(i,j)) > _ZERO_EPS)
-        {
-          _cJac[nv] = Cn_block(i,j);
-          _cJac_iRow[nv] = i; 
-          _cJac_jCol[nv] = j;
-          nv++;
-        }
-
-    // determine number of non-zeros in L_block
-    for (unsigned i = 0; i < L_block.rows(); i++)
-      for (unsigned j = 0; j < L_block.columns(); j++)
-        if (std::fabs(L_block(i,j)) > _ZERO_EPS)
-        {
-          _cJac[nv] = L_block(i,j);
-          _cJac_iRow[nv] = i + Cn_block.rows(); 
-          _cJac_jCol[nv] = j;
-          nv++;
-        }
-
-    // setup -1'*N constraint
-    for (unsigned i=0; i< Cn_block.columns(); i++)
-    {
-      RowIteratord_const ci = Cn_block.column(i).row_iterator_begin();
-      _cJac[nv] = -std::accumulate(ci, ci.end(), 0.0);
-      _cJac_iRow[nv] = Cn_block.rows() + L_block.rows();
-      _cJac_jCol[nv] = i;
-      nv++;
-    }
-
-    // setup *only indices* for Coulomb friction constraint
-    for (unsigned i=0; i< N_ACT_CONTACTS; i++)
-    {
-      const unsigned N_IDX = i;
-      const unsigned S_IDX = i + N_ACT_CONTACTS;
-      const unsigned T_IDX = i + N_ACT_CONTACTS*2;
-      _cJac_iRow[nv] = Cn_block.rows() + L_block.rows() + 1 + i;
-      _cJac_jCol[nv] = N_IDX;
-      nv++;       
-      _cJac_iRow[nv] = Cn_block.rows() + L_block.rows() + 1 + i;
-      _cJac_jCol[nv] = S_IDX;
-      nv++;       
-      _cJac_iRow[nv] = Cn_block.rows() + L_block.rows() + 1 + i;
-      _cJac_jCol[nv] = T_IDX;
-      nv++;       
-    }
-  }  
-  else
-  {
-    // count number of non-zeros in the Cn_block 
-    Cn_block.mult(R, _M);
-    for (unsigned i = 0; i < _M.rows(); i++)
-      for (unsigned j = 0; j < _M.columns(); j++)
-        if (std::fabs(_M(i,j)) > _ZERO_EPS)
-        {
-          _cJac[nv] = _M(i,j);
-          _cJac_iRow[nv] = i; 
-          _cJac_jCol[nv] = j;
-          nv++;
-        }
-
-    // determine number of non-zeros in L_block
-    L_block.mult(R, _M);
-    for (unsigned i = 0; i < _M.rows(); i++)
-      for (unsigned j = 0; j < _M.columns(); j++)
-        if (std::fabs(_M(i,j)) > _ZERO_EPS)
-        {
-          _cJac[nv] = _M(i,j);
-          _cJac_iRow[nv] = i + Cn_block.rows(); 
-          _cJac_jCol[nv] = j;
-          nv++;
-        }
-
-    // setup -1'*N constraint
-    Cn_block.mult(R, _M);  
-    for (unsigned i=0; i< N_CONTACTS; i++)
-    {
-      ColumnIteratord_const ci = _M.row(i).column_iterator_begin();
-      _cJac[nv] = -std::accumulate(ci, ci.end(), 0.0);
-      _cJac_iRow[nv] = Cn_block.rows() + L_block.rows();
-      _cJac_jCol[nv] = i;
-      nv++;
-    }
+  return (n == old_n && m == old_m &&
+          _h_iRow == old_h_iRow && _h_jCol == old_h_jCol &&
+          _cJac_iRow == old_cJac_iRow && _cJac_jCol == old_cJac_jCol);
+}
 
-    // setup *only* indices for Coulomb friction constraint
-    // NOTE: we are assuming that R is dense
-    for (unsigned i=0; i< N_ACT_CONTACTS; i++)
-      for (unsigned j=0; j< n; j++)
-      {
-        _cJac_iRow[nv] = N_CONTACTS + N_LIMITS + 1 + i;
-        _cJac_jCol[nv] = j;
-        nv++;
-      }
-  }
+/// User should not call this method (for IPOPT)
+bool NQP_IPOPT::get_nlp_info(Index& n, Index& m, Index& nnz_jac_g, Index& nnz_h_lag, IndexStyleEnum& index_style)
+{
+  n = _n;
+  m = _m;
+  nnz_jac_g = _cJac_iRow.size();
+  nnz_h_lag = _h_iRow.size();
 
   // C-indexing style
   index_style = TNLP::C_STYLE;
@@ -314,24 +119,19 @@ bool NQP_IPOPT::get_bounds_info(Index n, Number* x_l, Number* x_u, Index m, Numb
 
   // get info
   const unsigned N_CONTACTS = epd->N_CONTACTS;
-  const unsigned N_ACT_CONTACTS = epd->N_ACT_CONTACTS;
-  const unsigned N_LIMITS = epd->N_LIMITS;
-
-  // TODO: fix bounds for dense problem
 
-  // set variable bounds
+  // set variable bounds (tangential impulses are unbounded)
   for (unsigned i=0; i< n; i++)
   {
-    // see whether this is a normal contact force or limit force
-    if (i >= N_ACT_CONTACTS && i < N_ACT_CONTACTS*3)
+    if (i >= N_CONTACTS && i < N_CONTACTS*3)
       x_l[i] = -INF;
     else
       x_l[i] = 0.0;
     x_u[i] = INF;
   }
 
-  // set bounds on inequality constraints 
-  for (unsigned i=0; i< N_CONTACTS+N_ACT_CONTACTS+N_LIMITS+1; i++)
+  // set bounds on inequality constraints
+  for (unsigned i=0; i< m; i++)
   {
     g_l[i] = 0.0;
     g_u[i] = INF;
@@ -344,13 +144,28 @@ bool NQP_IPOPT::get_bounds_info(Index n, Number* x_l, Number* x_u, Index m, Numb
 bool NQP_IPOPT::get_starting_point(Index n, bool init_x, Number* x, bool init_z, Number* z_L, Number* z_U, Index m, bool init_lambda, Number* lam)
 {
   if (init_x)
-    std::fill_n(x, n, 0.0);
+  {
+    if (warm_start)
+      std::copy(z0.begin(), z0.end(), x);
+    else
+      std::fill_n(x, n, 0.0);
+  }
 
   if (init_z)
-    return false;
+  {
+    if (!warm_start)
+      return false;
+    std::copy(z_L0.begin(), z_L0.end(), z_L);
+    std::fill_n(z_U, n, 0.0);
+  }
 
   if (init_lambda)
-    std::fill_n(lam, m, 0.0);
+  {
+    if (warm_start)
+      std::copy(lambda0.begin(), lambda0.end(), lam);
+    else
+      std::fill_n(lam, m, 0.0);
+  }
 
   return true;
 }
@@ -358,13 +173,17 @@ bool NQP_IPOPT::get_starting_point(Index n, bool init_x, Number* x, bool init_z,
 /// User should not call this method (for IPOPT)
 bool NQP_IPOPT::eval_f(Index n, const Number* x, bool new_x, Number& obj_value)
 {
-  // get temporary data
-  _w.resize(n);
-  cblas_dcopy(n, c.data(), c.inc(), _w.data(), _w.inc());
-  cblas_dgemv(CblasColMajor, CblasNoTrans, n, n, 0.5, H.data(), H.leading_dim(), x, 1, 1.0, _w.data(), _w.inc());
+  // compute c'x
+  obj_value = 0.0;
+  for (unsigned i=0; i< n; i++)
+    obj_value += c[i]*x[i];
 
-  // call the objective function
-  obj_value = cblas_ddot(n, _w.data(), _w.inc(), x, 1);
+  // add 0.5*x'Hx using the upper triangle
+  for (unsigned k=0; k< _h_obj.size(); k++)
+  {
+    const unsigned i = _h_iRow[k], j = _h_jCol[k];
+    obj_value += (i == j) ? 0.5*_h_obj[k]*x[i]*x[i] : _h_obj[k]*x[i]*x[j];
+  }
 
   return true;
 }
@@ -372,9 +191,15 @@ bool NQP_IPOPT::eval_f(Index n, const Number* x, bool new_x, Number& obj_value)
 /// User should not call this method (for IPOPT)
 bool NQP_IPOPT::eval_grad_f(Index n, const Number* x, bool new_x, Number* grad_f)
 {
-  // compute the gradient 
-  cblas_dcopy(n, c.data(), c.inc(), grad_f, 1);
-  cblas_dgemv(CblasColMajor, CblasNoTrans, n, n, 1.0, H.data(), H.leading_dim(), x, 1, 1.0, grad_f, 1);
+  // compute the gradient (Hx + c) using the upper triangle of H
+  std::copy(c.begin(), c.end(), grad_f);
+  for (unsigned k=0; k< _h_obj.size(); k++)
+  {
+    const unsigned i = _h_iRow[k], j = _h_jCol[k];
+    grad_f[i] += _h_obj[k]*x[j];
+    if (i != j)
+      grad_f[j] += _h_obj[k]*x[i];
+  }
 
   return true;
 }
@@ -383,41 +208,24 @@ bool NQP_IPOPT::eval_grad_f(Index n, const Number* x, bool new_x, Number* grad_f
 bool NQP_IPOPT::eval_g(Index n, const Number* x, bool new_x, Index m, Number* g)
 {
   const unsigned N_CONTACTS = epd->N_CONTACTS;
-  const unsigned N_ACT_CONTACTS = epd->N_ACT_CONTACTS;
   const unsigned N_LIMITS = epd->N_LIMITS;
 
-  // copy x
-  _x.resize(n);
-  std::copy(x, x+n, _x.begin());
-
-  // compute w
-  if (_dense)
-    R.mult(_x, _w) += z;
-  else
-    _w = _x;
-
-  // evaluate the kappa constraint 
-  Cn_block.mult(_w, _workv);
-  _workv += Cn_v;
-  g[N_CONTACTS+N_LIMITS] = epd->kappa - std::accumulate(_workv.begin(), _workv.end(), 0.0) + _tol;
-
-  // evaluate the non-interpenetration constraints
-  std::copy(_workv.begin(), _workv.end(), g);
-
-  // evaluate the joint limit constraints
-  L_block.mult(_w, _workv) -= epd->L_v;
-  std::copy(_workv.begin(), _workv.end(), g+N_ACT_CONTACTS);
+  // evaluate the non-interpenetration and joint limit constraints
+  for (unsigned i=0; i< N_CONTACTS; i++)
+    g[i] = c[i];
+  for (unsigned i=0; i< N_LIMITS; i++)
+    g[N_CONTACTS+i] = c[N_CONTACTS*3+i];
+  for (unsigned k=0; k< _cJac_constant; k++)
+    g[_cJac_iRow[k]] += _cJac[k]*x[_cJac_jCol[k]];
 
   // evaluate the Coulomb friction constraint
-  for (unsigned i=0, j=N_CONTACTS+N_LIMITS+1; i< N_ACT_CONTACTS; i++, j++)
+  for (unsigned i=0, j=N_CONTACTS+N_LIMITS; i< N_CONTACTS; i++, j++)
   {
     const unsigned N_IDX = i;
-    const unsigned S_IDX = i+N_ACT_CONTACTS;
-    const unsigned T_IDX = i+N_ACT_CONTACTS*2;
-    const double muc_sq = mu_c[N_IDX];
-    const double mu_visc_sq = mu_visc[N_IDX];
-    g[j] = muc_sq * sqr(_w[N_IDX]) + mu_visc_sq - sqr(_w[S_IDX]) - sqr(_w[T_IDX]) + _tol;
-  }  
+    const unsigned S_IDX = i+N_CONTACTS;
+    const unsigned T_IDX = i+N_CONTACTS*2;
+    g[j] = mu_c[i] * sqr(x[N_IDX]) + mu_visc[i] - sqr(x[S_IDX]) - sqr(x[T_IDX]);
+  }
 
   return true;
 }
@@ -425,131 +233,80 @@ bool NQP_IPOPT::eval_g(Index n, const Number* x, bool new_x, Index m, Number* g)
 bool NQP_IPOPT::eval_jac_g(Index n, const Number* x, bool new_x, Index m, Index nele_jac, Index* iRow, Index* jCol, Number* values)
 {
   const unsigned N_CONTACTS = epd->N_CONTACTS;
-  const unsigned N_ACT_CONTACTS = epd->N_ACT_CONTACTS;
 
   // only do these computations if 'values' is non-null
   if (values)
   {
-    // setup invariant part of Jacobian 
-    std::copy(_cJac.get(), _cJac.get() + _cJac_constant, values);
+    // setup invariant part of Jacobian
+    std::copy(_cJac.begin(), _cJac.end(), values);
 
     // setup gradient of Coulomb friction constraint
-    if (!_dense)
+    for (unsigned i=0, j=_cJac_constant; i< N_CONTACTS; i++, j+= 3)
     {
-      for (unsigned i=0, j=_cJac_constant; i< N_ACT_CONTACTS; i++, j+= 3)
-      {
-        const unsigned N_IDX = i;
-        const unsigned S_IDX = i+N_ACT_CONTACTS;
-        const unsigned T_IDX = i+N_ACT_CONTACTS*2;
-        const double muc_sq = mu_c[N_IDX];
-        const double mu_visc_sq = mu_visc[N_IDX];
-        values[j+0] = 2.0*muc_sq*x[N_IDX];
-        values[j+1] = -2.0*x[S_IDX];
-        values[j+2] = -2.0*x[T_IDX];
-      }
-    }
-    else
-    {
-      // copy x
-      _x.resize(n);
-      std::copy(x, x+n, _x.begin());
-
-      // compute w
-      R.mult(_x, _w) += z;
-
-      for (unsigned i=0; i< N_ACT_CONTACTS; i++)
-      {
-        // get the contact event index
-        const unsigned N_IDX = 0;
-        const unsigned S_IDX = i + N_ACT_CONTACTS; 
-        const unsigned T_IDX = i + N_ACT_CONTACTS*2;
-
-        // compute contact friction
-        R.get_row(N_IDX, _workv2) *= ((double) 2.0 * _w[N_IDX] * mu_c[N_IDX]);
-        R.get_row(S_IDX, _workv) *= ((double) 2.0 * _w[S_IDX]);
-        _workv2 -= _workv;
-        R.get_row(T_IDX, _workv) *= ((double) 2.0 * _w[T_IDX]); 
-        _workv2 -= _workv;
-        std::copy(_workv2.begin(), _workv2.end(), values+_cJac_constant+n*i);
-      }
+      const unsigned N_IDX = i;
+      const unsigned S_IDX = i+N_CONTACTS;
+      const unsigned T_IDX = i+N_CONTACTS*2;
+      values[j+0] = 2.0*mu_c[i]*x[N_IDX];
+      values[j+1] = -2.0*x[S_IDX];
+      values[j+2] = -2.0*x[T_IDX];
     }
   }
 
   // setup the indices
   if (iRow && jCol)
   {
-    std::copy(_cJac_iRow.get(), _cJac_iRow.get()+nele_jac, iRow);
-    std::copy(_cJac_jCol.get(), _cJac_jCol.get()+nele_jac, jCol);
+    std::copy(_cJac_iRow.begin(), _cJac_iRow.end(), iRow);
+    std::copy(_cJac_jCol.begin(), _cJac_jCol.end(), jCol);
   }
 
   return true;
 }
 
-// sets the final solution 
-void NQP_IPOPT::finalize_solution(SolverReturn status, Index n, const Number* x, const Number* z_L, const Number* z_U, Index, const Number* g, const Number* lam, Number obj_value, const IpoptData* ip_data, IpoptCalculatedQuantities* ipcq)
+// sets the final solution
+void NQP_IPOPT::finalize_solution(SolverReturn status, Index n, const Number* x, const Number* z_L, const Number* z_U, Index m, const Number* g, const Number* lam, Number obj_value, const IpoptData* ip_data, IpoptCalculatedQuantities* ipcq)
 {
-  // copy x
-  _x.resize(n);
-  std::copy(x, x+n, _x.begin());
-
-  // account for nullspace
-  if (_dense)
-  {
-    R.mult(_x, _w) += z;
-    z = _w;
-  }
-  else
-    z = _x;
+  // copy x and the multipliers (for warm starting the next solve)
+  z.resize(n);
+  std::copy(x, x+n, z.begin());
+  lambda.resize(m);
+  std::copy(lam, lam+m, lambda.begin());
+  this->z_L.resize(n);
+  std::copy(z_L, z_L+n, this->z_L.begin());
 }
 
 /// The Hessian
 bool NQP_IPOPT::eval_h(Index n, const Number* x, bool new_x, Number obj_factor, Index m, const Number* lam, bool new_lambda, Index nele_hess, Index* iRow, Index* jCol, Number* values)
 {
   const unsigned N_CONTACTS = epd->N_CONTACTS;
-  const unsigned N_ACT_CONTACTS = epd->N_ACT_CONTACTS;
   const unsigned N_LIMITS = epd->N_LIMITS;
 
-  // NOTE: lambda is of size N_CONTACTS + N_ACT_CONTACTS + N_LIMITS + 1
-
-  // get pointer values
-  double* hobj = _h_obj.get();
+  // NOTE: lambda is of size N_CONTACTS*2 + N_LIMITS
 
   // setup Hessian, if desired
   if (values)
   {
-    // zero the values
-    std::fill_n(values, nele_hess, 0.0);
-
     // scale the objective function part of the Hessian
-    cblas_dcopy(_nnz_h_obj, hobj, 1, values, 1); 
-    cblas_dscal(_nnz_h_obj, obj_factor, values, 1); 
+    for (unsigned k=0; k< _h_obj.size(); k++)
+      values[k] = _h_obj[k]*obj_factor;
 
-    // get the starting index for lambda
-    unsigned lambda_start = N_CONTACTS + N_LIMITS + 1;
-    for (unsigned k=0; k< N_ACT_CONTACTS; k++)
+    // add the (diagonal) Coulomb friction constraint Hessians
+    const unsigned LAMBDA_START = N_CONTACTS + N_LIMITS;
+    for (unsigned i=0; i< N_CONTACTS; i++)
     {
-      // scale the values in the constraint Hessian
-      _workv.set_zero(_nnz_h_con[k]);
-      cblas_dcopy(_nnz_h_con[k], _h_con[k].get(), 1, _workv.data(), _workv.inc());
-      cblas_dscal(_nnz_h_con[k], lam[lambda_start+k], _workv.data(), _workv.inc());
-
-      // get the workv iterator
-      ColumnIteratord_const workv_iter = _workv.column_iterator_begin();
-
-      // update the combined Hessian
-      for (unsigned i=0; i< _h_con_indices[k].size(); i++)
-        values[_h_con_indices[k][i]] += workv_iter[i];
+      const double LAMBDA = lam[LAMBDA_START+i];
+      values[_h_diag[i]] += 2.0*mu_c[i]*LAMBDA;
+      values[_h_diag[i+N_CONTACTS]] -= 2.0*LAMBDA;
+      values[_h_diag[i+N_CONTACTS*2]] -= 2.0*LAMBDA;
     }
-  }      
+  }
 
   // setup indices
-  if (iRow)
+  if (iRow && jCol)
   {
-    std::copy(_h_iRow.get(), _h_iRow.get()+nele_hess, iRow);
-    std::copy(_h_jCol.get(), _h_jCol.get()+nele_hess, jCol);
+    std::copy(_h_iRow.begin(), _h_iRow.end(), iRow);
+    std::copy(_h_jCol.begin(), _h_jCol.end(), jCol);
   }
 
   return true;
 }
 
-
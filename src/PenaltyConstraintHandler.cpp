@@ -41,7 +41,10 @@ using boost::dynamic_pointer_cast;
 PenaltyConstraintHandler::PenaltyConstraintHandler(){}
 
 // Processes Penaltys
-void PenaltyConstraintHandler::process_constraints(const vector<UnilateralConstraint>& constraints) const
+/**
+ * The force applied for each contact is stored in its contact_force.
+ */
+void PenaltyConstraintHandler::process_constraints(vector<UnilateralConstraint>& constraints) const
 {
   FILE_LOG(LOG_CONSTRAINT) << "*************************************************************";
   FILE_LOG(LOG_CONSTRAINT) << endl;
@@ -76,7 +79,7 @@ static double sgn(double a)
 /**
  * \param constraints a set of constraints
  */
-void PenaltyConstraintHandler::apply_model(const vector<UnilateralConstraint>& constraints) const
+void PenaltyConstraintHandler::apply_model(vector<UnilateralConstraint>& constraints) const
 {
   const double INF = std::numeric_limits<double>::max();
   std::map<sorted_pair<RigidBodyPtr>, unsigned> deepest;
@@ -119,7 +122,7 @@ void PenaltyConstraintHandler::apply_model(const vector<UnilateralConstraint>& c
   for (map<sorted_pair<RigidBodyPtr>, unsigned>::const_iterator i = deepest.begin(); i != deepest.end(); i++)
   {
     // process it
-    const UnilateralConstraint& e = constraints[i->second];
+    UnilateralConstraint& e = constraints[i->second];
 
     // setup the constraint frame
     shared_ptr<Pose3d> contact_frame(new Pose3d);
@@ -200,6 +203,9 @@ void PenaltyConstraintHandler::apply_model(const vector<UnilateralConstraint>& c
 
         FILE_LOG(LOG_CONSTRAINT) << "Penalty Force: " << penalty_force << endl;
 
+        // record the force
+        e.contact_force = Pose3d::transform(GLOBAL, SForced(penalty_force, Vector3d(0,0,0,contact_frame), contact_frame));
+
         Ravelin::VectorNd gf;
         if(sba->is_enabled()){
           sba->convert_to_generalized_force(sba,Ravelin::SForced(penalty_force,Vector3d(0,0,0,contact_frame),contact_frame),gf);
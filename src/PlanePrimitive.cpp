@@ -24,6 +24,7 @@
 #include <Moby/CylinderPrimitive.h>
 #include <Moby/PolyhedralPrimitive.h>
 #include <Moby/GJK.h>
+#include <Moby/MemoryAccounting.h>
 #include <Moby/PlanePrimitive.h>
 
 using namespace Ravelin;
@@ -71,6 +72,7 @@ void PlanePrimitive::set_pose(const Pose3d& p)
 /// Gets the BVH root for the heightmap
 BVPtr PlanePrimitive::get_BVH_root(CollisionGeometryPtr geom)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
   const unsigned X = 0, Y = 1, Z = 2;
   const double SZ = 1e+2;
 
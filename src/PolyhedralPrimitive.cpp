@@ -12,8 +12,13 @@
 #include <Moby/SpherePrimitive.h>
 #include <Moby/HeightmapPrimitive.h>
 #include <Moby/PlanePrimitive.h>
+#include <Moby/TetraMeshPrimitive.h>
 #include <Moby/GJK.h>
+#include <Moby/CP.h>
 #include <Moby/XMLTree.h>
+#include <Moby/TessellatedPolyhedron.h>
+#include <Moby/ADF.h>
+#include <Moby/MemoryAccounting.h>
 #include <Moby/PolyhedralPrimitive.h>
 
 using std::cerr;
@@ -41,6 +46,13 @@ double PolyhedralPrimitive::calc_dist_and_normal(const Point3d& p, std::vector<V
   // verify that the primitive knows about this pose 
   assert(_poses.find(const_pointer_cast<Pose3d>(p.pose)) != _poses.end()); 
 
+  // use the distance field, if possible
+  if (_adf && _adf->contains(p))
+  {
+    normals.push_back(Vector3d());
+    return _adf->calc_signed_distance(p, normals.back());
+  }
+
   // see whether the point is inside or outside the primitive
   unsigned closest_facet;
   double dist = _poly.calc_signed_distance(Origin3d(p), closest_facet);
@@ -107,6 +119,69 @@ double PolyhedralPrimitive::calc_dist_and_normal(const Point3d& p, std::vector<V
   return dist;
 }
 
+/// Computes the signed distance from the polyhedron to a point
+/**
+ * If a distance field has been built over the polyhedron and the point lies
+ * within it, the distance is interpolated from the field.
+ */
+double PolyhedralPrimitive::calc_signed_dist(const Point3d& p) const
+{
+  // verify that the primitive knows about this pose 
+  assert(_poses.find(const_pointer_cast<Pose3d>(p.pose)) != _poses.end()); 
+
+  // use the distance field, if possible
+  if (_adf && _adf->contains(p))
+    return _adf->calc_signed_distance(p);
+
+  return _poly.calc_signed_distance(Origin3d(p));
+}
+
+/// Builds a distance field over the polyhedron, which is then used to answer point distance queries
+/**
+ * The faces of the polyhedron are triangulated and the distance field is
+ * built from the resulting triangle mesh. The field is discarded whenever
+ * the polyhedron changes.
+ * \param max_recursion the maximum depth of the distance field octree
+ * \param epsilon the maximum interpolation error in a cell of the octree 
+ *        above which the cell is subdivided
+ */
+void PolyhedralPrimitive::build_distance_field(unsigned max_recursion, double epsilon)
+{
+  // get the vertices of the polyhedron
+  const vector<shared_ptr<Polyhedron::Vertex> >& v = _poly.get_vertices();
+  if (v.empty())
+    throw std::runtime_error("PolyhedralPrimitive::build_distance_field() - no polyhedron to build distance field over");
+  std::map<shared_ptr<Polyhedron::Vertex>, unsigned> mapping;
+  vector<Origin3d> verts(v.size());
+  for (unsigned i=0; i< v.size(); i++)
+  {
+    verts[i] = v[i]->o;
+    mapping[v[i]] = i;
+  }
+
+  // triangulate each (convex) face as a fan
+  vector<IndexedTri> tris;
+  const vector<shared_ptr<Polyhedron::Face> >& f = _poly.get_faces();
+  for (unsigned i=0; i< f.size(); i++)
+  {
+    Polyhedron::VertexFaceIterator vfi(f[i], true);
+    unsigned first = mapping[*vfi];
+    vfi.advance();
+    unsigned last = mapping[*vfi];
+    while (vfi.has_next())
+    {
+      vfi.advance();
+      unsigned next = mapping[*vfi];
+      tris.push_back(IndexedTri(first, last, next));
+      last = next;
+    }
+  }
+
+  // build the distance field
+  TessellatedPolyhedron tpoly(IndexedTriArray(verts.begin(), verts.end(), tris.begin(), tris.end()));
+  _adf = ADF::build_ADF(tpoly, max_recursion, epsilon);
+}
+
 /// creates the visualization for the primitive
 osg::Node* PolyhedralPrimitive::create_visualization()
 {
@@ -186,6 +261,7 @@ osg::Node* PolyhedralPrimitive::create_visualization()
 
 BVPtr PolyhedralPrimitive::get_BVH_root(CollisionGeometryPtr geom)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
   throw std::runtime_error("Implement me!");
   return BVPtr();
 }
@@ -224,6 +300,9 @@ void PolyhedralPrimitive::set_pose(const Pose3d& P)
 
   // transform the polyhedron
   _poly = _poly.transform(T);
+
+  // the distance field is no longer valid
+  _adf.reset();
 } 
 
 /// Sets the polyhedron corresponding to this primitive
@@ -242,6 +321,7 @@ void PolyhedralPrimitive::set_polyhedron(const Polyhedron& p)
 
   // set the polyhedron
   _poly = p;
+  _adf.reset();
 
   // calculate mass properties
   calc_mass_properties();
@@ -274,6 +354,17 @@ double PolyhedralPrimitive::calc_signed_dist(shared_ptr<const PolyhedralPrimitiv
   if (dist >= 0.0)
     return dist;
 
+  // V-Clip did not find the polyhedra to be separated; find the closest
+  // points (or a point common to both) from the polyhedra's halfspaces
+  Point3d cpA, cpB;
+  double dist2 = CP::find_cpoint(bthis, p, poseA, poseB, cpA, cpB);
+  if (dist2 >= NEAR_ZERO)
+  {
+    pthis = cpA;
+    pp = cpB;
+    return dist2;
+  }
+
   // compute transforms
   Transform3d wTa = Pose3d::calc_relative_pose(poseA, GLOBAL);
   Transform3d wTb = Pose3d::calc_relative_pose(poseB, GLOBAL);
@@ -283,12 +374,8 @@ double PolyhedralPrimitive::calc_signed_dist(shared_ptr<const PolyhedralPrimitiv
   PolyhedralPrimitive::get_halfspaces(bthis->get_polyhedron(), poseA, wTa, std::back_inserter(hs));
   PolyhedralPrimitive::get_halfspaces(p->get_polyhedron(), poseB, wTb, std::back_inserter(hs));
 
-  // find a point interior to both
-  Ravelin::Origin3d ip;
-  double dist2 = -CompGeom::find_hs_interior_point(hs.begin(), hs.end(), ip);
-  if (dist2 >= NEAR_ZERO)
-    return dist2;
-  assert(dist2 < NEAR_ZERO);
+  // the common point is interior to both
+  Ravelin::Origin3d ip(wTa.transform_point(cpA));
 
   // attempt to calculate the half-space intersection
   try
@@ -297,11 +384,10 @@ double PolyhedralPrimitive::calc_signed_dist(shared_ptr<const PolyhedralPrimitiv
   }
   catch (NumericalException e)
   {
-    // if we're here, then the volume of intersection is an area, find
-    // closest points and quit
-    Vector3d ip0(ip, GLOBAL);
-    pthis = wTa.inverse_transform_point(ip0);
-    pp = wTb.inverse_transform_point(ip0);
+    // if we're here, then the volume of intersection is an area; the
+    // common point is a closest point
+    pthis = cpA;
+    pp = cpB;
 
     return 0.0;
   } 
@@ -377,6 +463,11 @@ double PolyhedralPrimitive::calc_signed_dist(shared_ptr<const Primitive> p, Poin
   if (polyp)
     return calc_signed_dist(polyp, pthis, pp);
 
+  // try polyhedron/tetra mesh
+  shared_ptr<const TetraMeshPrimitive> tetp = dynamic_pointer_cast<const TetraMeshPrimitive>(p);
+  if (tetp)
+    return tetp->calc_signed_dist(dynamic_pointer_cast<const Primitive>(shared_from_this()), pp, pthis);
+
   throw std::runtime_error("Unanticipated signed distance types!");
   return 0.0;
 }
@@ -435,6 +526,19 @@ void PolyhedralPrimitive::load_from_xml(shared_ptr<const XMLTree> node, std::map
     cerr << "  for attribute 'filename'.  Valid extensions are '.obj' (Wavefront OBJ)" << endl;
   }
 
+  // load or build the distance field, if desired
+  const double DEFAULT_ADF_TOL = 1e-3;
+  XMLAttrib* adf_fname_attr = node->get_attrib("distance-field-filename");
+  XMLAttrib* adf_depth_attr = node->get_attrib("distance-field-max-recursion");
+  XMLAttrib* adf_tol_attr = node->get_attrib("distance-field-tolerance");
+  if (adf_fname_attr)
+    _adf = ADF::load_from_file(adf_fname_attr->get_string_value());
+  else if (adf_depth_attr && !_poly.get_vertices().empty())
+  {
+    double tol = (adf_tol_attr) ? adf_tol_attr->get_real_value() : DEFAULT_ADF_TOL;
+    build_distance_field(adf_depth_attr->get_unsigned_value(), tol);
+  }
+
   // update the visualization
   update_visualization();
  
@@ -14,6 +14,7 @@
 #include <Moby/XMLReader.h>
 #include <Moby/Simulator.h>
 #include <Moby/RCArticulatedBody.h>
+#include <Moby/MemoryAccounting.h>
 
 using boost::shared_ptr;
 using boost::dynamic_pointer_cast;
@@ -97,6 +98,7 @@ RCArticulatedBodyPtr RCArticulatedBody::clone() const
 /// Compiles this body (updates the link transforms and velocities)
 void RCArticulatedBody::compile()
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eArticulatedBodies);
   // call parent methods first
   ArticulatedBody::compile();
   RCArticulatedBodyd::compile();
@@ -146,6 +148,7 @@ void RCArticulatedBody::compile()
 /// Sets the vector of links and joints
 void RCArticulatedBody::set_links_and_joints(const vector<RigidBodyPtr>& links, const vector<JointPtr>& joints)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eArticulatedBodies);
   // call the parent method to update the link indices, etc.
   vector<shared_ptr<RigidBodyd> > d_links;
   vector<shared_ptr<Jointd> > d_joints;
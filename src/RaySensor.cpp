@@ -0,0 +1,100 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#include <cstdlib>
+#include <limits>
+#include <Moby/XMLTree.h>
+#include <Moby/CollisionDetection.h>
+#include <Moby/ConstraintSimulator.h>
+#include <Moby/RaySensor.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using std::map;
+using std::list;
+using std::vector;
+using boost::shared_ptr;
+
+/// Constructs a ray sensor with a range of 10 that sees all geometries but those of its own body
+RaySensor::RaySensor()
+{
+  min_range = 0.0;
+  max_range = 10.0;
+  collision_mask = std::numeric_limits<unsigned>::max();
+  ignore_own_body = true;
+}
+
+/// Updates the sensor by casting its rays on their own
+/**
+ * The simulator does not call this method; it casts the rays of all ray
+ * sensors together instead.
+ */
+void RaySensor::update(ConstraintSimulator* sim, double dt)
+{
+  vector<LineSeg3> segs;
+  vector<RigidBodyPtr> ignored;
+  SceneQueryResults results;
+
+  prepare(sim->current_time);
+  get_rays(segs);
+  get_ignored_bodies(ignored);
+  sim->get_collision_detection()->cast_segments(sim->get_dynamic_bodies(), segs, results, collision_mask, &ignored);
+  set_ray_results(results, 0);
+}
+
+/// Appends the body whose geometries each ray passes through (NULL for none) to ignored
+void RaySensor::get_ignored_bodies(vector<RigidBodyPtr>& ignored) const
+{
+  ignored.insert(ignored.end(), num_rays(), (ignore_own_body) ? _body : RigidBodyPtr());
+}
+
+/// Appends a ray to a vector of segments
+/**
+ * \param gTs the transform from the sensor frame to the global frame
+ * \param dir the unit direction of the ray in the sensor frame
+ * \param t0 the distance along the direction at which the ray begins
+ * \param t1 the distance along the direction at which the ray ends
+ * \param segs the vector to which the ray is appended
+ */
+void RaySensor::append_ray(const Transform3d& gTs, const Origin3d& dir, double t0, double t1, vector<LineSeg3>& segs) const
+{
+  segs.push_back(LineSeg3(gTs.transform_point(Point3d(dir*t0, _F)), gTs.transform_point(Point3d(dir*t1, _F))));
+}
+
+/// Implements Base::load_from_xml()
+void RaySensor::load_from_xml(shared_ptr<const XMLTree> node, map<std::string, BasePtr>& id_map)
+{
+  // load the parent data
+  Sensor::load_from_xml(node, id_map);
+
+  // read the range and the collision mask
+  XMLAttrib* min_range_attr = node->get_attrib("min-range");
+  if (min_range_attr)
+    min_range = min_range_attr->get_real_value();
+  XMLAttrib* max_range_attr = node->get_attrib("max-range");
+  if (max_range_attr)
+    max_range = max_range_attr->get_real_value();
+  XMLAttrib* mask_attr = node->get_attrib("collision-mask");
+  if (mask_attr)
+    collision_mask = (unsigned) std::strtoul(mask_attr->get_string_value().c_str(), NULL, 0);
+  XMLAttrib* ignore_attr = node->get_attrib("ignore-own-body");
+  if (ignore_attr)
+    ignore_own_body = ignore_attr->get_bool_value();
+}
+
+/// Implements Base::save_to_xml()
+void RaySensor::save_to_xml(XMLTreePtr node, list<shared_ptr<const Base> >& shared_objects) const
+{
+  // save the parent data
+  Sensor::save_to_xml(node, shared_objects);
+
+  // save the range and the collision mask
+  node->attribs.insert(XMLAttrib("min-range", min_range));
+  node->attribs.insert(XMLAttrib("max-range", max_range));
+  node->attribs.insert(XMLAttrib("collision-mask", collision_mask));
+  node->attribs.insert(XMLAttrib("ignore-own-body", ignore_own_body));
+}
+
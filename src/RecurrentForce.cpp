@@ -0,0 +1,72 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0 
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#include <Ravelin/ArticulatedBodyd.h>
+#include <Moby/RecurrentForce.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
+using std::vector;
+
+/// Applies this force/torque to a number of bodies
+/**
+ * The default implementation calls add_force() for each body.
+ */
+void RecurrentForce::add_forces(const vector<shared_ptr<DynamicBodyd> >& bodies)
+{
+  for (unsigned i=0; i< bodies.size(); i++)
+    add_force(bodies[i]);
+}
+
+/// Determines whether per-body data must be resolved for the given bodies
+/**
+ * \return <b>true</b> if the bodies differ from those given on the last call
+ *         (or invalidate_batch() has been called since), in which case the
+ *         bodies are recorded and the caller must resolve its data
+ */
+bool RecurrentForce::update_batch(const vector<shared_ptr<DynamicBodyd> >& bodies)
+{
+  if (_batch_valid && bodies == _batch_bodies)
+    return false;
+
+  _batch_bodies = bodies;
+  _batch_valid = true;
+  return true;
+}
+
+/// Gets the rigid bodies (rigid bodies and links of articulated bodies) from a set of bodies
+/**
+ * \param bodies the bodies
+ * \param links on return, the rigid bodies
+ * \param owners on return, the index (into bodies) of the body that each
+ *        rigid body belongs to
+ */
+void RecurrentForce::get_links(const vector<shared_ptr<DynamicBodyd> >& bodies, vector<shared_ptr<RigidBodyd> >& links, vector<unsigned>& owners)
+{
+  links.clear();
+  owners.clear();
+  for (unsigned i=0; i< bodies.size(); i++)
+  {
+    shared_ptr<RigidBodyd> rb = dynamic_pointer_cast<RigidBodyd>(bodies[i]);
+    if (rb)
+    {
+      links.push_back(rb);
+      owners.push_back(i);
+      continue;
+    }
+
+    shared_ptr<ArticulatedBodyd> ab = dynamic_pointer_cast<ArticulatedBodyd>(bodies[i]);
+    if (ab)
+    {
+      const vector<shared_ptr<RigidBodyd> >& ab_links = ab->get_links();
+      links.insert(links.end(), ab_links.begin(), ab_links.end());
+      owners.insert(owners.end(), ab_links.size(), i);
+    }
+  }
+}
+
@@ -44,8 +44,10 @@
 #include <Moby/StokesDragForce.h>
 #include <Moby/DampingForce.h>
 #include <Moby/XMLTree.h>
+#include <Moby/ModelCache.h>
 #include <Moby/RigidBody.h>
 #include <Moby/SDFReader.h>
+#include <Moby/MemoryAccounting.h>
 
 using std::map;
 using std::vector;
@@ -86,6 +88,7 @@ static void to_osg_matrix(const Pose3d& src, osg::Matrixd& tgt)
  */
 shared_ptr<TimeSteppingSimulator> SDFReader::read(const std::string& fname)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eIO);
   vector<vector<ControlledBodyPtr> > models;
 
   // *************************************************************
@@ -128,7 +131,7 @@ shared_ptr<TimeSteppingSimulator> SDFReader::read(const std::string& fname)
   }
 
   // read the XML Tree
-  shared_ptr<const XMLTree> root_tree = XMLTree::read_from_xml(filename);
+  shared_ptr<const XMLTree> root_tree = ModelCache::get_tree(filename);
   if (!root_tree)
   {
     std::cerr << "SDFReader::read() - unable to open file " << fname;
@@ -151,6 +154,11 @@ shared_ptr<TimeSteppingSimulator> SDFReader::read(const std::string& fname)
     return shared_ptr<TimeSteppingSimulator>();
   }
 
+  // load all meshes referenced by the file up front (in parallel)
+  std::vector<std::string> mesh_uris;
+  find_mesh_uris(sdf_tree, mesh_uris);
+  ModelCache::prefetch_meshes(mesh_uris);
+
   // read in all world tags
   std::list<shared_ptr<const XMLTree> > world_nodes = find_tag("world", sdf_tree);
 
@@ -214,7 +222,7 @@ std::map<std::string, ControlledBodyPtr> SDFReader::read_models(const std::strin
   }
 
   // read the XML Tree
-  shared_ptr<const XMLTree> root_tree = XMLTree::read_from_xml(filename);
+  shared_ptr<const XMLTree> root_tree = ModelCache::get_tree(filename);
   if (!root_tree)
   {
     std::cerr << "SDFReader::read_model() - unable to open file " << fname;
@@ -237,6 +245,11 @@ std::map<std::string, ControlledBodyPtr> SDFReader::read_models(const std::strin
     return model_map;
   }
 
+  // load all meshes referenced by the file up front (in parallel)
+  std::vector<std::string> mesh_uris;
+  find_mesh_uris(sdf_tree, mesh_uris);
+  ModelCache::prefetch_meshes(mesh_uris);
+
   // read in all world tags
   std::list<shared_ptr<const XMLTree> > world_nodes = find_tag("world", sdf_tree);
 
@@ -374,6 +387,28 @@ void SDFReader::find_tag(const std::string& tag, shared_ptr<const XMLTree> root,
       l.push_back(*i);
 }
 
+/// Finds the (Wavefront OBJ) uri of every mesh in the tree
+void SDFReader::find_mesh_uris(shared_ptr<const XMLTree> root, std::vector<std::string>& uris)
+{
+  const std::list<XMLTreePtr>& child_nodes = root->children;
+  for (std::list<XMLTreePtr>::const_iterator i = child_nodes.begin(); i != child_nodes.end(); i++)
+  {
+    if (strcasecmp((*i)->name.c_str(), "mesh") == 0)
+    {
+      shared_ptr<const XMLTree> uri_node = find_one_tag("uri", *i);
+      if (!uri_node)
+        continue;
+      std::string fname = read_string(uri_node);
+      std::string fname_lower = fname;
+      std::transform(fname.begin(), fname.end(), fname_lower.begin(), ::tolower);
+      if (fname_lower.size() >= 4 && fname_lower.find(".obj") == fname_lower.size()-4)
+        uris.push_back(fname);
+    }
+    else
+      find_mesh_uris(*i, uris);
+  }
+}
+
 /// Find a particular tag
 shared_ptr<const XMLTree> SDFReader::find_one_tag(const std::string& tag, shared_ptr<const XMLTree> root)
 {
@@ -786,21 +821,12 @@ PrimitivePtr SDFReader::read_polyhedron(shared_ptr<const XMLTree> node)
   if (st != fname_lower.size()-4)
     throw std::runtime_error("Expect 'uri' to be of type Wavefront .obj");
 
-  // read in the file using an indexed triangle array
-  IndexedTriArray ita = IndexedTriArray::read_from_obj(fname);
-
-  // get all of the vertices and compute the convex hull (yielding a
-  // tessellated polyhedron)
-  const std::vector<Origin3d>& vertices = ita.get_vertices();
-  TessellatedPolyhedronPtr tessellated_poly = CompGeom::calc_convex_hull(vertices.begin(), vertices.end());   
-
-  // convert the tessellated polyhedron to a standard polyhedron
-  Polyhedron poly;
-  tessellated_poly->to_polyhedron(poly);
+  // get the convex hull of the mesh (cached for meshes read previously)
+  shared_ptr<const Polyhedron> poly = ModelCache::get_convex_hull(fname);
 
   // create the polyhedral primitive object 
   shared_ptr<PolyhedralPrimitive> p(new PolyhedralPrimitive);
-  p->set_polyhedron(poly);
+  p->set_polyhedron(*poly);
 
   return p;
 }
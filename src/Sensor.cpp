@@ -0,0 +1,128 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#include <iostream>
+#include <Moby/Constants.h>
+#include <Moby/XMLTree.h>
+#include <Moby/RigidBody.h>
+#include <Moby/Sensor.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using std::map;
+using std::list;
+using std::cerr;
+using std::endl;
+using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
+
+/// Constructs a sensor that is updated at every step
+Sensor::Sensor()
+{
+  rate = 0.0;
+  _timestamp = -1.0;
+  _F = shared_ptr<Pose3d>(new Pose3d);
+}
+
+/// Attaches the sensor to a rigid body (the relative pose of the sensor is retained)
+void Sensor::set_body(RigidBodyPtr body)
+{
+  _body = body;
+  _F->rpose = (body) ? body->get_pose() : GLOBAL;
+}
+
+/// Sets the pose of the sensor relative to the body
+void Sensor::set_relative_pose(const Pose3d& P)
+{
+  _F->x = P.x;
+  _F->q = P.q;
+}
+
+/// Determines whether the sensor is due to be updated at time t
+bool Sensor::is_due(double t) const
+{
+  if (rate <= 0.0 || _timestamp < 0.0)
+    return true;
+  return t >= _timestamp + 1.0/rate - NEAR_ZERO;
+}
+
+/// Records that the sensor has been updated at time t
+void Sensor::set_updated(double t)
+{
+  _timestamp = t;
+}
+
+/// Implements Base::load_from_xml()
+/**
+ * The body is specified using the body-id attribute and the sensor frame
+ * using the position and rpy (or quat) attributes.
+ */
+void Sensor::load_from_xml(shared_ptr<const XMLTree> node, map<std::string, BasePtr>& id_map)
+{
+  map<std::string, BasePtr>::const_iterator id_iter;
+
+  // load the parent data
+  Base::load_from_xml(node, id_map);
+
+  // read the rate
+  XMLAttrib* rate_attr = node->get_attrib("rate");
+  if (rate_attr)
+    rate = rate_attr->get_real_value();
+
+  // read the body
+  XMLAttrib* body_attr = node->get_attrib("body-id");
+  if (!body_attr)
+  {
+    cerr << "Sensor::load_from_xml() - sensor has no body-id attribute!" << endl;
+    cerr << "  offending node: " << endl << *node;
+  }
+  else
+  {
+    const std::string& ID = body_attr->get_string_value();
+    if ((id_iter = id_map.find(ID)) == id_map.end())
+    {
+      cerr << "Sensor::load_from_xml() - body id: " << ID << " not found!" << endl;
+      cerr << "  offending node: " << endl << *node;
+    }
+    else
+    {
+      RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(id_iter->second);
+      if (!rb)
+      {
+        cerr << "Sensor::load_from_xml() - object with id: " << ID << " is not a rigid body" << endl;
+        cerr << "  offending node: " << endl << *node;
+      }
+      else
+        set_body(rb);
+    }
+  }
+
+  // read the relative pose
+  XMLAttrib* position_attr = node->get_attrib("position");
+  XMLAttrib* rpy_attr = node->get_attrib("rpy");
+  XMLAttrib* quat_attr = node->get_attrib("quat");
+  if (position_attr)
+    _F->x = position_attr->get_origin_value();
+  if (rpy_attr)
+    _F->q = rpy_attr->get_rpy_value();
+  else if (quat_attr)
+    _F->q = quat_attr->get_quat_value();
+}
+
+/// Implements Base::save_to_xml()
+void Sensor::save_to_xml(XMLTreePtr node, list<shared_ptr<const Base> >& shared_objects) const
+{
+  // save the parent data
+  Base::save_to_xml(node, shared_objects);
+
+  // save the rate, the body, and the relative pose
+  node->attribs.insert(XMLAttrib("rate", rate));
+  if (_body)
+    node->attribs.insert(XMLAttrib("body-id", _body->id));
+  node->attribs.insert(XMLAttrib("position", _F->x));
+  node->attribs.insert(XMLAttrib("quat", _F->q));
+}
+
@@ -4,6 +4,7 @@
 #include <Moby/RigidBody.h>
 #include <Moby/ArticulatedBody.h>
 #include <Moby/CollisionGeometry.h>
+#include <Moby/CollisionDetection.h>
 #include <Moby/ImpactConstraintHandler.h>
 #include <Moby/Joint.h>
 #include <Moby/SignedDistDot.h>
@@ -34,6 +35,49 @@ double SignedDistDot::calc_signed_dist(shared_ptr<SingleBodyd> sb1, shared_ptr<S
   return min_dist;
 }
 
+/// Computes the time derivative of the signed distance between a pair of geometries at the bodies' current velocities
+/**
+ * The derivative is computed by finite differencing, as in
+ * compute_signed_dist_dot_Jacobians(). Both signed distances are computed
+ * here (pdi.dist may come from coarser levels of detail; see
+ * PairwiseDistInfo::coarse).
+ * \param pdi the pair of geometries
+ * \param coldet the collision detector used to compute signed distances
+ */
+double SignedDistDot::calc_signed_dist_dot(const PairwiseDistInfo& pdi, shared_ptr<CollisionDetection> coldet)
+{
+  const double DT = NEAR_ZERO;
+  map<shared_ptr<DynamicBodyd>, VectorNd> gc_map, gv_map;
+  vector<shared_ptr<DynamicBodyd> > supers;
+  Point3d dummy1, dummy2;
+
+  // get the two super bodies
+  shared_ptr<DynamicBodyd> sup1 = ImpactConstraintHandler::get_super_body(pdi.a->get_single_body());
+  shared_ptr<DynamicBodyd> sup2 = ImpactConstraintHandler::get_super_body(pdi.b->get_single_body());
+  supers.push_back(sup1);
+  if (sup1 != sup2)
+    supers.push_back(sup2);
+
+  // save the configurations and velocities of the bodies
+  for (unsigned i=0; i< supers.size(); i++)
+  {
+    supers[i]->get_generalized_coordinates_euler(gc_map[supers[i]]);
+    supers[i]->get_generalized_velocity(DynamicBodyd::eSpatial, gv_map[supers[i]]);
+  }
+
+  // compute the signed distance at the current configuration
+  double phi = coldet->calc_signed_dist(pdi.a, pdi.b, dummy1, dummy2);
+
+  // integrate the bodies' positions forward and compute the signed distance
+  integrate_positions(supers, DT);
+  double phi_new = coldet->calc_signed_dist(pdi.a, pdi.b, dummy1, dummy2);
+
+  // restore coordinates and velocities
+  restore_coords_and_velocities(supers, gc_map, gv_map);
+
+  return (phi_new - phi)/DT;
+}
+
 /// Computes the Jacobian for the time derivative of the signed distance functions vs. impulses applied at contact points
 /**
  * Assume the signed distance function is Phi(q(t)), so 
@@ -4,6 +4,7 @@
  * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
  ****************************************************************************/
 
+#include <sys/time.h>
 #include <map>
 #include <iostream>
 #ifdef USE_OSG
@@ -15,9 +16,11 @@
 #include <Moby/RCArticulatedBody.h>
 #include <Moby/RigidBody.h>
 #include <Moby/Joint.h>
+#include <Moby/CouplingConstraint.h>
 #include <Moby/XMLTree.h>
 #include <Moby/SparseJacobian.h>
 #include <Moby/Simulator.h>
+#include <Moby/MemoryAccounting.h>
 
 using std::list;
 using std::set;
@@ -153,7 +156,9 @@ double Simulator::step(double step_size)
   #endif
 
   // compute forward dynamics and integrate 
+  double start = get_current_time();
   current_time += integrate(step_size);
+  dynamics_time = get_current_time() - start;
 
   // TODO: do any constraint stabilization
 //  _cstab.stabilize(simulator);
@@ -165,6 +170,15 @@ double Simulator::step(double step_size)
   return step_size;
 }
 
+/// Gets the current (wall-clock) time, used for timing the steps
+double Simulator::get_current_time()
+{
+  const double MICROSEC = 1.0/1000000;
+  timeval t;
+  gettimeofday(&t, NULL);
+  return (double) t.tv_sec + (double) t.tv_usec * MICROSEC;
+}
+
 /// Finds the dynamic body in the simulator, if any
 /**
  * Searches unarticulated bodies, articulated bodies, and links of
@@ -196,16 +210,30 @@ ControlledBodyPtr Simulator::find_dynamic_body(const std::string& name) const
   return ControlledBodyPtr();
 }
 
+/// Discards the data that the simulator retains between steps
+/**
+ * This should be called whenever the states of the bodies are set by other
+ * than the simulator (e.g., when a simulation is restarted), so that the
+ * next step does not reuse data computed for the old states.
+ */
+void Simulator::reset_caches()
+{
+  _island_factorizations.clear();
+}
+
 /// Removes a dynamic body from the simulator
 void Simulator::remove_dynamic_body(ControlledBodyPtr body)
 {
-  // remove the body from the list of bodies
-  std::vector<ControlledBodyPtr>::iterator i = std::find(_bodies.begin(), _bodies.end(), body);
-  if (i == _bodies.end())
+  // remove the body from the (sorted) list of bodies
+  std::vector<ControlledBodyPtr>::iterator i = std::lower_bound(_bodies.begin(), _bodies.end(), body);
+  if (i == _bodies.end() || *i != body)
     return;
   else
     _bodies.erase(i);
 
+  // remove any factorization retained for the body's island
+  _island_factorizations.erase(dynamic_pointer_cast<DynamicBodyd>(body));
+
   #ifdef USE_OSG
   // see whether the body is articulated 
   ArticulatedBodyPtr abody = dynamic_pointer_cast<ArticulatedBody>(body);
@@ -251,7 +279,7 @@ void Simulator::remove_dynamic_body(ControlledBodyPtr body)
 void Simulator::add_dynamic_body(ControlledBodyPtr body) 
 {
   // if the body is already present in the simulator, skip it
-  if (std::find(_bodies.begin(), _bodies.end(), body) != _bodies.end())
+  if (std::binary_search(_bodies.begin(), _bodies.end(), body))
     return;
 
   // set the simulator pointer to the body
@@ -295,9 +323,8 @@ void Simulator::add_dynamic_body(ControlledBodyPtr body)
   }
   #endif
   
-  // add the body to the list of bodies and sort the list of bodies
-  _bodies.push_back(body); 
-  std::sort(_bodies.begin(), _bodies.end());
+  // add the body to the list of bodies, keeping the list sorted
+  _bodies.insert(std::lower_bound(_bodies.begin(), _bodies.end(), body), body);
 }
 
 /// Updates all visualization under the simulator
@@ -315,29 +342,71 @@ void Simulator::add_transient_vdata(osg::Node* vdata)
   #endif
 }
 
+/// Determines the bodies that each recurrent force is applied to
+/**
+ * The bodies are determined again only when the bodies in the simulator, or
+ * the recurrent forces attached to them, change.
+ */
+void Simulator::update_recurrent_force_batches()
+{
+  // get the bodies and their recurrent forces, in order
+  _rf_signature_work.clear();
+  BOOST_FOREACH(ControlledBodyPtr db, _bodies)
+  {
+    _rf_signature_work.push_back(db.get());
+    const list<RecurrentForcePtr>& rfs = db->get_recurrent_forces();
+    BOOST_FOREACH(RecurrentForcePtr rf, rfs)
+      _rf_signature_work.push_back(rf.get());
+  }
+
+  // see whether anything has changed
+  if (_rf_signature_work == _rf_signature)
+    return;
+  _rf_signature.swap(_rf_signature_work);
+
+  // group the bodies by recurrent force
+  _rf_batches.clear();
+  map<RecurrentForcePtr, unsigned> batch_index;
+  BOOST_FOREACH(ControlledBodyPtr db, _bodies)
+  {
+    shared_ptr<DynamicBodyd> rdb = dynamic_pointer_cast<DynamicBodyd>(db);
+    const list<RecurrentForcePtr>& rfs = db->get_recurrent_forces();
+    BOOST_FOREACH(RecurrentForcePtr rf, rfs)
+    {
+      map<RecurrentForcePtr, unsigned>::const_iterator i = batch_index.find(rf);
+      if (i == batch_index.end())
+      {
+        i = batch_index.insert(std::make_pair(rf, (unsigned) _rf_batches.size())).first;
+        _rf_batches.push_back(std::make_pair(rf, vector<shared_ptr<DynamicBodyd> >()));
+      }
+      _rf_batches[i->second].second.push_back(rdb);
+    }
+  }
+}
+
 /// Prepares to calculate forward dynamics for bodies
 void Simulator::precalc_fwd_dyn()
 {
   VectorNd tmp;
 
-  // clear force accumulators, then add all recurrent and compliant
-  // constraint forces
+  // clear force accumulators
   BOOST_FOREACH(ControlledBodyPtr db, _bodies)
-  {
-    // get the body as a Ravelin dynamic body
-    shared_ptr<DynamicBodyd> rdb = dynamic_pointer_cast<DynamicBodyd>(db);
+    dynamic_pointer_cast<DynamicBodyd>(db)->reset_accumulators();
 
-    // clear the force accumulators on the body
-    rdb->reset_accumulators();
+  // add all recurrent forces, applying each force to all of its bodies at once
+  update_recurrent_force_batches();
+  for (unsigned i=0; i< _rf_batches.size(); i++)
+    _rf_batches[i].first->add_forces(_rf_batches[i].second);
 
-    // add all recurrent forces on the body
-    const list<RecurrentForcePtr>& rfs = db->get_recurrent_forces();
-    BOOST_FOREACH(RecurrentForcePtr rf, rfs)
-      rf->add_force(rdb);
-    
+  // add controller forces
+  BOOST_FOREACH(ControlledBodyPtr db, _bodies)
+  {
     // call the body's controller
     if (db->controller)
     {
+      // get the body as a Ravelin dynamic body
+      shared_ptr<DynamicBodyd> rdb = dynamic_pointer_cast<DynamicBodyd>(db);
+
       // get the generalized forces
       (*db->controller)(db, tmp, current_time, db->controller_arg);
 
@@ -455,7 +524,7 @@ void Simulator::apply_impulse(shared_ptr<DynamicBodyd> db, const SharedVectorNd&
   }
 
   // compute change in velocity and constraint forces
-  solve(island, island_ijoints, v, f, 1.0, dv, lambda);
+  solve(island, island_ijoints, vector<CouplingConstraintPtr>(), v, f, 1.0, dv, lambda);
 
   // update velocities 
   for (unsigned i=0, gc_index = 0; i< island.size(); i++)
@@ -484,6 +553,7 @@ void Simulator::calc_fwd_dyn(double dt)
   VectorNd v, a, lambda, f;
   MatrixNd M;
   vector<JointPtr> island_ijoints; 
+  vector<CouplingConstraintPtr> island_couplings, released;
 
   // get the simulator pointer
   shared_ptr<Simulator> shared_this = dynamic_pointer_cast<Simulator>(shared_from_this());
@@ -536,8 +606,11 @@ void Simulator::calc_fwd_dyn(double dt)
         island_ijoints.push_back(dynamic_pointer_cast<Joint>(ijoints[k]));
     }
 
+    // get the engaged coupling constraints in the island
+    get_island_couplings(island, island_couplings);
+
     // get number of implicit constraints
-    const unsigned N_IMPLICIT = island_ijoints.size();
+    const unsigned N_IMPLICIT = island_ijoints.size() + island_couplings.size();
   
     // if there are no implicit constraints, just call calc_fwd_dyn(.) on
     // each body
@@ -549,11 +622,21 @@ void Simulator::calc_fwd_dyn(double dt)
         shared_ptr<DynamicBodyd> db = dynamic_pointer_cast<DynamicBodyd>(island[j]); 
 
         // no implicit constraints? just calculate forward dynamics for the body
-        db->calc_fwd_dyn();
+        // (charging articulated bodies to their subsystem)
+        if (dynamic_pointer_cast<ArticulatedBodyd>(db))
+        {
+          MemoryAccounting::Scope mem_scope(MemoryAccounting::eArticulatedBodies);
+          db->calc_fwd_dyn();
+        }
+        else
+          db->calc_fwd_dyn();
       }
     }
     else // there are implicit constraints - must go through the solve process
     {
+      // charge the solve for the implicit joints to articulated bodies
+      MemoryAccounting::Scope mem_scope(MemoryAccounting::eArticulatedBodies);
+
       // get the total number of generalized coordinates for the island
       const unsigned NGC_TOTAL = num_generalized_coordinates(island);
 
@@ -577,8 +660,29 @@ void Simulator::calc_fwd_dyn(double dt)
         gc_index += NGC;
       }
 
-      // compute acceleration and constraint forces
-      solve(island, island_ijoints, v, f, dt, a, lambda);
+      // compute acceleration and constraint forces; couplings with backlash
+      // that would have to pull are released and the problem is solved again
+      while (true)
+      {
+        solve(island, island_ijoints, island_couplings, v, f, dt, a, lambda);
+
+        // the coupling rows follow the joint rows
+        const unsigned C_START = lambda.size() - island_couplings.size();
+        released.clear();
+        for (unsigned j=0, k=0; j< island_couplings.size(); j++)
+        {
+          if (!island_couplings[j]->is_bilateral() && lambda[C_START+j] < 0.0)
+          {
+            island_couplings[j]->lambda = 0.0;
+            released.push_back(island_couplings[j]);
+          }
+          else
+            island_couplings[k++] = island_couplings[j];
+        }
+        if (released.empty())
+          break;
+        island_couplings.resize(island_couplings.size() - released.size());
+      }
 
       // set accelerations
       for (unsigned i=0, gc_index = 0; i< island.size(); i++)
@@ -590,25 +694,58 @@ void Simulator::calc_fwd_dyn(double dt)
       }
 
       // populate constraint forces
-      for (unsigned i=0, c_index = 0; i< island_ijoints.size(); i++)
+      unsigned c_index = 0;
+      for (unsigned i=0; i< island_ijoints.size(); i++)
       {
         const unsigned NEQ = island_ijoints[i]->num_constraint_eqns();
         SharedConstVectorNd lambda_sub = lambda.segment(c_index, c_index + NEQ);
         island_ijoints[i]->lambda = lambda_sub;
         c_index += NEQ;
       }
+      for (unsigned i=0; i< island_couplings.size(); i++)
+        island_couplings[i]->lambda = lambda[c_index++];
     }
   }
 }
 
+/// Gets the engaged coupling constraints that act on bodies in an island
+/**
+ * \param island the bodies in the island, sorted
+ * \param island_couplings the engaged coupling constraints on return
+ */
+void Simulator::get_island_couplings(const vector<shared_ptr<DynamicBodyd> >& island, vector<CouplingConstraintPtr>& island_couplings) const
+{
+  vector<shared_ptr<DynamicBodyd> > coupled;
+
+  island_couplings.clear();
+  for (unsigned i=0; i< coupling_constraints.size(); i++)
+  {
+    // couplings with free play are ignored until the free play is taken up
+    if (!coupling_constraints[i]->is_engaged())
+    {
+      coupling_constraints[i]->lambda = 0.0;
+      continue;
+    }
+
+    // all bodies of a coupling are in the same island
+    coupling_constraints[i]->get_super_bodies(coupled);
+    if (!coupled.empty() && std::binary_search(island.begin(), island.end(), coupled.front()))
+      island_couplings.push_back(coupling_constraints[i]);
+  }
+}
+
 // Solves | M   J' | | a      | = | v + inv(M)*f*dt | 
 //        | J   0  | | lambda |   | 0 |
 // using M*a = -J'*lambda + M*v + f*dt and
 // J*inv(M)*J'*lambda = J*v + J*inv(M)*f*dt
-void Simulator::solve(const vector<shared_ptr<DynamicBodyd> >& island, const vector<JointPtr>& island_ijoints, const VectorNd& v, const VectorNd& f, double dt, VectorNd& a, VectorNd& lambda) const
+// J*inv(M)*J' is formed and factored sparsely (with the symbolic analysis
+// retained for the island) when it is nonsingular; otherwise, the largest
+// full rank subset of the constraints is found densely.
+void Simulator::solve(const vector<shared_ptr<DynamicBodyd> >& island, const vector<JointPtr>& island_ijoints, const vector<CouplingConstraintPtr>& island_couplings, const VectorNd& v, const VectorNd& f, double dt, VectorNd& a, VectorNd& lambda) const
 {
   MatrixNd JiMJT_frr, JiM, iMJT, iMJT_frr, JiMJT, Jm, tmp;
-  VectorNd JiMf_frr, JiMf, iMf, Jv, Jv_frr, lambda_sub; 
+  VectorNd JiMf_frr, JiMf, iMf, Jv, Jv_frr, lambda_sub, JTlambda, tmpv; 
+  CSRMatrix JiMJT_sparse;
   const unsigned N_SPATIAL = 6;
   map<shared_ptr<DynamicBodyd>, unsigned> gc_map;
   std::vector<MatrixBlock> inv_inertias;
@@ -620,13 +757,15 @@ void Simulator::solve(const vector<shared_ptr<DynamicBodyd> >& island, const vec
   unsigned n_implicit_eqns = 0;
   for (unsigned i=0; i< island_ijoints.size(); i++)
     n_implicit_eqns += island_ijoints[i]->num_constraint_eqns();
+  n_implicit_eqns += island_couplings.size();
 
   // if there are no implicit equations, just solve with generalized inertia
   // matrices
   if (n_implicit_eqns == 0)
   {
-    // resize lambda
+    // resize lambda and a
     lambda.resize(0);
+    a.resize(NGC_TOTAL);
 
     for (unsigned i=0, gc_index = 0; i< island.size(); i++)
     {
@@ -716,12 +855,54 @@ void Simulator::solve(const vector<shared_ptr<DynamicBodyd> >& island, const vec
     eq_idx += island_ijoints[i]->num_constraint_eqns();
   } 
 
+  // add one row for each coupling constraint
+  for (unsigned i=0, eq_idx=n_implicit_eqns-island_couplings.size(); i< island_couplings.size(); i++)
+    island_couplings[i]->add_to_Jacobian(gc_map, eq_idx++, J);
+
   if (LOGGING(LOG_DYNAMICS))
   {
     J.to_dense(tmp);
     FILE_LOG(LOG_DYNAMICS) << "dense J: " << std::endl << tmp;
   }
 
+  // attempt to solve using a sparse factorization of J*inv(M)*J'
+  J.calc_J_iM_JT(inv_inertias, JiMJT_sparse);
+  SparseLDLT& ldlt = _island_factorizations[island.front()];
+  if (ldlt.factor(JiMJT_sparse))
+  {
+    // solve for lambda
+    J.mult(iMf, lambda);
+    lambda += J.mult(v, Jv);
+    ldlt.solve(lambda);
+    FILE_LOG(LOG_DYNAMICS) << "lambda (sparse): " << lambda << std::endl;
+
+    // compute J'*lambda
+    JTlambda.set_zero(NGC_TOTAL);
+    for (unsigned i=0; i< J.blocks.size(); i++)
+    {
+      const MatrixBlock& Jb = J.blocks[i];
+      SharedVectorNd lambda_b = lambda.segment(Jb.st_row_idx, Jb.st_row_idx + Jb.rows());
+      Jb.block.transpose_mult(lambda_b, tmpv);
+      SharedVectorNd JTlambda_b = JTlambda.segment(Jb.st_col_idx, Jb.st_col_idx + Jb.columns());
+      JTlambda_b += tmpv;
+    }
+
+    // now compute a using M*a = -J'*lambda + f
+    a = iMf;
+    for (unsigned i=0; i< inv_inertias.size(); i++)
+    {
+      const MatrixBlock& iMb = inv_inertias[i];
+      SharedVectorNd JTlambda_b = JTlambda.segment(iMb.st_col_idx, iMb.st_col_idx + iMb.columns());
+      iMb.block.mult(JTlambda_b, tmpv);
+      SharedVectorNd a_b = a.segment(iMb.st_col_idx, iMb.st_col_idx + iMb.columns());
+      a_b -= tmpv;
+    }
+    a /= dt;
+
+    FILE_LOG(LOG_DYNAMICS) << "a: " << a << std::endl;
+    return;
+  }
+
   // (J*inv(M)*J') * lambda = J*v + J*inv(M)*f*h
   J.mult(inv_inertias, NGC_TOTAL, JiM);
   MatrixNd::transpose(JiM, iMJT);
@@ -916,6 +1097,22 @@ void Simulator::load_from_xml(shared_ptr<const XMLTree> node, std::map<std::stri
     }
   }
 
+  // read all coupling constraints -- note: joints must already have been read
+  coupling_constraints.clear();
+  child_nodes = node->find_child_nodes("CouplingConstraint");
+  for (std::list<shared_ptr<const XMLTree> >::const_iterator i = child_nodes.begin(); i != child_nodes.end(); i++)
+  {
+    CouplingConstraintPtr coupling(new CouplingConstraint);
+    coupling->load_from_xml(*i, id_map);
+    if (coupling->num_terms() == 0)
+    {
+      std::cerr << "Simulator::load_from_xml() - coupling constraint has no terms" << std::endl;
+      std::cerr << "  offending node: " << std::endl << **i;
+      continue;
+    }
+    coupling_constraints.push_back(coupling);
+  }
+
   // get all recurrent forces used in the simulator -- note: this must be done
   // *after* all bodies have been loaded
   child_nodes = node->find_child_nodes("RecurrentForce");
@@ -1007,6 +1204,19 @@ void Simulator::find_islands(vector<vector<shared_ptr<DynamicBodyd> > >& islands
     edges.insert(std::make_pair(dbo, dbi));
   }
 
+  // loop through all coupling constraints in the simulator
+  vector<shared_ptr<DynamicBodyd> > coupled;
+  for (unsigned i=0; i< coupling_constraints.size(); i++)
+  {
+    // connect all bodies of the coupling to the first one
+    coupling_constraints[i]->get_super_bodies(coupled);
+    for (unsigned j=1; j< coupled.size(); j++)
+    {
+      edges.insert(std::make_pair(coupled.front(), coupled[j]));
+      edges.insert(std::make_pair(coupled[j], coupled.front()));
+    }
+  }
+
   // remove nodes from the set until there are no more nodes
   while (!nodes.empty())
   {
@@ -1073,5 +1283,13 @@ void Simulator::save_to_xml(XMLTreePtr node, std::list<shared_ptr<const Base> >&
       throw std::runtime_error("dynamic-body-id does not belong to a dynamic body");
     shared_objects.push_back(body);
   }
+
+  // save all coupling constraints
+  BOOST_FOREACH(CouplingConstraintPtr coupling, coupling_constraints)
+  {
+    XMLTreePtr child_node(new XMLTree("CouplingConstraint"));
+    node->add_child(child_node);
+    coupling->save_to_xml(child_node, shared_objects);
+  }
 }
 
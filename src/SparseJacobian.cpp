@@ -4,6 +4,8 @@
  * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
  ****************************************************************************/
 
+#include <cassert>
+#include <algorithm>
 #include <Ravelin/MissizeException.h>
 #include <Moby/SparseJacobian.h>
 
@@ -316,3 +318,178 @@ MatrixNd& SparseJacobian::to_dense(MatrixNd& M) const
   return M;
 }
 
+
+/// Converts a sparse Jacobian to compressed sparse row format
+/**
+ * Overlapping blocks are summed (consistent with mult()).
+ */
+CSRMatrix& SparseJacobian::to_csr(CSRMatrix& M) const
+{
+  // determine the blocks that touch each row
+  vector<vector<unsigned> > row_blocks(rows);
+  for (unsigned i=0; i< blocks.size(); i++)
+    for (unsigned r=0; r< blocks[i].rows(); r++)
+      row_blocks[blocks[i].st_row_idx+r].push_back(i);
+
+  // setup the matrix
+  M.rows = rows;
+  M.cols = cols;
+  M.row_ptr.resize(rows+1);
+  M.col_idx.clear();
+  M.values.clear();
+
+  // process each row
+  vector<int> pos(cols, -1);
+  vector<std::pair<unsigned, double> > row;
+  for (unsigned r=0; r< rows; r++)
+  {
+    // gather the entries of the row, summing duplicates
+    row.clear();
+    for (unsigned j=0; j< row_blocks[r].size(); j++)
+    {
+      const MatrixBlock& b = blocks[row_blocks[r][j]];
+      const unsigned R = r - b.st_row_idx;
+      for (unsigned c=0; c< b.columns(); c++)
+      {
+        const unsigned col = b.st_col_idx + c;
+        if (pos[col] < 0)
+        {
+          pos[col] = (int) row.size();
+          row.push_back(std::make_pair(col, b.block(R,c)));
+        }
+        else
+          row[pos[col]].second += b.block(R,c);
+      }
+    }
+
+    // sort the entries by column and store them
+    std::sort(row.begin(), row.end());
+    M.row_ptr[r] = M.col_idx.size();
+    for (unsigned j=0; j< row.size(); j++)
+    {
+      M.col_idx.push_back(row[j].first);
+      M.values.push_back(row[j].second);
+      pos[row[j].first] = -1;
+    }
+  }
+  M.row_ptr[rows] = M.col_idx.size();
+
+  return M;
+}
+
+/// Gets the transpose of a matrix in compressed sparse row format
+static void transpose(const CSRMatrix& M, CSRMatrix& MT)
+{
+  MT.rows = M.cols;
+  MT.cols = M.rows;
+
+  // count the entries in each column of M
+  MT.row_ptr.assign(M.cols+1, 0);
+  for (unsigned i=0; i< M.col_idx.size(); i++)
+    MT.row_ptr[M.col_idx[i]+1]++;
+  for (unsigned i=0; i< M.cols; i++)
+    MT.row_ptr[i+1] += MT.row_ptr[i];
+
+  // scatter the entries (rows of M are visited in order, so the columns of
+  // MT remain sorted)
+  MT.col_idx.resize(M.col_idx.size());
+  MT.values.resize(M.values.size());
+  vector<unsigned> next(MT.row_ptr.begin(), MT.row_ptr.end()-1);
+  for (unsigned r=0; r< M.rows; r++)
+    for (unsigned k=M.row_ptr[r]; k< M.row_ptr[r+1]; k++)
+    {
+      const unsigned dest = next[M.col_idx[k]]++;
+      MT.col_idx[dest] = r;
+      MT.values[dest] = M.values[k];
+    }
+}
+
+/// Computes J*iM*J' in compressed sparse row format, where iM is block diagonal
+/**
+ * \param iM the (square) diagonal blocks of a cols x cols matrix; columns not
+ *        covered by a block are treated as zero
+ * \param result the symmetric product, with both triangles stored
+ */
+CSRMatrix& SparseJacobian::calc_J_iM_JT(const vector<MatrixBlock>& iM, CSRMatrix& result) const
+{
+  // get the Jacobian and its transpose in compressed form
+  CSRMatrix J, JT;
+  to_csr(J);
+  transpose(J, JT);
+
+  // determine the block of iM that contains each column
+  vector<int> col_block(cols, -1);
+  for (unsigned i=0; i< iM.size(); i++)
+  {
+    assert(iM[i].rows() == iM[i].columns() && iM[i].st_row_idx == iM[i].st_col_idx);
+    for (unsigned j=0; j< iM[i].columns(); j++)
+      col_block[iM[i].st_col_idx+j] = (int) i;
+  }
+
+  // setup the result
+  result.rows = result.cols = rows;
+  result.row_ptr.resize(rows+1);
+  result.col_idx.clear();
+  result.values.clear();
+
+  // setup work vectors (sparse accumulators) 
+  vector<double> w(cols), a(rows);
+  vector<int> w_mark(cols, -1), a_mark(rows, -1);
+  vector<unsigned> w_pattern, a_pattern;
+
+  // compute the product a row at a time
+  for (unsigned i=0; i< rows; i++)
+  {
+    // compute row i of J*iM
+    w_pattern.clear();
+    for (unsigned k=J.row_ptr[i]; k< J.row_ptr[i+1]; k++)
+    {
+      const int bidx = col_block[J.col_idx[k]];
+      if (bidx < 0)
+        continue;
+      const MatrixBlock& b = iM[bidx];
+      const unsigned R = J.col_idx[k] - b.st_row_idx;
+      for (unsigned m=0; m< b.columns(); m++)
+      {
+        const unsigned c = b.st_col_idx + m;
+        if (w_mark[c] != (int) i)
+        {
+          w_mark[c] = (int) i;
+          w[c] = 0.0;
+          w_pattern.push_back(c);
+        }
+        w[c] += J.values[k] * b.block(R,m);
+      }
+    }
+
+    // compute row i of (J*iM)*J'
+    a_pattern.clear();
+    for (unsigned k=0; k< w_pattern.size(); k++)
+    {
+      const unsigned c = w_pattern[k];
+      for (unsigned m=JT.row_ptr[c]; m< JT.row_ptr[c+1]; m++)
+      {
+        const unsigned j = JT.col_idx[m];
+        if (a_mark[j] != (int) i)
+        {
+          a_mark[j] = (int) i;
+          a[j] = 0.0;
+          a_pattern.push_back(j);
+        }
+        a[j] += w[c] * JT.values[m];
+      }
+    }
+
+    // store the row
+    std::sort(a_pattern.begin(), a_pattern.end());
+    result.row_ptr[i] = result.col_idx.size();
+    for (unsigned k=0; k< a_pattern.size(); k++)
+    {
+      result.col_idx.push_back(a_pattern[k]);
+      result.values.push_back(a[a_pattern[k]]);
+    }
+  }
+  result.row_ptr[rows] = result.col_idx.size();
+
+  return result;
+}
@@ -0,0 +1,257 @@
+/****************************************************************************
+ * Copyright 2016 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#include <cmath>
+#include <algorithm>
+#include <set>
+#include <Ravelin/MissizeException.h>
+#include <Moby/Constants.h>
+#include <Moby/NonsquareMatrixException.h>
+#include <Moby/SparseLDLT.h>
+
+using std::set;
+using std::pair;
+using std::vector;
+using std::make_pair;
+using namespace Ravelin;
+using namespace Moby;
+
+/// Computes a minimum degree ordering of a symmetric matrix
+/**
+ * Eliminates, at each step, the vertex of the elimination graph with the
+ * smallest degree (ties broken by index, so the ordering is deterministic).
+ * Chains and trees are ordered from their leaves inward, which yields no
+ * fill-in at all.
+ */
+void SparseLDLT::calc_min_degree_ordering(const CSRMatrix& A, vector<unsigned>& P)
+{
+  const unsigned n = A.rows;
+
+  // build the adjacency structure of the matrix
+  vector<set<unsigned> > adj(n);
+  for (unsigned i=0; i< n; i++)
+    for (unsigned k=A.row_ptr[i]; k< A.row_ptr[i+1]; k++)
+    {
+      const unsigned j = A.col_idx[k];
+      if (i != j)
+      {
+        adj[i].insert(j);
+        adj[j].insert(i);
+      }
+    }
+
+  // setup the queue of vertices ordered by degree
+  set<pair<unsigned, unsigned> > q;
+  for (unsigned i=0; i< n; i++)
+    q.insert(make_pair((unsigned) adj[i].size(), i));
+
+  // eliminate vertices
+  P.clear();
+  while (!q.empty())
+  {
+    // get the vertex of minimum degree
+    const unsigned v = q.begin()->second;
+    q.erase(q.begin());
+    P.push_back(v);
+
+    // remove the vertex from the graph
+    const set<unsigned>& nbrs = adj[v];
+    for (set<unsigned>::const_iterator i = nbrs.begin(); i != nbrs.end(); i++)
+    {
+      q.erase(make_pair((unsigned) adj[*i].size(), *i));
+      adj[*i].erase(v);
+    }
+
+    // the neighbors of the vertex form a clique
+    for (set<unsigned>::const_iterator i = nbrs.begin(); i != nbrs.end(); i++)
+      for (set<unsigned>::const_iterator j = nbrs.begin(); j != nbrs.end(); j++)
+        if (*i != *j)
+          adj[*i].insert(*j);
+
+    // update the degrees of the neighbors
+    for (set<unsigned>::const_iterator i = nbrs.begin(); i != nbrs.end(); i++)
+      q.insert(make_pair((unsigned) adj[*i].size(), *i));
+    adj[v].clear();
+  }
+}
+
+/// Determines whether the given matrix has the sparsity pattern that was analyzed
+bool SparseLDLT::same_pattern(const CSRMatrix& A) const
+{
+  return A.rows == _n && A.row_ptr == _pattern_ptr && A.col_idx == _pattern_idx;
+}
+
+/// Computes the fill-reducing ordering and the symbolic factorization of a matrix
+/**
+ * \param A a symmetric matrix with both triangles stored
+ */
+void SparseLDLT::analyze(const CSRMatrix& A)
+{
+  if (A.rows != A.cols)
+    throw NonsquareMatrixException();
+
+  // store the pattern
+  _n = A.rows;
+  _pattern_ptr = A.row_ptr;
+  _pattern_idx = A.col_idx;
+
+  // compute the ordering
+  const int n = (int) _n;
+  calc_min_degree_ordering(A, _P);
+  _Pinv.resize(n);
+  for (int k=0; k< n; k++)
+    _Pinv[_P[k]] = k;
+
+  // compute the elimination tree and the number of nonzeros in each column of L
+  _parent.resize(n);
+  _Lnz.resize(n);
+  _flag.resize(n);
+  for (int k=0; k< n; k++)
+  {
+    _parent[k] = -1;
+    _flag[k] = k;
+    _Lnz[k] = 0;
+    const unsigned kk = _P[k];
+    for (unsigned p=A.row_ptr[kk]; p< A.row_ptr[kk+1]; p++)
+    {
+      // follow the path from i to the root of the etree, stopping at a flagged node
+      int i = (int) _Pinv[A.col_idx[p]];
+      if (i < k)
+      {
+        for (; _flag[i] != k; i = _parent[i])
+        {
+          if (_parent[i] == -1)
+            _parent[i] = k;
+          _Lnz[i]++;
+          _flag[i] = k;
+        }
+      }
+    }
+  }
+
+  // setup the column pointers of L
+  _Lp.resize(n+1);
+  _Lp[0] = 0;
+  for (int k=0; k< n; k++)
+    _Lp[k+1] = _Lp[k] + _Lnz[k];
+
+  // allocate memory for the numeric factorization
+  _Li.resize(_Lp[n]);
+  _Lx.resize(_Lp[n]);
+  _D.resize(n);
+  _Y.resize(n);
+  _pattern.resize(n);
+}
+
+/// Factors a symmetric matrix
+/**
+ * The symbolic analysis is reused if the pattern of A matches that of the
+ * previously factored matrix.
+ * \param A a symmetric matrix with both triangles stored
+ * \return <b>false</b> if the matrix is (numerically) singular
+ */
+bool SparseLDLT::factor(const CSRMatrix& A)
+{
+  // analyze the matrix, if necessary
+  if (!same_pattern(A))
+    analyze(A);
+
+  // compute L and D one row at a time
+  const int n = (int) _n;
+  for (int k=0; k< n; k++)
+  {
+    // compute the nonzero pattern of row k of L
+    _Y[k] = 0.0;
+    int top = n;
+    _flag[k] = k;
+    _Lnz[k] = 0;
+    double diag = 0.0;
+    const unsigned kk = _P[k];
+    for (unsigned p=A.row_ptr[kk]; p< A.row_ptr[kk+1]; p++)
+    {
+      int i = (int) _Pinv[A.col_idx[p]];
+      if (i <= k)
+      {
+        // scatter A(i,k) into Y
+        _Y[i] += A.values[p];
+        if (i == k)
+          diag = A.values[p];
+
+        // follow the path from i to the root of the etree
+        int len;
+        for (len = 0; _flag[i] != k; i = _parent[i])
+        {
+          _pattern[len++] = i;
+          _flag[i] = k;
+        }
+        while (len > 0)
+          _pattern[--top] = _pattern[--len];
+      }
+    }
+
+    // compute numerical values of row k of L (sparse triangular solve)
+    _D[k] = _Y[k];
+    _Y[k] = 0.0;
+    for (; top < n; top++)
+    {
+      const int i = _pattern[top];
+      const double yi = _Y[i];
+      _Y[i] = 0.0;
+      const unsigned p2 = _Lp[i] + _Lnz[i];
+      unsigned p;
+      for (p = _Lp[i]; p < p2; p++)
+        _Y[_Li[p]] -= _Lx[p] * yi;
+      const double l_ki = yi / _D[i];
+      _D[k] -= l_ki * yi;
+      _Li[p] = k;
+      _Lx[p] = l_ki;
+      _Lnz[i]++;
+    }
+
+    // check for a zero pivot
+    if (std::fabs(_D[k]) <= NEAR_ZERO * std::max(1.0, std::fabs(diag)))
+      return false;
+  }
+
+  return true;
+}
+
+/// Solves A*x = b using the factorization
+/**
+ * \param x contains b on entry, x on return
+ */
+VectorNd& SparseLDLT::solve(VectorNd& x) const
+{
+  if (x.size() != _n)
+    throw MissizeException();
+
+  // permute the right hand side
+  const unsigned n = _n;
+  _work.resize(n);
+  for (unsigned k=0; k< n; k++)
+    _work[k] = x[_P[k]];
+
+  // solve L*y = b
+  for (unsigned j=0; j< n; j++)
+    for (unsigned p=_Lp[j]; p< _Lp[j+1]; p++)
+      _work[_Li[p]] -= _Lx[p] * _work[j];
+
+  // solve D*z = y
+  for (unsigned j=0; j< n; j++)
+    _work[j] /= _D[j];
+
+  // solve L'*x = z
+  for (unsigned j=n; j > 0; j--)
+    for (unsigned p=_Lp[j-1]; p< _Lp[j]; p++)
+      _work[j-1] -= _Lx[p] * _work[_Li[p]];
+
+  // undo the permutation
+  for (unsigned k=0; k< n; k++)
+    x[_P[k]] = _work[k];
+
+  return x;
+}
+
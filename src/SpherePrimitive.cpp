@@ -18,8 +18,10 @@
 #include <Moby/PolyhedralPrimitive.h>
 #include <Moby/PlanePrimitive.h>
 #include <Moby/TriangleMeshPrimitive.h>
+#include <Moby/TetraMeshPrimitive.h>
 #include <Moby/HeightmapPrimitive.h>
 #include <Moby/GJK.h>
+#include <Moby/MemoryAccounting.h>
 #include <Moby/SpherePrimitive.h>
 
 using namespace Ravelin;
@@ -310,6 +312,11 @@ double SpherePrimitive::calc_signed_dist(shared_ptr<const Primitive> p, Point3d&
     return hmp->calc_signed_dist(thisp, pp, pthis);
   }
 
+  // try sphere/tetra mesh
+  shared_ptr<const TetraMeshPrimitive> tetp = dynamic_pointer_cast<const TetraMeshPrimitive>(p);
+  if (tetp)
+    return tetp->calc_signed_dist(dynamic_pointer_cast<const Primitive>(shared_from_this()), pp, pthis);
+
   // if the primitive is convex, can use GJK
   if (p->is_convex())
   {
@@ -397,6 +404,7 @@ void SpherePrimitive::save_to_xml(XMLTreePtr node, std::list<shared_ptr<const Ba
 /// Gets the root bounding volume
 BVPtr SpherePrimitive::get_BVH_root(CollisionGeometryPtr geom) 
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
   // get the pointer to the bounding sphere
   shared_ptr<BoundingSphere>& bsph = _bsphs[geom];
 
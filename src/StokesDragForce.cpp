@@ -4,6 +4,7 @@
  * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
  ****************************************************************************/
 
+#include <boost/foreach.hpp>
 #include <iostream>
 #include <Moby/XMLTree.h>
 #include <Moby/RigidBody.h>
@@ -29,41 +30,56 @@ StokesDragForce::StokesDragForce(const StokesDragForce& source)
   operator=(source);
 }
 
-/// Adds gravity to a body
+/// Adds drag to a rigid body
+void StokesDragForce::add_drag(shared_ptr<RigidBodyd> rb, double b, double b_ang)
+{
+  SForced w;
+  w.set_force(rb->get_velocity().get_linear() * -b);
+  w.set_torque(rb->get_velocity().get_angular() * -b_ang);
+  w.pose = rb->get_velocity().pose;
+  SForced wx = Pose3d::transform(rb->get_computation_frame(), w);
+  rb->add_force(wx);
+}
+
+/// Adds drag to a body
 void StokesDragForce::add_force(shared_ptr<DynamicBodyd> body)
 {
   // if the body is rigid, add drag
   RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(body);
   if (rb)
-  {
-    SForced w;
-    w.set_force(rb->get_velocity().get_linear() * -this->b);
-    w.set_torque(rb->get_velocity().get_angular() * -this->b_ang);
-    w.pose = rb->get_velocity().pose;
-    SForced wx = Pose3d::transform(rb->get_computation_frame(), w);
-    rb->add_force(wx);
-  }
+    add_drag(rb, this->b, this->b_ang);
   else
   {
     // it's an articulated body, get it as such
     ArticulatedBodyPtr ab = boost::dynamic_pointer_cast<ArticulatedBody>(body);
+    if (!ab)
+      return;
       
     // get the vector of links
     const std::vector<shared_ptr<RigidBodyd> >& links = ab->get_links();
       
     // apply drag force to all links
     BOOST_FOREACH(shared_ptr<RigidBodyd> rbd, links)
-    {
-      SForced w;
-      w.set_force(rb->get_velocity().get_linear() * -this->b);
-      w.set_torque(rb->get_velocity().get_angular() * -this->b_ang);
-      w.pose = rb->get_velocity().pose;
-      SForced wx = Pose3d::transform(rb->get_computation_frame(), w);
-      rb->add_force(wx);
-    }
+      add_drag(rbd, this->b, this->b_ang);
   }
 }
 
+/// Adds drag to a number of bodies
+/**
+ * The rigid bodies and links of articulated bodies are determined only when
+ * the set of bodies changes.
+ */
+void StokesDragForce::add_forces(const vector<shared_ptr<DynamicBodyd> >& bodies)
+{
+  // resolve the links, if necessary
+  if (update_batch(bodies))
+    get_links(bodies, _links, _owners);
+
+  // apply drag force to all links
+  for (unsigned i=0; i< _links.size(); i++)
+    add_drag(_links[i], this->b, this->b_ang);
+}
+
 /// Implements Base::load_from_xml()
 void StokesDragForce::load_from_xml(shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map)
 {
@@ -0,0 +1,829 @@
+/****************************************************************************
+ * Copyright 2015 Evan Drumwright
+ * This library is distributed under the terms of the Apache V2.0
+ * License (obtainable from http://www.apache.org/licenses/LICENSE-2.0).
+ ****************************************************************************/
+
+#ifdef USE_OSG
+#include <osg/Geode>
+#include <osg/Geometry>
+#endif
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <Moby/Log.h>
+#include <Moby/Constants.h>
+#include <Moby/XMLTree.h>
+#include <Moby/Triangle.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/MemoryAccounting.h>
+#include <Moby/TetraMeshPrimitive.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using boost::const_pointer_cast;
+using std::map;
+using std::list;
+using std::string;
+using std::vector;
+using std::endl;
+using std::cerr;
+
+// a face of a tetrahedron, identified by its sorted vertex indices
+struct TetraFace
+{
+  unsigned v[3];      // the sorted vertex indices
+  unsigned tetra;     // the tetrahedron that the face belongs to
+  unsigned face;      // the index of the face in the tetrahedron (0..3)
+
+  bool operator<(const TetraFace& f) const
+  {
+    if (v[0] != f.v[0]) return v[0] < f.v[0];
+    if (v[1] != f.v[1]) return v[1] < f.v[1];
+    return v[2] < f.v[2];
+  }
+
+  bool same(const TetraFace& f) const { return v[0] == f.v[0] && v[1] == f.v[1] && v[2] == f.v[2]; }
+};
+
+// compares tetrahedra centroids along an axis (for splitting hierarchy nodes)
+struct TetraCentroidComp
+{
+  TetraCentroidComp(const vector<Origin3d>& c, unsigned axis) : _c(&c), _axis(axis) { }
+  bool operator()(unsigned i, unsigned j) const { return (*_c)[i][_axis] < (*_c)[j][_axis]; }
+
+  private:
+    const vector<Origin3d>* _c;
+    unsigned _axis;
+};
+
+/// Creates an empty tetrahedral mesh primitive
+TetraMeshPrimitive::TetraMeshPrimitive()
+{
+  _bounding_radius = 0.0;
+}
+
+/// Creates the tetrahedral mesh primitive from a .tetra file and optionally centers it
+TetraMeshPrimitive::TetraMeshPrimitive(const string& filename, bool center)
+{
+  _bounding_radius = 0.0;
+
+  // read the mesh
+  IndexedTetraArray mesh = IndexedTetraArray::read_from_tetra(filename);
+  if (center)
+    mesh.center();
+  set_tetra_mesh(shared_ptr<const IndexedTetraArray>(new IndexedTetraArray(mesh)));
+}
+
+/// Creates the tetrahedral mesh primitive from a .tetra file and optionally centers it
+TetraMeshPrimitive::TetraMeshPrimitive(const string& filename, const Pose3d& T, bool center) : Primitive(T)
+{
+  _bounding_radius = 0.0;
+
+  // read the mesh
+  IndexedTetraArray mesh = IndexedTetraArray::read_from_tetra(filename);
+  if (center)
+    mesh.center();
+  set_tetra_mesh(shared_ptr<const IndexedTetraArray>(new IndexedTetraArray(mesh)));
+}
+
+/// Sets the tetrahedral mesh
+/**
+ * Determines the boundary of the mesh and builds the bounding box hierarchy
+ * and the distance field; the cost of doing so is O(n log n) in the number
+ * of tetrahedra.
+ */
+void TetraMeshPrimitive::set_tetra_mesh(shared_ptr<const IndexedTetraArray> mesh)
+{
+  _mesh = mesh;
+
+  // bounding volumes are no longer valid
+  _obbs.clear();
+
+  // build the boundary, the hierarchy, and the distance field
+  build_boundary();
+  build_tree();
+  build_distance_field();
+
+  // compute the bounding radius
+  _bounding_radius = 0.0;
+  for (unsigned i=0; i< _boundary_verts.size(); i++)
+    _bounding_radius = std::max(_bounding_radius, _mesh->get_vertices()[_boundary_verts[i]].norm());
+
+  // recompute mass properties
+  calc_mass_properties();
+
+  // update the visualization, if necessary
+  update_visualization();
+}
+
+/// Determines the boundary of the mesh and the barycentric transforms of the tetrahedra
+void TetraMeshPrimitive::build_boundary()
+{
+  const unsigned X = 0, Y = 1, Z = 2, THREE_D = 3, NFACES = 4;
+
+  // clear existing data
+  _boundary.reset();
+  _boundary_verts.clear();
+  _tetra_data.clear();
+  if (!_mesh || _mesh->num_tetra() == 0)
+    return;
+
+  const vector<Origin3d>& verts = _mesh->get_vertices();
+  const vector<IndexedTetra>& tetra = _mesh->get_tetra();
+  _tetra_data.resize(tetra.size());
+
+  // get all faces of all tetrahedra (ordered as in Tetrahedron: abc, bdc,
+  // dac, dba)
+  vector<TetraFace> faces(tetra.size()*NFACES);
+  for (unsigned i=0; i< tetra.size(); i++)
+  {
+    const IndexedTetra& t = tetra[i];
+    const unsigned fv[NFACES][THREE_D] = { { t.a, t.b, t.c }, { t.b, t.d, t.c },
+                                           { t.d, t.a, t.c }, { t.d, t.b, t.a } };
+    for (unsigned j=0; j< NFACES; j++)
+    {
+      TetraFace& f = faces[i*NFACES+j];
+      std::copy(fv[j], fv[j]+THREE_D, f.v);
+      std::sort(f.v, f.v+THREE_D);
+      f.tetra = i;
+      f.face = j;
+    }
+
+    // compute the transform from a point to barycentric coordinates
+    TetraData& data = _tetra_data[i];
+    data.nfaces = 0;
+    data.surface = false;
+    Origin3d c0 = verts[t.a] - verts[t.d];
+    Origin3d c1 = verts[t.b] - verts[t.d];
+    Origin3d c2 = verts[t.c] - verts[t.d];
+    const double M[9] = { c0[X], c1[X], c2[X], c0[Y], c1[Y], c2[Y], c0[Z], c1[Z], c2[Z] };
+    const double det = M[0]*(M[4]*M[8] - M[5]*M[7]) - M[1]*(M[3]*M[8] - M[5]*M[6]) + M[2]*(M[3]*M[7] - M[4]*M[6]);
+    const double scale = std::max(c0.norm(), std::max(c1.norm(), c2.norm()));
+    data.degenerate = (std::fabs(det) <= NEAR_ZERO*scale*scale*scale);
+    if (data.degenerate)
+    {
+      std::fill(data.Binv, data.Binv+9, 0.0);
+      FILE_LOG(LOG_COLDET) << "TetraMeshPrimitive::build_boundary() - tetrahedron " << i << " is degenerate" << endl;
+      continue;
+    }
+    const double inv_det = 1.0/det;
+    data.Binv[0] = (M[4]*M[8] - M[5]*M[7])*inv_det;
+    data.Binv[1] = (M[2]*M[7] - M[1]*M[8])*inv_det;
+    data.Binv[2] = (M[1]*M[5] - M[2]*M[4])*inv_det;
+    data.Binv[3] = (M[5]*M[6] - M[3]*M[8])*inv_det;
+    data.Binv[4] = (M[0]*M[8] - M[2]*M[6])*inv_det;
+    data.Binv[5] = (M[2]*M[3] - M[0]*M[5])*inv_det;
+    data.Binv[6] = (M[3]*M[7] - M[4]*M[6])*inv_det;
+    data.Binv[7] = (M[1]*M[6] - M[0]*M[7])*inv_det;
+    data.Binv[8] = (M[0]*M[4] - M[1]*M[3])*inv_det;
+  }
+
+  // faces that appear exactly once are on the boundary
+  std::sort(faces.begin(), faces.end());
+  vector<IndexedTri> tris;
+  vector<bool> on_boundary(verts.size(), false);
+  for (unsigned i=0, j=0; i< faces.size(); i = j)
+  {
+    // find the end of the group of identical faces
+    for (j=i+1; j< faces.size() && faces[j].same(faces[i]); j++) ;
+    if (j - i != 1)
+      continue;
+
+    // get the face in the order it appears in the tetrahedron
+    const IndexedTetra& t = tetra[faces[i].tetra];
+    const unsigned fv[NFACES][NFACES] = { { t.a, t.b, t.c, t.d }, { t.b, t.d, t.c, t.a },
+                                          { t.d, t.a, t.c, t.b }, { t.d, t.b, t.a, t.c } };
+    const unsigned* v = fv[faces[i].face];
+
+    // orient the face away from the opposite vertex
+    Origin3d n = Origin3d::cross(verts[v[1]] - verts[v[0]], verts[v[2]] - verts[v[0]]);
+    if (n.dot(verts[v[3]] - verts[v[0]]) > 0.0)
+      tris.push_back(IndexedTri(v[0], v[2], v[1]));
+    else
+      tris.push_back(IndexedTri(v[0], v[1], v[2]));
+
+    // record the face with the tetrahedron and mark its vertices
+    TetraData& data = _tetra_data[faces[i].tetra];
+    data.faces[data.nfaces++] = tris.size() - 1;
+    for (unsigned k=0; k< THREE_D; k++)
+      on_boundary[v[k]] = true;
+  }
+
+  // set the boundary vertices
+  for (unsigned i=0; i< on_boundary.size(); i++)
+    if (on_boundary[i])
+      _boundary_verts.push_back(i);
+
+  // tetrahedra with all vertices on the boundary need exact distances
+  for (unsigned i=0; i< tetra.size(); i++)
+    _tetra_data[i].surface = on_boundary[tetra[i].a] && on_boundary[tetra[i].b] && on_boundary[tetra[i].c] && on_boundary[tetra[i].d];
+
+  // create the boundary mesh (sharing vertices with the tetrahedral mesh)
+  _boundary = shared_ptr<const IndexedTriArray>(new IndexedTriArray(_mesh->get_vertices_pointer(), tris));
+
+  FILE_LOG(LOG_COLDET) << "TetraMeshPrimitive::build_boundary() - " << tetra.size() << " tetrahedra, " << tris.size() << " boundary triangles" << endl;
+}
+
+/// Builds the bounding box hierarchy over the tetrahedra
+void TetraMeshPrimitive::build_tree()
+{
+  _nodes.clear();
+  _tetra.clear();
+  if (!_mesh || _mesh->num_tetra() == 0)
+    return;
+
+  // compute the tetrahedra centroids
+  const vector<Origin3d>& verts = _mesh->get_vertices();
+  const vector<IndexedTetra>& tetra = _mesh->get_tetra();
+  vector<Origin3d> centroids(tetra.size());
+  _tetra.resize(tetra.size());
+  for (unsigned i=0; i< tetra.size(); i++)
+  {
+    centroids[i] = (verts[tetra[i].a] + verts[tetra[i].b] + verts[tetra[i].c] + verts[tetra[i].d])*0.25;
+    _tetra[i] = i;
+  }
+
+  // build the hierarchy
+  _nodes.reserve(2*tetra.size()/MAX_LEAF_TETRA + 1);
+  _nodes.push_back(Node());
+  build_node(0, 0, tetra.size(), centroids);
+}
+
+/// Builds a node of the bounding box hierarchy (and, recursively, its children)
+void TetraMeshPrimitive::build_node(unsigned idx, unsigned first, unsigned count, const vector<Origin3d>& centroids)
+{
+  const unsigned X = 0, Y = 1, Z = 2, THREE_D = 3;
+  const double INF = std::numeric_limits<double>::max();
+  const vector<Origin3d>& verts = _mesh->get_vertices();
+  const vector<IndexedTetra>& tetra = _mesh->get_tetra();
+
+  // compute the bounding box of the vertices and of the centroids
+  Origin3d lo(INF, INF, INF), hi(-INF, -INF, -INF);
+  Origin3d clo(INF, INF, INF), chi(-INF, -INF, -INF);
+  for (unsigned i=first; i< first+count; i++)
+  {
+    const IndexedTetra& t = tetra[_tetra[i]];
+    const unsigned v[4] = { t.a, t.b, t.c, t.d };
+    for (unsigned j=0; j< 4; j++)
+      for (unsigned k=0; k< THREE_D; k++)
+      {
+        lo[k] = std::min(lo[k], verts[v[j]][k]);
+        hi[k] = std::max(hi[k], verts[v[j]][k]);
+      }
+    const Origin3d& c = centroids[_tetra[i]];
+    for (unsigned k=0; k< THREE_D; k++)
+    {
+      clo[k] = std::min(clo[k], c[k]);
+      chi[k] = std::max(chi[k], c[k]);
+    }
+  }
+
+  // setup the node
+  Node& node = _nodes[idx];
+  for (unsigned k=0; k< THREE_D; k++)
+  {
+    node.lo[k] = lo[k];
+    node.hi[k] = hi[k];
+  }
+  node.first = first;
+  node.count = count;
+  node.left = -1;
+  if (count <= MAX_LEAF_TETRA)
+    return;
+
+  // split at the median centroid along the axis of greatest extent
+  Origin3d ext = chi - clo;
+  unsigned axis = (ext[X] > ext[Y]) ? ((ext[X] > ext[Z]) ? X : Z) : ((ext[Y] > ext[Z]) ? Y : Z);
+  const unsigned half = count/2;
+  std::nth_element(_tetra.begin()+first, _tetra.begin()+first+half, _tetra.begin()+first+count, TetraCentroidComp(centroids, axis));
+
+  // create the children (this may invalidate 'node')
+  const unsigned left = _nodes.size();
+  _nodes[idx].left = (int) left;
+  _nodes.push_back(Node());
+  _nodes.push_back(Node());
+  build_node(left, first, half, centroids);
+  build_node(left+1, first+half, count-half, centroids);
+}
+
+/// Computes the signed distance to the boundary at every vertex and the distance gradient within every tetrahedron
+void TetraMeshPrimitive::build_distance_field()
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  _vdist.clear();
+  if (!_mesh || _mesh->num_tetra() == 0)
+    return;
+
+  // boundary vertices have zero distance
+  const vector<Origin3d>& verts = _mesh->get_vertices();
+  _vdist.resize(verts.size(), 0.0);
+  vector<bool> on_boundary(verts.size(), false);
+  for (unsigned i=0; i< _boundary_verts.size(); i++)
+    on_boundary[_boundary_verts[i]] = true;
+
+  // interior vertices are at the negated distance to the boundary
+  // worker threads do not inherit the subsystem current in this thread
+  const MemoryAccounting::Subsystem MEM_SUBSYSTEM = MemoryAccounting::get_current();
+  #ifdef _OPENMP
+  #pragma omp parallel for
+  #endif
+  for (int i=0; i< (int) verts.size(); i++)
+  {
+    MemoryAccounting::Scope mem_scope(MEM_SUBSYSTEM);
+    if (on_boundary[i])
+      continue;
+    Point3d closest;
+    unsigned tri;
+    _vdist[i] = -calc_boundary_dist(Point3d(verts[i], GLOBAL), closest, tri);
+  }
+
+  // compute the gradient of the interpolated distance in each tetrahedron:
+  // phi(p) = phi_d + sum_k (phi_k - phi_d)*lambda_k, lambda = Binv*(p - d)
+  const vector<IndexedTetra>& tetra = _mesh->get_tetra();
+  for (unsigned i=0; i< tetra.size(); i++)
+  {
+    TetraData& data = _tetra_data[i];
+    const double dd = _vdist[tetra[i].d];
+    const double dphi[3] = { _vdist[tetra[i].a] - dd, _vdist[tetra[i].b] - dd, _vdist[tetra[i].c] - dd };
+    data.grad[X] = dphi[0]*data.Binv[0] + dphi[1]*data.Binv[3] + dphi[2]*data.Binv[6];
+    data.grad[Y] = dphi[0]*data.Binv[1] + dphi[1]*data.Binv[4] + dphi[2]*data.Binv[7];
+    data.grad[Z] = dphi[0]*data.Binv[2] + dphi[1]*data.Binv[5] + dphi[2]*data.Binv[8];
+  }
+}
+
+/// Computes the squared distance from a point to the box of a hierarchy node
+double TetraMeshPrimitive::calc_sq_dist(const Node& node, const Point3d& p)
+{
+  const unsigned THREE_D = 3;
+  double sq_dist = 0.0;
+  for (unsigned k=0; k< THREE_D; k++)
+  {
+    if (p[k] < node.lo[k])
+      sq_dist += (node.lo[k] - p[k])*(node.lo[k] - p[k]);
+    else if (p[k] > node.hi[k])
+      sq_dist += (p[k] - node.hi[k])*(p[k] - node.hi[k]);
+  }
+
+  return sq_dist;
+}
+
+/// Finds a tetrahedron containing the given point
+/**
+ * \param p the query point (in the mesh frame)
+ * \param bary on return, the barycentric coordinates of p in the tetrahedron
+ *        (weights of vertices a, b, c, and d)
+ * \return the index of the tetrahedron, or -1 if p is not within the mesh
+ */
+int TetraMeshPrimitive::find_tetra(const Point3d& p, double bary[4]) const
+{
+  const unsigned X = 0, Y = 1, Z = 2, MAX_STACK = 128;
+  const vector<Origin3d>& verts = _mesh->get_vertices();
+  const vector<IndexedTetra>& tetra = _mesh->get_tetra();
+
+  if (_nodes.empty())
+    return -1;
+
+  // traverse the hierarchy
+  unsigned stack[MAX_STACK];
+  unsigned n = 0;
+  stack[n++] = 0;
+  while (n > 0)
+  {
+    const Node& node = _nodes[stack[--n]];
+    if (calc_sq_dist(node, p) > NEAR_ZERO*NEAR_ZERO)
+      continue;
+
+    if (!node.is_leaf())
+    {
+      assert(n+2 <= MAX_STACK);
+      stack[n++] = (unsigned) node.left;
+      stack[n++] = (unsigned) node.left+1;
+      continue;
+    }
+
+    // test each tetrahedron in the leaf
+    for (unsigned i=node.first; i< node.first+node.count; i++)
+    {
+      const unsigned t = _tetra[i];
+      const TetraData& data = _tetra_data[t];
+      if (data.degenerate)
+        continue;
+
+      // compute the barycentric coordinates
+      const Origin3d& d = verts[tetra[t].d];
+      const double r[3] = { p[X] - d[X], p[Y] - d[Y], p[Z] - d[Z] };
+      bary[0] = data.Binv[0]*r[X] + data.Binv[1]*r[Y] + data.Binv[2]*r[Z];
+      bary[1] = data.Binv[3]*r[X] + data.Binv[4]*r[Y] + data.Binv[5]*r[Z];
+      bary[2] = data.Binv[6]*r[X] + data.Binv[7]*r[Y] + data.Binv[8]*r[Z];
+      bary[3] = 1.0 - bary[0] - bary[1] - bary[2];
+      if (bary[0] >= -NEAR_ZERO && bary[1] >= -NEAR_ZERO && bary[2] >= -NEAR_ZERO && bary[3] >= -NEAR_ZERO)
+        return (int) t;
+    }
+  }
+
+  return -1;
+}
+
+/// Computes the (unsigned) distance from a point to the boundary of the mesh
+/**
+ * \param p the query point (in the mesh frame)
+ * \param closest on return, the closest point on the boundary
+ * \param tri on return, the index of the closest boundary triangle
+ */
+double TetraMeshPrimitive::calc_boundary_dist(const Point3d& p, Point3d& closest, unsigned& tri) const
+{
+  const unsigned MAX_STACK = 128;
+  double min_sq_dist = std::numeric_limits<double>::max();
+  tri = std::numeric_limits<unsigned>::max();
+
+  if (_nodes.empty() || !_boundary)
+    return min_sq_dist;
+
+  // traverse the hierarchy, visiting the nearer child first; every boundary
+  // triangle lies within the box of the tetrahedron that it belongs to
+  unsigned stack[MAX_STACK];
+  unsigned n = 0;
+  stack[n++] = 0;
+  while (n > 0)
+  {
+    const Node& node = _nodes[stack[--n]];
+    if (calc_sq_dist(node, p) >= min_sq_dist)
+      continue;
+
+    if (!node.is_leaf())
+    {
+      assert(n+2 <= MAX_STACK);
+      const unsigned left = (unsigned) node.left, right = left+1;
+      if (calc_sq_dist(_nodes[left], p) < calc_sq_dist(_nodes[right], p))
+      {
+        stack[n++] = right;
+        stack[n++] = left;
+      }
+      else
+      {
+        stack[n++] = left;
+        stack[n++] = right;
+      }
+      continue;
+    }
+
+    // examine the boundary triangles of each tetrahedron in the leaf
+    for (unsigned i=node.first; i< node.first+node.count; i++)
+    {
+      const TetraData& data = _tetra_data[_tetra[i]];
+      for (unsigned j=0; j< data.nfaces; j++)
+      {
+        Point3d cp;
+        double sq_dist = Triangle::calc_sq_dist(_boundary->get_triangle(data.faces[j], p.pose), p, cp);
+        if (sq_dist < min_sq_dist)
+        {
+          min_sq_dist = sq_dist;
+          closest = cp;
+          tri = data.faces[j];
+        }
+      }
+    }
+  }
+
+  return std::sqrt(min_sq_dist);
+}
+
+/// Computes the signed distance from a point to the primitive and the outward normal at the point
+double TetraMeshPrimitive::calc_field_dist(const Point3d& p, Vector3d& normal) const
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+  const vector<IndexedTetra>& tetra = _mesh->get_tetra();
+
+  // look for the tetrahedron containing the point
+  double bary[4];
+  int t = find_tetra(p, bary);
+
+  // interpolate the distance field, if possible
+  if (t >= 0 && !_tetra_data[t].surface)
+  {
+    const TetraData& data = _tetra_data[t];
+    Vector3d grad(data.grad[X], data.grad[Y], data.grad[Z], p.pose);
+    double grad_norm = grad.norm();
+    if (grad_norm > NEAR_ZERO)
+    {
+      normal = grad/grad_norm;
+      return bary[0]*_vdist[tetra[t].a] + bary[1]*_vdist[tetra[t].b] +
+             bary[2]*_vdist[tetra[t].c] + bary[3]*_vdist[tetra[t].d];
+    }
+  }
+
+  // still here? compute the distance to the boundary exactly
+  Point3d closest;
+  unsigned tri;
+  double dist = calc_boundary_dist(p, closest, tri);
+  if (tri == std::numeric_limits<unsigned>::max())
+  {
+    normal.set_zero(p.pose);
+    return dist;
+  }
+
+  // setup the normal
+  if (dist > NEAR_ZERO)
+    normal = (t >= 0) ? (closest - p)/dist : (p - closest)/dist;
+  else
+    normal = _boundary->get_triangle(tri, p.pose).calc_normal();
+
+  return (t >= 0) ? -dist : dist;
+}
+
+/// Computes the signed distance from a point to the primitive
+double TetraMeshPrimitive::calc_signed_dist(const Point3d& p) const
+{
+  // verify that the point is defined with respect to one of the poses
+  assert(_poses.find(const_pointer_cast<Pose3d>(p.pose)) != _poses.end());
+
+  if (!_mesh)
+    return std::numeric_limits<double>::max();
+
+  Vector3d normal;
+  return calc_field_dist(p, normal);
+}
+
+/// Computes the signed distance from a point to the primitive and the outward normal at the point
+double TetraMeshPrimitive::calc_dist_and_normal(const Point3d& p, vector<Vector3d>& normals) const
+{
+  // verify that the point is defined with respect to one of the poses
+  assert(_poses.find(const_pointer_cast<Pose3d>(p.pose)) != _poses.end());
+
+  // setup the normal
+  normals.push_back(Vector3d());
+  Vector3d& normal = normals.back();
+
+  if (!_mesh)
+  {
+    normal.set_zero(p.pose);
+    return std::numeric_limits<double>::max();
+  }
+
+  return calc_field_dist(p, normal);
+}
+
+/// Computes the signed distance between this and another primitive
+/**
+ * The vertices of the other primitive are examined against the distance
+ * field of this one.
+ */
+double TetraMeshPrimitive::calc_signed_dist(shared_ptr<const Primitive> p, Point3d& pthis, Point3d& pp) const
+{
+  if (!_mesh)
+    return std::numeric_limits<double>::max();
+
+  // get the vertices from the other primitive
+  shared_ptr<Primitive> pnc = const_pointer_cast<Primitive>(p);
+  vector<Point3d> verts;
+  pnc->get_vertices(pp.pose, verts);
+
+  // examine the distance from each vertex
+  double mindist = std::numeric_limits<double>::max();
+  for (unsigned i=0; i< verts.size(); i++)
+  {
+    Point3d pt = Pose3d::transform_point(pthis.pose, verts[i]);
+    Vector3d normal;
+    double dist = calc_field_dist(pt, normal);
+    if (dist < mindist)
+    {
+      mindist = dist;
+      pp = verts[i];
+      pthis = pt - normal*dist;
+    }
+  }
+
+  return mindist;
+}
+
+/// Gets the vertices on the boundary of the mesh
+void TetraMeshPrimitive::get_vertices(shared_ptr<const Pose3d> P, vector<Point3d>& vertices) const
+{
+  // verify that the primitive knows about this pose
+  assert(_poses.find(const_pointer_cast<Pose3d>(P)) != _poses.end() || P == get_pose());
+
+  vertices.clear();
+  if (!_mesh)
+    return;
+
+  const vector<Origin3d>& verts = _mesh->get_vertices();
+  vertices.resize(_boundary_verts.size());
+  for (unsigned i=0; i< _boundary_verts.size(); i++)
+    vertices[i] = Point3d(verts[_boundary_verts[i]], P);
+}
+
+/// Gets the root bounding volume (the box at the root of the hierarchy)
+BVPtr TetraMeshPrimitive::get_BVH_root(CollisionGeometryPtr geom)
+{
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
+  const unsigned THREE_D = 3;
+
+  // get the pointer to the bounding box
+  OBBPtr& obb = _obbs[geom];
+
+  // create the bounding box, if necessary
+  if (!obb)
+  {
+    obb = shared_ptr<OBB>(new OBB);
+    obb->geom = geom;
+
+    // get the pose for the primitive and geometry
+    shared_ptr<const Pose3d> P = _cg_poses[geom];
+
+    // setup the obb center, orientation, and half-lengths
+    obb->center = Point3d(0.0, 0.0, 0.0, P);
+    obb->R.set_identity();
+    obb->l.set_zero(P);
+    if (!_nodes.empty())
+    {
+      const Node& root = _nodes.front();
+      for (unsigned k=0; k< THREE_D; k++)
+      {
+        obb->center[k] = (root.lo[k] + root.hi[k])*0.5;
+        obb->l[k] = (root.hi[k] - root.lo[k])*0.5;
+      }
+    }
+  }
+
+  return obb;
+}
+
+/// Calculates mass properties of this primitive
+/**
+ * Computes the mass, center-of-mass, and inertia of this primitive by
+ * summing over the tetrahedra.
+ */
+void TetraMeshPrimitive::calc_mass_properties()
+{
+  const unsigned X = 0, Y = 1, Z = 2, THREE_D = 3;
+
+  // if there is no mesh, set things to some defaults
+  if (!_mesh || _mesh->num_tetra() == 0)
+  {
+    _J.m = 0.0;
+    _J.h.set_zero();
+    _J.J.set_zero();
+    return;
+  }
+
+  // compute the volume, the first moment, and the second moment (about the
+  // primitive origin); the second moment of a tetrahedron with vertices v_i
+  // is V/20 * (sum_i v_i v_i' + (sum_i v_i)(sum_i v_i)')
+  const vector<Origin3d>& verts = _mesh->get_vertices();
+  const vector<IndexedTetra>& tetra = _mesh->get_tetra();
+  double volume = 0.0;
+  double m1[THREE_D] = { 0.0, 0.0, 0.0 };
+  double C[THREE_D][THREE_D] = { { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 } };
+  for (unsigned i=0; i< tetra.size(); i++)
+  {
+    const Origin3d* v[4] = { &verts[tetra[i].a], &verts[tetra[i].b], &verts[tetra[i].c], &verts[tetra[i].d] };
+    Origin3d s = *v[0] + *v[1] + *v[2] + *v[3];
+    double vol = std::fabs(Origin3d::cross(*v[0] - *v[3], *v[1] - *v[3]).dot(*v[2] - *v[3]))/6.0;
+    volume += vol;
+    for (unsigned j=0; j< THREE_D; j++)
+    {
+      m1[j] += vol*s[j]*0.25;
+      for (unsigned k=0; k< THREE_D; k++)
+      {
+        double vv = s[j]*s[k];
+        for (unsigned l=0; l< 4; l++)
+          vv += (*v[l])[j]*(*v[l])[k];
+        C[j][k] += vol*vv/20.0;
+      }
+    }
+  }
+
+  // compute the center-of-mass
+  Origin3d com(m1[X]/volume, m1[Y]/volume, m1[Z]/volume);
+  _jF->x = com;
+
+  // compute the mass if density is given
+  if (_density)
+    _J.m = *_density * volume;
+
+  // compute the second moment about the center-of-mass
+  for (unsigned j=0; j< THREE_D; j++)
+    for (unsigned k=0; k< THREE_D; k++)
+      C[j][k] -= volume*com[j]*com[k];
+
+  // compute the inertia tensor
+  const double trace = C[X][X] + C[Y][Y] + C[Z][Z];
+  for (unsigned j=0; j< THREE_D; j++)
+    for (unsigned k=0; k< THREE_D; k++)
+      _J.J(j,k) = (_J.m/volume) * (((j == k) ? trace : 0.0) - C[j][k]);
+
+  // if one or more values of J is NaN, don't verify anything
+  for (unsigned i=X; i<= Z; i++)
+    for (unsigned j=i; j<= Z; j++)
+      if (std::isnan(_J.J(i,j)))
+      {
+        _J.J.set_zero();
+        return;
+      }
+}
+
+/// Creates the visualization for this primitive (the boundary of the mesh)
+osg::Node* TetraMeshPrimitive::create_visualization()
+{
+  #ifdef USE_OSG
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // create a new group to hold the geometry
+  osg::Group* group = new osg::Group;
+
+  // only create stuff if necessary
+  if (_boundary)
+  {
+    // create necessary OSG elements for visualization
+    osg::Geode* geode = new osg::Geode;
+    osg::Geometry* geom = new osg::Geometry;
+    geode->addDrawable(geom);
+    group->addChild(geode);
+
+    // get the vertices and facets
+    const std::vector<Origin3d>& verts = _boundary->get_vertices();
+    const std::vector<IndexedTri>& facets = _boundary->get_facets();
+
+    // create the vertex array
+    osg::Vec3Array* varray = new osg::Vec3Array(verts.size());
+    for (unsigned i=0; i< verts.size(); i++)
+      (*varray)[i] = osg::Vec3((float) verts[i][X], (float) verts[i][Y], (float) verts[i][Z]);
+    geom->setVertexArray(varray);
+
+    // create the faces
+    for (unsigned i=0; i< facets.size(); i++)
+    {
+      osg::DrawElementsUInt* face = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES, 0);
+      face->push_back(facets[i].a);
+      face->push_back(facets[i].b);
+      face->push_back(facets[i].c);
+      geom->addPrimitiveSet(face);
+    }
+  }
+
+  return group;
+  #else
+  return NULL;
+  #endif
+}
+
+/// Implements Base::load_from_xml() for serialization
+void TetraMeshPrimitive::load_from_xml(shared_ptr<const XMLTree> node, map<string, BasePtr>& id_map)
+{
+  // check that this node name is correct
+  assert(strcasecmp(node->name.c_str(), "TetraMesh") == 0);
+
+  // load data from the Primitive
+  Primitive::load_from_xml(node, id_map);
+
+  // make sure that a filename is specified
+  XMLAttrib* fname_attr = node->get_attrib("filename");
+  if (!fname_attr)
+  {
+    cerr << "TetraMeshPrimitive::load_from_xml() - trying to load a ";
+    cerr << " tetrahedral mesh w/o a filename!" << endl;
+    cerr << "  offending node: " << endl << *node << endl;
+    return;
+  }
+
+  // read the mesh
+  IndexedTetraArray mesh = IndexedTetraArray::read_from_tetra(fname_attr->get_string_value());
+
+  // see whether to center the mesh
+  XMLAttrib* center_attr = node->get_attrib("center");
+  if (center_attr && center_attr->get_bool_value())
+    mesh.center();
+
+  // set the mesh (this also computes mass properties)
+  set_tetra_mesh(shared_ptr<const IndexedTetraArray>(new IndexedTetraArray(mesh)));
+}
+
+/// Implements Base::save_to_xml() for serialization
+void TetraMeshPrimitive::save_to_xml(XMLTreePtr node, list<shared_ptr<const Base> >& shared_objects) const
+{
+  // save the parent data
+  Primitive::save_to_xml(node, shared_objects);
+
+  // (re)set the node name
+  node->name = "TetraMesh";
+
+  // make sure there is a mesh to write
+  if (!_mesh)
+    return;
+
+  // make a filename using "this"
+  const unsigned MAX_DIGITS = 28;
+  char buffer[MAX_DIGITS+1];
+  sprintf(buffer, "%p", this);
+  string filename = "tetramesh" + string(buffer) + ".tetra";
+
+  // add the filename as an attribute
+  node->attribs.insert(XMLAttrib("filename", filename));
+
+  // write the mesh
+  _mesh->write_to_tetra(filename);
+}
+
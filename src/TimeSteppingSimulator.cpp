@@ -46,6 +46,8 @@ using namespace Moby;
 TimeSteppingSimulator::TimeSteppingSimulator()
 {
   min_step_size = NEAR_ZERO;
+  sustained_contact_steps = 0;
+  sustained_contact_vel_tol = 1e-3;
 }
 
 /// Steps the simulator forward by the given step size
@@ -53,17 +55,23 @@ double TimeSteppingSimulator::step(double step_size)
 {
   const double INF = std::numeric_limits<double>::max();
 
-  // determine the set of collision geometries
-  determine_geometries();
-
   // clear one-step visualization data
   #ifdef USE_OSG
   _transient_vdata->removeChildren(0, _transient_vdata->getNumChildren());
   #endif
 
+  // hide contact visualization from the last step
+  reset_contact_visualization();
+
   // clear stored derivatives
   _current_dx.resize(0);
 
+  // clear the timings and counts from the last step
+  reset_step_statistics();
+
+  // finish removing any bodies removed since the last step
+  purge_removed_geometries();
+
   FILE_LOG(LOG_SIMULATOR) << "+stepping simulation from time: " << this->current_time << " by " << step_size << std::endl;
   if (LOGGING(LOG_SIMULATOR))
   {
@@ -87,15 +95,15 @@ double TimeSteppingSimulator::step(double step_size)
   // do the Euler step
   step_si_Euler(step_size);
 
+  // update the sensors (before the callback, so that it sees their output)
+  update_sensors(step_size);
+
   // call the callback
   if (post_step_callback_fn)
     post_step_callback_fn(this);
 
   // do constraint stabilization
-  shared_ptr<ConstraintSimulator> simulator = dynamic_pointer_cast<ConstraintSimulator>(shared_from_this());
-  FILE_LOG(LOG_SIMULATOR) << "stabilization started" << std::endl;
-  cstab.stabilize(simulator);
-  FILE_LOG(LOG_SIMULATOR) << "stabilization done" << std::endl;
+  stabilize_constraints();
 
   // write out constraint violation
   #ifndef NDEBUG
@@ -110,6 +118,37 @@ double TimeSteppingSimulator::step(double step_size)
   return step_size;
 }
 
+/// Discards the data that the simulator retains between steps
+/**
+ * In addition to the data discarded by ConstraintSimulator::reset_caches(),
+ * this discards the sustained contacts, their resting step counts, and the
+ * sustained contact solver's warm start data.
+ */
+void TimeSteppingSimulator::reset_caches()
+{
+  ConstraintSimulator::reset_caches();
+  _sustained_constraints.clear();
+  _resting_steps.clear();
+  _sustained_constraint_handler.clear_warm_start_data();
+}
+
+/// Does constraint stabilization and times it
+/**
+ * Stabilization computes pairwise distances itself; that time is charged to
+ * stabilization_time alone, so that the phase timings do not overlap.
+ */
+void TimeSteppingSimulator::stabilize_constraints()
+{
+  shared_ptr<ConstraintSimulator> simulator = dynamic_pointer_cast<ConstraintSimulator>(shared_from_this());
+  FILE_LOG(LOG_SIMULATOR) << "stabilization started" << std::endl;
+  const double NARROW_PHASE_TIME = narrow_phase_time;
+  double start = get_current_time();
+  cstab.stabilize(simulator);
+  stabilization_time += get_current_time() - start;
+  narrow_phase_time = NARROW_PHASE_TIME;
+  FILE_LOG(LOG_SIMULATOR) << "stabilization done" << std::endl;
+}
+
 /// Does a full integration cycle (but not necessarily a full step)
 double TimeSteppingSimulator::do_mini_step(double dt)
 {
@@ -170,14 +209,20 @@ double TimeSteppingSimulator::do_mini_step(double dt)
   FILE_LOG(LOG_SIMULATOR) << "Position integration ended w/h = " << h << std::endl;
 
   // prepare to calculate forward dynamics
+  double start = get_current_time();
   precalc_fwd_dyn();
 
   // apply compliant unilateral constraint forces
   calc_compliant_unilateral_constraint_forces();
+  record_step_contacts(_compliant_constraints, h);
 
   // compute forward dynamics
   calc_fwd_dyn(h);
 
+  // apply forces for sustained contacts (and recompute forward dynamics)
+  if (sustained_contact_steps > 0)
+    calc_sustained_unilateral_constraint_forces(h);
+
   // integrate the bodies' velocities forward by h
   for (unsigned i=0; i< _bodies.size(); i++)
   {
@@ -197,19 +242,32 @@ double TimeSteppingSimulator::do_mini_step(double dt)
     vector<shared_ptr<DynamicBodyd> > bodies;
     BOOST_FOREACH(ControlledBodyPtr cb, _bodies)
       bodies.push_back(dynamic_pointer_cast<DynamicBodyd>(cb));
-    _dissipator->apply(bodies);
+    _dissipator->apply(bodies, h);
   }
 
   FILE_LOG(LOG_SIMULATOR) << "Integrated velocity by " << h << std::endl;
+  dynamics_time += get_current_time() - start;
 
   // recompute pairwise distances
   calc_pairwise_distances();
 
-  // find unilateral constraints
-  find_unilateral_constraints(contact_dist_thresh);
+  // find unilateral constraints (looking ahead by the mini-step for joint
+  // limits)
+  start = get_current_time();
+  find_unilateral_constraints(contact_dist_thresh, h);
+  for (unsigned i=0; i< _rigid_constraints.size(); i++)
+    if (_rigid_constraints[i].constraint_type == UnilateralConstraint::eContact)
+      step_contacts++;
+  step_contacts += _compliant_constraints.size();
 
   // handle any impacts
   calc_impacting_unilateral_constraint_forces(-1.0);
+  record_step_contacts(_rigid_constraints, 0.0);
+  constraint_time += get_current_time() - start;
+
+  // determine which contacts are resting
+  if (sustained_contact_steps > 0)
+    update_resting_steps();
 
   // update the time
   current_time += h;
@@ -221,6 +279,90 @@ double TimeSteppingSimulator::do_mini_step(double dt)
   return h;
 }
 
+/// Computes acceleration-level forces for contacts that have been resting for sustained_contact_steps mini-steps
+/**
+ * The contacts are those found at the end of the last mini-step; the bodies'
+ * generalized accelerations must be current. Forward dynamics are
+ * recomputed after the contact forces have been applied.
+ */
+void TimeSteppingSimulator::calc_sustained_unilateral_constraint_forces(double dt)
+{
+  // the sustained constraint handler does not account for implicit joints
+  // or coupling constraints
+  if (!implicit_joints.empty() || !coupling_constraints.empty())
+    return;
+
+  // get the contacts between geometries that have been resting long enough
+  _sustained_constraints.clear();
+  for (unsigned i=0; i< _rigid_constraints.size(); i++)
+  {
+    const UnilateralConstraint& e = _rigid_constraints[i];
+    if (e.constraint_type != UnilateralConstraint::eContact)
+      continue;
+    map<sorted_pair<CollisionGeometryPtr>, unsigned>::const_iterator iter = _resting_steps.find(make_sorted_pair(e.contact_geom1, e.contact_geom2));
+    if (iter != _resting_steps.end() && iter->second >= sustained_contact_steps)
+      _sustained_constraints.push_back(e);
+  }
+
+  FILE_LOG(LOG_SIMULATOR) << "TimeSteppingSimulator::calc_sustained_unilateral_constraint_forces() - processing " << _sustained_constraints.size() << " sustained contacts" << std::endl;
+
+  // compute the contact forces (this also discards warm starting data for
+  // contacts that are no longer sustained)
+  try
+  {
+    _sustained_constraint_handler.process_constraints(_sustained_constraints);
+    record_step_contacts(_sustained_constraints, dt);
+  }
+  catch (SustainedUnilateralConstraintSolveFailException e)
+  {
+    // contacts will be treated as impacts until they rest again
+    FILE_LOG(LOG_SIMULATOR) << "sustained contact force computation failed; resetting resting contact counts" << std::endl;
+    _resting_steps.clear();
+  }
+
+  // recompute forward dynamics
+  if (!_sustained_constraints.empty())
+    calc_fwd_dyn(dt);
+}
+
+/// Updates the number of consecutive mini-steps that contacts between pairs of geometries have been resting
+/**
+ * Contacts between a pair of geometries are resting if every contact between
+ * the pair has normal and tangential speeds no greater than
+ * sustained_contact_vel_tol after impacts have been processed.
+ */
+void TimeSteppingSimulator::update_resting_steps()
+{
+  std::set<sorted_pair<CollisionGeometryPtr> > contact_geoms, moving_geoms;
+
+  // determine the pairs of geometries with contacts that are not resting
+  for (unsigned i=0; i< _rigid_constraints.size(); i++)
+  {
+    const UnilateralConstraint& e = _rigid_constraints[i];
+    if (e.constraint_type != UnilateralConstraint::eContact)
+      continue;
+    sorted_pair<CollisionGeometryPtr> geoms = make_sorted_pair(e.contact_geom1, e.contact_geom2);
+    contact_geoms.insert(geoms);
+    double vn = e.calc_contact_vel(e.contact_normal);
+    double vs = e.calc_contact_vel(e.contact_tan1);
+    double vt = e.calc_contact_vel(e.contact_tan2);
+    if (std::fabs(vn) > sustained_contact_vel_tol ||
+        std::sqrt(vs*vs + vt*vt) > sustained_contact_vel_tol)
+      moving_geoms.insert(geoms);
+  }
+
+  // update the counts; pairs that are no longer in contact are removed
+  map<sorted_pair<CollisionGeometryPtr>, unsigned> resting_steps;
+  BOOST_FOREACH(const sorted_pair<CollisionGeometryPtr>& geoms, contact_geoms)
+  {
+    if (moving_geoms.find(geoms) != moving_geoms.end())
+      continue;
+    map<sorted_pair<CollisionGeometryPtr>, unsigned>::const_iterator iter = _resting_steps.find(geoms);
+    resting_steps[geoms] = (iter == _resting_steps.end()) ? 1 : iter->second + 1;
+  }
+  _resting_steps.swap(resting_steps);
+}
+
 /// Checks to see whether all constraints are met
 bool TimeSteppingSimulator::constraints_met(const std::vector<PairwiseDistInfo>& current_pairwise_distances)
 {
@@ -305,25 +447,29 @@ double TimeSteppingSimulator::calc_next_CA_Euler_step(double contact_dist_thresh
     }
   }
 
-  // if the distance between any pair of bodies is sufficiently small
-  // get next possible event time
-  BOOST_FOREACH(PairwiseDistInfo pdi, _pairwise_distances)
+  // only process pairs for which neither of the bodies is compliant
+  vector<PairwiseDistInfo> pdis;
+  BOOST_FOREACH(const PairwiseDistInfo& pdi, _pairwise_distances)
   {
-    // only process if neither of the bodies is compliant
     RigidBodyPtr rba = dynamic_pointer_cast<RigidBody>(pdi.a->get_single_body());
     RigidBodyPtr rbb = dynamic_pointer_cast<RigidBody>(pdi.b->get_single_body());
     if (rba->compliance == RigidBody::eCompliant || 
         rbb->compliance == RigidBody::eCompliant)
       continue; 
+    pdis.push_back(pdi);
+  }
 
-      // compute an upper bound on the event time
-      double event_time = _coldet->calc_CA_Euler_step(pdi);
-
-      FILE_LOG(LOG_SIMULATOR) << "Next contact time between " << pdi.a->get_single_body()->body_id << " and " << pdi.b->get_single_body()->body_id << ": " << event_time << std::endl;
+  // compute upper bounds on the event times (the collision detector may
+  // process the pairs concurrently)
+  vector<double> event_times;
+  _coldet->calc_CA_Euler_steps(pdis, event_times);
 
-      // not a current event, find when it could become active
-      next_event_time = std::min(next_event_time, event_time);
-    }
+  // get next possible event time
+  for (unsigned i=0; i< pdis.size(); i++)
+  {
+    FILE_LOG(LOG_SIMULATOR) << "Next contact time between " << pdis[i].a->get_single_body()->body_id << " and " << pdis[i].b->get_single_body()->body_id << ": " << event_times[i] << std::endl;
+    next_event_time = std::min(next_event_time, event_times[i]);
+  }
 
   FILE_LOG(LOG_SIMULATOR) << "TimeSteppingSimulator::calc_next_CA_Euler_step exited" << std::endl; 
 
@@ -395,7 +541,7 @@ void TimeSteppingSimulator::step_si_Euler(double dt)
     vector<shared_ptr<DynamicBodyd> > bodies;
     BOOST_FOREACH(ControlledBodyPtr cb, _bodies)
       bodies.push_back(dynamic_pointer_cast<DynamicBodyd>(cb));
-    _dissipator->apply(bodies);
+    _dissipator->apply(bodies, dt);
   }
 
   // recompute pairwise distances
@@ -470,6 +616,14 @@ void TimeSteppingSimulator::load_from_xml(shared_ptr<const XMLTree> node, map<st
   XMLAttrib* min_step_attrib = node->get_attrib("min-step-size");
   if (min_step_attrib)
     min_step_size = min_step_attrib->get_real_value();
+
+  // read the sustained contact parameters
+  XMLAttrib* sustained_steps_attrib = node->get_attrib("sustained-contact-steps");
+  if (sustained_steps_attrib)
+    sustained_contact_steps = sustained_steps_attrib->get_unsigned_value();
+  XMLAttrib* sustained_tol_attrib = node->get_attrib("sustained-contact-vel-tol");
+  if (sustained_tol_attrib)
+    sustained_contact_vel_tol = sustained_tol_attrib->get_real_value();
 }
 
 /// Implements Base::save_to_xml()
@@ -483,6 +637,10 @@ void TimeSteppingSimulator::save_to_xml(XMLTreePtr node, list<shared_ptr<const B
 
   // save the minimum step size
   node->attribs.insert(XMLAttrib("min-step-size", min_step_size));
+
+  // save the sustained contact parameters
+  node->attribs.insert(XMLAttrib("sustained-contact-steps", sustained_contact_steps));
+  node->attribs.insert(XMLAttrib("sustained-contact-vel-tol", sustained_contact_vel_tol));
 }
 
 
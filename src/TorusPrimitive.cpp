@@ -16,8 +16,10 @@
 #include <Moby/Constants.h>
 #include <Moby/CollisionGeometry.h>
 #include <Moby/HeightmapPrimitive.h>
+#include <Moby/MemoryAccounting.h>
 #include <Moby/TorusPrimitive.h>
 #include <Moby/PlanePrimitive.h>
+#include <Moby/TetraMeshPrimitive.h>
 
 using boost::shared_ptr;
 using boost::const_pointer_cast;
@@ -76,6 +78,7 @@ osg::Node* TorusPrimitive::create_visualization()
 /// Gets the root BVH for this torus
 BVPtr TorusPrimitive::get_BVH_root(CollisionGeometryPtr geom)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
   const unsigned X = 0, Y = 1, Z = 2;
 
   // get the pointer to the obb 
@@ -203,6 +206,11 @@ double TorusPrimitive::calc_signed_dist(shared_ptr<const Primitive> p, Point3d&
   if (planep)
     return calc_signed_dist(planep, pthis, pp);
 
+  // try torus/tetra mesh
+  shared_ptr<const TetraMeshPrimitive> tetp = dynamic_pointer_cast<const TetraMeshPrimitive>(p);
+  if (tetp)
+    return tetp->calc_signed_dist(dynamic_pointer_cast<const Primitive>(shared_from_this()), pp, pthis);
+
   throw std::runtime_error("Unsupported geometric pair"); 
 }
 
@@ -652,8 +652,8 @@ double Triangle::calc_sq_dist(const Triangle& t1, const Triangle& t2, Point3d& c
     fSqrDistTmp = calc_sq_dist(t2, seg, tmp2, tmp1);
     if (fSqrDistTmp < fSqrDist)
     {
-      cp1 = tmp2;
-      cp2 = tmp1;
+      cp1 = tmp1;
+      cp2 = tmp2;
       fSqrDist = fSqrDistTmp;
     }
   }
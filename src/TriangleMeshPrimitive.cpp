@@ -24,7 +24,12 @@
 #include <Moby/BoundingSphere.h>
 #include <Moby/CollisionGeometry.h>
 #include <Moby/GJK.h>
+#include <Moby/CompGeom.h>
+#include <Moby/ModelCache.h>
+#include <Moby/ADF.h>
+#include <Moby/TetraMeshPrimitive.h>
 #include <Moby/TriangleMeshPrimitive.h>
+#include <Moby/MemoryAccounting.h>
 
 using namespace Ravelin;
 using namespace Moby;
@@ -62,7 +67,7 @@ TriangleMeshPrimitive::TriangleMeshPrimitive(const string& filename, bool center
 
   // construct a new triangle mesh from the filename
   if (filename.find(".obj") == filename.size() - 4)
-    set_mesh(shared_ptr<IndexedTriArray>(new IndexedTriArray(IndexedTriArray::read_from_obj(filename))));
+    set_mesh(ModelCache::get_mesh(filename));
   else
     throw std::runtime_error("TriangleMeshPrimitive (constructor): unknown mesh file type!");
 
@@ -85,7 +90,7 @@ TriangleMeshPrimitive::TriangleMeshPrimitive(const string& filename, const Pose3
 
   // construct a new triangle mesh from the filename
   if (filename.find("obj") == filename.size() - 4)
-    set_mesh(shared_ptr<IndexedTriArray>(new IndexedTriArray(IndexedTriArray::read_from_obj(filename))));
+    set_mesh(ModelCache::get_mesh(filename));
   else
     throw std::runtime_error("TriangleMeshPrimitive (constructor): unknown mesh file type!");
 
@@ -176,6 +181,9 @@ void TriangleMeshPrimitive::center()
   // do the transformation
   _mesh = shared_ptr<IndexedTriArray>(new IndexedTriArray(_mesh->transform(T)));
 
+  // the distance field is no longer valid
+  _adf.reset();
+
   // re-calculate mass properties 
   calc_mass_properties();
 
@@ -230,7 +238,7 @@ void TriangleMeshPrimitive::load_from_xml(shared_ptr<const XMLTree> node, map<st
 
   // get the type of file and construct the triangle mesh appropriately
   if (fname_lower.find(string(OBJ_EXT)) == fname_lower.size() - strlen(OBJ_EXT))
-    set_mesh(shared_ptr<IndexedTriArray>(new IndexedTriArray(IndexedTriArray::read_from_obj(fname))));
+    set_mesh(ModelCache::get_mesh(fname));
   else
   {
     cerr << "TriangleMeshPrimitive::load_from_xml() - unrecognized filename extension" << endl;
@@ -242,6 +250,19 @@ void TriangleMeshPrimitive::load_from_xml(shared_ptr<const XMLTree> node, map<st
   if (center_attr && center_attr->get_bool_value())
     this->center();
 
+  // load or build the distance field, if desired
+  const double DEFAULT_ADF_TOL = 1e-3;
+  XMLAttrib* adf_fname_attr = node->get_attrib("distance-field-filename");
+  XMLAttrib* adf_depth_attr = node->get_attrib("distance-field-max-recursion");
+  XMLAttrib* adf_tol_attr = node->get_attrib("distance-field-tolerance");
+  if (adf_fname_attr)
+    _adf = ADF::load_from_file(adf_fname_attr->get_string_value());
+  else if (adf_depth_attr && _mesh)
+  {
+    double tol = (adf_tol_attr) ? adf_tol_attr->get_real_value() : DEFAULT_ADF_TOL;
+    build_distance_field(adf_depth_attr->get_unsigned_value(), tol);
+  }
+
   // recompute mass properties
   calc_mass_properties();
 
@@ -299,19 +320,20 @@ void TriangleMeshPrimitive::save_to_xml(XMLTreePtr node, list<shared_ptr<const B
 /// Sets the mesh
 void TriangleMeshPrimitive::set_mesh(boost::shared_ptr<const IndexedTriArray> mesh)
 {
-  // TODO: remove this calculation (replaces mesh with convex hull)
-  const vector<Origin3d>& verts = mesh->get_vertices();
-  TessellatedPolyhedronPtr poly = CompGeom::calc_convex_hull(verts.begin(), verts.end());
-  _mesh = shared_ptr<const IndexedTriArray>(new IndexedTriArray(poly->get_mesh()));
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
+  // TODO: remove this calculation (replaces mesh with convex hull); the hull
+  // is shared with every primitive that uses the same mesh
+  _mesh = ModelCache::get_convex_hull_mesh(mesh);
 
   // TODO: restore this
   // set the mesh
 //  _mesh = mesh;
 
-  // vertices and bounding volumes are no longer valid
+  // vertices, bounding volumes, and the distance field are no longer valid
   _vertices.clear();
   _mesh_vertices.clear();
-  _roots.clear();;
+  _roots.clear();
+  _adf.reset();
 
   // update visualization
   update_visualization();
@@ -336,16 +358,7 @@ void TriangleMeshPrimitive::calc_mass_properties()
   }
 
   // determine which mesh to use
-  TessellatedPolyhedronPtr poly;
-  const IndexedTriArray* mesh = NULL;
-  if (_convexify_inertia)
-  {
-    const vector<Origin3d>& verts = _mesh->get_vertices();
-    poly = CompGeom::calc_convex_hull(verts.begin(), verts.end());
-    mesh = &poly->get_mesh();
-  }
-  else
-    mesh = _mesh.get();
+  shared_ptr<const IndexedTriArray> mesh = (_convexify_inertia) ? ModelCache::get_convex_hull_mesh(_mesh) : _mesh;
 
   // get triangles
   std::list<Triangle> tris;
@@ -399,6 +412,7 @@ void TriangleMeshPrimitive::calc_mass_properties()
 /// Gets the pointer to the root bounding box
 BVPtr TriangleMeshPrimitive::get_BVH_root(CollisionGeometryPtr geom)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eGeometry);
   // build the bounding box if necessary
   BVPtr& root = _roots[geom]; 
   if (!root)
@@ -407,6 +421,84 @@ BVPtr TriangleMeshPrimitive::get_BVH_root(CollisionGeometryPtr geom)
   return root; 
 }
 
+/// Finds the first intersection of a line segment with the mesh, using the mesh's bounding volume hierarchy
+/**
+ * Only triangles in leaves of the hierarchy that the segment passes through
+ * are tested. The hierarchy for the geometry must already have been built
+ * (using get_BVH_root()).
+ * \param geom the geometry whose hierarchy is used
+ * \param seg the line segment (defined in the frame of the mesh)
+ * \param t on return, the parameter of the intersection (0 at the first
+ *        point of the segment, 1 at the second)
+ * \param isect on return, the point of intersection
+ * \param normal on return, the normal of the triangle intersected
+ * \return <b>true</b> if the segment intersects the mesh
+ */
+bool TriangleMeshPrimitive::intersect_seg(CollisionGeometryPtr geom, const LineSeg3& seg, double& t, Point3d& isect, Vector3d& normal) const
+{
+  // get the root of the hierarchy
+  map<CollisionGeometryPtr, BVPtr>::const_iterator root_iter = _roots.find(geom);
+  if (root_iter == _roots.end() || !root_iter->second)
+    throw std::runtime_error("TriangleMeshPrimitive::intersect_seg() - bounding volume hierarchy has not been built");
+  BVPtr root = root_iter->second;
+
+  // get the segment direction
+  const Vector3d d = seg.second - seg.first;
+  const double dd = d.norm_sq();
+
+  // the bounding volumes are not defined relative to the mesh frame, though
+  // their coordinates are
+  shared_ptr<const Pose3d> Pbv = root->get_relative_pose();
+  LineSeg3 bseg(Point3d(Origin3d(seg.first), Pbv), Point3d(Origin3d(seg.second), Pbv));
+
+  // traverse the hierarchy 
+  t = std::numeric_limits<double>::max();
+  stack<BVPtr> S;
+  S.push(root);
+  while (!S.empty())
+  {
+    BVPtr bv = S.top();
+    S.pop();
+
+    // skip bounding volumes that the segment misses or enters after the
+    // closest intersection found so far
+    double tmin = 0.0;
+    Point3d q;
+    if (!bv->intersects(bseg, tmin, std::min(t, 1.0), q))
+      continue;
+
+    if (!bv->is_leaf())
+    {
+      BOOST_FOREACH(BVPtr child, bv->children)
+        S.push(child);
+      continue;
+    }
+
+    // test the triangles in the leaf
+    map<BVPtr, list<unsigned> >::const_iterator tris_iter = _mesh_tris.find(bv);
+    if (tris_iter == _mesh_tris.end())
+      continue;
+    BOOST_FOREACH(unsigned idx, tris_iter->second)
+    {
+      Triangle tri = _mesh->get_triangle(idx, seg.first.pose);
+      Point3d p, p2;
+      if (CompGeom::intersect_seg_tri(seg, tri, p, p2) == CompGeom::eSegTriNoIntersect)
+        continue;
+
+      // compute the parameter of the intersection
+      const double tp = (dd > NEAR_ZERO) ? (p - seg.first).dot(d)/dd : 0.0;
+      if (tp < t)
+      {
+        t = tp;
+        isect = p;
+        normal = tri.calc_normal();
+      }
+    }
+  }
+
+  return t <= 1.0;
+}
+
 /// Returns whether the mesh is convex (currently mesh must be convex)
 bool TriangleMeshPrimitive::is_convex() const
 {
@@ -414,41 +506,114 @@ bool TriangleMeshPrimitive::is_convex() const
 }
 
 /// Computes the signed distance to a point from the mesh 
+/**
+ * If a distance field has been built over the mesh and the point lies within
+ * it, the distance is interpolated from the field; otherwise, every triangle
+ * of the mesh is examined.
+ */
 double TriangleMeshPrimitive::calc_signed_dist(const Point3d& p) const
 {
   // verify that the point is defined with respect to one of the poses
   assert(_poses.find(const_pointer_cast<Pose3d>(p.pose)) != _poses.end());
 
-  // if the primitive is convex and the point is outside, return the closest
-  // distance
-  if (is_convex())
+  // use the distance field, if possible
+  if (_adf && _adf->contains(p))
+    return _adf->calc_signed_distance(p);
+
+  // otherwise, examine every triangle
+  return calc_mesh_signed_dist(*_mesh, p);
+}
+
+/// Computes the signed distance to a point from a mesh by examining every triangle
+double TriangleMeshPrimitive::calc_mesh_signed_dist(const IndexedTriArray& mesh, const Point3d& p)
+{
+  Vector3d normal;
+  return calc_mesh_signed_dist(mesh, p, normal);
+}
+
+/// Computes the signed distance to a point from a mesh by examining every triangle
+/**
+ * The magnitude of the distance is the distance to the closest triangle. The
+ * point is inside the mesh if the generalized winding number of the mesh
+ * about the point exceeds one half, so the sign is correct for non-convex
+ * meshes as well (and degrades gracefully for meshes with small holes).
+ * \param normal on return, the normal of the closest triangle
+ */
+double TriangleMeshPrimitive::calc_mesh_signed_dist(const IndexedTriArray& mesh, const Point3d& p, Vector3d& normal)
+{
+  // loop through all triangles of the mesh, accumulating the solid angle
+  // that the mesh subtends at the point
+  double min_dist_sq = std::numeric_limits<double>::max();
+  double solid_angle = 0.0;
+  for (unsigned i=0; i< mesh.num_tris(); i++)
   {
-    // loop through all triangles of the mesh
-    bool inside = false;
-    double min_dist = std::numeric_limits<double>::max();
-    double max_dist = -min_dist;
-    for (unsigned i=0; i< _mesh->num_tris(); i++)
+    Triangle tri = mesh.get_triangle(i, p.pose);
+    Point3d closest;
+    double dist_sq = Triangle::calc_sq_dist(tri, p, closest);
+    if (dist_sq < min_dist_sq)
     {
-      double dist = _mesh->get_triangle(i, p.pose).calc_signed_dist(p);
-      if (dist < 0.0)
-      {
-        max_dist = std::max(max_dist, dist);
-        inside = true;
-      }
-      else
-        min_dist = std::min(min_dist, dist);
+      min_dist_sq = dist_sq;
+      normal = tri.calc_normal();
     }
-
-    // if the point is outside, return the minimum distance
-    if (!inside)
-      return min_dist;
-    else
-      return max_dist;
-  } 
-  else
-  {
-    throw std::runtime_error("TriangleMeshPrimitive::calc_signed_dist() - non-convex meshes not currently supported!");
+    solid_angle += calc_solid_angle(tri, p);
   }
+
+  // the winding number is the solid angle divided by 4*pi 
+  const double dist = std::sqrt(min_dist_sq);
+  return (std::fabs(solid_angle) > 2.0*M_PI) ? -dist : dist;
+}
+
+/// Computes the signed solid angle that a triangle subtends at a point
+/**
+ * Uses the formula of Van Oosterom and Strackee; the angle is positive if
+ * the point lies behind the triangle (with respect to its normal).
+ */
+double TriangleMeshPrimitive::calc_solid_angle(const Triangle& tri, const Point3d& p)
+{
+  const Vector3d A = tri.a - p, B = tri.b - p, C = tri.c - p;
+  const double LA = A.norm(), LB = B.norm(), LC = C.norm();
+  const double NUM = A.dot(Vector3d::cross(B, C));
+  const double DEN = LA*LB*LC + A.dot(B)*LC + B.dot(C)*LA + C.dot(A)*LB;
+  return 2.0*std::atan2(NUM, DEN);
+}
+
+/// Distance function used to build the distance field over the mesh
+double TriangleMeshPrimitive::mesh_distance_function(const Vector3d& p, void* data)
+{
+  const IndexedTriArray& mesh = *(const IndexedTriArray*) data;
+  return calc_mesh_signed_dist(mesh, p);
+}
+
+/// Builds a distance field over the mesh, which is then used to answer point distance queries
+/**
+ * Point distance queries (and the vertex-sampled contact queries that are
+ * built on them) within the field's bounds then take time logarithmic in the
+ * size of the mesh rather than linear. The field is built in the mesh frame
+ * and is discarded whenever the mesh changes. The distances are sampled
+ * using the winding number of the mesh, so the mesh need not be convex.
+ * \param max_recursion the maximum depth of the distance field octree
+ * \param epsilon the maximum interpolation error in a cell of the octree 
+ *        above which the cell is subdivided
+ */
+void TriangleMeshPrimitive::build_distance_field(unsigned max_recursion, double epsilon)
+{
+  const unsigned THREE_D = 3;
+
+  if (!_mesh || _mesh->get_vertices().empty())
+    throw std::runtime_error("TriangleMeshPrimitive::build_distance_field() - no mesh to build distance field over");
+
+  // get the bounding box of the mesh
+  const vector<Origin3d>& verts = _mesh->get_vertices();
+  Origin3d lo = verts.front(), hi = verts.front();
+  for (unsigned i=1; i< verts.size(); i++)
+    for (unsigned j=0; j< THREE_D; j++)
+    {
+      lo[j] = std::min(lo[j], verts[i][j]);
+      hi[j] = std::max(hi[j], verts[i][j]);
+    }
+
+  // build the distance field
+  _adf = ADF::build_ADF(Vector3d(lo, GLOBAL), Vector3d(hi, GLOBAL), &mesh_distance_function, max_recursion, epsilon, -1.0, std::numeric_limits<double>::max(), (void*) _mesh.get());
 }
 
 /// Computes the distance and normal from a point on the mesh 
@@ -461,51 +626,22 @@ double TriangleMeshPrimitive::calc_dist_and_normal(const Point3d& p, std::vector
   // verify that the point is defined with respect to one of the poses
   assert(_poses.find(const_pointer_cast<Pose3d>(p.pose)) != _poses.end());
 
-  // if the primitive is convex and the point is outside, return the closest
-  // distance
-  if (is_convex())
-  {
-    // loop through all triangles of the mesh
-    bool inside = false;
-    double min_dist = std::numeric_limits<double>::max();
-    double max_dist = -min_dist;
-    for (unsigned i=0; i< _mesh->num_tris(); i++)
-    {
-      double dist = _mesh->get_triangle(i, p.pose).calc_signed_dist(p);
-      if (dist < 0.0)
-      {
-        if (dist > max_dist)
-        {
-          normal = _mesh->get_triangle(i, p.pose).calc_normal();
-          max_dist = dist;
-        }
-        inside = true;
-      }
-      else if (!inside)
-      {
-        if (dist < min_dist)
-        {
-          normal = _mesh->get_triangle(i, p.pose).calc_normal();
-          min_dist = dist;
-        }
-      }
-    }
+  // use the distance field, if possible
+  if (_adf && _adf->contains(p))
+    return _adf->calc_signed_distance(p, normal);
 
-    // if the point is outside, return the minimum distance
-    if (!inside)
-      return min_dist;
-    else
-      return max_dist;
-  } 
-  else
-  {
-    throw std::runtime_error("TriangleMeshPrimitive::calc_signed_dist() - non-convex meshes not currently supported!");
-  }
+  // otherwise, examine every triangle
+  return calc_mesh_signed_dist(*_mesh, p, normal);
 }
 
 /// Computes the distance and normal from a point on the mesh 
 double TriangleMeshPrimitive::calc_signed_dist(shared_ptr<const Primitive> primitive, Point3d& pthis, Point3d& pprimitive) const
 {
+  // try mesh/tetra mesh
+  shared_ptr<const TetraMeshPrimitive> tetp = dynamic_pointer_cast<const TetraMeshPrimitive>(primitive);
+  if (tetp)
+    return tetp->calc_signed_dist(dynamic_pointer_cast<const Primitive>(shared_from_this()), pprimitive, pthis);
+
   if (is_convex() && primitive->is_convex())
   {
     shared_ptr<const Pose3d> Ptri = pthis.pose;
@@ -759,11 +895,12 @@ void TriangleMeshPrimitive::set_pose(const Pose3d& p)
   // go ahead and set the new transform
   Primitive::set_pose(p);
 
-  // reset mesh, vertices, and bounding volumes 
+  // reset mesh, vertices, bounding volumes, and the distance field
   _mesh.reset();
   _vertices.clear();
   _mesh_vertices.clear();
   _roots.clear();
+  _adf.reset();
 
   // recalculate the mass properties
   calc_mass_properties();
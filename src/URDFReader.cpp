@@ -20,8 +20,9 @@
 #include <osgDB/ReadFile>
 #endif
 
-/*
 #include <Moby/TriangleMeshPrimitive.h>
+#include <Moby/ModelCache.h>
+/*
 #include <Moby/CSG.h>
 #include <Moby/ConePrimitive.h>
 */
@@ -42,6 +43,7 @@
 #include <Moby/UniversalJoint.h>
 #include <Moby/XMLTree.h>
 #include <Moby/URDFReader.h>
+#include <Moby/MemoryAccounting.h>
 
 //#define DEBUG_URDF
 
@@ -64,6 +66,7 @@ using boost::dynamic_pointer_cast;
  */
 bool URDFReader::read(const string& fname, std::string& name, vector<RigidBodyPtr>& links, vector<JointPtr>& joints)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eIO);
   // *************************************************************
   // going to remove any path from the argument and change to that
   // path; this is done so that all files referenced from the
@@ -104,7 +107,7 @@ bool URDFReader::read(const string& fname, std::string& name, vector<RigidBodyPt
   }
 
   // read the XML Tree 
-  shared_ptr<const XMLTree> tree = XMLTree::read_from_xml(filename);
+  shared_ptr<const XMLTree> tree = ModelCache::get_tree(filename);
   if (!tree)
   {
     std::cerr << "URDFReader::read() - unable to open file " << fname;
@@ -148,6 +151,18 @@ bool URDFReader::read_robot(shared_ptr<const XMLTree> node, URDFData& data, stri
   if (name_attrib)
   {
     name = name_attrib->get_string_value();
+
+    // load all meshes referenced by the robot up front (in parallel)
+    vector<string> mesh_fnames;
+    list<shared_ptr<const XMLTree> > mesh_nodes = node->find_descendant_nodes("mesh");
+    for (list<shared_ptr<const XMLTree> >::const_iterator i = mesh_nodes.begin(); i != mesh_nodes.end(); i++)
+    {
+      XMLAttrib* filename_attrib = (*i)->get_attrib("filename");
+      if (filename_attrib && is_obj_file(filename_attrib->get_string_value()))
+        mesh_fnames.push_back(filename_attrib->get_string_value());
+    }
+    ModelCache::prefetch_meshes(mesh_fnames);
+
     read_links(node, data, links);
     read_joints(node, data, links, joints);
   }
@@ -827,8 +842,8 @@ PrimitivePtr URDFReader::read_primitive(shared_ptr<const XMLTree> node, URDFData
         return primitive;
       else if ((primitive = read_sphere(*i, data)))
         return primitive;
-//      else if ((primitive = read_trimesh(*i, data)))
-//        return primitive;
+      else if ((primitive = read_trimesh(*i, data)))
+        return primitive;
     }
   }
 
@@ -860,7 +875,15 @@ shared_ptr<BoxPrimitive> URDFReader::read_box(shared_ptr<const XMLTree> node, UR
   return shared_ptr<BoxPrimitive>();
 }
 
-/*
+/// Determines whether a filename refers to a Wavefront OBJ file
+bool URDFReader::is_obj_file(const string& fname)
+{
+  const char* OBJ_EXT = ".obj";
+  if (fname.size() < strlen(OBJ_EXT))
+    return false;
+  return strcasecmp(fname.c_str() + fname.size() - strlen(OBJ_EXT), OBJ_EXT) == 0;
+}
+
 /// Reads a trimesh primitive
 shared_ptr<TriangleMeshPrimitive> URDFReader::read_trimesh(shared_ptr<const XMLTree> node, URDFData& data)
 {
@@ -875,6 +898,13 @@ shared_ptr<TriangleMeshPrimitive> URDFReader::read_trimesh(shared_ptr<const XMLT
       if (!filename_attrib)
         continue;
 
+      // only Wavefront OBJ meshes are supported
+      if (!is_obj_file(filename_attrib->get_string_value()))
+      {
+        std::cerr << "URDFReader::read_trimesh() warning- mesh '" << filename_attrib->get_string_value() << "' is not a Wavefront OBJ file; ignoring" << std::endl;
+        continue;
+      }
+
       // warn that scale attribute is not used
       if (scale_attrib)
         std::cerr << "URDFReader::read_trimesh() warning- 'scale' attribute is not used" << std::endl;
@@ -886,7 +916,6 @@ shared_ptr<TriangleMeshPrimitive> URDFReader::read_trimesh(shared_ptr<const XMLT
 
   return shared_ptr<TriangleMeshPrimitive>();
 }
-*/
 
 /// Reads a cylinder primitive
 shared_ptr<CylinderPrimitive> URDFReader::read_cylinder(shared_ptr<const XMLTree> node, URDFData& data)
@@ -26,6 +26,7 @@
 #include <Moby/RCArticulatedBody.h>
 #include <Moby/CollisionGeometry.h>
 #include <Moby/Log.h>
+#include <Moby/CouplingConstraint.h>
 #include <Moby/UnilateralConstraint.h>
 
 using namespace Ravelin;
@@ -57,8 +58,10 @@ UnilateralConstraint::UnilateralConstraint()
   limit_epsilon = (double) 0.0;
   limit_upper = false;
   limit_impulse = (double) 0.0;
+  limit_speculative_vel = (double) 0.0;
   contact_normal.set_zero(GLOBAL);
   contact_impulse.set_zero(GLOBAL);
+  contact_force.set_zero(GLOBAL);
   contact_point.set_zero(GLOBAL);
   contact_mu_coulomb = (double) 0.0;
   contact_mu_viscous = (double) 0.0;
@@ -79,12 +82,14 @@ UnilateralConstraint& UnilateralConstraint::operator=(const UnilateralConstraint
   limit_dof = e.limit_dof;
   limit_upper = e.limit_upper;
   limit_impulse = e.limit_impulse;
+  limit_speculative_vel = e.limit_speculative_vel;
   limit_joint = e.limit_joint;
   contact_normal = e.contact_normal;
   contact_geom1 = e.contact_geom1;
   contact_geom2 = e.contact_geom2;
   contact_point = e.contact_point;
   contact_impulse = e.contact_impulse;
+  contact_force = e.contact_force;
   contact_mu_coulomb = e.contact_mu_coulomb;
   contact_mu_viscous = e.contact_mu_viscous;
   contact_penalty_Kp = e.contact_penalty_Kp;
@@ -98,7 +103,14 @@ UnilateralConstraint& UnilateralConstraint::operator=(const UnilateralConstraint
 }
 
 /// Computes the constraint data
-void UnilateralConstraint::compute_constraint_data(MatrixNd& M, VectorNd& q) const
+/**
+ * \param M the constraint space inverse inertia matrix (on return)
+ * \param q the constraint velocity (on return)
+ * \param a if non-NULL, the constraint acceleration induced by the bodies'
+ *        current generalized accelerations (on return); velocity product
+ *        terms are neglected, so this is only accurate for resting constraints
+ */
+void UnilateralConstraint::compute_constraint_data(MatrixNd& M, VectorNd& q, VectorNd* a) const
 {
   if (constraint_type == eContact)
   {
@@ -168,6 +180,15 @@ void UnilateralConstraint::compute_constraint_data(MatrixNd& M, VectorNd& q) con
     // free v1 and allocate v2 and workv
     su2->get_generalized_velocity(DynamicBodyd::eSpatial, v);
     q += J2.mult(v, workv);
+
+    // compute the constraint acceleration, if desired
+    if (a)
+    {
+      su1->get_generalized_acceleration(v);
+      J1.mult(v, *a);
+      su2->get_generalized_acceleration(v);
+      *a += J2.mult(v, workv);
+    }
   }
   else if (constraint_type == eLimit)
   {
@@ -214,6 +235,19 @@ void UnilateralConstraint::compute_constraint_data(MatrixNd& M, VectorNd& q) con
     // if we're at an upper limit, negate q
     if (limit_upper)
       q.negate(); 
+
+    // allow approach to a limit that has not yet been reached
+    q[0] += limit_speculative_vel;
+
+    // compute the constraint acceleration, if desired
+    if (a && su)
+    {
+      su->get_generalized_acceleration(v);
+      a->resize(1);
+      (*a)[0] = v[limit_joint->get_coord_index() + limit_dof];
+      if (limit_upper)
+        a->negate();
+    }
   }
 } 
 
@@ -737,7 +771,7 @@ double UnilateralConstraint::calc_constraint_vel() const
   else if (constraint_type == eLimit)
   {
     double qd = limit_joint->qd[limit_dof];
-    return (limit_upper) ? -qd : qd;
+    return ((limit_upper) ? -qd : qd) + limit_speculative_vel;
   }
   else
   {
@@ -937,7 +971,7 @@ osg::Node* UnilateralConstraint::to_visualization_data() const
  * \param constraints the list of constraints
  * \param groups the islands of connected constraints on return
  */
-void UnilateralConstraint::determine_connected_constraints(const vector<UnilateralConstraint>& constraints, const vector<JointPtr>& implicit_joints, list<pair<list<UnilateralConstraint*>, list<shared_ptr<SingleBodyd> > > >& groups, list<vector<shared_ptr<DynamicBodyd> > >& remaining_islands)
+void UnilateralConstraint::determine_connected_constraints(const vector<UnilateralConstraint>& constraints, const vector<JointPtr>& implicit_joints, const vector<CouplingConstraintPtr>& couplings, list<pair<list<UnilateralConstraint*>, list<shared_ptr<SingleBodyd> > > >& groups, list<vector<shared_ptr<DynamicBodyd> > >& remaining_islands)
 {
   FILE_LOG(LOG_CONSTRAINT) << "UnilateralConstraint::determine_connected_contacts() entered" << std::endl;
 
@@ -1006,6 +1040,29 @@ void UnilateralConstraint::determine_connected_constraints(const vector<Unilater
     }
   } 
 
+  // get all links moved by engaged coupling constraints; these are connected
+  // to each other
+  for (unsigned i=0; i< couplings.size(); i++)
+  {
+    if (!couplings[i]->is_engaged())
+      continue;
+    shared_ptr<SingleBodyd> first;
+    for (unsigned j=0; j< couplings[i]->num_terms(); j++)
+    {
+      shared_ptr<RigidBodyd> outboard = couplings[i]->get_joint(j)->get_outboard_link();
+      if (!outboard->is_enabled())
+        continue;
+      nodes.insert(outboard);
+      if (!first)
+        first = outboard;
+      else if (first != outboard)
+      {
+        edges.insert(std::make_pair(first, outboard));
+        edges.insert(std::make_pair(outboard, first));
+      }
+    }
+  }
+
   FILE_LOG(LOG_CONSTRAINT) << " -- single bodies in constraints:" << std::endl;
   if (LOGGING(LOG_CONSTRAINT))
     for (set<shared_ptr<SingleBodyd> >::const_iterator i = nodes.begin(); i != nodes.end(); i++)
@@ -18,6 +18,7 @@
 #endif
 
 #include <Moby/HeightmapPrimitive.h>
+#include <Moby/TetraMeshPrimitive.h>
 #include <Moby/PlanePrimitive.h>
 #include <Moby/CylinderPrimitive.h>
 #include <Moby/ConePrimitive.h>
@@ -25,6 +26,7 @@
 #include <Moby/Constants.h>
 #include <Moby/Simulator.h>
 #include <Moby/TimeSteppingSimulator.h>
+#include <Moby/EventDrivenSimulator.h>
 #include <Moby/RigidBody.h>
 #include <Moby/CollisionGeometry.h>
 #include <Moby/BoxPrimitive.h>
@@ -42,10 +44,16 @@
 #include <Moby/GravityForce.h>
 #include <Moby/StokesDragForce.h>
 #include <Moby/Dissipation.h>
+#include <Moby/C2ACCD.h>
 #include <Moby/DampingForce.h>
+#include <Moby/LidarSensor.h>
+#include <Moby/DepthCameraSensor.h>
+#include <Moby/ContactSensor.h>
+#include <Moby/ForceTorqueSensor.h>
 #include <Moby/XMLTree.h>
 #include <Moby/SDFReader.h>
 #include <Moby/XMLReader.h>
+#include <Moby/MemoryAccounting.h>
 
 using std::vector;
 using boost::shared_ptr;
@@ -59,6 +67,7 @@ using namespace Moby;
  */
 std::map<std::string, BasePtr> XMLReader::read(const std::string& fname)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eIO);
   // setup the list of IDs
   std::map<std::string, BasePtr> id_map;
   
@@ -156,8 +165,8 @@ std::map<std::string, BasePtr> XMLReader::construct_ID_map(shared_ptr<XMLTree> m
   process_tag("Heightmap", moby_tree, &read_heightmap, id_map);
   process_tag("Plane", moby_tree, &read_plane, id_map);
   process_tag("Polyhedron", moby_tree, &read_polyhedron, id_map);
-/*
   process_tag("TetraMesh", moby_tree, &read_tetramesh, id_map);
+/*
   process_tag("PrimitivePlugin", moby_tree, &read_primitive_plugin, id_map);
   process_tag("CSG", moby_tree, &read_CSG, id_map);
 */
@@ -192,8 +201,15 @@ std::map<std::string, BasePtr> XMLReader::construct_ID_map(shared_ptr<XMLTree> m
   process_tag("RCArticulatedBody", moby_tree, &read_rc_abody, id_map);
   process_tag("RCArticulatedBodySymbolicPlugin", moby_tree, &read_rc_abody_symbolic, id_map);
 
+  // read and construct all sensors -- we do this after the bodies have been read
+  process_tag("Lidar", moby_tree, &read_lidar, id_map);
+  process_tag("DepthCamera", moby_tree, &read_depth_camera, id_map);
+  process_tag("ContactSensor", moby_tree, &read_contact_sensor, id_map);
+  process_tag("ForceTorqueSensor", moby_tree, &read_force_torque_sensor, id_map);
+
   // read and construct plugin collision detectors, if any
   process_tag("CollisionDetectionPlugin", moby_tree, &read_coldet_plugin, id_map);  
+  process_tag("C2ACCD", moby_tree, &read_c2accd, id_map);
 
   // damping forces and dissipation must be constructed after bodies
   process_tag("DampingForce", moby_tree, &read_damping_force, id_map);
@@ -202,6 +218,7 @@ std::map<std::string, BasePtr> XMLReader::construct_ID_map(shared_ptr<XMLTree> m
   // finally, read and construct the simulator objects -- must be done last
   process_tag("Simulator", moby_tree, &read_simulator, id_map);
   process_tag("TimeSteppingSimulator", moby_tree, &read_time_stepping_simulator, id_map);
+  process_tag("EventDrivenSimulator", moby_tree, &read_event_driven_simulator, id_map);
 
   // output unprocessed tags / attributes
   std::queue<shared_ptr<const XMLTree> > q;
@@ -265,6 +282,19 @@ void XMLReader::read_dissipation(shared_ptr<const XMLTree> node, std::map<std::s
   b->load_from_xml(node, id_map);
 }
 
+/// Reads and constructs the C2ACCD object
+void XMLReader::read_c2accd(shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map)
+{
+  // sanity check
+  assert(strcasecmp(node->name.c_str(), "C2ACCD") == 0);
+
+  // create a new C2ACCD object
+  boost::shared_ptr<Base> b(new C2ACCD());
+  
+  // populate the object
+  b->load_from_xml(node, id_map);
+}
+
 /// Reads and constructs a geometry plugin object
 void XMLReader::read_primitive_plugin(shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map)
 {
@@ -454,17 +484,17 @@ void XMLReader::read_CSG(shared_ptr<const XMLTree> node, std::map<std::string, B
 //  b->load_from_xml(node, id_map);
 }
 
-/// Reads and constructs the TriangleMeshPrimitive object
+/// Reads and constructs the TetraMeshPrimitive object
 void XMLReader::read_tetramesh(shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map)
 {  
   // sanity check
   assert(strcasecmp(node->name.c_str(), "TetraMesh") == 0);
 
-  // create a new IndexedTetraArray object
-//  boost::shared_ptr<Base> b(new IndexedTetraArray());
+  // create a new TetraMeshPrimitive object
+  boost::shared_ptr<Base> b(new TetraMeshPrimitive());
   
   // populate the object
-//  b->load_from_xml(node, id_map);
+  b->load_from_xml(node, id_map);
 }
 
 /// Reads and constructs the PolyhedralPrimitive object
@@ -548,6 +578,22 @@ void XMLReader::read_time_stepping_simulator(shared_ptr<const XMLTree> node, std
   b->load_from_xml(node, id_map);
 }
 
+/// Reads and constructs the EventDrivenSimulator object
+/**
+ * \pre node is named EventDrivenSimulator
+ */
+void XMLReader::read_event_driven_simulator(shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map)
+{
+  // sanity check
+  assert(strcasecmp(node->name.c_str(), "EventDrivenSimulator") == 0);
+
+  // create a new EventDrivenSimulator object
+  boost::shared_ptr<Base> b(new EventDrivenSimulator());
+  
+  // populate the object
+  b->load_from_xml(node, id_map);
+}
+
 /// Reads and constructs the Simulator object
 /**
  * \pre node is named Simulator
@@ -907,6 +953,70 @@ void XMLReader::read_stokes_drag_force(shared_ptr<const XMLTree> node, std::map<
   sdf->load_from_xml(node, id_map);
 }
 
+/// Reads and constructs the LidarSensor object
+/**
+ * \pre node is named Lidar
+ */
+void XMLReader::read_lidar(shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map)
+{
+  // sanity check
+  assert(strcasecmp(node->name.c_str(), "Lidar") == 0);
+
+  // create a new LidarSensor object
+  boost::shared_ptr<LidarSensor> lidar(new LidarSensor());
+
+  // populate the object
+  lidar->load_from_xml(node, id_map);
+}
+
+/// Reads and constructs the DepthCameraSensor object
+/**
+ * \pre node is named DepthCamera
+ */
+void XMLReader::read_depth_camera(shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map)
+{
+  // sanity check
+  assert(strcasecmp(node->name.c_str(), "DepthCamera") == 0);
+
+  // create a new DepthCameraSensor object
+  boost::shared_ptr<DepthCameraSensor> camera(new DepthCameraSensor());
+
+  // populate the object
+  camera->load_from_xml(node, id_map);
+}
+
+/// Reads and constructs the ContactSensor object
+/**
+ * \pre node is named ContactSensor
+ */
+void XMLReader::read_contact_sensor(shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map)
+{
+  // sanity check
+  assert(strcasecmp(node->name.c_str(), "ContactSensor") == 0);
+
+  // create a new ContactSensor object
+  boost::shared_ptr<ContactSensor> sensor(new ContactSensor());
+
+  // populate the object
+  sensor->load_from_xml(node, id_map);
+}
+
+/// Reads and constructs the ForceTorqueSensor object
+/**
+ * \pre node is named ForceTorqueSensor
+ */
+void XMLReader::read_force_torque_sensor(shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map)
+{
+  // sanity check
+  assert(strcasecmp(node->name.c_str(), "ForceTorqueSensor") == 0);
+
+  // create a new ForceTorqueSensor object
+  boost::shared_ptr<ForceTorqueSensor> sensor(new ForceTorqueSensor());
+
+  // populate the object
+  sensor->load_from_xml(node, id_map);
+}
+
 /// Reads and constructs the DampingForce object
 /**
  * \pre node is named DampingForce
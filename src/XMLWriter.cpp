@@ -10,6 +10,7 @@
 #include <Moby/Base.h>
 #include <Moby/XMLTree.h>
 #include <Moby/XMLWriter.h>
+#include <Moby/MemoryAccounting.h>
 
 using boost::shared_ptr;
 using namespace Moby;
@@ -17,6 +18,7 @@ using namespace Moby;
 /// Serializes the given objects (and all dependencies) to XML
 void XMLWriter::serialize_to_xml(const std::string& fname, const std::list<shared_ptr<const Base> >& objects)
 {
+  MemoryAccounting::Scope mem_scope(MemoryAccounting::eIO);
   // get the filename
   std::string filename = fname;
 
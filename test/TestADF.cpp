@@ -0,0 +1,82 @@
+#include <cmath>
+#include <cstdio>
+#include <boost/shared_ptr.hpp>
+#include <Moby/ADF.h>
+#include "gtest/gtest.h"
+
+using namespace Ravelin;
+using namespace Moby;
+
+static double get_random(double r_min, double r_max)
+{
+  return (r_max-r_min) * ((double) rand() / (double) RAND_MAX) + r_min;
+}
+
+// signed distance to the unit sphere
+static double sphere_distance(const Vector3d& p, void* data)
+{
+  return p.norm() - 1.0;
+}
+
+// signed distance to a halfspace (exactly representable by the ADF)
+static double plane_distance(const Vector3d& p, void* data)
+{
+  return p[0] + 2.0*p[1] - 0.5*p[2];
+}
+
+TEST(ADF, Plane)
+{
+  boost::shared_ptr<ADF> adf = ADF::build_ADF(Vector3d(-1,-1,-1), Vector3d(1,1,1), &plane_distance, 6, 1e-6);
+
+  // a linear distance field should not require any subdivision
+  EXPECT_EQ(adf->count_cells(), (unsigned) 1);
+
+  for (unsigned i=0; i< 100; i++)
+  {
+    Vector3d p(get_random(-1,1), get_random(-1,1), get_random(-1,1));
+    EXPECT_NEAR(adf->calc_signed_distance(p), plane_distance(p, NULL), 1e-10);
+  }
+}
+
+TEST(ADF, Sphere)
+{
+  const double EPS = 1e-3, TOL = 1e-2;
+  boost::shared_ptr<ADF> adf = ADF::build_ADF(Vector3d(-1,-1,-1), Vector3d(1,1,1), &sphere_distance, 7, EPS);
+  EXPECT_GT(adf->count_cells(), (unsigned) 1);
+  EXPECT_EQ(adf->get_recursion_level(), (unsigned) 7);
+
+  for (unsigned i=0; i< 1000; i++)
+  {
+    Vector3d p(get_random(-1,1), get_random(-1,1), get_random(-1,1));
+    ASSERT_TRUE(adf->contains(p));
+
+    // check the distance
+    Vector3d normal;
+    double dist = adf->calc_signed_distance(p, normal);
+    EXPECT_NEAR(dist, sphere_distance(p, NULL), TOL);
+
+    // check the normal away from the center of the sphere
+    if (p.norm() > 0.5)
+      EXPECT_GT(normal.dot(p)/p.norm(), 1.0 - TOL);
+  }
+
+  // points outside of the bounds are not contained
+  EXPECT_FALSE(adf->contains(Vector3d(2,0,0)));
+}
+
+TEST(ADF, SaveLoad)
+{
+  boost::shared_ptr<ADF> adf = ADF::build_ADF(Vector3d(-1,-1,-1), Vector3d(1,1,1), &sphere_distance, 5, 1e-3);
+  const char* FNAME = "adf-test.adf";
+  adf->save_to_file(FNAME);
+  boost::shared_ptr<ADF> adf2 = ADF::load_from_file(FNAME);
+  std::remove(FNAME);
+
+  EXPECT_EQ(adf->count_cells(), adf2->count_cells());
+  for (unsigned i=0; i< 100; i++)
+  {
+    Vector3d p(get_random(-1,1), get_random(-1,1), get_random(-1,1));
+    EXPECT_NEAR(adf->calc_signed_distance(p), adf2->calc_signed_distance(p), 1e-12);
+  }
+}
+
@@ -0,0 +1,54 @@
+#include <vector>
+#include <Moby/CAPI.h>
+#include "gtest/gtest.h"
+
+using std::vector;
+
+// resetting without a simulation fails (and reports why)
+TEST(CAPI, ResetUnloaded)
+{
+  MobySimulation* sim = moby_create();
+  EXPECT_EQ(moby_reset(sim), -1);
+  EXPECT_STRNE(moby_get_last_error(sim), "");
+  moby_destroy(sim);
+}
+
+// stepping after a reset reproduces stepping after the load
+TEST(CAPI, ResetRoundTrip)
+{
+  const double DT = 1e-2;
+  const unsigned N_STEPS = 100;
+
+  MobySimulation* sim = moby_create();
+  ASSERT_EQ(moby_load(sim, "box.xml"), 0);
+  const MobyState* state = moby_get_state(sim);
+  ASSERT_GT(state->n_bodies, (unsigned) 0);
+  const unsigned N_POSES = state->n_bodies*MOBY_POSE_STRIDE;
+  const unsigned N_VELS = state->n_bodies*MOBY_VELOCITY_STRIDE;
+
+  // record the initial state, then step (the box falls and lands)
+  vector<double> poses0(state->poses, state->poses + N_POSES);
+  ASSERT_EQ(moby_step(sim, DT, N_STEPS), 0);
+  vector<double> poses1(state->poses, state->poses + N_POSES);
+  vector<double> vels1(state->velocities, state->velocities + N_VELS);
+  const unsigned N_CONTACTS = state->n_contacts;
+  const double T1 = state->time;
+
+  // reset and verify that the initial state is restored
+  ASSERT_EQ(moby_reset(sim), 0);
+  EXPECT_EQ(state->time, 0.0);
+  EXPECT_EQ(state->step, (unsigned long) 0);
+  for (unsigned i=0; i< N_POSES; i++)
+    EXPECT_NEAR(state->poses[i], poses0[i], 1e-12);
+
+  // step again and verify that the same state is reached
+  ASSERT_EQ(moby_step(sim, DT, N_STEPS), 0);
+  EXPECT_NEAR(state->time, T1, 1e-12);
+  EXPECT_EQ(state->n_contacts, N_CONTACTS);
+  for (unsigned i=0; i< N_POSES; i++)
+    EXPECT_NEAR(state->poses[i], poses1[i], 1e-8);
+  for (unsigned i=0; i< N_VELS; i++)
+    EXPECT_NEAR(state->velocities[i], vels1[i], 1e-8);
+
+  moby_destroy(sim);
+}
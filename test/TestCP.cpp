@@ -0,0 +1,110 @@
+#include <cmath>
+#include <boost/shared_ptr.hpp>
+#include <Moby/BoxPrimitive.h>
+#include <Moby/CP.h>
+#include "gtest/gtest.h"
+
+using namespace Ravelin;
+using namespace Moby;
+
+static double get_random(double r_min, double r_max)
+{
+  return (r_max-r_min) * ((double) rand() / (double) RAND_MAX) + r_min;
+}
+
+TEST(CP, Separated)
+{
+  const double TOL = 1e-6;
+  boost::shared_ptr<BoxPrimitive> p(new BoxPrimitive(2,2,2));
+  boost::shared_ptr<BoxPrimitive> q(new BoxPrimitive(2,2,2));
+
+  // boxes separated along x by one unit
+  boost::shared_ptr<Pose3d> p_pose(new Pose3d(Origin3d(0, 0, 0)));
+  boost::shared_ptr<Pose3d> q_pose(new Pose3d(Origin3d(3, 0.5, 0.25)));
+  Point3d cpP(p_pose), cpQ(q_pose);
+  double dist = CP::find_cpoint(p, q, p_pose, q_pose, cpP, cpQ);
+  EXPECT_NEAR(dist, 1.0, TOL);
+  EXPECT_NEAR(cpP[0], 1.0, TOL);
+  EXPECT_NEAR(cpQ[0], -1.0, TOL);
+
+  // the distance is the distance between the closest points
+  Point3d wP = Pose3d::transform_point(GLOBAL, cpP);
+  Point3d wQ = Pose3d::transform_point(GLOBAL, cpQ);
+  EXPECT_NEAR((wP - wQ).norm(), dist, TOL);
+}
+
+TEST(CP, Rotated)
+{
+  const double TOL = 1e-6;
+  boost::shared_ptr<BoxPrimitive> p(new BoxPrimitive(2,2,2));
+  boost::shared_ptr<BoxPrimitive> q(new BoxPrimitive(2,2,2));
+
+  // rotate q by 45 degrees about z so that an edge points toward p
+  boost::shared_ptr<Pose3d> p_pose(new Pose3d(Origin3d(0, 0, 0)));
+  boost::shared_ptr<Pose3d> q_pose(new Pose3d(Quatd::rpy(0, 0, M_PI_4), Origin3d(4, 0, 0)));
+  Point3d cpP(p_pose), cpQ(q_pose);
+  double dist = CP::find_cpoint(p, q, p_pose, q_pose, cpP, cpQ);
+  EXPECT_NEAR(dist, 3.0 - std::sqrt(2.0), TOL);
+}
+
+TEST(CP, Intersecting)
+{
+  boost::shared_ptr<BoxPrimitive> p(new BoxPrimitive(2,2,2));
+  boost::shared_ptr<BoxPrimitive> q(new BoxPrimitive(2,2,2));
+
+  // boxes overlapping by half a unit along x
+  boost::shared_ptr<Pose3d> p_pose(new Pose3d(Origin3d(0, 0, 0)));
+  boost::shared_ptr<Pose3d> q_pose(new Pose3d(Origin3d(1.5, 0, 0)));
+  Point3d cpP(p_pose), cpQ(q_pose);
+  double dist = CP::find_cpoint(p, q, p_pose, q_pose, cpP, cpQ);
+  EXPECT_NEAR(dist, -0.25, 1e-6);
+
+  // the common point is in both boxes
+  Point3d w = Pose3d::transform_point(GLOBAL, cpP);
+  EXPECT_NEAR(w[0], 0.75, 1e-6);
+}
+
+TEST(CP, Random)
+{
+  const unsigned N = 100;
+  boost::shared_ptr<BoxPrimitive> p(new BoxPrimitive(2,2,2));
+  boost::shared_ptr<BoxPrimitive> q(new BoxPrimitive(1,2,3));
+  boost::shared_ptr<Pose3d> p_pose(new Pose3d(Origin3d(0, 0, 0)));
+
+  for (unsigned i=0; i< N; i++)
+  {
+    // setup a random pose for q
+    Quatd quat(get_random(-1.0, 1.0), get_random(-1.0, 1.0), get_random(-1.0, 1.0), get_random(-1.0, 1.0));
+    quat.normalize();
+    Origin3d x(get_random(2.5, 5.0), get_random(-5.0, 5.0), get_random(-5.0, 5.0));
+    boost::shared_ptr<Pose3d> q_pose(new Pose3d(quat, x));
+
+    // compute the closest points
+    Point3d cpP(p_pose), cpQ(q_pose);
+    double dist = CP::find_cpoint(p, q, p_pose, q_pose, cpP, cpQ);
+    if (dist < 0.0)
+      continue;
+
+    // closest points must lie on the boxes and realize the distance
+    Point3d wP = Pose3d::transform_point(GLOBAL, cpP);
+    Point3d wQ = Pose3d::transform_point(GLOBAL, cpQ);
+    EXPECT_NEAR((wP - wQ).norm(), dist, 1e-6);
+    for (unsigned j=0; j< 3; j++)
+      EXPECT_LE(std::fabs(cpP[j]), 1.0 + 1e-6);
+    EXPECT_LE(std::fabs(cpQ[0]), 0.5 + 1e-6);
+    EXPECT_LE(std::fabs(cpQ[1]), 1.0 + 1e-6);
+    EXPECT_LE(std::fabs(cpQ[2]), 1.5 + 1e-6);
+
+    // no vertex of q is closer to p than the distance
+    for (unsigned j=0; j< 8; j++)
+    {
+      Point3d vq((j & 1) ? 0.5 : -0.5, (j & 2) ? 1.0 : -1.0, (j & 4) ? 1.5 : -1.5, q_pose);
+      Point3d v = Pose3d::transform_point(p_pose, vq);
+      double dx = std::max(std::fabs(v[0]) - 1.0, 0.0);
+      double dy = std::max(std::fabs(v[1]) - 1.0, 0.0);
+      double dz = std::max(std::fabs(v[2]) - 1.0, 0.0);
+      EXPECT_GE(std::sqrt(dx*dx + dy*dy + dz*dz), dist - 1e-6);
+    }
+  }
+}
+
@@ -0,0 +1,107 @@
+#include <cmath>
+#include <Moby/LP.h>
+#include "gtest/gtest.h"
+
+using namespace Ravelin;
+using namespace Moby;
+
+static double get_random(double r_min, double r_max)
+{
+  return (r_max-r_min) * ((double) rand() / (double) RAND_MAX) + r_min;
+}
+
+TEST(LP, Simple)
+{
+  // maximize x + y s.t. x + 2y <= 4, 3x + y <= 6, 0 <= x, y <= 10
+  MatrixNd A(2,2);
+  A(0,0) = 1.0;  A(0,1) = 2.0;
+  A(1,0) = 3.0;  A(1,1) = 1.0;
+  VectorNd b(2), c(2), l(2), u(2), x;
+  b[0] = 4.0;  b[1] = 6.0;
+  c[0] = c[1] = 1.0;
+  l[0] = l[1] = 0.0;
+  u[0] = u[1] = 10.0;
+  ASSERT_TRUE(LP::lp_seidel(A, b, c, l, u, x));
+  EXPECT_NEAR(x[0], 1.6, 1e-8);
+  EXPECT_NEAR(x[1], 1.2, 1e-8);
+}
+
+TEST(LP, Infeasible)
+{
+  // x <= -1 and x >= 1
+  MatrixNd A(2,1);
+  A(0,0) = 1.0;
+  A(1,0) = -1.0;
+  VectorNd b(2), c(1), l(1), u(1), x;
+  b[0] = b[1] = -1.0;
+  c[0] = 1.0;
+  l[0] = -10.0;
+  u[0] = 10.0;
+  EXPECT_FALSE(LP::lp_seidel(A, b, c, l, u, x));
+}
+
+TEST(LP, Deterministic)
+{
+  const unsigned N = 50, D = 3;
+
+  // setup a random, feasible LP
+  MatrixNd A(N,D);
+  VectorNd b(N), c(D), l(D), u(D), x1, x2;
+  for (unsigned i=0; i< N; i++)
+  {
+    for (unsigned j=0; j< D; j++)
+      A(i,j) = get_random(-1.0, 1.0);
+    b[i] = get_random(0.5, 1.0);
+  }
+  for (unsigned j=0; j< D; j++)
+  {
+    c[j] = get_random(-1.0, 1.0);
+    l[j] = -5.0;
+    u[j] = 5.0;
+  }
+
+  // solving twice yields identical results
+  ASSERT_TRUE(LP::lp_seidel(A, b, c, l, u, x1));
+  ASSERT_TRUE(LP::lp_seidel(A, b, c, l, u, x2));
+  for (unsigned j=0; j< D; j++)
+    EXPECT_EQ(x1[j], x2[j]);
+
+  // the solution is feasible
+  for (unsigned i=0; i< N; i++)
+    EXPECT_LE(VectorNd::dot(A.row(i), x1), b[i] + 1e-8);
+
+  // no sampled feasible point is better
+  double opt = c.dot(x1);
+  VectorNd y(D);
+  for (unsigned k=0; k< 10000; k++)
+  {
+    for (unsigned j=0; j< D; j++)
+      y[j] = get_random(l[j], u[j]);
+    bool feasible = true;
+    for (unsigned i=0; i< N && feasible; i++)
+      feasible = (VectorNd::dot(A.row(i), y) <= b[i]);
+    if (feasible)
+      EXPECT_LE(c.dot(y), opt + 1e-8);
+  }
+}
+
+TEST(LP, LeastSquares)
+{
+  // find the point in the unit cube closest to (2, 0.5, -3)
+  MatrixNd A = MatrixNd::zero(6,3);
+  VectorNd b(6), e(3), x;
+  for (unsigned i=0; i< 3; i++)
+  {
+    A(i*2,i) = 1.0;
+    A(i*2+1,i) = -1.0;
+    b[i*2] = b[i*2+1] = 1.0;
+  }
+  MatrixNd C = MatrixNd::zero(3,3);
+  C(0,0) = C(1,1) = C(2,2) = 1.0;
+  e[0] = -2.0;  e[1] = -0.5;  e[2] = 3.0;
+  ASSERT_TRUE(LP::lsq_seidel(A, b, C, e, x));
+  EXPECT_NEAR(x[0], 1.0, 1e-8);
+  EXPECT_NEAR(x[1], 0.5, 1e-8);
+  EXPECT_NEAR(x[2], -1.0, 1e-8);
+}
+
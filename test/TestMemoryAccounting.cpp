@@ -0,0 +1,78 @@
+#include <Moby/MemoryAccounting.h>
+#include "gtest/gtest.h"
+
+using namespace Moby;
+
+// this test must be built with MEMORY_ACCOUNTING
+TEST(MemoryAccounting, Enabled)
+{
+  EXPECT_TRUE(MemoryAccounting::enabled());
+}
+
+// an allocation is charged to the current subsystem and credited back to it,
+// even if it is freed outside of the subsystem's scope
+TEST(MemoryAccounting, ChargeAndCredit)
+{
+  const size_t N = 1000;
+  const size_t BEFORE = MemoryAccounting::get_bytes(MemoryAccounting::eSolver);
+  const size_t OTHER = MemoryAccounting::get_bytes(MemoryAccounting::eIO);
+
+  char* p;
+  {
+    MemoryAccounting::Scope mem_scope(MemoryAccounting::eSolver);
+    EXPECT_EQ(MemoryAccounting::get_current(), MemoryAccounting::eSolver);
+    p = new char[N];
+  }
+  EXPECT_EQ(MemoryAccounting::get_current(), MemoryAccounting::eOther);
+  EXPECT_EQ(MemoryAccounting::get_bytes(MemoryAccounting::eSolver), BEFORE + N);
+
+  {
+    MemoryAccounting::Scope mem_scope(MemoryAccounting::eIO);
+    delete [] p;
+  }
+  EXPECT_EQ(MemoryAccounting::get_bytes(MemoryAccounting::eSolver), BEFORE);
+  EXPECT_EQ(MemoryAccounting::get_bytes(MemoryAccounting::eIO), OTHER);
+}
+
+// the peaks are reset to the current allocations, so each "step" reports
+// its own peak
+TEST(MemoryAccounting, ResetPeaks)
+{
+  const size_t BEFORE = MemoryAccounting::get_bytes(MemoryAccounting::eSolver);
+  const size_t STEP_BYTES[2] = { 5000, 100 };
+
+  for (unsigned i=0; i< 2; i++)
+  {
+    MemoryAccounting::reset_peaks();
+    EXPECT_EQ(MemoryAccounting::get_peak_bytes(MemoryAccounting::eSolver), BEFORE);
+
+    // "step"
+    {
+      MemoryAccounting::Scope mem_scope(MemoryAccounting::eSolver);
+      char* p = new char[STEP_BYTES[i]];
+      delete [] p;
+    }
+
+    EXPECT_EQ(MemoryAccounting::get_bytes(MemoryAccounting::eSolver), BEFORE);
+    EXPECT_EQ(MemoryAccounting::get_peak_bytes(MemoryAccounting::eSolver), BEFORE + STEP_BYTES[i]);
+  }
+}
+
+#if __cplusplus >= 201703L
+// over-aligned allocations are charged and aligned
+TEST(MemoryAccounting, Aligned)
+{
+  struct alignas(64) Block { char data[64]; };
+  const size_t BEFORE = MemoryAccounting::get_bytes(MemoryAccounting::eSolver);
+
+  Block* b;
+  {
+    MemoryAccounting::Scope mem_scope(MemoryAccounting::eSolver);
+    b = new Block[3];
+  }
+  EXPECT_EQ((size_t) b % 64, (size_t) 0);
+  EXPECT_GE(MemoryAccounting::get_bytes(MemoryAccounting::eSolver), BEFORE + 3*sizeof(Block));
+  delete [] b;
+  EXPECT_EQ(MemoryAccounting::get_bytes(MemoryAccounting::eSolver), BEFORE);
+}
+#endif
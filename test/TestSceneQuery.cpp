@@ -0,0 +1,170 @@
+#include <cmath>
+#include <boost/shared_ptr.hpp>
+#include <Moby/RigidBody.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/SpherePrimitive.h>
+#include <Moby/PlanePrimitive.h>
+#include <Moby/CCD.h>
+#include "gtest/gtest.h"
+
+using boost::shared_ptr;
+using std::vector;
+using namespace Ravelin;
+using namespace Moby;
+
+// creates a rigid body with a unit sphere centered at x
+static RigidBodyPtr create_sphere(double x, unsigned group)
+{
+  RigidBodyPtr rb(new RigidBody);
+  Pose3d P;
+  P.x = Origin3d(x, 0.0, 0.0);
+  rb->set_pose(P);
+
+  CollisionGeometryPtr cg(new CollisionGeometry);
+  cg->set_single_body(rb);
+  cg->set_geometry(PrimitivePtr(new SpherePrimitive(1.0)));
+  cg->collision_group = group;
+  rb->geometries.push_back(cg);
+  return rb;
+}
+
+class SceneQueryTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      coldet = shared_ptr<CCD>(new CCD);
+      for (unsigned i=0; i< 10; i++)
+      {
+        spheres.push_back(create_sphere(5.0*i, (i % 2 == 0) ? 1 : 2));
+        bodies.push_back(spheres.back());
+      }
+    }
+
+    shared_ptr<CCD> coldet;
+    vector<RigidBodyPtr> spheres;
+    vector<ControlledBodyPtr> bodies;
+};
+
+TEST_F(SceneQueryTest, Rays)
+{
+  const double TOL = 1e-5;
+
+  // cast a ray from the left of every sphere toward +x and one that misses
+  vector<Point3d> origins;
+  vector<Vector3d> dirs;
+  for (unsigned i=0; i< spheres.size(); i++)
+  {
+    origins.push_back(Point3d(5.0*i - 2.0, 0.0, 0.0, GLOBAL));
+    dirs.push_back(Vector3d(1.0, 0.0, 0.0, GLOBAL));
+  }
+  origins.push_back(Point3d(0.0, 2.0, 0.0, GLOBAL));
+  dirs.push_back(Vector3d(1.0, 0.0, 0.0, GLOBAL));
+
+  SceneQueryResults results;
+  coldet->cast_rays(bodies, origins, dirs, 100.0, results);
+  ASSERT_EQ(results.size(), (unsigned) origins.size());
+  for (unsigned i=0; i< spheres.size(); i++)
+  {
+    ASSERT_TRUE(results.geoms[i]);
+    EXPECT_EQ(results.geoms[i], spheres[i]->geometries.front());
+    EXPECT_NEAR(results.t[i], 1.0, TOL);
+    EXPECT_NEAR(results.points[i][0], 5.0*i - 1.0, TOL);
+    EXPECT_NEAR(results.normals[i][0], -1.0, TOL);
+  }
+  EXPECT_FALSE(results.geoms.back());
+
+  // only query the second collision group
+  coldet->cast_rays(bodies, origins, dirs, 100.0, results, 2);
+  EXPECT_EQ(results.geoms[0], spheres[1]->geometries.front());
+  EXPECT_NEAR(results.t[0], 5.0, TOL);
+}
+
+TEST_F(SceneQueryTest, Spheres)
+{
+  const double TOL = 1e-5;
+
+  // sweep a sphere of radius 0.5 past the first sphere
+  vector<LineSeg3> segs(1);
+  segs[0].first = Point3d(-5.0, 0.0, 0.0, GLOBAL);
+  segs[0].second = Point3d(5.0, 0.0, 0.0, GLOBAL);
+
+  SceneQueryResults results;
+  coldet->cast_spheres(bodies, segs, 0.5, results);
+  ASSERT_TRUE(results.geoms[0]);
+  EXPECT_EQ(results.geoms[0], spheres[0]->geometries.front());
+  EXPECT_NEAR(results.t[0], 0.35, TOL);
+
+  // the box with half-length 0.5 along x first touches at the same point
+  coldet->cast_boxes(bodies, segs, Origin3d(0.5, 0.1, 0.1), Quatd::identity(), results);
+  ASSERT_TRUE(results.geoms[0]);
+  EXPECT_NEAR(results.t[0], 0.35, 1e-2);
+}
+
+TEST_F(SceneQueryTest, PointDistances)
+{
+  const double TOL = 1e-8;
+
+  vector<Point3d> points;
+  points.push_back(Point3d(2.5, 0.0, 0.0, GLOBAL));
+  points.push_back(Point3d(10.5, 0.0, 0.0, GLOBAL));
+  points.push_back(Point3d(0.0, 100.0, 0.0, GLOBAL));
+
+  SceneQueryResults results;
+  coldet->calc_point_distances(bodies, points, 10.0, results);
+  EXPECT_NEAR(results.t[0], 1.5, TOL);
+  EXPECT_EQ(results.geoms[1], spheres[2]->geometries.front());
+  EXPECT_NEAR(results.t[1], -0.5, TOL);
+  EXPECT_FALSE(results.geoms[2]);
+}
+
+TEST_F(SceneQueryTest, GrazingRayHitsPlane)
+{
+  const double TOL = 1e-5;
+
+  // add a plane below the spheres
+  RigidBodyPtr rb(new RigidBody);
+  Pose3d P;
+  P.x = Origin3d(0.0, -10.0, 0.0);
+  rb->set_pose(P);
+  CollisionGeometryPtr cg(new CollisionGeometry);
+  cg->set_single_body(rb);
+  cg->set_geometry(PrimitivePtr(new PlanePrimitive));
+  rb->geometries.push_back(cg);
+  bodies.push_back(rb);
+
+  // cast a ray that descends one unit over a thousand
+  vector<Point3d> origins(1, Point3d(0.0, -9.0, 0.0, GLOBAL));
+  vector<Vector3d> dirs(1, Vector3d(1000.0, -1.0, 0.0, GLOBAL));
+  SceneQueryResults results;
+  coldet->cast_rays(bodies, origins, dirs, 2000.0, results);
+  ASSERT_TRUE(results.geoms[0]);
+  EXPECT_EQ(results.geoms[0], cg);
+  EXPECT_NEAR(results.t[0], std::sqrt(1000.0*1000.0 + 1.0), TOL);
+  EXPECT_NEAR(results.points[0][1], -10.0, TOL);
+}
+
+TEST_F(SceneQueryTest, SceneFollowsChanges)
+{
+  const double TOL = 1e-8;
+
+  vector<Point3d> points(1, Point3d(0.5, 0.0, 0.0, GLOBAL));
+  SceneQueryResults results;
+  coldet->calc_point_distances(bodies, points, 10.0, results);
+  EXPECT_EQ(results.geoms[0], spheres[0]->geometries.front());
+  EXPECT_NEAR(results.t[0], -0.5, TOL);
+
+  // move the first sphere; the next batch must see it at its new pose
+  Pose3d P;
+  P.x = Origin3d(0.5, 3.0, 0.0);
+  spheres[0]->set_pose(P);
+  coldet->calc_point_distances(bodies, points, 10.0, results);
+  EXPECT_EQ(results.geoms[0], spheres[0]->geometries.front());
+  EXPECT_NEAR(results.t[0], 2.0, TOL);
+
+  // remove the first sphere; the next batch must not see it
+  bodies.erase(bodies.begin());
+  coldet->calc_point_distances(bodies, points, 10.0, results);
+  EXPECT_EQ(results.geoms[0], spheres[1]->geometries.front());
+  EXPECT_NEAR(results.t[0], 3.5, TOL);
+}
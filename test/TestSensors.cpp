@@ -0,0 +1,73 @@
+#include <Moby/XMLReader.h>
+#include <Moby/TimeSteppingSimulator.h>
+#include <Moby/RigidBody.h>
+#include <Moby/ContactSensor.h>
+#include <Moby/ForceTorqueSensor.h>
+#include "gtest/gtest.h"
+
+using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
+using std::map;
+using std::vector;
+using namespace Ravelin;
+using namespace Moby;
+
+template <class T>
+static void find(const map<std::string, BasePtr>& read_map, shared_ptr<T>& obj, const std::string& id)
+{
+  for (map<std::string, BasePtr>::const_iterator i = read_map.begin(); i != read_map.end(); i++)
+  {
+     obj = dynamic_pointer_cast<T>(i->second);
+     if (obj && obj->id == id)
+       return;
+  }
+  obj.reset();
+}
+
+// a box resting on a plane must measure its weight
+TEST(Sensors, RestingBox)
+{
+  const double DT = 1e-2;
+  const double GRAV = 9.81;
+  const unsigned N_SETTLE = (unsigned) (2.0/DT), N_MEASURE = 100;
+  shared_ptr<TimeSteppingSimulator> sim;
+  shared_ptr<RigidBody> box;
+
+  // load the box and the simulator
+  map<std::string, BasePtr> READ_MAP = XMLReader::read(std::string("box.xml"));
+  find(READ_MAP, sim, "simulator");
+  find(READ_MAP, box, "box");
+  ASSERT_TRUE(sim);
+  ASSERT_TRUE(box);
+
+  // attach a contact sensor and a force/torque sensor to the box
+  shared_ptr<ContactSensor> cs(new ContactSensor);
+  shared_ptr<ForceTorqueSensor> fts(new ForceTorqueSensor);
+  cs->set_body(box);
+  cs->set_capacity(256);
+  fts->set_body(box);
+  sim->sensors.push_back(cs);
+  sim->sensors.push_back(fts);
+
+  // let the box come to rest
+  for (unsigned i=0; i< N_SETTLE; i++)
+    sim->step(DT);
+
+  // measure the contact force
+  const double WEIGHT = box->get_inertia().m * GRAV;
+  double ft_sum = 0.0, cs_sum = 0.0;
+  for (unsigned i=0; i< N_MEASURE; i++)
+  {
+    sim->step(DT);
+
+    // the sensor frame is aligned with the (unrotated) box
+    ft_sum += fts->get_wrench().get_force()[1];
+
+    ASSERT_EQ(cs->num_dropped(), (unsigned) 0);
+    for (unsigned j=0; j< cs->num_contacts(); j++)
+      cs_sum += cs->get_forces()[j][1];
+  }
+
+  EXPECT_NEAR(ft_sum/N_MEASURE, WEIGHT, 1e-2*WEIGHT);
+  EXPECT_NEAR(cs_sum/N_MEASURE, WEIGHT, 1e-2*WEIGHT);
+}
@@ -221,3 +221,99 @@ TEST(MultTranspose, Matrix)
       EXPECT_NEAR(result_dense(i,j), result_sparse(i,j), 1e-6);
 }
 
+
+TEST(CSR, Conversion)
+{
+  MatrixNd J, J_csr;
+  SparseJacobian Js;
+  CSRMatrix Jc;
+
+  // setup the sparse Jacobian (with overlapping blocks)
+  Js.rows = 10;
+  Js.cols = 20;
+  for (unsigned i=0; i< 10; i++)
+  {
+    Js.blocks.push_back(MatrixBlock());
+    Js.blocks.back().block.resize(1,10);
+    Js.blocks.back().st_row_idx = i;
+    Js.blocks.back().st_col_idx = i;
+    for (unsigned j=0; j< 10; j++)
+      Js.blocks.back().block(0,j) = (double) rand()/RAND_MAX;
+  }
+
+  // the dense version sums overlapping blocks (like mult())
+  MatrixNd I = MatrixNd::identity(20);
+  Js.mult(I, J);
+
+  // convert to CSR and back
+  Js.to_csr(Jc);
+  J_csr.set_zero(Jc.rows, Jc.cols);
+  for (unsigned i=0; i< Jc.rows; i++)
+    for (unsigned k=Jc.row_ptr[i]; k< Jc.row_ptr[i+1]; k++)
+    {
+      if (k > Jc.row_ptr[i])
+        EXPECT_LT(Jc.col_idx[k-1], Jc.col_idx[k]);
+      J_csr(i, Jc.col_idx[k]) = Jc.values[k];
+    }
+
+  // check the results
+  for (unsigned i=0; i< J.rows(); i++)
+    for (unsigned j=0; j< J.columns(); j++)
+      EXPECT_NEAR(J(i,j), J_csr(i,j), 1e-6);
+}
+
+TEST(CSR, MultInertiaTranspose)
+{
+  MatrixNd J;
+  SparseJacobian Js;
+
+  // setup the sparse Jacobian
+  J.set_zero(10, 20);
+  Js.rows = 10;
+  Js.cols = 20;
+  for (unsigned i=0; i< 10; i++)
+  {
+    Js.blocks.push_back(MatrixBlock());
+    Js.blocks.back().block.resize(1,4);
+    Js.blocks.back().st_row_idx = i;
+    Js.blocks.back().st_col_idx = i*2;
+    for (unsigned j=0; j< 4; j++)
+    {
+      Js.blocks.back().block(0,j) = (double) rand()/RAND_MAX;
+      J(i,j+i*2) = Js.blocks.back().block(0,j);
+    }
+  }
+
+  // setup 10 2x2 (block diagonal) matrices 
+  MatrixNd iM = MatrixNd::zero(20,20);
+  vector<MatrixBlock> x;
+  for (unsigned i=0; i< 10; i++)
+  {
+    x.push_back(MatrixBlock());
+    x[i].st_row_idx = i*2;
+    x[i].st_col_idx = i*2;
+    x[i].block.resize(2,2);
+    for (unsigned j=0; j< 2; j++)
+      for (unsigned k=0; k< 2; k++)
+        x[i].block(j,k) = (double) rand() / RAND_MAX;
+    iM.block(i*2, i*2+2, i*2, i*2+2) = x[i].block;
+  }
+
+  // do the dense version
+  MatrixNd J_iM, result_dense;
+  J.mult(iM, J_iM);
+  J_iM.mult_transpose(J, result_dense);
+
+  // do the sparse version
+  CSRMatrix result_sparse;
+  Js.calc_J_iM_JT(x, result_sparse);
+  MatrixNd result_sparse_dense = MatrixNd::zero(10,10);
+  for (unsigned i=0; i< result_sparse.rows; i++)
+    for (unsigned k=result_sparse.row_ptr[i]; k< result_sparse.row_ptr[i+1]; k++)
+      result_sparse_dense(i, result_sparse.col_idx[k]) = result_sparse.values[k];
+
+  // check the results
+  for (unsigned i=0; i< result_dense.rows(); i++)
+    for (unsigned j=0; j< result_dense.columns(); j++)
+      EXPECT_NEAR(result_dense(i,j), result_sparse_dense(i,j), 1e-6);
+}
@@ -0,0 +1,96 @@
+#include <Moby/SparseLDLT.h>
+#include "gtest/gtest.h"
+
+using std::vector;
+using namespace Ravelin;
+using namespace Moby;
+
+// converts a dense symmetric matrix to CSR format (keeping only nonzeros)
+static void to_csr(const MatrixNd& A, CSRMatrix& Ac)
+{
+  Ac.rows = A.rows();
+  Ac.cols = A.columns();
+  Ac.row_ptr.clear();
+  Ac.col_idx.clear();
+  Ac.values.clear();
+  Ac.row_ptr.push_back(0);
+  for (unsigned i=0; i< A.rows(); i++)
+  {
+    for (unsigned j=0; j< A.columns(); j++)
+      if (A(i,j) != 0.0)
+      {
+        Ac.col_idx.push_back(j);
+        Ac.values.push_back(A(i,j));
+      }
+    Ac.row_ptr.push_back(Ac.col_idx.size());
+  }
+}
+
+TEST(SparseLDLT, Random)
+{
+  const unsigned N = 30;
+
+  // setup a random, sparse, symmetric, diagonally dominant matrix
+  MatrixNd A = MatrixNd::zero(N,N);
+  for (unsigned i=0; i< N; i++)
+  {
+    A(i,i) = (double) N;
+    for (unsigned j=0; j< i; j++)
+      if (rand() % 5 == 0)
+        A(i,j) = A(j,i) = (double) rand()/RAND_MAX - 0.5;
+  }
+  CSRMatrix Ac;
+  to_csr(A, Ac);
+
+  // factor twice (the second factorization reuses the symbolic analysis)
+  SparseLDLT ldlt;
+  for (unsigned k=0; k< 2; k++)
+  {
+    ASSERT_TRUE(ldlt.factor(Ac));
+
+    // solve and check the residual
+    VectorNd b(N), x, r;
+    for (unsigned i=0; i< N; i++)
+      b[i] = (double) rand()/RAND_MAX;
+    x = b;
+    ldlt.solve(x);
+    A.mult(x, r) -= b;
+    EXPECT_NEAR(r.norm(), 0.0, 1e-8);
+
+    // change the values, but not the pattern
+    for (unsigned i=0; i< Ac.values.size(); i++)
+      Ac.values[i] *= 2.0;
+    A *= 2.0;
+  }
+}
+
+TEST(SparseLDLT, ChainHasNoFill)
+{
+  const unsigned N = 100;
+
+  // setup a tridiagonal matrix (a chain) 
+  MatrixNd A = MatrixNd::zero(N,N);
+  for (unsigned i=0; i< N; i++)
+  {
+    A(i,i) = 4.0;
+    if (i > 0)
+      A(i,i-1) = A(i-1,i) = -1.0;
+  }
+  CSRMatrix Ac;
+  to_csr(A, Ac);
+
+  SparseLDLT ldlt;
+  ASSERT_TRUE(ldlt.factor(Ac));
+  EXPECT_EQ(ldlt.nnz_L(), N-1);
+}
+
+TEST(SparseLDLT, Singular)
+{
+  MatrixNd A(2,2);
+  A(0,0) = A(0,1) = A(1,0) = A(1,1) = 1.0;
+  CSRMatrix Ac;
+  to_csr(A, Ac);
+
+  SparseLDLT ldlt;
+  EXPECT_FALSE(ldlt.factor(Ac));
+}
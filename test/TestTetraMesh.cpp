@@ -0,0 +1,139 @@
+#include <cmath>
+#include <cstdlib>
+#include <boost/shared_ptr.hpp>
+#include <Moby/RigidBody.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/TetraMeshPrimitive.h>
+#include <Moby/BoxPrimitive.h>
+#include "gtest/gtest.h"
+
+using boost::shared_ptr;
+using std::vector;
+using namespace Ravelin;
+using namespace Moby;
+
+static double get_random(double r_min, double r_max)
+{
+  return (r_max-r_min) * ((double) rand() / (double) RAND_MAX) + r_min;
+}
+
+// creates a unit cube from twelve tetrahedra that share a vertex at the center
+static shared_ptr<const IndexedTetraArray> create_cube()
+{
+  vector<Origin3d> verts;
+  for (unsigned i=0; i< 8; i++)
+    verts.push_back(Origin3d((i & 1) ? 0.5 : -0.5, (i & 2) ? 0.5 : -0.5, (i & 4) ? 0.5 : -0.5));
+  verts.push_back(Origin3d(0.0, 0.0, 0.0));
+
+  const unsigned QUADS[6][4] = { { 0, 2, 6, 4 }, { 1, 3, 7, 5 }, { 0, 1, 5, 4 },
+                                 { 2, 3, 7, 6 }, { 0, 1, 3, 2 }, { 4, 5, 7, 6 } };
+  vector<IndexedTetra> tetra;
+  for (unsigned i=0; i< 6; i++)
+  {
+    tetra.push_back(IndexedTetra(QUADS[i][0], QUADS[i][1], QUADS[i][2], 8));
+    tetra.push_back(IndexedTetra(QUADS[i][0], QUADS[i][2], QUADS[i][3], 8));
+  }
+
+  return shared_ptr<const IndexedTetraArray>(new IndexedTetraArray(verts.begin(), verts.end(), tetra.begin(), tetra.end()));
+}
+
+// signed distance to the unit cube (exact in the interior)
+static double cube_distance(const Point3d& p)
+{
+  return std::max(std::fabs(p[0]), std::max(std::fabs(p[1]), std::fabs(p[2]))) - 0.5;
+}
+
+class TetraMeshTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      tm = shared_ptr<TetraMeshPrimitive>(new TetraMeshPrimitive);
+      tm->set_tetra_mesh(create_cube());
+      rb = RigidBodyPtr(new RigidBody);
+      cg = CollisionGeometryPtr(new CollisionGeometry);
+      cg->set_single_body(rb);
+      cg->set_geometry(tm);
+      P = tm->get_pose(cg);
+    }
+
+    shared_ptr<TetraMeshPrimitive> tm;
+    RigidBodyPtr rb;
+    CollisionGeometryPtr cg;
+    shared_ptr<const Pose3d> P;
+};
+
+TEST_F(TetraMeshTest, Boundary)
+{
+  EXPECT_EQ(tm->get_mesh(P)->num_tris(), (unsigned) 12);
+
+  vector<Point3d> verts;
+  tm->get_vertices(P, verts);
+  EXPECT_EQ(verts.size(), (unsigned) 8);
+
+  // only the center vertex is in the interior
+  EXPECT_NEAR(tm->get_vertex_distances()[8], -0.5, 1e-10);
+}
+
+TEST_F(TetraMeshTest, Penetration)
+{
+  const double TOL = 1e-8;
+
+  for (unsigned i=0; i< 1000; i++)
+  {
+    Point3d p(get_random(-0.5, 0.5), get_random(-0.5, 0.5), get_random(-0.5, 0.5), P);
+    vector<Vector3d> normals;
+    double dist = tm->calc_dist_and_normal(p, normals);
+    ASSERT_EQ(normals.size(), (unsigned) 1);
+    EXPECT_NEAR(dist, cube_distance(p), TOL);
+
+    // the normal is the axis of greatest magnitude
+    unsigned axis = (std::fabs(p[0]) > std::fabs(p[1])) ? ((std::fabs(p[0]) > std::fabs(p[2])) ? 0 : 2) : ((std::fabs(p[1]) > std::fabs(p[2])) ? 1 : 2);
+    EXPECT_NEAR(normals.front()[axis], (p[axis] > 0.0) ? 1.0 : -1.0, TOL);
+  }
+}
+
+TEST_F(TetraMeshTest, Outside)
+{
+  vector<Vector3d> normals;
+  double dist = tm->calc_dist_and_normal(Point3d(1.0, 0.0, 0.0, P), normals);
+  EXPECT_NEAR(dist, 0.5, 1e-10);
+  EXPECT_NEAR(normals.front()[0], 1.0, 1e-10);
+
+  // distance to a corner
+  dist = tm->calc_signed_dist(Point3d(1.0, 1.0, 1.0, P));
+  EXPECT_NEAR(dist, std::sqrt(0.75), 1e-10);
+}
+
+TEST_F(TetraMeshTest, MassProperties)
+{
+  tm->set_density(1.0);
+  const SpatialRBInertiad& J = tm->get_inertia();
+  EXPECT_NEAR(J.m, 1.0, 1e-10);
+  for (unsigned i=0; i< 3; i++)
+    for (unsigned j=0; j< 3; j++)
+      EXPECT_NEAR(J.J(i,j), (i == j) ? 1.0/6.0 : 0.0, 1e-10);
+}
+
+TEST_F(TetraMeshTest, BoxDistance)
+{
+  const double TOL = 1e-8;
+
+  // setup a box with half-lengths of 0.25
+  shared_ptr<BoxPrimitive> box(new BoxPrimitive(0.5, 0.5, 0.5));
+  RigidBodyPtr box_rb(new RigidBody);
+  CollisionGeometryPtr box_cg(new CollisionGeometry);
+  box_cg->set_single_body(box_rb);
+  box_cg->set_geometry(box);
+
+  // separated: the nearest box vertices are 0.25 from the cube
+  Point3d pbox, ptm;
+  box_rb->set_pose(Pose3d(Quatd::identity(), Origin3d(1.0, 0.0, 0.0)));
+  EXPECT_NEAR(CollisionGeometry::calc_signed_dist(box_cg, cg, pbox, ptm), 0.25, TOL);
+  EXPECT_NEAR(CollisionGeometry::calc_signed_dist(cg, box_cg, ptm, pbox), 0.25, TOL);
+
+  // penetrating: the deepest box vertices are 0.125 inside the cube
+  box_rb->set_pose(Pose3d(Quatd::identity(), Origin3d(0.625, 0.0, 0.0)));
+  EXPECT_NEAR(CollisionGeometry::calc_signed_dist(box_cg, cg, pbox, ptm), -0.125, TOL);
+  EXPECT_NEAR(Pose3d::transform_point(GLOBAL, pbox)[0], 0.375, TOL);
+}